@@ -0,0 +1,122 @@
+#!/bin/bash
+#
+# ECE 521 - Computer Design Techniques, Fall 2014
+# Project 1B - Victim Cache and L2 Cache Simulator
+#
+# Shell script to benchmark the simulator; run by "make bench". It runs the
+# microbenchmarks (sim_cache_bench) and then times sim_cache_opt end to end
+# over the bundled traces and a few large synthetic ones from sim_tracegen,
+# for a set of representative configurations. Every result is one CSV line:
+#   suite,name,config,ops,seconds,ops_per_sec
+# where ops are references for the end-to-end runs. The lines go to the
+# console and to the given output file.
+#
+# Environment:
+#   BENCH_OPS   ops per microbenchmark (default 10000000)
+#   BENCH_REFS  references per synthetic trace (default 2000000)
+#   BENCH_REPS  runs per end-to-end benchmark; the fastest counts (default 3)
+#
+# Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+#
+
+
+NUM_PARAMS=1
+TRACE_DIR=../docs
+TRACES="gcc go perl vortex"
+SYN_DIR=bench_traces
+BENCH_OPS=${BENCH_OPS:-10000000}
+BENCH_REFS=${BENCH_REFS:-2000000}
+BENCH_REPS=${BENCH_REPS:-3}
+
+# Representative configurations: L1 only, L1 + VC, L1 + L2, L1 + VC + L2.
+CONFIGS=(
+    "32 8192 4 0 0 0"
+    "32 8192 4 1024 0 0"
+    "64 32768 8 0 262144 16"
+    "32 8192 4 1024 262144 8"
+)
+
+
+function print_usage()
+{
+    echo "Usage: $0 <output-csv-file>"
+    echo "Example: $0 bench_results.csv"
+}
+
+
+# Writes a synthetic trace: <name> <# of refs>; same trace on every run.
+function gen_trace()
+{
+    local pattern
+
+    case $1 in
+        stream)  pattern="--pattern=stream" ;;
+        random)  pattern="--pattern=random,stride=4" ;;
+        hotcold) pattern="--pattern=random,stride=4,footprint=32K,weight=9
+                          --pattern=random,stride=4" ;;
+        zipf)    pattern="--pattern=zipf" ;;
+        chase)   pattern="--pattern=chase,footprint=1M" ;;
+    esac
+
+    ./sim_tracegen --refs=$2 --footprint=64M --writes=30 $pattern \
+        --out=$SYN_DIR/$1_$2.txt
+}
+
+
+# Times a run of sim_cache_opt: <trace> <config>; prints the CSV line.
+function run_e2e()
+{
+    local trace=$1
+    local config=$2
+    local refs=$(cat $trace | wc -l)
+    local best=""
+    local rep start end secs
+
+    for ((rep = 0; rep < BENCH_REPS; ++rep)); do
+        start=$(date +%s%N)
+        ./sim_cache_opt $config $trace > /dev/null || return 1
+        end=$(date +%s%N)
+        secs=$(( end - start ))
+        if [ -z "$best" ] || [ $secs -lt $best ]; then
+            best=$secs
+        fi
+    done
+
+    awk -v name=$(basename $trace .txt) -v config="$config" -v refs=$refs \
+        -v ns=$best 'BEGIN {
+            gsub(" ", "/", config);
+            printf("e2e,%s,%s,%u,%.6f,%.0f\n", name, config, refs,
+                ns / 1e9, ((ns > 0) ? (refs * 1e9 / ns) : 0));
+        }'
+}
+
+
+function run_bench()
+{
+    local trace config
+
+    ./sim_cache_bench $BENCH_OPS || return 1
+
+    mkdir -p $SYN_DIR
+    for kind in stream random hotcold zipf chase; do
+        if [ ! -f $SYN_DIR/${kind}_$BENCH_REFS.txt ]; then
+            gen_trace $kind $BENCH_REFS
+        fi
+    done
+
+    for trace in $(for name in $TRACES; do echo $TRACE_DIR/${name}_trace.txt;
+            done) $SYN_DIR/*_$BENCH_REFS.txt; do
+        for config in "${CONFIGS[@]}"; do
+            run_e2e $trace "$config" || return 1
+        done
+    done
+}
+
+
+if [ $# -ne $NUM_PARAMS ]; then
+    print_usage
+    exit 1
+fi
+
+run_bench | tee $1
+exit ${PIPESTATUS[0]}
@@ -4,7 +4,7 @@
  *
  * This module contains the majority of the cache implementation, like
  * cache and tagstore init with corresponding cleanup routines, 
- * replacement policy implementation (LRU), cache lookup and so on.
+ * replacement policy hooks, cache lookup and so on.
  *
  * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
  */
@@ -17,18 +17,40 @@
 #include "cache.h"
 #include "cache_utils.h"
 #include "cache_print.h"
+#include "cache_opts.h"
+#include "cache_interval.h"
+#include "cache_prefetch.h"
+#include "cache_repl.h"
+#include "cache_trace.h"
+#include "cache_timing.h"
+#include "cache_coherence.h"
+#include "cache_ring.h"
+#include "cache_arena.h"
+#include "cache_shard.h"
+#include "cache_incl.h"
+#include "cache_fa.h"
+#include "cache_wbb.h"
+#include "cache_ptag.h"
+#include "cache_index.h"
+#include "cache_sector.h"
+#include "cache_model.h"
+#include "cache_results.h"
+#include "cache_prof.h"
+#include "cache_write.h"
 
 /* Globals */
 boolean             g_l2_present = FALSE;       /* l2 cache present?        */
 boolean             g_victim_present = FALSE;   /* victim cache present?    */
+uint32_t            g_num_cores = 1;            /* # of simulated cores     */
 
-cache_generic_t     g_l1_cache;             /* primary l1 cache             */
+/* Every core has its own L1 (and VC); L2 is shared by all of them. */
+cache_generic_t     g_l1_caches[CACHE_MAX_CORES];   /* primary l1 caches    */
 cache_generic_t     g_l2_cache;             /* l2 cache                     */
-cache_generic_t     g_vic_cache;            /* victim cache for L1          */
+cache_generic_t     g_vic_caches[CACHE_MAX_CORES];  /* victim caches for L1 */
 
-cache_tagstore_t    g_l1_cache_ts;          /* primary cache tagstore       */
+cache_tagstore_t    g_l1_caches_ts[CACHE_MAX_CORES];
 cache_tagstore_t    g_l2_cache_ts;          /* l2 cache tagstore            */
-cache_tagstore_t    g_vic_cache_ts;         /* victim cache tagstore        */
+cache_tagstore_t    g_vic_caches_ts[CACHE_MAX_CORES];
 
 uint32_t            g_addr_count;           /* ID for mref from trace file  */
 
@@ -44,11 +66,12 @@ const char          *g_write = "WRITE";     /* mref WRITE type string       */
  * Name:    cache_init
  *
  * Desc:    Init code for cache. It sets up the cache parameters based on
- *          the user given cache configuration.
+ *          the user given cache configuration. Every core gets the same
+ *          private L1 and victim caches.
  *
  * Params:  
- *  l1_cache    ptr to the L1 cache 
- *  vic_cache   ptr to the victim cache
+ *  l1_cache    ptr to the L1 caches, one per core
+ *  vic_cache   ptr to the victim caches, one per core
  *  l2_cache    ptr to the L2 cache
  *  num_args    # of input arguments
  *  input       ptr to input list
@@ -61,6 +84,7 @@ cache_init(cache_generic_t *l1_cache, cache_generic_t *vic_cache,
 {
     char        *trace_file = NULL;
     uint8_t     arg_iter = 1;
+    uint32_t    core = 0;
     uint32_t    blk_size = 0;
     uint32_t    l1_size = 0;
     uint16_t    l1_set_assoc = 0;
@@ -100,8 +124,10 @@ cache_init(cache_generic_t *l1_cache, cache_generic_t *vic_cache,
     l1_cache->level = CACHE_LEVEL_1;
     l1_cache->set_assoc = l1_set_assoc;
     l1_cache->blk_size = blk_size;
-    l1_cache->repl_plcy = CACHE_REPL_PLCY_LRU;
-    l1_cache->write_plcy = CACHE_WRITE_PLCY_WBWA;
+    l1_cache->repl_plcy = g_cache_opts.level[CACHE_OPTS_L1].repl;
+    l1_cache->ptags = g_cache_opts.level[CACHE_OPTS_L1].ptags;
+    l1_cache->index_fn = g_cache_opts.level[CACHE_OPTS_L1].index_fn;
+    l1_cache->write_plcy = g_cache_opts.level[CACHE_OPTS_L1].write_plcy;
     l1_cache->victim_size = victim_size;
     l1_cache->stats.cache = l1_cache;
     dprint_info("%s init successful\n", CACHE_GET_NAME(l1_cache));
@@ -115,7 +141,7 @@ cache_init(cache_generic_t *l1_cache, cache_generic_t *vic_cache,
         vic_cache->size = victim_size;
         vic_cache->level = CACHE_LEVEL_L1_VICTIM;
         vic_cache->blk_size = blk_size;
-        vic_cache->repl_plcy = CACHE_REPL_PLCY_LRU;
+        vic_cache->repl_plcy = g_cache_opts.level[CACHE_OPTS_VC].repl;
         vic_cache->write_plcy = CACHE_WRITE_PLCY_WBWA;
         vic_cache->stats.cache = vic_cache;
         vic_cache->set_assoc = /* VC is a fully associative cache. */
@@ -129,10 +155,13 @@ cache_init(cache_generic_t *l1_cache, cache_generic_t *vic_cache,
         l2_cache->size = l2_size;
         l2_cache->level = CACHE_LEVEL_2;
         l2_cache->set_assoc = l2_set_assoc;
-        l2_cache->blk_size = blk_size;
+        l2_cache->blk_size = (g_cache_opts.level[CACHE_OPTS_L2].blk_size ?
+                g_cache_opts.level[CACHE_OPTS_L2].blk_size : blk_size);
         l2_cache->victim_size = 0;      /* No victim cache for L2 */
-        l2_cache->repl_plcy = CACHE_REPL_PLCY_LRU;
-        l2_cache->write_plcy = CACHE_WRITE_PLCY_WBWA;
+        l2_cache->repl_plcy = g_cache_opts.level[CACHE_OPTS_L2].repl;
+        l2_cache->ptags = g_cache_opts.level[CACHE_OPTS_L2].ptags;
+        l2_cache->index_fn = g_cache_opts.level[CACHE_OPTS_L2].index_fn;
+        l2_cache->write_plcy = g_cache_opts.level[CACHE_OPTS_L2].write_plcy;
         l2_cache->stats.cache = l2_cache;
         dprint_info("%s init successful\n", CACHE_GET_NAME(l2_cache));
     }
@@ -156,6 +185,34 @@ cache_init(cache_generic_t *l1_cache, cache_generic_t *vic_cache,
         l2_cache->next_cache = NULL;
     }
 
+    /*
+     * Rest of the cores are copies of core 0. Their private caches are
+     * linked among themselves; the L2 link back is just for core 0.
+     */
+    for (core = 1; core < g_num_cores; ++core) {
+        memcpy(&l1_cache[core], l1_cache, sizeof(*l1_cache));
+        l1_cache[core].core = core;
+        l1_cache[core].stats.cache = &l1_cache[core];
+
+        if (cache_util_is_victim_present()) {
+            memcpy(&vic_cache[core], vic_cache, sizeof(*vic_cache));
+            vic_cache[core].core = core;
+            vic_cache[core].stats.cache = &vic_cache[core];
+            vic_cache[core].prev_cache = &l1_cache[core];
+            l1_cache[core].next_cache = &vic_cache[core];
+        }
+    }
+
+    /* Tell the cores apart in the output, eg. C3-L1. */
+    for (core = 0; (g_num_cores > 1) && (core < g_num_cores); ++core) {
+        snprintf(l1_cache[core].name, CACHE_NAME_LEN, "C%u-%s",
+                core, g_l1_name);
+        if (cache_util_is_victim_present()) {
+            snprintf(vic_cache[core].name, CACHE_NAME_LEN, "C%u-%s",
+                    core, g_vic_name);
+        }
+    }
+
 exit:
     return;
 }
@@ -167,10 +224,10 @@ exit:
  * Desc:    Init code for a tagstore. Does the following:
  *          1. Calculates all the cache parameters based on the user 
  *              given specifications.
- *          2. Allocated memory for tags and tag_data. This will be a 
- *              contiguous allocation and the data should be accessed bu
- *              either 2D indices or by linearizing the 2D index to an 1D
- *              index. 
+ *          2. Allocated memory for tags and tag_data from the simulation
+ *              arena. This will be a contiguous allocation and the data
+ *              should be accessed by either 2D indices or by linearizing
+ *              the 2D index to an 1D index.
  *              1D_index = block_index + (set_index * blocks_per_set)
  *
  *                             blocks-->
@@ -193,9 +250,11 @@ exit:
  *  cache       ptr to the actual cache
  *  tagstore    ptr to the tagstore to be assoicated with the cache
  *
- * Returns: Nothing
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR if the tagstore can't be set up
  **************************************************************************/
-void
+cache_rv
 cache_tagstore_init(cache_generic_t *cache, cache_tagstore_t *tagstore)
 {
     uint8_t     tag_bits = 0;
@@ -203,11 +262,10 @@ cache_tagstore_init(cache_generic_t *cache, cache_tagstore_t *tagstore)
     uint8_t     blk_offset_bits = 0;
     uint32_t    num_sets = 0;
     uint32_t    num_blocks_per_set = 0;
-    uint32_t    iter = 0;
 
     if ((!cache) || (!tagstore)) {
         cache_assert(0);
-        goto exit;
+        goto error_exit;
     }
 
     /* 
@@ -232,32 +290,68 @@ cache_tagstore_init(cache_generic_t *cache, cache_tagstore_t *tagstore)
     tagstore->num_blocks_per_set = num_blocks_per_set = cache->set_assoc;
     tagstore->num_blocks = num_sets * num_blocks_per_set;
 
-    /* Allocate memory to store indices, tags and tag data. */ 
-    tagstore->lru_block_id = calloc(1, num_sets * sizeof(uint8_t));
-    tagstore->index = 
-        calloc(1, (num_sets * sizeof(uint32_t)));
-    tagstore->tags = 
-        calloc(1, (num_sets * num_blocks_per_set * sizeof (uint32_t)));
-    tagstore->tag_data = 
-        calloc(1, (num_sets * num_blocks_per_set * 
-                    sizeof (*(tagstore->tag_data))));
-    tagstore->set_ref_count = calloc(1, (num_sets * sizeof(uint32_t)));
-
-    if ((!tagstore->index) || (!tagstore->tags) || (!tagstore->tag_data)) {
+    /* Carve the tags and tag data out of the simulation arena. */ 
+    tagstore->tags = cache_arena_calloc((num_sets * num_blocks_per_set),
+            sizeof(uint32_t));
+    tagstore->tag_data = cache_arena_calloc((num_sets * num_blocks_per_set),
+            sizeof(*(tagstore->tag_data)));
+
+    /* Sectored blocks have a valid and a dirty bit per sector as well. */
+    tagstore->num_sector_bits = blk_offset_bits;
+    tagstore->sec_valid = tagstore->sec_dirty = NULL;
+    if (cache->num_sectors > 1) {
+        tagstore->num_sector_bits -= util_log_base_2(cache->num_sectors);
+        tagstore->sec_valid = cache_arena_calloc(tagstore->num_blocks,
+                sizeof(uint32_t));
+        tagstore->sec_dirty = cache_arena_calloc(tagstore->num_blocks,
+                sizeof(uint32_t));
+    }
+
+    if ((!tagstore->tags) || (!tagstore->tag_data) ||
+            ((cache->num_sectors > 1) &&
+             ((!tagstore->sec_valid) || (!tagstore->sec_dirty)))) {
         dprint("Error: Unable to allocate memory for cache %s tagstore.\n",
                 CACHE_GET_NAME(cache));
         cache_assert(0);
-        goto fatal_exit;
+        goto error_exit;
     }
 
-    /* Initialize indices. */
-    for (iter = 0; iter < num_sets; ++iter)
-        tagstore->index[iter] = iter;
-
     /* Assoicate the tagstore to the given cache and vice-versa. */
     cache->tagstore = tagstore;
     tagstore->cache = cache;
 
+    /* Pick the set index function; the VC never has conflict counters. */
+    if (CACHE_RV_OK != cache_index_init(tagstore, cache->index_fn,
+                ((g_cache_opts.set_stats) && (!CACHE_IS_VC(cache))))) {
+        dprint("Error: Unable to allocate memory for cache %s set stats.\n",
+                CACHE_GET_NAME(cache));
+        goto error_exit;
+    }
+
+    /* A single set (eg. VC) is looked up through a tag index. */
+    tagstore->fa = NULL;
+    if ((1 == num_sets) && (CACHE_RV_OK != cache_fa_init(tagstore))) {
+        dprint("Error: Unable to allocate memory for cache %s tag index.\n",
+                CACHE_GET_NAME(cache));
+        goto error_exit;
+    }
+
+    /* The other sets get a partial tag filter, if asked for. */
+    tagstore->ptag = NULL;
+    if ((CACHE_PTAGS_ON == cache->ptags) && (!tagstore->fa) &&
+            (CACHE_RV_OK != cache_ptag_init(tagstore))) {
+        dprint("Error: Unable to allocate memory for cache %s partial "
+                "tags.\n", CACHE_GET_NAME(cache));
+        goto error_exit;
+    }
+
+    /* Bind the replacement policy; it allocates its own state. */
+    if (CACHE_RV_OK != cache_repl_init(tagstore, cache->repl_plcy)) {
+        dprint("Error: Unable to set up %s replacement for cache %s.\n",
+                g_cache_repl_names[cache->repl_plcy], CACHE_GET_NAME(cache));
+        goto error_exit;
+    }
+
 #ifdef DBG_ON
     dprint_info("printing ts data for %s\n", CACHE_GET_NAME(cache));
     cache_print_tagstore(cache);
@@ -265,12 +359,10 @@ cache_tagstore_init(cache_generic_t *cache, cache_tagstore_t *tagstore)
 
     dprint_info("%s, tagstore init successful\n", CACHE_GET_NAME(cache));
 
-exit:
-    return;
+    return CACHE_RV_OK;
 
-fatal_exit:
-    /* Fatal exit. Quit the program. */
-    exit(-1);
+error_exit:
+    return CACHE_RV_ERR;
 }
 
 
@@ -292,8 +384,14 @@ cache_cleanup(cache_generic_t *cache)
         goto exit;
     }
 
-    /* First cleanup the tagstore and then the actual cache. */
-    cache_tagstore_cleanup(cache, cache->tagstore);
+    /*
+     * First cleanup the tagstore and then the actual cache. Caches of a
+     * sharded run have no tagstore; the shards have their own.
+     */
+    cache_pf_cleanup(cache);
+    cache_wbb_cleanup(cache);
+    if (cache->tagstore)
+        cache_tagstore_cleanup(cache, cache->tagstore);
     memset(cache, 0, sizeof(*cache));
 
 exit:
@@ -304,7 +402,9 @@ exit:
 /*************************************************************************** 
  * Name:    cache_tagstore_cleanup
  *
- * Desc:    Cleanup code for tagstore. Frees all allocated memory.
+ * Desc:    Cleanup code for tagstore. The arrays are part of the
+ *          simulation arena and go away with it; only the replacement
+ *          state kept outside of the arena is freed here.
  *
  * Params:
  *  cache       ptr to the cache to which the current tagstore is part of
@@ -320,21 +420,7 @@ cache_tagstore_cleanup(cache_generic_t *cache, cache_tagstore_t *tagstore)
         goto exit;
     }
 
-    if (tagstore->lru_block_id)
-        free(tagstore->lru_block_id);
-
-    if (tagstore->index)
-        free(tagstore->index);
-
-    if (tagstore->tags)
-        free(tagstore->tags);
-
-    if (tagstore->tag_data)
-        free(tagstore->tag_data);
-
-    if (tagstore->set_ref_count)
-        free(tagstore->set_ref_count);
-
+    cache_repl_cleanup(tagstore);
     memset(tagstore, 0, sizeof(*tagstore));
 
 exit:
@@ -343,134 +429,112 @@ exit:
 
 
 /*************************************************************************** 
- * Name:    cache_get_lru_block
+ * Name:    cache_tagstore_fill
  *
- * Desc:    Returns the LRU block ID for the given set.
+ * Desc:    Reports a new block, already written to the tag array and made
+ *          valid, to the replacement policy, the tag index, the partial
+ *          tag filter and the set conflict counters.
  *
  * Params:
  *  tagstore    ptr to the cache tagstore
- *  mref        ptr to the incoming memory reference
- *  line        ptr to the decoded cache line
+ *  set         set of the block
+ *  way         way of the block
  *
- * Returns: int32_t
- *          ID of the frist valid LRU block for eviction
- *          CACHE_RV_ERR on error
+ * Returns: Nothing
  **************************************************************************/
-int32_t
-cache_get_lru_block(cache_tagstore_t *tagstore, mem_ref_t *mref, 
-        cache_line_t *line)
+void
+cache_tagstore_fill(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
 {
-    int32_t             block_id = 0;
-    int32_t             min_block_id = 0;
-    uint32_t            num_blocks = 0;
-    uint32_t            tag_index = 0;
-    uint64_t            min_age = 0;
-    cache_tag_data_t    *tag_data = NULL;
-#ifdef DBG_ON
-    cache_generic_t     *cache = NULL;
-#endif /* DBG_ON */
-
-    if ((!tagstore) || (!mref) || (!line)) {
-        cache_assert(0);
-        goto error_exit;
-    }
+    if (tagstore->fa)
+        cache_fa_fill(tagstore, way);
+    if (tagstore->ptag)
+        cache_ptag_fill(tagstore, set, way);
+    if (tagstore->sets)
+        cache_index_fill(tagstore, set);
+    tagstore->repl->on_fill(tagstore, set, way);
 
-    num_blocks = tagstore->num_blocks_per_set;
-    tag_index = (line->index * num_blocks);
-    tag_data = &tagstore->tag_data[tag_index];
-
-    for (block_id = 0, min_age = tag_data[block_id].age; 
-            block_id < num_blocks; ++block_id) {
-        if ((tag_data[block_id].valid) && tag_data[block_id].age < min_age) {
-            min_block_id = block_id;
-            min_age = tag_data[block_id].age;
-        }
-    }
-    tagstore->lru_block_id[line->index] = min_block_id;
+    return;
+}
 
-#ifdef DBG_ON
-    cache = (cache_generic_t *) tagstore->cache;
-    printf("%s, LRU index %u\n", CACHE_GET_NAME(cache), line->index);
-    for (block_id = 0; block_id < num_blocks; ++block_id) {
-        printf("    B %u, V %u, D %u, A %lu\n",
-                block_id, tag_data[block_id].valid, 
-                tag_data[block_id].dirty, tag_data[block_id].age);
-    }
- 
-    printf("%s, min_block %u, min_age %lu\n", CACHE_GET_NAME(cache), 
-            min_block_id, min_age);
-#endif /* DBG_ON */
 
-    return min_block_id;
+/* Reports an invalidated block to the replacement policy and filters. */
+void
+cache_tagstore_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    if (tagstore->fa)
+        cache_fa_invalidate(tagstore, way);
+    if (tagstore->ptag)
+        cache_ptag_invalidate(tagstore, set, way);
+    tagstore->repl->on_invalidate(tagstore, set, way);
 
-error_exit:
-    return CACHE_RV_ERR;
+    return;
 }
 
 
-/*************************************************************************** 
- * Name:    cache_get_lfu_block
+/***************************************************************************
+ * Name:    cache_tagstore_set_dirty
  *
- * Desc:    Returns the LFU block ID for the given set.
+ * Desc:    Marks sectors of a valid block dirty, and the block along with
+ *          them. Sector bits left over from before the block was last
+ *          cleaned are dropped first.
  *
  * Params:
  *  tagstore    ptr to the cache tagstore
- *  mref        ptr to the incoming memory reference
- *  line        ptr to the decoded cache line
+ *  set         set of the block
+ *  way         way of the block
+ *  sectors     mask of the sectors written; 1 if not sectored
  *
- * Returns: int32_t
- *          ID of the frist valid LFU block for eviction
- *          CACHE_RV_ERR on error
+ * Returns: Nothing
  **************************************************************************/
-int32_t
-cache_get_lfu_block(cache_tagstore_t *tagstore, mem_ref_t *mref, 
-        cache_line_t *line)
+void
+cache_tagstore_set_dirty(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way, uint32_t sectors)
 {
-    int32_t             block_id = 0;
-    int32_t             min_block_id = 0;
-    uint32_t            num_blocks = 0;
-    uint32_t            tag_index = 0;
-    uint32_t            min_ref_count = 0;
-#ifdef DBG_ON
-    uint32_t            *tags = NULL;
-#endif /* DBG_ON */
-    cache_tag_data_t    *tag_data = NULL;
+    uint32_t    blk = ((set * tagstore->num_blocks_per_set) + way);
 
-    if ((!tagstore) || (!mref) || (!line)) {
-        cache_assert(0);
-        goto error_exit;
+    if (tagstore->sec_dirty) {
+        if (!tagstore->tag_data[blk].dirty)
+            tagstore->sec_dirty[blk] = 0;
+        tagstore->sec_dirty[blk] |= sectors;
     }
+    tagstore->tag_data[blk].dirty = 1;
 
-    num_blocks = tagstore->num_blocks_per_set;
-    tag_index = (line->index * num_blocks);
-#ifdef DBG_ON
-    tags = &tagstore->tags[tag_index];
-#endif /* DBG_ON */
-    tag_data = &tagstore->tag_data[tag_index];
+    return;
+}
 
-    for (block_id = 0, min_ref_count = tag_data[block_id].ref_count; 
-            block_id < num_blocks; ++block_id) {
-        if ((tag_data[block_id].valid) && 
-                (tag_data[block_id].ref_count < min_ref_count)) {
-            min_block_id = block_id;
-            min_ref_count = tag_data[block_id].ref_count;
-        }
-    }
 
-#ifdef DBG_ON
-    printf("LFU index %u\n", line->index);
-    for (block_id = 0; block_id < num_blocks; ++block_id) {
-        printf("    block %u, tag 0x%x, valid %u, ref_count %u\n",
-                block_id, tags[block_id], tag_data[block_id].valid, 
-                tag_data[block_id].ref_count);
+/* Sets the valid sectors of a block just placed; none of them is dirty. */
+static inline void
+cache_tagstore_set_sectors(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way, uint32_t sectors)
+{
+    uint32_t    blk = ((set * tagstore->num_blocks_per_set) + way);
+
+    if (tagstore->sec_valid) {
+        tagstore->sec_valid[blk] = sectors;
+        tagstore->sec_dirty[blk] = 0;
     }
-    printf("min_block %u, min_ref_count %u\n", min_block_id, min_ref_count);
-#endif /* DBG_ON */
 
-    return min_block_id;
+    return;
+}
 
-error_exit:
-    return CACHE_RV_ERR;
+
+/*
+ * Sets up the read request that fetches the given sectors of a block (the
+ * whole block, if not sectored) from the next level.
+ */
+static void
+cache_make_read_ref(cache_tagstore_t *tagstore, mem_ref_t *mref,
+        uint32_t sectors, mem_ref_t *read_ref)
+{
+    memcpy(read_ref, mref, sizeof(*read_ref));
+    read_ref->ref_type = MEM_REF_TYPE_READ;
+    read_ref->ref_size_bits = tagstore->num_offset_bits;
+    if (tagstore->sec_valid)
+        cache_sector_set_range(tagstore, sectors, read_ref);
+
+    return;
 }
 
 
@@ -501,6 +565,11 @@ cache_get_first_invalid_block(cache_tagstore_t *tagstore, cache_line_t *line)
         goto error_exit;
     }
 
+    if (tagstore->fa)
+        return cache_fa_first_invalid(tagstore);
+    if (tagstore->ptag)
+        return cache_ptag_first_invalid(tagstore, line->index);
+
     cache = (cache_generic_t *) tagstore->cache;
     num_blocks = tagstore->num_blocks_per_set;
     tag_index = (line->index * num_blocks);
@@ -548,6 +617,11 @@ cache_does_tag_match(cache_tagstore_t *tagstore, cache_line_t *line)
         goto error_exit;
     }
 
+    if (tagstore->fa)
+        return cache_fa_lookup(tagstore, line->tag);
+    if (tagstore->ptag)
+        return cache_ptag_lookup(tagstore, line->index, line->tag);
+
     num_blocks = tagstore->num_blocks_per_set;
     tag_index = (line->index * num_blocks);
     tags = &tagstore->tags[tag_index];
@@ -569,12 +643,12 @@ error_exit:
 
 
 void
-cache_write_to_victim(cache_generic_t *vc, mem_ref_t *write_ref, boolean dirty)
+cache_write_to_victim(cache_generic_t *vc, mem_ref_t *write_ref, boolean dirty,
+        uint8_t state)
 {
     int32_t             block_id = -1;
     uint32_t            tag_index = 0;
     uint32_t            *tags = NULL;
-    uint64_t            curr_age = 0;
     cache_line_t        line;
     cache_tag_data_t    *tag_data = NULL;
     cache_tagstore_t    *vc_ts = NULL;
@@ -597,11 +671,11 @@ cache_write_to_victim(cache_generic_t *vc, mem_ref_t *write_ref, boolean dirty)
     tags = &vc_ts->tags[tag_index];
     tag_data = &vc_ts->tag_data[tag_index];
 
-    curr_age = util_get_curr_time();
     tags[block_id] = line.tag;
     tag_data[block_id].valid = 1;
-    tag_data[block_id].age = curr_age;
     tag_data[block_id].dirty = dirty;
+    tag_data[block_id].state = state;
+    cache_tagstore_fill(vc_ts, line.index, block_id);
 
     dprint_dp("%s, writing from L1, VC TAG %x, INDEX %u, BLOCK %d, DIRTY %u\n",
             CACHE_GET_NAME(vc), line.tag, line.index, block_id, dirty);
@@ -632,11 +706,15 @@ cache_handle_dirty_tag_evicts(cache_generic_t *cache, mem_ref_t *mem_ref,
         uint32_t block_id)
 {
     uint32_t            tag_index = 0;
+    uint32_t            sectors = 0;
     uint32_t            *tags = NULL;
+    mem_ref_t           write_ref;
     cache_line_t        line;
+    cache_line_t        write_line;
     cache_tagstore_t    *tagstore = NULL;
     cache_tag_data_t    *tag_data = NULL;
 
+    CACHE_PROF_PUSH(CACHE_PROF_ST_WB);
     if ((!cache) || (!mem_ref)) {
         cache_assert(0);
         goto exit;
@@ -651,31 +729,28 @@ cache_handle_dirty_tag_evicts(cache_generic_t *cache, mem_ref_t *mem_ref,
     tags = &tagstore->tags[tag_index];
     tag_data = &tagstore->tag_data[tag_index];
 
+    /*
+     * To write the dirty block to next level, encode the dirty tag to a
+     * memory ref addr, with the ref type as write.
+     */
+    memset(&write_line, 0, sizeof(write_line));
+    memset(&write_ref, 0, sizeof(write_ref));
+    write_line.tag = tags[block_id];
+    write_line.index = line.index;
+    cache_util_encode_mem_addr(tagstore, &write_line, &write_ref);
+    write_ref.ref_type = MEM_REF_TYPE_WRITE;
+
     /* 
      * If there's another level of cache, write the dirty block to the next
      * available cache.
      */
     if ((cache->next_cache) && (CACHE_WRITE_PLCY_WBWA == cache->write_plcy)) {
-        mem_ref_t       write_ref;
-        cache_line_t    write_line;
-
-        /*
-         * To write the dirty block to next cache, issue a write request to
-         * the next cache by encoding the dirty tag to a memory ref addr and
-         * the ref type as write.
-         */
-        memset(&write_line, 0, sizeof(write_line));
-        memset(&write_ref, 0, sizeof(write_ref));
-        write_line.tag = tags[block_id];;
-        write_line.index = line.index;
-        cache_util_encode_mem_addr(tagstore, &write_line, &write_ref);
-        write_ref.ref_type = MEM_REF_TYPE_WRITE;
-
         if (CACHE_IS_VC(cache->next_cache)) {
             boolean dirty = FALSE;
 
             dirty = tag_data[block_id].dirty;
-            cache_write_to_victim(cache->next_cache, &write_ref, dirty);
+            cache_write_to_victim(cache->next_cache, &write_ref, dirty,
+                    tag_data[block_id].state);
             tag_data[block_id].dirty = 0;
             goto exit;
         }
@@ -686,8 +761,6 @@ cache_handle_dirty_tag_evicts(cache_generic_t *cache, mem_ref_t *mem_ref,
 
         dprint_info("%s writing dirty block [%u, %d] to next level due "    \
                 "to eviction", CACHE_GET_NAME(cache), line.index, block_id);
-
-        cache_evict_and_add_tag(cache->next_cache, &write_ref);
     } else {
         dprint_dp("LRU WRITE TO MEMORY, INDEX %u, BLOCK %d, DIRTY %u\n",
             line.index, block_id, 
@@ -697,12 +770,67 @@ cache_handle_dirty_tag_evicts(cache_generic_t *cache, mem_ref_t *mem_ref,
                 CACHE_GET_NAME(cache), line.index, block_id);
     }
 
-    /* Update the write back counter and clear the dirty bit on the block. */ 
-    cache->stats.num_write_backs += 1;
-    cache->stats.num_blk_mem_traffic += 1;
+    /*
+     * A sectored block writes back just its dirty sectors; if only the
+     * block is known to be dirty, all its valid sectors go. With a
+     * write-back buffer, the block waits there to be written out later.
+     * Either way, the dirty bits on the block are cleared.
+     */
+    sectors = 1;
+    if (tagstore->sec_dirty) {
+        sectors = tagstore->sec_dirty[tag_index + block_id];
+        if (!sectors)
+            sectors = tagstore->sec_valid[tag_index + block_id];
+        tagstore->sec_dirty[tag_index + block_id] = 0;
+    }
+
+    if (cache->wbb)
+        cache_wbb_put(cache, write_ref.ref_addr, sectors);
+    else
+        cache_write_back(cache, write_ref.ref_addr, sectors);
     tag_data[block_id].dirty = 0;
 
 exit:
+    CACHE_PROF_POP();
+    return;
+}
+
+
+/*************************************************************************** 
+ * Name:    cache_write_back
+ *
+ * Desc:    Writes a dirty block out of a cache: to the next cache as a write
+ *          request, if there's one, or else to memory. Of a sectored
+ *          block, only the given sectors are written; the request to the
+ *          next cache covers the smallest aligned run of sectors holding
+ *          them.
+ *
+ * Params:
+ *  cache   ptr to the cache the block was evicted from
+ *  addr    address of the dirty block
+ *  sectors mask of the sectors to write; 1 if not sectored
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_write_back(cache_generic_t *cache, uint32_t addr, uint32_t sectors)
+{
+    mem_ref_t           write_ref;
+    cache_tagstore_t    *tagstore = cache->tagstore;
+
+    if ((cache->next_cache) && (CACHE_WRITE_PLCY_WBWA == cache->write_plcy)) {
+        memset(&write_ref, 0, sizeof(write_ref));
+        write_ref.ref_addr = addr;
+        write_ref.ref_type = MEM_REF_TYPE_WRITE;
+        cache_sector_set_range(tagstore, sectors, &write_ref);
+        cache_evict_and_add_tag(cache->next_cache, &write_ref);
+    }
+
+    /* Update the write back counters. */
+    cache->stats.num_write_backs += 1;
+    cache->stats.num_blk_mem_traffic += 1;
+    cache->stats.num_wb_bytes += CACHE_SECTOR_BYTES(tagstore, sectors);
+
     return;
 }
 
@@ -726,7 +854,6 @@ int32_t
 cache_evict_tag(cache_generic_t *cache, mem_ref_t *mref, cache_line_t *line)
 {
     int32_t             block_id = 0;
-    uint32_t            tag_index;
     cache_tagstore_t    *tagstore = NULL;
 
     if ((!cache) || (!mref) || (!line)) {
@@ -735,40 +862,19 @@ cache_evict_tag(cache_generic_t *cache, mem_ref_t *mref, cache_line_t *line)
     }
 
     tagstore = cache->tagstore;
-    tag_index = (line->index * tagstore->num_blocks_per_set);
+    block_id = tagstore->repl->choose_victim(tagstore, line->index);
+    if (tagstore->sets)
+        cache_index_evict(tagstore, line->index);
 
-    switch (CACHE_GET_REPLACEMENT_POLICY(cache)) {
-        case CACHE_REPL_PLCY_LRU:
-            block_id = cache_get_lru_block(tagstore, mref, line);
-            if (CACHE_RV_ERR == block_id)
-                goto error_exit;
-            break;
+    /* Blocks leaving the private caches of a core leave the directory. */
+    if ((g_cache_coh) && ((CACHE_IS_VC(cache)) ||
+                ((CACHE_IS_L1(cache)) && (!cache_util_is_victim_present()))))
+        cache_coh_evict(cache, line->index, block_id);
 
-        case CACHE_REPL_PLCY_LFU:
-            block_id = cache_get_lfu_block(tagstore, mref, line);
-            if (CACHE_RV_ERR == block_id)
-                goto error_exit;
+    /* Private copies of an inclusive L2 victim have to go as well. */
+    if ((CACHE_INCL_INCLUSIVE == g_cache_incl) && (CACHE_IS_L2(cache)))
+        cache_incl_back_inval(cache, line->index, block_id);
 
-            /*
-             * According to LFU policy, the row ref count should be set to
-             * the ref count of the block being evicted and the evicted block 
-             * ref count should be reset.
-             */
-            tagstore->set_ref_count[line->index] = 
-                tagstore->tag_data[tag_index + block_id].ref_count;
-            tagstore->tag_data[tag_index + block_id].ref_count = 0;
-            
-#ifdef DBG_ON
-            printf("set_ref_count %u, tag_ref_count %u\n",
-                    tagstore->set_ref_count[line->index],
-                    tagstore->tag_data[tag_index + block_id].ref_count);
-#endif /* DBG_ON */
-            break;
-
-        default:
-            cache_assert(0);
-            goto error_exit;
-    }
     dprint_dp("LRU EVICT FROM %s, INDEX %u, BLOCK %d, DIRTY %u\n",
         CACHE_GET_NAME(cache), line->index, block_id, 
         cache_util_is_block_dirty(tagstore, line, block_id));
@@ -796,6 +902,13 @@ cache_evict_tag(cache_generic_t *cache, mem_ref_t *mref, cache_line_t *line)
 
         goto ret_id;
     }
+
+    /* Blocks leaving the private caches are the only fills of exclusive L2. */
+    if ((CACHE_INCL_EXCLUSIVE == g_cache_incl) &&
+            ((CACHE_IS_L1(cache)) || (CACHE_IS_VC(cache)))) {
+        cache_incl_victim_fill(cache, line->index, block_id);
+        goto ret_id;
+    }
     
     /* If the block to be evicted is dirty, write it back if required. */
     if (cache_util_is_block_dirty(tagstore, line, block_id)) {
@@ -812,6 +925,87 @@ error_exit:
 }
 
 
+/***************************************************************************
+ * Name:    cache_sector_miss
+ *
+ * Desc:    Handles a reference that finds its tag, but not all the sectors
+ *          it asks for. The missing sectors are read from the next level
+ *          into the same block; nothing is evicted. Counts as a miss.
+ *
+ * Params:
+ *  cache       ptr to the sectored cache
+ *  mref        ptr to the memory reference
+ *  line        ptr to the decoded cache line
+ *  block_id    way holding the tag
+ *  sectors     mask of the sectors asked for
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_sector_miss(cache_generic_t *cache, mem_ref_t *mref, cache_line_t *line,
+        uint32_t block_id, uint32_t sectors)
+{
+    uint32_t            blk = 0;
+    uint32_t            missing = 0;
+    mem_ref_t           read_ref;
+    cache_tagstore_t    *tagstore = cache->tagstore;
+
+    blk = ((line->index * tagstore->num_blocks_per_set) + block_id);
+    missing = (sectors & ~tagstore->sec_valid[blk]);
+
+    /* A sectored L1 has no VC, so the next level is L2 or memory. */
+    if (cache->next_cache) {
+        cache_make_read_ref(tagstore, mref, sectors, &read_ref);
+        cache_evict_and_add_tag(cache->next_cache, &read_ref);
+    } else if (CACHE_TIMING_IS_DEMAND(cache, mref)) {
+        g_cache_ref_src = CACHE_TIMING_SRC_MEM;
+    }
+
+    cache->stats.num_sector_misses += 1;
+    cache->stats.num_blk_mem_traffic += 1;
+    cache->stats.num_fill_bytes += CACHE_SECTOR_BYTES(tagstore, missing);
+    tagstore->sec_valid[blk] |= sectors;
+    tagstore->repl->on_hit(tagstore, line->index, block_id);
+
+    if (IS_MEM_REF_READ(mref)) {
+        cache->stats.num_read_misses += 1;
+    } else {
+        cache->stats.num_write_misses += 1;
+        cache->write->on_hit(cache, mref, line->index, block_id, sectors);
+
+        if ((g_cache_coh) && (CACHE_IS_L1(cache))) {
+            cache_coh_write_hit(cache, &tagstore->tag_data[blk],
+                    mref->ref_addr);
+        }
+    }
+
+    return;
+}
+
+
+/*
+ * Runs a request that covers more than a block of the cache, from a level
+ * with larger blocks, as one request per block, in address order.
+ */
+static void
+cache_split_ref(cache_generic_t *cache, mem_ref_t *mref)
+{
+    uint32_t    iter = 0;
+    uint8_t     blk_bits = cache->tagstore->num_offset_bits;
+    mem_ref_t   blk_ref;
+
+    memcpy(&blk_ref, mref, sizeof(blk_ref));
+    blk_ref.ref_addr &= ~((1U << mref->ref_size_bits) - 1);
+    blk_ref.ref_size_bits = blk_bits;
+    for (iter = 0; iter < (1U << (mref->ref_size_bits - blk_bits)); ++iter) {
+        cache_evict_and_add_tag(cache, &blk_ref);
+        blk_ref.ref_addr += (1U << blk_bits);
+    }
+
+    return;
+}
+
+
 /*************************************************************************** 
  * Name:    cache_evict_and_add_tag 
  *
@@ -826,7 +1020,8 @@ error_exit:
  *              on the block.
  *
  *          For all three operations above, we need to update read/write, 
- *          miss/hit counters, valid, dirty (for writes) and age for the block.
+ *          miss/hit counters, valid, dirty (for writes) and replacement
+ *          state for the block.
  *
  * Params:
  *  in_cache    ptr to cache
@@ -838,38 +1033,63 @@ void
 cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
 {
     uint8_t             read_flag = FALSE;
+    uint8_t             coh_state = CACHE_MESI_I;
+    uint8_t             pf_event = CACHE_PF_EV_MISS;
+    boolean             pf_demand = FALSE;
     int32_t             block_id = 0;
     uint32_t            tag_index = 0;
+    uint32_t            sectors = 0;
     uint32_t            *tags = NULL;
-    uint64_t            curr_age;
     cache_line_t        line;
     cache_tag_data_t    *tag_data = NULL;
     cache_tagstore_t    *tagstore = NULL;
 
+    /* Time spent here is the level's own, less that of nested stages. */
+    CACHE_PROF_PUSH(CACHE_PROF_LEVEL(cache));
     if ((!cache) || (!mref)) {
         cache_assert(0);
         goto exit;
     }
     tagstore = cache->tagstore;
 
-    /* Fetch the current time to be used for tag age (for LRU). */
-    curr_age = util_get_curr_time(); 
+    /* Requests from a level with larger blocks go one block at a time. */
+    if (mref->ref_size_bits > tagstore->num_offset_bits) {
+        cache_split_ref(cache, mref);
+        goto split_exit;
+    }
 
     /* Decode the memmory reference to the current cache's cache line. */
     memset(&line, 0, sizeof(line));
+    CACHE_PROF_PUSH(CACHE_PROF_ST_DECODE);
     cache_util_decode_mem_addr(tagstore, mref->ref_addr, &line);
+    CACHE_PROF_POP();
 
     /* Fetch the appropriate set within the tagstore. */
     tag_index = (line.index * tagstore->num_blocks_per_set);
     tags = &tagstore->tags[tag_index];
     tag_data = &tagstore->tag_data[tag_index];
     read_flag = (IS_MEM_REF_READ(mref) ? TRUE : FALSE);
+    sectors = cache_sector_mask(tagstore, mref);
 
     if (read_flag)
         cache->stats.num_reads += 1;
     else
         cache->stats.num_writes += 1;
 
+    /*
+     * Prefetchers train only on demand accesses: every L1 access and the
+     * reads coming from the previous level. Prefetch requests and write
+     * backs from the previous level do not count. Land the prefetches
+     * that are due before looking up the tag.
+     */
+    if ((cache->pf) && (!(mref->ref_flags & MEM_REF_F_PREFETCH)) &&
+            ((CACHE_IS_L1(cache)) || (read_flag))) {
+        pf_demand = TRUE;
+        CACHE_PROF_PUSH(CACHE_PROF_ST_PF);
+        cache_pf_retire(cache);
+        CACHE_PROF_POP();
+    }
+
     /*
      * Notes
      * =====
@@ -903,7 +1123,20 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
      *        the counters and return to previous level.
      */
 
-    if (CACHE_RV_ERR != (block_id = cache_does_tag_match(tagstore, &line))) {
+    block_id = cache_does_tag_match(tagstore, &line);
+    if ((CACHE_RV_ERR != block_id) && (tagstore->sec_valid) &&
+            ((tagstore->sec_valid[tag_index + block_id] & sectors) !=
+             sectors)) {
+        /* Sector miss; the tag is here, but not all the sectors asked for. */
+        dprint_info("sector miss for cache %s, tag 0x%x at index %u, "
+                "block %u\n", CACHE_GET_NAME(cache), line.tag, line.index,
+                block_id);
+        if (pf_demand) {
+            cache_pf_demand_miss(cache,
+                    (mref->ref_addr >> tagstore->num_offset_bits));
+        }
+        cache_sector_miss(cache, mref, &line, block_id, sectors);
+    } else if (CACHE_RV_ERR != block_id) {
         /* 
          * Cache hit!
          * Tag is already present. Just update the counters and go fetch the
@@ -915,20 +1148,27 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
         dprint_info("cache hit for cache %s, tag 0x%x at index %u, block %u\n",
                 CACHE_GET_NAME(cache), line.tag, line.index, block_id);
         tag_data[block_id].valid = 1;
-        tag_data[block_id].age = curr_age;
-        tag_data[block_id].ref_count += 1;
+        tagstore->repl->on_hit(tagstore, line.index, block_id);
+        if (CACHE_TIMING_IS_DEMAND(cache, mref)) {
+            g_cache_ref_src = (CACHE_IS_L1(cache) ?
+                    CACHE_TIMING_SRC_L1 : CACHE_TIMING_SRC_L2);
+        }
+
+        pf_event = CACHE_PF_EV_HIT;
+        if ((pf_demand) && (tag_data[block_id].prefetched)) {
+            pf_event = CACHE_PF_EV_PF_HIT;
+            tag_data[block_id].prefetched = 0;
+            cache->stats.num_pf_useful += 1;
+        }
 
         if (read_flag) {
             cache->stats.num_read_hits += 1;
         } else {
             cache->stats.num_write_hits += 1;
-            
-            /* Set the block to be dirty only for WBWA write policy. */
-            if (CACHE_WRITE_PLCY_WBWA == CACHE_GET_WRITE_POLICY(cache)) {
-                tag_data[block_id].dirty = 1;
-             } else {
-                cache->stats.num_blk_mem_traffic += 1;
-             }
+            cache->write->on_hit(cache, mref, line.index, block_id, sectors);
+
+            if ((g_cache_coh) && (CACHE_IS_L1(cache)))
+                cache_coh_write_hit(cache, &tag_data[block_id], mref->ref_addr);
         }
     } else {
         cache_generic_t *next_cache = NULL;
@@ -958,6 +1198,15 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
                 CACHE_GET_NAME(cache), line.tag, line.index);
         next_cache = cache->next_cache;
 
+        if (pf_demand) {
+            cache_pf_demand_miss(cache,
+                    (mref->ref_addr >> tagstore->num_offset_bits));
+        }
+
+        /* Write misses that don't allocate are done with here. */
+        if ((!read_flag) && (cache->write->on_miss(cache, mref)))
+            goto exit;
+
         dprint_info("cache %s, index %u, block %d selected for tag 0x%x\n",
                 CACHE_GET_NAME(cache), line.index, block_id, line.tag);
 
@@ -973,7 +1222,8 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
                 cache_tagstore_t    *vc_ts = NULL;
                 cache_stats_t       *vc_stats = NULL;
 
-                vc = cache_util_get_vc(); 
+                CACHE_PROF_SWITCH(CACHE_PROF_ST_VC);
+                vc = cache->next_cache;
                 vc_ts = vc->tagstore;
                 vc_stats = &vc->stats;
                 memset(&vc_line, 0, sizeof(vc_line));
@@ -982,6 +1232,8 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
                 vc_block_id = cache_does_tag_match(vc_ts, &vc_line);
                 if (CACHE_RV_ERR != vc_block_id) {
                     uint8_t             tmp_l1_dirty = 0;
+                    uint8_t             tmp_l1_state = 0;
+                    boolean             l1_valid = FALSE;
                     uint32_t            vc_tag_index = 0;
                     uint32_t            *vc_tags;
                     mem_ref_t           l1_old_ref;
@@ -993,13 +1245,17 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
 
                     /* 
                      * Find a block to place the to-be-fetcheed data. Go for 
-                     * LRU block (don't evict, as we are just going to swap it
-                     * with VC), if no free blocks are available.
+                     * the replacement victim (don't evict, as we are just
+                     * going to swap it with VC), if no free blocks are
+                     * available.
                      */
                     block_id = cache_get_first_invalid_block(tagstore, &line);
-                    if (CACHE_RV_ERR == block_id)
-                        block_id = cache_util_get_lru_block_id(cache->tagstore,
-                                &line);
+                    if (CACHE_RV_ERR == block_id) {
+                        block_id = tagstore->repl->choose_victim(tagstore,
+                                line.index);
+                        if (tagstore->sets)
+                            cache_index_evict(tagstore, line.index);
+                    }
 
                     vc_tag_index = (vc_line.index * vc_ts->num_blocks_per_set);
                     vc_tags = &vc_ts->tags[vc_tag_index];
@@ -1029,7 +1285,8 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
                     dprint_dp("addr %x, l1 tag %x, vc tag %x\n",
                         l1_old_ref.ref_addr, l1_old_line.tag, vc_tmp_line.tag);
 
-                    /* Swap tag data and dirty bits. */
+                    /* Swap tag data, dirty bits and coherence states. */
+                    l1_valid = tag_data[block_id].valid;
                     tags[block_id] = line.tag;
                     vc_tags[vc_block_id] = vc_tmp_line.tag;
                     
@@ -1037,14 +1294,36 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
                     tag_data[block_id].dirty = 
                         vc_tag_data[vc_block_id].dirty;
                     vc_tag_data[vc_block_id].dirty = tmp_l1_dirty;
+                    tmp_l1_state = tag_data[block_id].state;
+                    tag_data[block_id].state = vc_tag_data[vc_block_id].state;
+                    vc_tag_data[vc_block_id].state = tmp_l1_state;
                     if (!read_flag)
                         tag_data[block_id].dirty = 1;
         
-                    curr_age = util_get_curr_time(); 
                     tag_data[block_id].valid = 1;
-                    tag_data[block_id].age = curr_age;
-                    vc_tag_data[vc_block_id].valid = 1;
-                    vc_tag_data[vc_block_id].age = curr_age;
+                    tag_data[block_id].prefetched = 0;
+                    cache_tagstore_fill(tagstore, line.index, block_id);
+
+                    /*
+                     * Coherence invalidations can leave holes in L1; there's
+                     * nothing to swap back into the VC then.
+                     */
+                    if (l1_valid) {
+                        vc_tag_data[vc_block_id].valid = 1;
+                        cache_tagstore_fill(vc_ts, vc_line.index,
+                                vc_block_id);
+                    } else {
+                        vc_tag_data[vc_block_id].valid = 0;
+                        vc_tag_data[vc_block_id].dirty = 0;
+                        vc_tag_data[vc_block_id].state = CACHE_MESI_I;
+                        cache_tagstore_invalidate(vc_ts, vc_line.index,
+                                vc_block_id);
+                    }
+
+                    if ((g_cache_coh) && (!read_flag)) {
+                        cache_coh_write_hit(cache, &tag_data[block_id],
+                                mref->ref_addr);
+                    }
 
 #ifdef DBG_ON
                     dprint_info("print cache conntents start\n");
@@ -1053,6 +1332,8 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
                     dprint_info("print cache conntents end\n");
 #endif /* DBG_ON */
                     vc_stats->num_swaps += 1;
+                    if (g_cache_timing)
+                        g_cache_ref_src = CACHE_TIMING_SRC_VC;
                     if (read_flag)
                         vc_stats->num_read_hits += 1;
                     else
@@ -1065,21 +1346,24 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
                     dprint_dbg("MISS %s\n", CACHE_GET_NAME(vc));
                     dprint_dp("MISS %s, TAG %x\n", 
                             CACHE_GET_NAME(vc), vc_line.tag);
-                    next_cache = (cache_util_is_l2_present()) ? 
-                        cache_util_get_l2() : NULL;
+                    next_cache = vc->next_cache;
 
                     if (read_flag)
                         vc_stats->num_read_misses += 1;
                     else
                         vc_stats->num_write_misses += 1;
+                    CACHE_PROF_SWITCH(CACHE_PROF_ST_L1);
                 }
             } else {
                 /* VC not present. Set next_cache to L2 if available. */
-                next_cache = (cache_util_is_l2_present()) ? 
-                    cache_util_get_l2() : NULL;
+                next_cache = cache->next_cache;
             }
         }
 
+        /* Private cache miss; the directory decides the MESI state. */
+        if ((g_cache_coh) && (CACHE_IS_L1(cache)))
+            coh_state = cache_coh_miss(cache, mref->ref_addr, (!read_flag));
+
         /* Check next level cache, if available. */ 
         if (next_cache) {
             mem_ref_t       read_ref;
@@ -1091,38 +1375,66 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
             if (CACHE_RV_ERR == block_id)
                 block_id = cache_evict_tag(cache, mref, &line);
 
+            /*
+             * The evicted block is gone; don't let an inclusive L2 find it
+             * here while it makes room for the new one.
+             */
+            tag_data[block_id].valid = 0;
+            if (tagstore->ptag)
+                cache_ptag_invalidate(tagstore, line.index, block_id);
+
             /* 
              * For cache misses, issues a read reference for that address
-             * to the next cache level.
+             * (the sectors asked for, if sectored) to the next cache level.
              */
-            memset(&read_ref, 0, sizeof(read_ref));
-            memcpy(&read_ref, mref, sizeof(read_ref));
-            read_ref.ref_type = MEM_REF_TYPE_READ;
+            cache_make_read_ref(tagstore, mref, sectors, &read_ref);
             dprint_dp("%s, READ FROM %s %x, %x\n", 
                     CACHE_GET_NAME(cache), CACHE_GET_NAME(next_cache), 
                     read_ref.ref_addr, line.tag);
 
             cache_evict_and_add_tag(next_cache, &read_ref);
 
+            /* Exclusive L2 gives the block up, along with its dirty bit. */
+            if (CACHE_INCL_EXCLUSIVE == g_cache_incl) {
+                tag_data[block_id].dirty =
+                    cache_incl_take(next_cache, read_ref.ref_addr);
+            }
+
             tags[block_id] = line.tag;
             cache->stats.num_blk_mem_traffic += 1;
+            cache->stats.num_fill_bytes += CACHE_SECTOR_BYTES(tagstore,
+                    sectors);
             tag_data[block_id].valid = 1;
-            tag_data[block_id].age = curr_age;
-            tag_data[block_id].ref_count = 
-                (util_get_block_ref_count(tagstore, &line) + 1);
+            tag_data[block_id].prefetched = 0;
+            tag_data[block_id].state = coh_state;
+            cache_tagstore_set_sectors(tagstore, line.index, block_id,
+                    sectors);
+            cache_tagstore_fill(tagstore, line.index, block_id);
 
             if (read_flag) {
                 cache->stats.num_read_misses += 1;
             } else {
                 cache->stats.num_write_misses += 1;
-
-                /* Set the block to be dirty only for WBWA write policy. */
-                if (CACHE_WRITE_PLCY_WBWA == CACHE_GET_WRITE_POLICY(cache))
-                    tag_data[block_id].dirty = 1;
+                cache->write->on_hit(cache, mref, line.index, block_id,
+                        sectors);
             }
             dprint_info("%s, tag 0x%x added to index %u, block %u\n", 
                     CACHE_GET_NAME(cache), line.tag, line.index, block_id);
         } else {
+            /*
+             * Exclusive L2 misses are filled in the private cache asking for
+             * the block; L2 gets it only when it's evicted from there.
+             */
+            if ((CACHE_INCL_EXCLUSIVE == g_cache_incl) &&
+                    (CACHE_IS_L2(cache)) && (read_flag)) {
+                if (CACHE_TIMING_IS_DEMAND(cache, mref))
+                    g_cache_ref_src = CACHE_TIMING_SRC_MEM;
+                cache->stats.num_blk_mem_traffic += 1;
+                cache->stats.num_fill_bytes += cache->blk_size;
+                cache->stats.num_read_misses += 1;
+                goto exit;
+            }
+
             /*
              * Find a block to place the to-be-fetcheed data. Go for
              * block eviction, if no free blocks are available.
@@ -1135,12 +1447,18 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
              * We are at the last cache and currently handling a miss. 
              * Read from memory and place it the previouly found block. 
              */
+            if (CACHE_TIMING_IS_DEMAND(cache, mref))
+                g_cache_ref_src = CACHE_TIMING_SRC_MEM;
             tags[block_id] = line.tag;
             cache->stats.num_blk_mem_traffic += 1;
+            cache->stats.num_fill_bytes += CACHE_SECTOR_BYTES(tagstore,
+                    sectors);
             tag_data[block_id].valid = 1;
-            tag_data[block_id].age = curr_age;
-            tag_data[block_id].ref_count = 
-                (util_get_block_ref_count(tagstore, &line) + 1);
+            tag_data[block_id].prefetched = 0;
+            tag_data[block_id].state = coh_state;
+            cache_tagstore_set_sectors(tagstore, line.index, block_id,
+                    sectors);
+            cache_tagstore_fill(tagstore, line.index, block_id);
 
             dprint_dp("%s, READ FROM MEMORY %x, %x\n", 
                     CACHE_GET_NAME(cache), mref->ref_addr, line.tag);
@@ -1149,10 +1467,8 @@ cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mref)
                 cache->stats.num_read_misses += 1;
             } else {
                 cache->stats.num_write_misses += 1;
-
-                /* Set the block to be dirty only for WBWA write policy. */
-                if (CACHE_WRITE_PLCY_WBWA == CACHE_GET_WRITE_POLICY(cache))
-                    tag_data[block_id].dirty = 1;
+                cache->write->on_hit(cache, mref, line.index, block_id,
+                        sectors);
             }
             dprint_info("%s, tag 0x%x added to index %u, block %u\n", 
                     CACHE_GET_NAME(cache), line.tag, line.index, block_id);
@@ -1163,10 +1479,159 @@ exit:
 #ifdef DBG_ON
     cache_print_tags(cache, &line);
 #endif /* DBG_ON */
+    /* Train the prefetcher and issue prefetches, if any. */
+    if (pf_demand) {
+        CACHE_PROF_PUSH(CACHE_PROF_ST_PF);
+        cache_pf_on_access(cache,
+                (mref->ref_addr >> tagstore->num_offset_bits), pf_event);
+        CACHE_PROF_POP();
+    }
+
+split_exit:
+    CACHE_PROF_POP();
     return;
 }
 
 
+/*************************************************************************** 
+ * Name:    cache_is_block_present
+ *
+ * Desc:    Checks whether the block containing the given address is
+ *          present in the cache. For L1, blocks in the victim cache are
+ *          considered present as well.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *  addr    memory address
+ *
+ * Returns: boolean
+ *  TRUE if the block is present
+ *  FALSE otherwise
+ **************************************************************************/
+boolean
+cache_is_block_present(cache_generic_t *cache, uint32_t addr)
+{
+    cache_line_t    line;
+    cache_generic_t *vc = NULL;
+
+    memset(&line, 0, sizeof(line));
+    cache_util_decode_mem_addr(cache->tagstore, addr, &line);
+    if (CACHE_RV_ERR != cache_does_tag_match(cache->tagstore, &line))
+        return TRUE;
+
+    if ((CACHE_IS_L1(cache)) && (cache_util_is_victim_present())) {
+        vc = cache->next_cache;
+        cache_util_decode_mem_addr(vc->tagstore, addr, &line);
+        if (CACHE_RV_ERR != cache_does_tag_match(vc->tagstore, &line))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+/*************************************************************************** 
+ * Name:    cache_prefetch_fill
+ *
+ * Desc:    Fills a prefetched block into the cache. Uses the same path as
+ *          a demand miss: picks an invalid block or evicts one (with the
+ *          usual write backs and victim cache handling) and reads the block
+ *          from the next level. Prefetch fills do not update the read/write
+ *          counters of this cache and the block is marked as prefetched,
+ *          until the first demand hit on it.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *  addr    address of the block to be prefetched
+ *
+ * Returns: boolean
+ *  TRUE if the block was filled
+ *  FALSE if the block is already present
+ **************************************************************************/
+boolean
+cache_prefetch_fill(cache_generic_t *cache, uint32_t addr)
+{
+    int32_t             block_id = 0;
+    uint32_t            tag_index = 0;
+    uint32_t            *tags = NULL;
+    mem_ref_t           pf_ref;
+    mem_ref_t           victim_ref;
+    cache_line_t        line;
+    cache_line_t        victim_line;
+    uint8_t             coh_state = CACHE_MESI_I;
+    cache_generic_t     *next_cache = NULL;
+    cache_tag_data_t    *tag_data = NULL;
+    cache_tagstore_t    *tagstore = NULL;
+
+    if ((!cache) || (!cache->pf)) {
+        cache_assert(0);
+        return FALSE;
+    }
+
+    if (cache_is_block_present(cache, addr))
+        return FALSE;
+
+    tagstore = cache->tagstore;
+    memset(&pf_ref, 0, sizeof(pf_ref));
+    pf_ref.ref_type = MEM_REF_TYPE_READ;
+    pf_ref.ref_flags = MEM_REF_F_PREFETCH;
+    pf_ref.ref_addr = addr;
+    pf_ref.ref_size_bits = tagstore->num_offset_bits;
+
+    memset(&line, 0, sizeof(line));
+    cache_util_decode_mem_addr(tagstore, addr, &line);
+    tag_index = (line.index * tagstore->num_blocks_per_set);
+    tags = &tagstore->tags[tag_index];
+    tag_data = &tagstore->tag_data[tag_index];
+
+    if ((g_cache_coh) && (CACHE_IS_L1(cache)))
+        coh_state = cache_coh_miss(cache, addr, FALSE);
+
+    block_id = cache_get_first_invalid_block(tagstore, &line);
+    if (CACHE_RV_ERR == block_id) {
+        block_id = cache_evict_tag(cache, &pf_ref, &line);
+
+        /* Remember the victim to detect pollution by this fill. */
+        memset(&victim_line, 0, sizeof(victim_line));
+        victim_line.tag = tags[block_id];
+        victim_line.index = line.index;
+        cache_util_encode_mem_addr(tagstore, &victim_line, &victim_ref);
+        cache_pf_note_evict(cache,
+                (victim_ref.ref_addr >> tagstore->num_offset_bits));
+        tag_data[block_id].valid = 0;
+        if (tagstore->ptag)
+            cache_ptag_invalidate(tagstore, line.index, block_id);
+    }
+
+    /* L1 + VC act as one; the block comes from L2 or memory. */
+    next_cache = cache->next_cache;
+    if ((next_cache) && (CACHE_IS_VC(next_cache)))
+        next_cache = next_cache->next_cache;
+
+    if (next_cache)
+        cache_evict_and_add_tag(next_cache, &pf_ref);
+
+    tags[block_id] = line.tag;
+    cache->stats.num_blk_mem_traffic += 1;
+    cache->stats.num_pf_fills += 1;
+    cache->stats.num_fill_bytes += cache->blk_size;
+    tag_data[block_id].valid = 1;
+    tag_data[block_id].dirty = 0;
+    cache_tagstore_set_sectors(tagstore, line.index, block_id,
+            cache_sector_all(tagstore));
+    if ((next_cache) && (CACHE_INCL_EXCLUSIVE == g_cache_incl))
+        tag_data[block_id].dirty = cache_incl_take(next_cache, addr);
+    tag_data[block_id].prefetched = 1;
+    tag_data[block_id].state = coh_state;
+    cache_tagstore_fill(tagstore, line.index, block_id);
+
+    dprint_info("%s, prefetched tag 0x%x into index %u, block %u\n",
+            CACHE_GET_NAME(cache), line.tag, line.index, block_id);
+
+    return TRUE;
+}
+
+
 /*************************************************************************** 
  * Name:    cache_handle_memory_request 
  *
@@ -1197,10 +1662,13 @@ cache_handle_memory_request(cache_generic_t *cache, mem_ref_t *mref)
      * on the cache configuration.
      */
     memset(&line, 0, sizeof(line));
+    CACHE_PROF_PUSH(CACHE_PROF_ST_DECODE);
     cache_util_decode_mem_addr(cache->tagstore, mref->ref_addr, &line);
+    CACHE_PROF_POP();
 
     /* Cache pipeline starts here. */
     cache_evict_and_add_tag(cache, mref);
+    CACHE_WBB_TICK(cache);
 
     return TRUE;
 
@@ -1209,124 +1677,128 @@ error_exit:
 }
 
 
-/* 42: Life, the Universe and Everything; including caches. */
-int
-main(int argc, char **argv)
+/*************************************************************************** 
+ * Name:    cache_cleanup_all
+ *
+ * Desc:    Cleans up the caches of all the cores and the shared L2.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_cleanup_all(void)
 {
-    char            newline = '\n';
-    const char      *trace_fpath = NULL;
-    FILE            *trace_fptr = NULL;
-    mem_ref_t       mem_ref;
-
-    /* Error out in case of invalid arguments. */
-    if (FALSE == cache_util_validate_input(argc, argv)) {
-        printf("Error: Invalid input(s). See usage for help.\n");
-        cache_print_usage(argv[0]);
-        goto usage_exit;
-    }
-    trace_fpath = argv[argc - 1];
-
-    memset(&mem_ref, 0, sizeof(mem_ref));
-
-    /* 
-     * Parse arguments and populate the data structure with 
-     * cache attributes. 
-     */
-    cache_init(&g_l1_cache, &g_vic_cache, &g_l2_cache, argc, argv);
+    uint32_t    core = 0;
 
-    /* Initialize a tagstore for L1 & L2 caches. */
-    cache_tagstore_init(&g_l1_cache, &g_l1_cache_ts);
-    if (cache_util_is_victim_present())
-        cache_tagstore_init(&g_vic_cache, &g_vic_cache_ts);
-    if (cache_util_is_l2_present())
-        cache_tagstore_init(&g_l2_cache, &g_l2_cache_ts);
-
-    /* Try opening the trace file. */
-    trace_fptr = fopen(trace_fpath, "r");
-    if (!trace_fptr) {
-        printf("Error: Unable to open trace file %s.\n", trace_fpath);
-        dprint_err("unable to open trace file %s.\n", trace_fpath);
-        goto error_exit;
+    for (core = 0; core < g_num_cores; ++core) {
+        if (cache_util_is_victim_present())
+            cache_cleanup(&g_vic_caches[core]);
+        cache_cleanup(&g_l1_caches[core]);
     }
+    if (cache_util_is_l2_present())
+        cache_cleanup(&g_l2_cache);
 
-    /* 
-     * Read the trace file, fetch the address and process the memory access
-     * request for every request in the trace file. 
-     */
-    while (fscanf(trace_fptr, "%c %x%c", 
-                &(mem_ref.ref_type), &(mem_ref.ref_addr), &newline) != EOF) {
-        /* All requests start at L1 cache. */
-        g_addr_count += 1;
-
-        dprint_dbg("\n%u. Address %x %s\n", g_addr_count, mem_ref.ref_addr,
-                CACHE_GET_REF_TYPE_STR((&mem_ref)));
-
-#ifdef DBG_ON
-        {
-            cache_line_t    l1_line;
-            cache_line_t    vc_line;
+    return;
+}
 
-            cache_util_decode_mem_addr(g_l1_cache.tagstore, 
-                    mem_ref.ref_addr, &l1_line);
-            cache_util_decode_mem_addr(g_vic_cache.tagstore, 
-                    mem_ref.ref_addr, &vc_line);
 
-            dprint_dp("ADDR %x, L1 tag %x, VC tag %x\n",
-                    mem_ref.ref_addr, l1_line.tag, vc_line.tag);
-        }
-#endif /* DBG_ON */
+/*************************************************************************** 
+ * Name:    cache_sim_init
+ *
+ * Desc:    Sets up the tagstores and the optional models of the configured
+ *          caches, ready for the first reference.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_sim_init(void)
+{
+    uint32_t        core = 0;
 
-        dprint_info("mem_ref %c 0x%x\n", 
-                mem_ref.ref_type, mem_ref.ref_addr);
-        if (!cache_handle_memory_request(&g_l1_cache, &mem_ref)) {
-            dprint_err("Error: Unable to handle memory reference request for "\
-                    "type %c, addr 0x%x.\n", 
-                    mem_ref.ref_type, mem_ref.ref_addr);
-            goto error_exit;
-        }
+    /* Initialize a tagstore for L1 & L2 caches. */
+    for (core = 0; core < g_num_cores; ++core) {
+        if ((CACHE_RV_OK != cache_tagstore_init(&g_l1_caches[core],
+                        &g_l1_caches_ts[core])) ||
+                ((cache_util_is_victim_present()) &&
+                 (CACHE_RV_OK != cache_tagstore_init(&g_vic_caches[core],
+                        &g_vic_caches_ts[core]))))
+            return CACHE_RV_ERR;
     }
+    if ((cache_util_is_l2_present()) &&
+            (CACHE_RV_OK != cache_tagstore_init(&g_l2_cache,
+                    &g_l2_cache_ts)))
+        return CACHE_RV_ERR;
+
+    /* Set up the sharer directory for multiple cores. */
+    if (CACHE_RV_OK != cache_coh_init())
+        return CACHE_RV_ERR;
+
+    /* Set up the prefetchers, if asked for. */
+    for (core = 0; core < g_num_cores; ++core) {
+        if (CACHE_RV_OK != cache_pf_init(&g_l1_caches[core],
+                    &g_cache_opts.level[CACHE_OPTS_L1]))
+            return CACHE_RV_ERR;
+    }
+    if ((cache_util_is_l2_present()) &&
+             (CACHE_RV_OK != cache_pf_init(&g_l2_cache,
+                    &g_cache_opts.level[CACHE_OPTS_L2])))
+        return CACHE_RV_ERR;
+
+    /* Set up the write-back buffers, if asked for. */
+    for (core = 0; core < g_num_cores; ++core) {
+        if ((CACHE_RV_OK != cache_wbb_init(&g_l1_caches[core],
+                        &g_cache_opts.level[CACHE_OPTS_L1])) ||
+                ((cache_util_is_victim_present()) &&
+                 (CACHE_RV_OK != cache_wbb_init(&g_vic_caches[core],
+                        &g_cache_opts.level[CACHE_OPTS_VC]))))
+            return CACHE_RV_ERR;
+    }
+    if ((cache_util_is_l2_present()) &&
+             (CACHE_RV_OK != cache_wbb_init(&g_l2_cache,
+                    &g_cache_opts.level[CACHE_OPTS_L2])))
+        return CACHE_RV_ERR;
 
-#ifdef DBG_ON
-    cache_print_cache_dbg_data(&g_l1_cache);
-#endif /* DBG_ON */
-
-    /* Dump the cache simulator configuration, cache state and statistics. */
-    dprint_dbg("\n");
-    cache_print_sim_config(&g_l1_cache);
-
-    cache_print_cache_data(&g_l1_cache);
-    if (cache_util_is_victim_present())
-        cache_print_cache_data(&g_vic_cache);
-    if (cache_util_is_l2_present())
-        cache_print_cache_data(&g_l2_cache);
-
-    cache_print_sim_stats(&g_l1_cache);
+    /* Start interval stats collection, if asked for. */
+    if (CACHE_RV_OK != cache_interval_init())
+        return CACHE_RV_ERR;
 
-    /* Cleanup and exit normally. */
-    if (trace_fptr) 
-        fclose(trace_fptr);
+    /* Set up the timing model, if asked for. */
+    if (CACHE_RV_OK != cache_timing_init())
+        return CACHE_RV_ERR;
 
-    if (cache_util_is_victim_present())
-        cache_cleanup(&g_vic_cache);
-    if (cache_util_is_l2_present())
-        cache_cleanup(&g_l2_cache);
-    cache_cleanup(&g_l1_cache);
+    return CACHE_RV_OK;
+}
 
-    return 0;
 
-usage_exit:
-    return -1;
+/*************************************************************************** 
+ * Name:    cache_sim_finish
+ *
+ * Desc:    Wraps up a simulation after its last reference: writes out what
+ *          the write-back buffers still hold and closes the interval and
+ *          timing models.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_sim_finish(void)
+{
+    uint32_t        core = 0;
 
-error_exit:
-    if (trace_fptr)
-        fclose(trace_fptr);
+    /* Write out the blocks still waiting in the write-back buffers. */
+    if (g_cache_wbb_on) {
+        for (core = 0; core < g_num_cores; ++core)
+            cache_wbb_flush(&g_l1_caches[core]);
+    }
 
-    if (cache_util_is_victim_present())
-        cache_cleanup(&g_vic_cache);
-    if (cache_util_is_l2_present())
-        cache_cleanup(&g_l2_cache);
-    cache_cleanup(&g_l1_cache);
+    cache_interval_cleanup();
+    cache_timing_finish();
 
-    return -1;
+    return;
 }
-
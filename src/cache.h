@@ -26,15 +26,32 @@
 #define CACHE_NAME_LEN          24
 #define CACHE_ADDR_32BIT_LEN    32
 #define CACHE_TRACE_FILE_LEN    256
+#define CACHE_MAX_CORES         64      /* sharers fit a 64-bit mask    */
 
 #define CACHE_REPL_PLCY_LRU     0
 #define CACHE_REPL_PLCY_LFU     1
+#define CACHE_REPL_PLCY_FIFO    2
+#define CACHE_REPL_PLCY_RANDOM  3
+#define CACHE_REPL_PLCY_PLRU_TREE   4
+#define CACHE_REPL_PLCY_PLRU_BIT    5
+#define CACHE_REPL_PLCY_SRRIP   6
+#define CACHE_REPL_PLCY_BRRIP   7
+#define CACHE_REPL_PLCY_OPT     8
+#define CACHE_REPL_PLCY_MAX     9
 #define CACHE_WRITE_PLCY_WBWA   0
 #define CACHE_WRITE_PLCY_WTNA   1
 
 #define MEM_REF_TYPE_READ       'r'
 #define MEM_REF_TYPE_WRITE      'w'
 
+#define MEM_REF_F_PREFETCH      0x1     /* issued by a prefetcher       */
+
+/* MESI states of the blocks in the private (per-core) caches */
+#define CACHE_MESI_I            0
+#define CACHE_MESI_S            1
+#define CACHE_MESI_E            2
+#define CACHE_MESI_M            3
+
 /* Standard typedefs */
 typedef unsigned char uchar;
 typedef unsigned char boolean;
@@ -46,6 +63,10 @@ typedef enum cache_rv__ {
 /* Memory reference: address and refernce type */
 typedef struct mem_ref__ {
     uint8_t     ref_type;
+    uint8_t     ref_flags;              /* MEM_REF_F_*                  */
+    uint8_t     ref_core;               /* issuing core                 */
+    uint8_t     ref_size_bits;          /* log2 of the bytes covered, for
+                                           sectored caches; 0 from trace*/
     uint32_t    ref_addr;
 } mem_ref_t;
 
@@ -57,10 +78,12 @@ typedef struct cache_line__ {
 } cache_line_t;
 
 typedef struct cache_tag_data__ {
-    uint64_t        age;                    /* age of this block (LRU)  */
-    uint32_t        ref_count;              /* ref. count (LFU)         */
     uint8_t         valid;                  /* valid bit of the block   */
     uint8_t         dirty;                  /* dirty bit of the block   */
+    uint8_t         prefetched;             /* filled by prefetch, and
+                                               not referenced yet       */
+    uint8_t         state;                  /* CACHE_MESI_*; tracked only
+                                               with more than one core  */
 } cache_tag_data_t;
 
 /* Cache tag store data structure */
@@ -72,11 +95,23 @@ typedef struct cache_tagstore__ {
     uint8_t             num_tag_bits;           /* # of bits for tags       */
     uint8_t             num_index_bits;         /* # of bits for index      */
     uint8_t             num_offset_bits;        /* # of bits for blk offset */
-    uint8_t             *lru_block_id;          /* LRU block within the set */
-    uint32_t            *index;                 /* ptr to tag indices       */
+    uint8_t             num_sector_bits;        /* log2 of sector size; the
+                                                   offset bits if none      */
     uint32_t            *tags;                  /* ptr to tag array         */
     cache_tag_data_t    *tag_data;              /* ptr to tag stats         */
-    uint32_t            *set_ref_count;         /* row-wise ref count (LFU) */
+    const struct cache_repl_ops__ *repl;        /* replacement policy       */
+    void                *repl_state;            /* policy private state     */
+    struct cache_fa__   *fa;                    /* tag index; fully assoc.
+                                                   tagstores only           */
+    struct cache_ptag__ *ptag;                  /* partial tag filter, if
+                                                   any                      */
+    uint8_t             index_fn;               /* CACHE_INDEX_* function   */
+    uint32_t            num_index_sets;         /* # of sets it maps to     */
+    struct cache_sets__ *sets;                  /* per set conflict counters,
+                                                   if any                   */
+    uint32_t            *sec_valid;             /* valid sectors per block;
+                                                   sectored tagstores only  */
+    uint32_t            *sec_dirty;             /* dirty sectors per block  */
 } cache_tagstore_t;
 
 /* Cache statistics data structure */
@@ -89,7 +124,41 @@ typedef struct cache_stats__ {
     uint32_t            num_read_misses;        /* # of read misses         */
     uint32_t            num_write_misses;       /* # of write misses        */
     uint32_t            num_write_backs;        /* # of write backs         */
+    uint32_t            num_write_throughs;     /* # of writes passed on by
+                                                   a WTNA cache             */
     uint32_t            num_blk_mem_traffic;    /* # of blks transferred    */
+    uint32_t            num_pf_issued;          /* # of prefetches issued   */
+    uint32_t            num_pf_useful;          /* # of prefetched blks hit */
+    uint32_t            num_pf_late;            /* # of demand misses on
+                                                   in-flight prefetches     */
+    uint32_t            num_pf_polluting;       /* # of demand misses on
+                                                   blks evicted by pf fills */
+    uint32_t            num_pf_fills;           /* # of blks prefetched     */
+    uint32_t            num_coh_invals;         /* # of blks invalidated by
+                                                   other cores' writes      */
+    uint32_t            num_coh_downgrades;     /* # of E/M blks downgraded
+                                                   by other cores' reads    */
+    uint32_t            num_coh_upgrades;       /* # of S to M upgrades     */
+    uint32_t            num_coh_write_backs;    /* # of M blks written back
+                                                   due to coherence         */
+    uint32_t            num_back_invals;        /* # of blks invalidated by
+                                                   inclusive L2 evictions   */
+    uint32_t            num_back_inval_wbs;     /* # of those that were
+                                                   dirty                    */
+    uint32_t            num_victim_fills;       /* # of blks filled from the
+                                                   private caches' victims,
+                                                   exclusive L2             */
+    uint32_t            num_wbb_writes;         /* # of write backs put in
+                                                   the write-back buffer    */
+    uint32_t            num_wbb_coalesced;      /* # of those merged into a
+                                                   waiting entry            */
+    uint32_t            num_wbb_full_stalls;    /* # of those that found
+                                                   the buffer full          */
+    uint32_t            num_sector_misses;      /* # of tag hits missing
+                                                   the sectors asked for    */
+    uint64_t            num_fill_bytes;         /* bytes read from the next
+                                                   level or memory          */
+    uint64_t            num_wb_bytes;           /* bytes written back       */
     void                *cache;                 /* ptr to parent cache      */
 } cache_stats_t;
 
@@ -98,14 +167,22 @@ typedef struct cache_generic__ {
     char                name[CACHE_NAME_LEN];   /* name - L1, L2..          */
     char                trace_file[CACHE_TRACE_FILE_LEN];
     uint8_t             level;                  /* 1, 2, 3 ..               */
+    uint8_t             core;                   /* owner core of L1 and VC  */
     uint16_t            set_assoc;              /* level of associativity   */
     uint32_t            blk_size;               /* cache block size         */
     uint32_t            size;                   /* total cache size         */
     uint8_t             repl_plcy;              /* replacement policy       */
     uint8_t             write_plcy;             /* write policy             */
+    const struct cache_write_ops__ *write;      /* write policy hooks       */
     uint32_t            victim_size;            /* victim cache size        */
+    uint32_t            num_sectors;            /* sectors per block; 0 or 1
+                                                   if not sectored          */
+    uint8_t             ptags;                  /* CACHE_PTAGS_* filter     */
+    uint8_t             index_fn;               /* CACHE_INDEX_* function   */
     cache_stats_t       stats;                  /* cache statistics         */
     cache_tagstore_t    *tagstore;              /* associated tagstore      */
+    struct cache_pf__   *pf;                    /* prefetcher, if any       */
+    struct cache_wbb__  *wbb;                   /* write-back buffer, if any*/
     struct cache_generic__ *next_cache;         /* next higher level cache  */
     struct cache_generic__ *prev_cache;         /* prev lower level cache   */
 } cache_generic_t;
@@ -114,9 +191,10 @@ typedef struct cache_generic__ {
 /* Externs */
 extern boolean          g_l2_present;
 extern boolean          g_victim_present;
-extern cache_generic_t  g_l1_cache;
+extern uint32_t         g_num_cores;
+extern cache_generic_t  g_l1_caches[];
 extern cache_generic_t  g_l2_cache;
-extern cache_generic_t  g_vic_cache;
+extern cache_generic_t  g_vic_caches[];
 extern const char       *g_dirty;
 extern const char       *g_l1_name;
 extern const char       *g_l2_name;
@@ -133,6 +211,12 @@ cache_init(cache_generic_t *l1_cache, cache_generic_t *vic_cache,
 void
 cache_cleanup(cache_generic_t *pcache);
 void
+cache_cleanup_all(void);
+cache_rv
+cache_sim_init(void);
+void
+cache_sim_finish(void);
+cache_rv
 cache_tagstore_init(cache_generic_t *cache, cache_tagstore_t *tagstore);
 void
 cache_tagstore_cleanup(cache_generic_t *cache, cache_tagstore_t *tagstore);
@@ -148,19 +232,27 @@ int32_t
 cache_get_first_invalid_block(cache_tagstore_t *tagstore, cache_line_t *line);
 int32_t
 cache_does_tag_match(cache_tagstore_t *tagstore, cache_line_t *line);
-int32_t
-cache_get_lru_block(cache_tagstore_t *tagstore, mem_ref_t *mref,
-        cache_line_t *line);
-int32_t
-cache_get_lfu_block(cache_tagstore_t *tagstore, mem_ref_t *mref,
-    cache_line_t *line);
+void
+cache_tagstore_fill(cache_tagstore_t *tagstore, uint32_t set, uint32_t way);
+void
+cache_tagstore_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way);
+void
+cache_tagstore_set_dirty(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way, uint32_t sectors);
 int32_t
 cache_evict_tag(cache_generic_t *cache, mem_ref_t *mref, cache_line_t *line);
 void
 cache_handle_dirty_tag_evicts(cache_generic_t *cache, mem_ref_t *mem_ref, 
         uint32_t block_id);
 void
+cache_write_back(cache_generic_t *cache, uint32_t addr, uint32_t sectors);
+void
 cache_evict_and_add_tag(cache_generic_t *cache, mem_ref_t *mem_ref);
+boolean
+cache_is_block_present(cache_generic_t *cache, uint32_t addr);
+boolean
+cache_prefetch_fill(cache_generic_t *cache, uint32_t addr);
 
 #if 0
 inline void
@@ -0,0 +1,210 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the per-simulation memory arena.
+ *
+ * Memory is bump allocated from anonymous mappings of at least
+ * CACHE_ARENA_CHUNK bytes, rounded up to the huge page size; a config
+ * normally fits in one of them. Pages are only committed when touched, and
+ * fresh mappings are zeroed, so a block is never cleared or freed on its
+ * own: the whole arena goes away with cache_arena_release. With
+ * --hugepages=thp the mappings are advised for transparent huge pages;
+ * with --hugepages=hugetlb they are mapped from the hugetlbfs pool, falling
+ * back to THP advice once the pool runs dry.
+ *
+ * The arena is filled while the caches are set up, on the main thread;
+ * it's not meant for allocations during the simulation.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_arena.h"
+
+/* Globals */
+cache_arena_t       g_cache_arena;      /* arena of the simulation      */
+
+
+/***************************************************************************
+ * Name:    cache_arena_init
+ *
+ * Desc:    Sets up the arena as per --hugepages= and --arena-align=. No
+ *          memory is mapped until the first allocation.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR on an invalid alignment
+ **************************************************************************/
+cache_rv
+cache_arena_init(void)
+{
+    uint32_t    align = g_cache_opts.arena_align;
+
+    if (!align)
+        align = CACHE_ARENA_DEF_ALIGN;
+
+    if ((align < sizeof(uint64_t)) || (align > CACHE_ARENA_MAX_ALIGN) ||
+            (!util_is_power_of_2(align))) {
+        dprint("Error: --arena-align must be a power of 2, from %zu to %u.\n",
+                sizeof(uint64_t), CACHE_ARENA_MAX_ALIGN);
+        return CACHE_RV_ERR;
+    }
+
+    memset(&g_cache_arena, 0, sizeof(g_cache_arena));
+    g_cache_arena.hugepages = g_cache_opts.hugepages;
+    g_cache_arena.align = align;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_arena_map
+ *
+ * Desc:    Maps a new chunk big enough for the given # of bytes and makes
+ *          it the current one.
+ *
+ * Params:
+ *  arena   ptr to the arena
+ *  bytes   # of bytes the chunk must fit, after its header
+ *
+ * Returns: cache_arena_chunk_t *
+ *  ptr to the new chunk on success
+ *  NULL otherwise
+ **************************************************************************/
+static cache_arena_chunk_t *
+cache_arena_map(cache_arena_t *arena, size_t bytes)
+{
+    void                *base = MAP_FAILED;
+    size_t              size = 0;
+    boolean             hugetlb = FALSE;
+    cache_arena_chunk_t *chunk = NULL;
+
+    size = (bytes + CACHE_ARENA_MAX_ALIGN);
+    if (size < CACHE_ARENA_CHUNK)
+        size = CACHE_ARENA_CHUNK;
+    size = ((size + CACHE_ARENA_HUGE_PAGE - 1) & ~(CACHE_ARENA_HUGE_PAGE - 1));
+
+#ifdef MAP_HUGETLB
+    if (CACHE_HUGEPAGES_HUGETLB == arena->hugepages) {
+        base = mmap(NULL, size, (PROT_READ | PROT_WRITE),
+                (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB), -1, 0);
+        if (MAP_FAILED == base)
+            arena->num_fallbacks += 1;
+        else
+            hugetlb = TRUE;
+    }
+#endif /* MAP_HUGETLB */
+
+    if (MAP_FAILED == base) {
+        base = mmap(NULL, size, (PROT_READ | PROT_WRITE),
+                (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE), -1, 0);
+        if (MAP_FAILED == base)
+            return NULL;
+
+#ifdef MADV_HUGEPAGE
+        if (CACHE_HUGEPAGES_OFF != arena->hugepages)
+            (void) madvise(base, size, MADV_HUGEPAGE);
+#endif /* MADV_HUGEPAGE */
+    }
+
+    chunk = base;
+    chunk->next = arena->chunks;
+    chunk->size = size;
+    chunk->used = sizeof(*chunk);
+    chunk->hugetlb = hugetlb;
+
+    arena->chunks = chunk;
+    arena->num_chunks += 1;
+    arena->num_mapped += size;
+
+    return chunk;
+}
+
+
+/***************************************************************************
+ * Name:    cache_arena_calloc
+ *
+ * Desc:    Carves a zeroed block out of the arena, aligned as per
+ *          --arena-align=. The block lives until cache_arena_release.
+ *
+ * Params:
+ *  num     # of elements
+ *  size    size of an element
+ *
+ * Returns: void *
+ *  ptr to the block on success
+ *  NULL otherwise
+ **************************************************************************/
+void *
+cache_arena_calloc(size_t num, size_t size)
+{
+    size_t              bytes = 0;
+    size_t              offset = 0;
+    cache_arena_t       *arena = &g_cache_arena;
+    cache_arena_chunk_t *chunk = arena->chunks;
+
+    if ((size) && (num > (SIZE_MAX / size)))
+        return NULL;
+    bytes = (num * size);
+    if (!bytes)
+        bytes = 1;
+
+    if (chunk)
+        offset = ((chunk->used + arena->align - 1) & ~(arena->align - 1));
+
+    if ((!chunk) || ((offset + bytes) > chunk->size)) {
+        chunk = cache_arena_map(arena, bytes);
+        if (!chunk)
+            return NULL;
+        offset = ((chunk->used + arena->align - 1) & ~(arena->align - 1));
+    }
+
+    chunk->used = (offset + bytes);
+    arena->num_allocs += 1;
+    arena->num_bytes += bytes;
+
+    return (((uint8_t *) chunk) + offset);
+}
+
+
+/***************************************************************************
+ * Name:    cache_arena_release
+ *
+ * Desc:    Unmaps all the chunks of the arena at once. Every block carved
+ *          out of it is gone afterwards.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_arena_release(void)
+{
+    cache_arena_chunk_t *chunk = g_cache_arena.chunks;
+    cache_arena_chunk_t *next = NULL;
+
+    dprint_info("arena: %lu blocks, %lu bytes in %u chunks (%lu mapped)\n",
+            g_cache_arena.num_allocs, g_cache_arena.num_bytes,
+            g_cache_arena.num_chunks, g_cache_arena.num_mapped);
+
+    for (; chunk; chunk = next) {
+        next = chunk->next;
+        munmap(chunk, chunk->size);
+    }
+    g_cache_arena.chunks = NULL;
+    g_cache_arena.num_chunks = 0;
+
+    return;
+}
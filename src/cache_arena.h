@@ -0,0 +1,63 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the per-simulation memory arena. All the tagstore arrays and the
+ * replacement policy state are carved out of a few large mappings, which
+ * may be backed by huge pages, and are released together at exit.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_ARENA_H_
+#define CACHE_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_HUGEPAGES_OFF         0   /* regular pages                */
+#define CACHE_HUGEPAGES_THP         1   /* advise transparent hugepages */
+#define CACHE_HUGEPAGES_HUGETLB     2   /* MAP_HUGETLB, else THP advice */
+
+#define CACHE_ARENA_CHUNK           (64UL << 20)    /* min mapping size */
+#define CACHE_ARENA_HUGE_PAGE       (2UL << 20)     /* mapping rounding */
+#define CACHE_ARENA_DEF_ALIGN       64              /* a cache line     */
+#define CACHE_ARENA_MAX_ALIGN       4096
+
+/* One mapping; the header sits at its start */
+typedef struct cache_arena_chunk__ {
+    struct cache_arena_chunk__  *next;  /* previous mapping             */
+    size_t                      size;   /* size of the mapping          */
+    size_t                      used;   /* bytes carved out, incl. hdr  */
+    boolean                     hugetlb;/* backed by MAP_HUGETLB        */
+} cache_arena_chunk_t;
+
+/* Arena state and statistics */
+typedef struct cache_arena__ {
+    uint8_t             hugepages;      /* CACHE_HUGEPAGES_*            */
+    uint32_t            align;          /* alignment of every block     */
+    cache_arena_chunk_t *chunks;        /* newest mapping first         */
+    uint32_t            num_chunks;     /* # of mappings                */
+    uint32_t            num_fallbacks;  /* # of failed MAP_HUGETLBs     */
+    uint64_t            num_allocs;     /* # of blocks carved out       */
+    uint64_t            num_bytes;      /* # of bytes carved out        */
+    uint64_t            num_mapped;     /* # of bytes mapped            */
+} cache_arena_t;
+
+
+/* Externs */
+extern cache_arena_t    g_cache_arena;
+
+
+/* Function declarations */
+cache_rv
+cache_arena_init(void);
+void *
+cache_arena_calloc(size_t num, size_t size);
+void
+cache_arena_release(void);
+
+#endif /* CACHE_ARENA_H_ */
@@ -0,0 +1,324 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * Microbenchmarks of the simulator hot paths: address decode, tag match,
+ * victim selection of every replacement policy and the L1 - VC swap. It's
+ * linked with the simulator objects, less the driver (cache_main.c), and
+ * run by "make bench" (see bench.sh), which adds the end-to-end runs.
+ *
+ * Every benchmark prints one CSV line:
+ *  suite,name,config,ops,seconds,ops_per_sec
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_arena.h"
+#include "cache_incl.h"
+#include "cache_repl.h"
+
+/* Constants */
+#define CACHE_BENCH_DEF_OPS         10000000    /* ops per benchmark    */
+#define CACHE_BENCH_NUM_ADDRS       4096        /* power of 2           */
+#define CACHE_BENCH_MAX_ARGS        16
+
+/* Globals */
+static cache_tagstore_t g_bench_l1_ts;
+static cache_tagstore_t g_bench_vc_ts;
+static cache_tagstore_t g_bench_l2_ts;
+static uint32_t         g_bench_addrs[CACHE_BENCH_NUM_ADDRS];
+static cache_line_t     g_bench_lines[CACHE_BENCH_NUM_ADDRS];
+static volatile uint32_t g_bench_sink;  /* keeps the work from going away */
+
+
+/* Returns the monotonic time in seconds. */
+static double
+cache_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+
+/* Prints the result line of a benchmark. */
+static void
+cache_bench_report(const char *name, const char *config, uint64_t ops,
+        double secs)
+{
+    printf("micro,%s,%s,%lu,%.6f,%.0f\n", name, config, ops, secs,
+            ((secs > 0) ? (ops / secs) : 0.0));
+    fflush(stdout);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_bench_setup
+ *
+ * Desc:    Sets up the caches for a benchmark from a command line, the way
+ *          the simulator does: options, then the positional configuration.
+ *          Whatever the previous benchmark set up is released first.
+ *
+ * Params:
+ *  cmd     ptr to the command line, without the program name
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+static cache_rv
+cache_bench_setup(const char *cmd)
+{
+    int         argc = 1;
+    int         num_opts = 0;
+    char        buf[256];
+    char        *argv[CACHE_BENCH_MAX_ARGS + 1];
+    char        *tok = NULL;
+
+    if (g_l1_caches[0].tagstore) {
+        cache_cleanup(&g_l1_caches[0]);
+        if (cache_util_is_victim_present())
+            cache_cleanup(&g_vic_caches[0]);
+        if (cache_util_is_l2_present())
+            cache_cleanup(&g_l2_cache);
+        cache_arena_release();
+    }
+
+    strncpy(buf, cmd, (sizeof(buf) - 1));
+    buf[sizeof(buf) - 1] = '\0';
+    argv[0] = "sim_cache_bench";
+    for (tok = strtok(buf, " "); (tok) && (argc < CACHE_BENCH_MAX_ARGS);
+            tok = strtok(NULL, " "))
+        argv[argc++] = tok;
+    argv[argc] = NULL;
+
+    num_opts = cache_opts_parse(argc, argv);
+    if (CACHE_RV_ERR == num_opts)
+        return CACHE_RV_ERR;
+    argv[num_opts] = argv[0];
+
+    if (CACHE_RV_OK != cache_arena_init())
+        return CACHE_RV_ERR;
+
+    g_num_cores = 1;
+    cache_init(g_l1_caches, g_vic_caches, &g_l2_cache, (argc - num_opts),
+            (argv + num_opts));
+    if (CACHE_RV_OK != cache_incl_init())
+        return CACHE_RV_ERR;
+
+    if ((CACHE_RV_OK != cache_tagstore_init(&g_l1_caches[0],
+                    &g_bench_l1_ts)) ||
+            ((cache_util_is_victim_present()) &&
+             (CACHE_RV_OK != cache_tagstore_init(&g_vic_caches[0],
+                    &g_bench_vc_ts))) ||
+            ((cache_util_is_l2_present()) &&
+             (CACHE_RV_OK != cache_tagstore_init(&g_l2_cache,
+                    &g_bench_l2_ts))))
+        return CACHE_RV_ERR;
+
+    return CACHE_RV_OK;
+}
+
+
+/* Runs the benchmark addresses through L1 as reads. */
+static void
+cache_bench_warm(void)
+{
+    uint32_t    iter = 0;
+    mem_ref_t   mref;
+
+    memset(&mref, 0, sizeof(mref));
+    mref.ref_type = MEM_REF_TYPE_READ;
+    for (iter = 0; iter < CACHE_BENCH_NUM_ADDRS; ++iter) {
+        mref.ref_addr = g_bench_addrs[iter];
+        cache_handle_memory_request(&g_l1_caches[0], &mref);
+    }
+
+    return;
+}
+
+
+/* Address decode into <tag, index, offset>. */
+static void
+cache_bench_decode(uint64_t ops)
+{
+    uint64_t        iter = 0;
+    uint32_t        sum = 0;
+    double          start = 0.0;
+    cache_line_t    line;
+
+    if (CACHE_RV_OK != cache_bench_setup("32 8192 4 0 0 0 bench"))
+        return;
+
+    start = cache_bench_now();
+    for (iter = 0; iter < ops; ++iter) {
+        cache_util_decode_mem_addr(&g_bench_l1_ts,
+                g_bench_addrs[iter & (CACHE_BENCH_NUM_ADDRS - 1)], &line);
+        sum += (line.tag ^ line.index);
+    }
+    cache_bench_report("decode", "32B/8KB/4-way", ops,
+            (cache_bench_now() - start));
+    g_bench_sink = sum;
+
+    return;
+}
+
+
+/* Tag match of decoded lines, over a warm cache; half of them hit. */
+static void
+cache_bench_tag_match(const char *name, const char *config, const char *cmd,
+        uint64_t ops)
+{
+    uint64_t    iter = 0;
+    uint32_t    sum = 0;
+    double      start = 0.0;
+
+    if (CACHE_RV_OK != cache_bench_setup(cmd))
+        return;
+
+    cache_bench_warm();
+    for (iter = 0; iter < CACHE_BENCH_NUM_ADDRS; ++iter) {
+        cache_util_decode_mem_addr(&g_bench_l1_ts,
+                (g_bench_addrs[iter] ^ ((iter & 1) << 28)),
+                &g_bench_lines[iter]);
+    }
+
+    start = cache_bench_now();
+    for (iter = 0; iter < ops; ++iter) {
+        sum += cache_does_tag_match(&g_bench_l1_ts,
+                &g_bench_lines[iter & (CACHE_BENCH_NUM_ADDRS - 1)]);
+    }
+    cache_bench_report(name, config, ops, (cache_bench_now() - start));
+    g_bench_sink = sum;
+
+    return;
+}
+
+
+/* Victim selection and refill of full sets, for one policy. */
+static void
+cache_bench_victim(const char *policy, uint64_t ops)
+{
+    char        cmd[128];
+    char        name[64];
+    uint64_t    iter = 0;
+    uint32_t    set = 0;
+    uint32_t    way = 0;
+    uint32_t    sum = 0;
+    uint32_t    num_sets = 0;
+    double      start = 0.0;
+    const cache_repl_ops_t *repl = NULL;
+
+    snprintf(cmd, sizeof(cmd), "--l1-repl=%s 32 8192 8 0 0 0 bench", policy);
+    if (CACHE_RV_OK != cache_bench_setup(cmd))
+        return;
+
+    /* Fill every way of every set first. */
+    num_sets = g_bench_l1_ts.num_sets;
+    repl = g_bench_l1_ts.repl;
+    for (set = 0; set < num_sets; ++set) {
+        for (way = 0; way < g_bench_l1_ts.num_blocks_per_set; ++way) {
+            cache_tagstore_fill(&g_bench_l1_ts, set, way);
+            repl->on_fill(&g_bench_l1_ts, set, way);
+        }
+    }
+
+    start = cache_bench_now();
+    for (iter = 0; iter < ops; ++iter) {
+        set = ((g_bench_addrs[iter & (CACHE_BENCH_NUM_ADDRS - 1)] >> 5) &
+                (num_sets - 1));
+        way = repl->choose_victim(&g_bench_l1_ts, set);
+        repl->on_fill(&g_bench_l1_ts, set, way);
+        if (iter & 1)
+            repl->on_hit(&g_bench_l1_ts, set, (way ^ 1));
+        sum += way;
+    }
+    snprintf(name, sizeof(name), "victim_%s", policy);
+    cache_bench_report(name, "32B/8KB/8-way", ops,
+            (cache_bench_now() - start));
+    g_bench_sink = sum;
+
+    return;
+}
+
+
+/* L1 - VC swaps: two blocks that conflict in a direct mapped L1. */
+static void
+cache_bench_swap(uint64_t ops)
+{
+    uint64_t    iter = 0;
+    double      start = 0.0;
+    mem_ref_t   mref;
+
+    if (CACHE_RV_OK != cache_bench_setup("32 1024 1 256 0 0 bench"))
+        return;
+
+    memset(&mref, 0, sizeof(mref));
+    mref.ref_type = MEM_REF_TYPE_READ;
+    mref.ref_addr = 0;
+    cache_handle_memory_request(&g_l1_caches[0], &mref);
+
+    start = cache_bench_now();
+    for (iter = 0; iter < ops; ++iter) {
+        mref.ref_addr = ((iter & 1) ? 1024 : 0);
+        cache_handle_memory_request(&g_l1_caches[0], &mref);
+    }
+    cache_bench_report("victim_swap", "32B/1KB/1-way+VC256", ops,
+            (cache_bench_now() - start));
+    g_bench_sink = g_l1_caches[0].stats.num_swaps;
+
+    return;
+}
+
+
+/* Usage: sim_cache_bench [ops per benchmark] */
+int
+main(int argc, char **argv)
+{
+    uint32_t    iter = 0;
+    uint32_t    seed = 0x2014;
+    uint64_t    ops = CACHE_BENCH_DEF_OPS;
+
+    if (argc > 1)
+        ops = strtoull(argv[1], NULL, 0);
+    if (!ops) {
+        printf("Usage: %s [ops per benchmark]\n", argv[0]);
+        return -1;
+    }
+
+    /* Random block addresses over 1MB, as seen by the benchmarks. */
+    for (iter = 0; iter < CACHE_BENCH_NUM_ADDRS; ++iter)
+        g_bench_addrs[iter] = (util_xorshift32(&seed) & 0xfffe0);
+
+    printf("suite,name,config,ops,seconds,ops_per_sec\n");
+    cache_bench_decode(ops);
+    cache_bench_tag_match("tag_match", "32B/8KB/4-way",
+            "32 8192 4 0 0 0 bench", ops);
+    cache_bench_tag_match("tag_match_fa", "32B/8KB/256-way",
+            "32 8192 256 0 0 0 bench", ops);
+    for (iter = 0; g_cache_repl_names[iter]; ++iter) {
+        /* OPT needs the trace itself. */
+        if (strcmp(g_cache_repl_names[iter], "opt"))
+            cache_bench_victim(g_cache_repl_names[iter], ops);
+    }
+    cache_bench_swap(ops);
+
+    cache_cleanup(&g_l1_caches[0]);
+    if (cache_util_is_victim_present())
+        cache_cleanup(&g_vic_caches[0]);
+    cache_arena_release();
+
+    return 0;
+}
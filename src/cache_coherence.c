@@ -0,0 +1,428 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements MESI coherence for the private caches of the
+ * simulated cores, with an L2 side sharer directory.
+ *
+ * L1 and its VC act as one private cache per core; a block moving between
+ * them keeps its state and stays in the directory. The directory is told
+ * about every block leaving a private cache, clean or dirty, so its
+ * sharer masks are exact and no broadcast is ever needed:
+ *  - a read miss downgrades the E/M copy of another core, if any, to S;
+ *  - a write miss, or a write hit on an S block (an upgrade), invalidates
+ *    the copies of all the other sharers.
+ * M copies that are downgraded or invalidated are written back to L2 (or
+ * memory) first, so that the requester reads the latest data from there.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_repl.h"
+#include "cache_coherence.h"
+
+/* Globals */
+cache_coh_t     *g_cache_coh;           /* NULL with a single core      */
+
+
+/* Home slot of a block in the directory */
+static inline uint32_t
+cache_coh_hash(cache_coh_t *coh, uint32_t blk)
+{
+    return ((blk * 0x9e3779b1U) & coh->mask);
+}
+
+
+/* Returns the slot of the block, or the free slot it would go into. */
+static uint32_t
+cache_coh_slot(cache_coh_t *coh, uint32_t blk)
+{
+    uint32_t    slot = cache_coh_hash(coh, blk);
+
+    while ((coh->dir[slot].used) && (coh->dir[slot].blk != blk))
+        slot = ((slot + 1) & coh->mask);
+
+    return slot;
+}
+
+
+/***************************************************************************
+ * Name:    cache_coh_dir_remove
+ *
+ * Desc:    Removes a directory entry. The entries after it in the same
+ *          probe sequence are moved back, so that lookups never need
+ *          tombstones.
+ *
+ * Params:
+ *  coh     ptr to the coherence state
+ *  slot    slot of the entry to be removed
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_coh_dir_remove(cache_coh_t *coh, uint32_t slot)
+{
+    uint32_t            next = slot;
+    uint32_t            home = 0;
+    cache_dir_entry_t   *dir = coh->dir;
+
+    dir[slot].used = 0;
+    while (dir[(next = ((next + 1) & coh->mask))].used) {
+        /* Move the entry back if the hole lies between its home and it. */
+        home = cache_coh_hash(coh, dir[next].blk);
+        if (((next - home) & coh->mask) >= ((next - slot) & coh->mask)) {
+            dir[slot] = dir[next];
+            dir[next].used = 0;
+            slot = next;
+        }
+    }
+    coh->count -= 1;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_coh_init
+ *
+ * Desc:    Sets up the sharer directory when more than one core is
+ *          simulated. The directory is sized for all the private cache
+ *          blocks at half load. To be called after the tagstores are set
+ *          up.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success or with a single core
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_coh_init(void)
+{
+    uint64_t        num_blocks = 0;
+    uint64_t        num_slots = CACHE_COH_MIN_DIR_SLOTS;
+    cache_coh_t     *coh = NULL;
+    cache_generic_t *l1 = cache_util_get_l1(0);
+
+    if (g_num_cores < 2)
+        return CACHE_RV_OK;
+
+    num_blocks = l1->tagstore->num_blocks;
+    if (cache_util_is_victim_present())
+        num_blocks += cache_util_get_vc(0)->tagstore->num_blocks;
+    num_blocks *= g_num_cores;
+    while (num_slots < (2 * num_blocks))
+        num_slots <<= 1;
+
+    coh = calloc(1, sizeof(*coh));
+    if ((!coh) || (num_slots > (1ULL << 31)) ||
+            (!(coh->dir = calloc(num_slots, sizeof(*coh->dir))))) {
+        dprint("Error: Unable to allocate memory for the coherence "
+                "directory.\n");
+        free(coh);
+        return CACHE_RV_ERR;
+    }
+    coh->mask = (uint32_t) (num_slots - 1);
+    coh->blk_bits = l1->tagstore->num_offset_bits;
+    g_cache_coh = coh;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_coh_cleanup
+ *
+ * Desc:    Frees the sharer directory.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_coh_cleanup(void)
+{
+    if (!g_cache_coh)
+        return;
+
+    free(g_cache_coh->dir);
+    free(g_cache_coh);
+    g_cache_coh = NULL;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_coh_find
+ *
+ * Desc:    Looks up a block in the private caches (L1, then VC) of a core.
+ *
+ * Params:
+ *  core    ID of the core
+ *  addr    block address
+ *  line    ptr to the line, decoded for the cache holding the block
+ *  way     ptr to the way holding the block
+ *
+ * Returns: cache_generic_t *
+ *  ptr to the cache holding the block
+ *  NULL if the core doesn't have the block
+ **************************************************************************/
+static cache_generic_t *
+cache_coh_find(uint32_t core, uint32_t addr, cache_line_t *line,
+        int32_t *way)
+{
+    cache_generic_t *cache = cache_util_get_l1(core);
+
+    for (; (cache) && ((CACHE_IS_L1(cache)) || (CACHE_IS_VC(cache)));
+            cache = cache->next_cache) {
+        cache_util_decode_mem_addr(cache->tagstore, addr, line);
+        *way = cache_does_tag_match(cache->tagstore, line);
+        if (CACHE_RV_ERR != *way)
+            return cache;
+    }
+
+    return NULL;
+}
+
+
+/* Writes a block modified by another core back to L2 or memory. */
+static void
+cache_coh_flush(cache_coh_t *coh, cache_generic_t *cache, uint32_t addr)
+{
+    mem_ref_t   wb_ref;
+
+    memset(&wb_ref, 0, sizeof(wb_ref));
+    wb_ref.ref_type = MEM_REF_TYPE_WRITE;
+    wb_ref.ref_addr = addr;
+    wb_ref.ref_size_bits = cache->tagstore->num_offset_bits;
+    if (cache_util_is_l2_present())
+        cache_evict_and_add_tag(cache_util_get_l2(), &wb_ref);
+
+    cache->stats.num_coh_write_backs += 1;
+    coh->num_write_backs += 1;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_coh_recall
+ *
+ * Desc:    Invalidates (for writes of another core) or downgrades to S (for
+ *          reads of another core) the copy of a block held by a core.
+ *          Modified data is written back first.
+ *
+ * Params:
+ *  coh     ptr to the coherence state
+ *  core    ID of the core holding the block
+ *  addr    block address
+ *  inval   TRUE to invalidate, FALSE to downgrade
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_coh_recall(cache_coh_t *coh, uint32_t core, uint32_t addr,
+        boolean inval)
+{
+    int32_t             way = CACHE_RV_ERR;
+    cache_line_t        line;
+    cache_generic_t     *cache = NULL;
+    cache_tagstore_t    *tagstore = NULL;
+    cache_tag_data_t    *tag_data = NULL;
+
+    memset(&line, 0, sizeof(line));
+    cache = cache_coh_find(core, addr, &line, &way);
+    if (!cache) {
+        /* The directory is exact; a sharer always has the block. */
+        cache_assert(0);
+        return;
+    }
+    tagstore = cache->tagstore;
+    tag_data = &tagstore->tag_data[(line.index *
+            tagstore->num_blocks_per_set) + way];
+
+    if (tag_data->dirty) {
+        cache_coh_flush(coh, cache, addr);
+        tag_data->dirty = 0;
+    }
+
+    if (!inval) {
+        tag_data->state = CACHE_MESI_S;
+        cache->stats.num_coh_downgrades += 1;
+        coh->num_downgrade_msgs += 1;
+        return;
+    }
+
+    tag_data->valid = 0;
+    tag_data->prefetched = 0;
+    tag_data->state = CACHE_MESI_I;
+    cache_tagstore_invalidate(tagstore, line.index, way);
+    cache->stats.num_coh_invals += 1;
+    coh->num_inval_msgs += 1;
+
+    return;
+}
+
+
+/* Invalidates the block in all the sharers other than the given core. */
+static void
+cache_coh_inval_others(cache_coh_t *coh, cache_dir_entry_t *entry,
+        uint32_t core)
+{
+    uint32_t    sharer = 0;
+    uint64_t    others = (entry->sharers & ~(1ULL << core));
+
+    while (others) {
+        sharer = __builtin_ctzll(others);
+        others &= (others - 1);
+        cache_coh_recall(coh, sharer, (entry->blk << coh->blk_bits), TRUE);
+    }
+    entry->sharers = (1ULL << core);
+    entry->owner = core;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_coh_miss
+ *
+ * Desc:    Coherence actions for a private cache miss, i.e. the block is in
+ *          neither L1 nor the VC of the core. To be called before the block
+ *          is fetched from the next level.
+ *
+ * Params:
+ *  cache   ptr to the L1 cache of the requesting core
+ *  addr    address of the reference
+ *  write   TRUE for a write (read for ownership)
+ *
+ * Returns: uint8_t
+ *  CACHE_MESI_* state for the new block
+ **************************************************************************/
+uint8_t
+cache_coh_miss(cache_generic_t *cache, uint32_t addr, boolean write)
+{
+    uint32_t            blk = 0;
+    uint64_t            others = 0;
+    cache_coh_t         *coh = g_cache_coh;
+    cache_dir_entry_t   *entry = NULL;
+
+    blk = (addr >> coh->blk_bits);
+    coh->num_lookups += 1;
+    entry = &coh->dir[cache_coh_slot(coh, blk)];
+
+    if (!entry->used) {
+        entry->used = 1;
+        entry->blk = blk;
+        entry->sharers = (1ULL << cache->core);
+        entry->owner = cache->core;
+        coh->count += 1;
+        if (coh->count > coh->peak)
+            coh->peak = coh->count;
+        return (write ? CACHE_MESI_M : CACHE_MESI_E);
+    }
+
+    if (write) {
+        cache_coh_inval_others(coh, entry, cache->core);
+        return CACHE_MESI_M;
+    }
+
+    if ((CACHE_COH_NO_OWNER != entry->owner) &&
+            (cache->core != entry->owner)) {
+        cache_coh_recall(coh, entry->owner, (blk << coh->blk_bits), FALSE);
+    }
+
+    others = (entry->sharers & ~(1ULL << cache->core));
+    entry->sharers |= (1ULL << cache->core);
+    entry->owner = (others ? CACHE_COH_NO_OWNER : cache->core);
+
+    return (others ? CACHE_MESI_S : CACHE_MESI_E);
+}
+
+
+/***************************************************************************
+ * Name:    cache_coh_write_hit
+ *
+ * Desc:    Coherence actions for a write hit in the private caches of a
+ *          core. E blocks turn M silently; S blocks need an upgrade, which
+ *          invalidates all the other copies.
+ *
+ * Params:
+ *  cache       ptr to the L1 cache of the writing core
+ *  tag_data    ptr to the tag data of the block written
+ *  addr        address of the reference
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_coh_write_hit(cache_generic_t *cache, cache_tag_data_t *tag_data,
+        uint32_t addr)
+{
+    cache_coh_t         *coh = g_cache_coh;
+    cache_dir_entry_t   *entry = NULL;
+
+    if (CACHE_MESI_S == tag_data->state) {
+        coh->num_lookups += 1;
+        entry = &coh->dir[cache_coh_slot(coh, (addr >> coh->blk_bits))];
+        cache_assert(entry->used);
+        cache_coh_inval_others(coh, entry, cache->core);
+        cache->stats.num_coh_upgrades += 1;
+    }
+    tag_data->state = CACHE_MESI_M;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_coh_evict
+ *
+ * Desc:    Drops the core from the sharers of a block leaving its private
+ *          caches; the entry goes away with the last sharer. To be called
+ *          before the block is replaced.
+ *
+ * Params:
+ *  cache   ptr to the private cache (L1 without VC, or VC)
+ *  set     set of the block
+ *  way     way of the block
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_coh_evict(cache_generic_t *cache, uint32_t set, uint32_t way)
+{
+    uint32_t            slot = 0;
+    mem_ref_t           ref;
+    cache_line_t        line;
+    cache_coh_t         *coh = g_cache_coh;
+    cache_tagstore_t    *tagstore = cache->tagstore;
+    cache_dir_entry_t   *entry = NULL;
+
+    memset(&line, 0, sizeof(line));
+    line.tag = tagstore->tags[(set * tagstore->num_blocks_per_set) + way];
+    line.index = set;
+    cache_util_encode_mem_addr(tagstore, &line, &ref);
+
+    slot = cache_coh_slot(coh, (ref.ref_addr >> coh->blk_bits));
+    entry = &coh->dir[slot];
+    if (!entry->used) {
+        cache_assert(0);
+        return;
+    }
+
+    entry->sharers &= ~(1ULL << cache->core);
+    if (cache->core == entry->owner)
+        entry->owner = CACHE_COH_NO_OWNER;
+    if (!entry->sharers)
+        cache_coh_dir_remove(coh, slot);
+
+    return;
+}
@@ -0,0 +1,65 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * MESI coherence between the private L1 (+ VC) caches of the simulated
+ * cores. The MESI state of a block lives in its tag data; the shared L2
+ * side keeps a sparse directory of the blocks held by any private cache,
+ * with a bit mask of the cores holding them. Coherence actions only visit
+ * the cores in the mask, so their cost does not grow with the # of cores.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_COHERENCE_H_
+#define CACHE_COHERENCE_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_COH_NO_OWNER          0xff
+#define CACHE_COH_MIN_DIR_SLOTS     1024
+
+/* Directory entry; one per block held by at least one private cache */
+typedef struct cache_dir_entry__ {
+    uint64_t    sharers;                /* bit per core holding the blk */
+    uint32_t    blk;                    /* block address                */
+    uint8_t     used;                   /* slot in use                  */
+    uint8_t     owner;                  /* core with the E/M copy, or
+                                           CACHE_COH_NO_OWNER           */
+} cache_dir_entry_t;
+
+/* Coherence state and the directory statistics */
+typedef struct cache_coh__ {
+    uint8_t             blk_bits;       /* log2 of the block size       */
+    uint32_t            mask;           /* # of directory slots - 1     */
+    uint32_t            count;          /* # of directory entries       */
+    uint32_t            peak;           /* max # of directory entries   */
+    cache_dir_entry_t   *dir;           /* open addressed directory     */
+    uint64_t            num_lookups;    /* # of directory lookups       */
+    uint64_t            num_inval_msgs; /* # of invalidations sent      */
+    uint64_t            num_downgrade_msgs; /* # of downgrades sent     */
+    uint64_t            num_write_backs;    /* # of M blks flushed      */
+} cache_coh_t;
+
+
+/* Externs */
+extern cache_coh_t      *g_cache_coh;
+
+
+/* Function declarations */
+cache_rv
+cache_coh_init(void);
+void
+cache_coh_cleanup(void);
+uint8_t
+cache_coh_miss(cache_generic_t *cache, uint32_t addr, boolean write);
+void
+cache_coh_write_hit(cache_generic_t *cache, cache_tag_data_t *tag_data,
+        uint32_t addr);
+void
+cache_coh_evict(cache_generic_t *cache, uint32_t set, uint32_t way);
+
+#endif /* CACHE_COHERENCE_H_ */
@@ -0,0 +1,222 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the tag index of fully associative tagstores.
+ *
+ * Every valid way has a slot in a linear probing hash table keyed by its
+ * tag, and a bit in the used bitmap. Both are kept up to date by the fill
+ * and invalidate hooks of the tagstore. The tag array stays the reference:
+ * a slot only counts if the way still holds that tag and is valid, as the
+ * cache core rewrites a tag before it reports the fill. Slots are removed
+ * by shifting the rest of their probe run back, so there are no tombstones
+ * and a lookup stops at the first empty slot.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_arena.h"
+#include "cache_fa.h"
+
+
+/* Returns the home slot of a tag; Fibonacci hashing. */
+static inline uint32_t
+cache_fa_home(cache_fa_t *fa, uint32_t tag)
+{
+    return ((tag * 0x9e3779b9U) >> fa->shift);
+}
+
+
+/***************************************************************************
+ * Name:    cache_fa_init
+ *
+ * Desc:    Sets up an empty tag index for a fully associative tagstore,
+ *          from the arena.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore; one set, geometry set up already
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_fa_init(cache_tagstore_t *tagstore)
+{
+    uint32_t    bits = 1;
+    uint32_t    ways = tagstore->num_blocks_per_set;
+    cache_fa_t  *fa = NULL;
+
+    while ((1U << bits) < (ways * CACHE_FA_LOAD_FACTOR))
+        bits += 1;
+
+    fa = cache_arena_calloc(1, sizeof(*fa));
+    if (!fa)
+        return CACHE_RV_ERR;
+
+    fa->mask = ((1U << bits) - 1);
+    fa->shift = (32 - bits);
+    fa->slots = cache_arena_calloc((fa->mask + 1), sizeof(cache_fa_slot_t));
+    fa->pos = cache_arena_calloc(ways, sizeof(uint32_t));
+    fa->used = cache_arena_calloc(((ways + 63) / 64), sizeof(uint64_t));
+    if ((!fa->slots) || (!fa->pos) || (!fa->used))
+        return CACHE_RV_ERR;
+
+    tagstore->fa = fa;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_fa_lookup
+ *
+ * Desc:    Finds the valid way holding the given tag.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  tag         tag to look for
+ *
+ * Returns: int32_t
+ *  ID of the way on a match
+ *  CACHE_RV_ERR if no match is found
+ **************************************************************************/
+int32_t
+cache_fa_lookup(cache_tagstore_t *tagstore, uint32_t tag)
+{
+    uint32_t        slot = 0;
+    uint32_t        way = 0;
+    cache_fa_t      *fa = tagstore->fa;
+
+    for (slot = cache_fa_home(fa, tag); fa->slots[slot].way;
+            slot = ((slot + 1) & fa->mask)) {
+        if (fa->slots[slot].tag != tag)
+            continue;
+
+        way = (fa->slots[slot].way - 1);
+        if ((tagstore->tags[way] == tag) && (tagstore->tag_data[way].valid))
+            return way;
+    }
+
+    return CACHE_RV_ERR;
+}
+
+
+/***************************************************************************
+ * Name:    cache_fa_first_invalid
+ *
+ * Desc:    Returns the lowest free way, as a scan of the valid bits would.
+ *          A full set, the common case, is known from the count alone.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *
+ * Returns: int32_t
+ *  ID of the lowest free way
+ *  CACHE_RV_ERR if all the ways are in use
+ **************************************************************************/
+int32_t
+cache_fa_first_invalid(cache_tagstore_t *tagstore)
+{
+    uint32_t        word = 0;
+    uint32_t        way = 0;
+    uint32_t        ways = tagstore->num_blocks_per_set;
+    cache_fa_t      *fa = tagstore->fa;
+
+    if (fa->count == ways)
+        return CACHE_RV_ERR;
+
+    for (word = 0; (word * 64) < ways; ++word) {
+        if (~fa->used[word]) {
+            way = ((word * 64) + __builtin_ctzll(~fa->used[word]));
+            return ((way < ways) ? (int32_t) way : CACHE_RV_ERR);
+        }
+    }
+
+    return CACHE_RV_ERR;
+}
+
+
+/* Drops the slot of a way, shifting the rest of its probe run back. */
+static void
+cache_fa_remove(cache_fa_t *fa, uint32_t way)
+{
+    uint32_t    hole = 0;
+    uint32_t    slot = 0;
+    uint32_t    home = 0;
+
+    if (!fa->pos[way])
+        return;
+
+    hole = (fa->pos[way] - 1);
+    fa->pos[way] = 0;
+    fa->used[way / 64] &= ~(1ULL << (way % 64));
+    fa->count -= 1;
+
+    for (slot = ((hole + 1) & fa->mask); fa->slots[slot].way;
+            slot = ((slot + 1) & fa->mask)) {
+        /* Entries whose home lies cyclically in (hole, slot] stay. */
+        home = cache_fa_home(fa, fa->slots[slot].tag);
+        if (((slot - home) & fa->mask) < ((slot - hole) & fa->mask))
+            continue;
+
+        fa->slots[hole] = fa->slots[slot];
+        fa->pos[fa->slots[hole].way - 1] = (hole + 1);
+        hole = slot;
+    }
+    fa->slots[hole].way = 0;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_fa_fill
+ *
+ * Desc:    Indexes the block just placed in a way, replacing whatever the
+ *          way was indexed under before.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  way         way of the new block
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_fa_fill(cache_tagstore_t *tagstore, uint32_t way)
+{
+    uint32_t        slot = 0;
+    uint32_t        tag = tagstore->tags[way];
+    cache_fa_t      *fa = tagstore->fa;
+
+    cache_fa_remove(fa, way);
+
+    for (slot = cache_fa_home(fa, tag); fa->slots[slot].way;
+            slot = ((slot + 1) & fa->mask))
+        ;
+
+    fa->slots[slot].tag = tag;
+    fa->slots[slot].way = (way + 1);
+    fa->pos[way] = (slot + 1);
+    fa->used[way / 64] |= (1ULL << (way % 64));
+    fa->count += 1;
+
+    return;
+}
+
+
+/* Unindexes a way whose block was invalidated. */
+void
+cache_fa_invalidate(cache_tagstore_t *tagstore, uint32_t way)
+{
+    cache_fa_remove(tagstore->fa, way);
+
+    return;
+}
@@ -0,0 +1,52 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the tag index of fully associative tagstores, like the VC. The single
+ * set is looked up through an open addressed tag to way hash table, and
+ * the free ways are kept in a bitmap, so that neither a lookup nor a fill
+ * has to scan all the ways.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_FA_H_
+#define CACHE_FA_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_FA_LOAD_FACTOR        2   /* slots per way, at least      */
+
+/* Hash slot; empty if way is 0 */
+typedef struct cache_fa_slot__ {
+    uint32_t    tag;                    /* tag of the block             */
+    uint32_t    way;                    /* way ID + 1                   */
+} cache_fa_slot_t;
+
+/* Tag index of a fully associative tagstore */
+typedef struct cache_fa__ {
+    uint32_t            mask;           /* # of slots - 1               */
+    uint8_t             shift;          /* 32 - log2(# of slots)        */
+    uint32_t            count;          /* # of indexed (valid) ways    */
+    cache_fa_slot_t     *slots;         /* linear probing hash table    */
+    uint32_t            *pos;           /* slot + 1 per way; 0 if none  */
+    uint64_t            *used;          /* bit per indexed way          */
+} cache_fa_t;
+
+
+/* Function declarations */
+cache_rv
+cache_fa_init(cache_tagstore_t *tagstore);
+int32_t
+cache_fa_lookup(cache_tagstore_t *tagstore, uint32_t tag);
+int32_t
+cache_fa_first_invalid(cache_tagstore_t *tagstore);
+void
+cache_fa_fill(cache_tagstore_t *tagstore, uint32_t way);
+void
+cache_fa_invalidate(cache_tagstore_t *tagstore, uint32_t way);
+
+#endif /* CACHE_FA_H_ */
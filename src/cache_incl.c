@@ -0,0 +1,463 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the inclusive and exclusive L2 policies.
+ *
+ * Inclusive: every block of L1 and the VC is in L2 as well, as they are
+ * only filled through L2. When L2 evicts a block, the private copies of it
+ * are invalidated; dirty ones are merged into the L2 victim, which then
+ * goes to memory with a single write back. With larger L2 blocks, all the
+ * private blocks within the victim go; with smaller ones, the private
+ * block holding it goes, and a dirty one makes every L2 block of it dirty.
+ *
+ * Exclusive: a block lives in either the private caches or L2. An L2 hit
+ * moves the block up, dirty bit and all, and an L2 miss fills only the
+ * private cache. Blocks leaving the private caches, clean or dirty, are
+ * the only fills of L2.
+ *
+ * The private caches above an L2 are those of every core, or, for a single
+ * core, the ones linked below it; the latter keeps the shards of a
+ * --threads= run apart.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_repl.h"
+#include "cache_coherence.h"
+#include "cache_shard.h"
+#include "cache_incl.h"
+#include "cache_sector.h"
+
+/* Globals */
+uint8_t             g_cache_incl;       /* CACHE_INCL_*; never DEFAULT  */
+
+const char *g_cache_incl_names[] = {
+    "default", "non-inclusive", "inclusive", "exclusive", NULL
+};
+
+
+/***************************************************************************
+ * Name:    cache_incl_init
+ *
+ * Desc:    Sets up the inclusion policy as per --inclusion=. Inclusive and
+ *          exclusive need an L2, and exclusive a single core, as a shared
+ *          L2 can't hand a block to more than one of them, and one block
+ *          size.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR on an unsupported configuration
+ **************************************************************************/
+cache_rv
+cache_incl_init(void)
+{
+    uint8_t     incl = g_cache_opts.inclusion;
+
+    g_cache_incl = CACHE_INCL_NON_INCLUSIVE;
+    if (CACHE_INCL_DEFAULT == incl)
+        return CACHE_RV_OK;
+
+    if (!cache_util_is_l2_present()) {
+        dprint("Error: --inclusion needs an L2 cache.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if ((CACHE_INCL_EXCLUSIVE == incl) && (g_num_cores > 1)) {
+        dprint("Error: --inclusion=exclusive needs a single core.\n");
+        return CACHE_RV_ERR;
+    }
+
+    /* Exclusive L2 moves whole blocks up and down. */
+    if ((CACHE_INCL_EXCLUSIVE == incl) &&
+            (cache_util_get_l2()->blk_size != cache_util_get_l1(0)->blk_size)) {
+        dprint("Error: --inclusion=exclusive needs the same block size at "
+                "L1 and L2.\n");
+        return CACHE_RV_ERR;
+    }
+    g_cache_incl = incl;
+
+    return CACHE_RV_OK;
+}
+
+
+/* Returns the L1 of the given core under the L2. */
+static cache_generic_t *
+cache_incl_get_l1(cache_generic_t *l2, uint32_t core)
+{
+    cache_generic_t *cache = l2->prev_cache;
+
+    if (g_num_cores > 1)
+        return cache_util_get_l1(core);
+
+    while ((cache) && (cache->prev_cache))
+        cache = cache->prev_cache;
+
+    return cache;
+}
+
+
+/* Returns the address of the block in the given set and way. */
+static uint32_t
+cache_incl_get_addr(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    mem_ref_t       ref;
+    cache_line_t    line;
+
+    memset(&line, 0, sizeof(line));
+    line.tag = tagstore->tags[(set * tagstore->num_blocks_per_set) + way];
+    line.index = set;
+    cache_util_encode_mem_addr(tagstore, &line, &ref);
+
+    return ref.ref_addr;
+}
+
+
+/* Returns the way holding the block in the cache, or CACHE_RV_ERR. */
+static int32_t
+cache_incl_find(cache_generic_t *cache, uint32_t addr, cache_line_t *line)
+{
+    memset(line, 0, sizeof(*line));
+    cache_util_decode_mem_addr(cache->tagstore, addr, line);
+
+    return cache_does_tag_match(cache->tagstore, line);
+}
+
+
+/* Marks the L2 blocks holding a dirty private block dirty; all sectors. */
+static void
+cache_incl_merge_dirty(cache_generic_t *l2, uint32_t addr, uint8_t blk_bits)
+{
+    int32_t             block_id = CACHE_RV_ERR;
+    uint32_t            iter = 0;
+    uint8_t             l2_bits = l2->tagstore->num_offset_bits;
+    cache_line_t        line;
+
+    if (blk_bits < l2_bits)
+        blk_bits = l2_bits;
+    addr &= ~((1U << blk_bits) - 1);
+    for (iter = 0; iter < (1U << (blk_bits - l2_bits)); ++iter) {
+        block_id = cache_incl_find(l2, (addr + (iter << l2_bits)), &line);
+        if (CACHE_RV_ERR != block_id) {
+            cache_tagstore_set_dirty(l2->tagstore, line.index, block_id,
+                    cache_sector_all(l2->tagstore));
+        }
+    }
+
+    return;
+}
+
+
+/* Invalidates a block of a cache. */
+static void
+cache_incl_invalidate(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_tag_data_t    *tag_data = NULL;
+
+    tag_data = &tagstore->tag_data[(set * tagstore->num_blocks_per_set) + way];
+    tag_data->valid = 0;
+    tag_data->dirty = 0;
+    tag_data->prefetched = 0;
+    tag_data->state = CACHE_MESI_I;
+    cache_tagstore_invalidate(tagstore, set, way);
+
+    return;
+}
+
+
+/* Back-invalidates the private block holding an address, if any. */
+static void
+cache_incl_back_inval_blk(cache_generic_t *l2, cache_generic_t *cache,
+        uint32_t addr)
+{
+    int32_t             block_id = CACHE_RV_ERR;
+    cache_line_t        line;
+    cache_tagstore_t    *tagstore = cache->tagstore;
+    cache_tag_data_t    *tag_data = NULL;
+
+    block_id = cache_incl_find(cache, addr, &line);
+    if (CACHE_RV_ERR == block_id)
+        return;
+
+    tag_data = &tagstore->tag_data[(line.index *
+            tagstore->num_blocks_per_set) + block_id];
+    if (tag_data->dirty) {
+        cache_incl_merge_dirty(l2, addr, tagstore->num_offset_bits);
+        cache->stats.num_back_inval_wbs += 1;
+    }
+
+    /* The block leaves the private caches of the core. */
+    if (g_cache_coh)
+        cache_coh_evict(cache, line.index, block_id);
+
+    cache_incl_invalidate(tagstore, line.index, block_id);
+    cache->stats.num_back_invals += 1;
+
+    dprint_info("%s, back-invalidated 0x%x from index %u, block %d\n",
+            CACHE_GET_NAME(cache), addr, line.index, block_id);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_incl_back_inval
+ *
+ * Desc:    Inclusive L2. Invalidates the private copies of a block that L2
+ *          is about to evict: every private block within it, or the one
+ *          holding it. Dirty copies make the L2 blocks they cover dirty,
+ *          so that the eviction writes the victim back to memory. To be
+ *          called before the L2 victim is replaced.
+ *
+ * Params:
+ *  l2      ptr to the L2 cache
+ *  set     set of the L2 victim
+ *  way     way of the L2 victim
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_incl_back_inval(cache_generic_t *l2, uint32_t set, uint32_t way)
+{
+    uint32_t            addr = 0;
+    uint32_t            core = 0;
+    uint32_t            iter = 0;
+    uint8_t             l2_bits = l2->tagstore->num_offset_bits;
+    uint8_t             blk_bits = 0;
+    cache_generic_t     *cache = NULL;
+
+    addr = cache_incl_get_addr(l2->tagstore, set, way);
+
+    for (core = 0; core < g_num_cores; ++core) {
+        for (cache = cache_incl_get_l1(l2, core);
+                (cache) && ((CACHE_IS_L1(cache)) || (CACHE_IS_VC(cache)));
+                cache = cache->next_cache) {
+            blk_bits = cache->tagstore->num_offset_bits;
+            if (blk_bits >= l2_bits) {
+                cache_incl_back_inval_blk(l2, cache, addr);
+                continue;
+            }
+            for (iter = 0; iter < (1U << (l2_bits - blk_bits)); ++iter)
+                cache_incl_back_inval_blk(l2, cache,
+                        (addr + (iter << blk_bits)));
+        }
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_incl_take
+ *
+ * Desc:    Exclusive L2. Removes a block that was just read by the private
+ *          caches from L2, as it moves up.
+ *
+ * Params:
+ *  l2      ptr to the L2 cache
+ *  addr    address of the block
+ *
+ * Returns: boolean
+ *  TRUE if the L2 copy was dirty; the private copy is dirty then
+ *  FALSE otherwise, or if L2 didn't have the block
+ **************************************************************************/
+boolean
+cache_incl_take(cache_generic_t *l2, uint32_t addr)
+{
+    int32_t             block_id = CACHE_RV_ERR;
+    boolean             dirty = FALSE;
+    cache_line_t        line;
+    cache_tagstore_t    *tagstore = l2->tagstore;
+
+    block_id = cache_incl_find(l2, addr, &line);
+    if (CACHE_RV_ERR == block_id)
+        return FALSE;
+
+    dirty = tagstore->tag_data[(line.index * tagstore->num_blocks_per_set) +
+        block_id].dirty;
+    cache_incl_invalidate(tagstore, line.index, block_id);
+
+    return dirty;
+}
+
+
+/***************************************************************************
+ * Name:    cache_incl_victim_fill
+ *
+ * Desc:    Exclusive L2. Places a block leaving the private caches (L1
+ *          without VC, or VC) in L2, clean or dirty; L2 evicts a block for
+ *          it if needed. To be called before the block is replaced.
+ *
+ * Params:
+ *  cache   ptr to the private cache evicting the block
+ *  set     set of the block
+ *  way     way of the block
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_incl_victim_fill(cache_generic_t *cache, uint32_t set, uint32_t way)
+{
+    int32_t             block_id = CACHE_RV_ERR;
+    boolean             dirty = FALSE;
+    mem_ref_t           fill_ref;
+    cache_line_t        line;
+    cache_generic_t     *l2 = cache->next_cache;
+    cache_tagstore_t    *l2_ts = l2->tagstore;
+    cache_tag_data_t    *tag_data = NULL;
+
+    tag_data = &cache->tagstore->tag_data[(set *
+            cache->tagstore->num_blocks_per_set) + way];
+    dirty = tag_data->dirty;
+
+    memset(&fill_ref, 0, sizeof(fill_ref));
+    fill_ref.ref_type = MEM_REF_TYPE_WRITE;
+    fill_ref.ref_addr = cache_incl_get_addr(cache->tagstore, set, way);
+
+    /* Only an L2 prefetch can have brought the block in already. */
+    block_id = cache_incl_find(l2, fill_ref.ref_addr, &line);
+    if (CACHE_RV_ERR != block_id) {
+        l2_ts->tag_data[(line.index * l2_ts->num_blocks_per_set) +
+            block_id].dirty |= dirty;
+        l2_ts->repl->on_hit(l2_ts, line.index, block_id);
+    } else {
+        block_id = cache_get_first_invalid_block(l2_ts, &line);
+        if (CACHE_RV_ERR == block_id)
+            block_id = cache_evict_tag(l2, &fill_ref, &line);
+
+        l2_ts->tags[(line.index * l2_ts->num_blocks_per_set) + block_id] =
+            line.tag;
+        tag_data = &l2_ts->tag_data[(line.index * l2_ts->num_blocks_per_set)
+            + block_id];
+        tag_data->valid = 1;
+        tag_data->dirty = dirty;
+        tag_data->prefetched = 0;
+        tag_data->state = CACHE_MESI_I;
+        cache_tagstore_fill(l2_ts, line.index, block_id);
+    }
+    l2->stats.num_victim_fills += 1;
+
+    if (dirty)
+        cache->stats.num_write_backs += 1;
+    cache->stats.num_blk_mem_traffic += 1;
+    cache->tagstore->tag_data[(set * cache->tagstore->num_blocks_per_set) +
+        way].dirty = 0;
+
+    dprint_info("%s, victim 0x%x filled into %s, dirty %u\n",
+            CACHE_GET_NAME(cache), fill_ref.ref_addr, CACHE_GET_NAME(l2),
+            dirty);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_incl_count
+ *
+ * Desc:    Adds up the capacity, the valid blocks and the distinct blocks
+ *          of one hierarchy: an L2 and the private caches above it. A
+ *          private block counts as distinct unless L2 or another core
+ *          holds it too.
+ *
+ * Params:
+ *  l2      ptr to the L2 cache
+ *  usage   ptr to the usage to add to
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_incl_count(cache_generic_t *l2, cache_incl_usage_t *usage)
+{
+    boolean             shared = FALSE;
+    uint32_t            addr = 0;
+    uint32_t            core = 0;
+    uint32_t            other = 0;
+    uint32_t            block_id = 0;
+    cache_line_t        line;
+    cache_generic_t     *cache = NULL;
+    cache_generic_t     *peer = NULL;
+    cache_tagstore_t    *tagstore = l2->tagstore;
+
+    usage->num_blocks += tagstore->num_blocks;
+    for (block_id = 0; block_id < tagstore->num_blocks; ++block_id) {
+        if (tagstore->tag_data[block_id].valid) {
+            usage->num_valid += 1;
+            usage->num_unique += 1;
+        }
+    }
+
+    for (core = 0; core < g_num_cores; ++core) {
+        for (cache = cache_incl_get_l1(l2, core);
+                (cache) && ((CACHE_IS_L1(cache)) || (CACHE_IS_VC(cache)));
+                cache = cache->next_cache) {
+            tagstore = cache->tagstore;
+            usage->num_blocks += tagstore->num_blocks;
+
+            for (block_id = 0; block_id < tagstore->num_blocks; ++block_id) {
+                if (!tagstore->tag_data[block_id].valid)
+                    continue;
+                usage->num_valid += 1;
+
+                addr = cache_incl_get_addr(tagstore,
+                        (block_id / tagstore->num_blocks_per_set),
+                        (block_id % tagstore->num_blocks_per_set));
+                shared = (CACHE_RV_ERR != cache_incl_find(l2, addr, &line));
+                for (other = 0; (!shared) && (other < core); ++other) {
+                    for (peer = cache_util_get_l1(other); (!shared) && (peer)
+                            && ((CACHE_IS_L1(peer)) || (CACHE_IS_VC(peer)));
+                            peer = peer->next_cache) {
+                        shared = (CACHE_RV_ERR !=
+                                cache_incl_find(peer, addr, &line));
+                    }
+                }
+
+                if (!shared)
+                    usage->num_unique += 1;
+            }
+        }
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_incl_get_usage
+ *
+ * Desc:    Finds how much of the capacity of the hierarchy holds distinct
+ *          blocks. Copies kept by more than one cache, eg. in L1 and an
+ *          inclusive L2, are counted once.
+ *
+ * Params:
+ *  usage   ptr to the usage to fill in
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_incl_get_usage(cache_incl_usage_t *usage)
+{
+    uint32_t    shard = 0;
+
+    memset(usage, 0, sizeof(*usage));
+    usage->blk_size = cache_util_get_l2()->blk_size;
+
+    if (!g_cache_shards) {
+        cache_incl_count(cache_util_get_l2(), usage);
+        return;
+    }
+
+    for (shard = 0; shard < g_cache_shards->num_shards; ++shard)
+        cache_incl_count(&g_cache_shards->shards[shard].l2, usage);
+
+    return;
+}
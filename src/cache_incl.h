@@ -0,0 +1,53 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the constants and function declarations for the
+ * inclusion policy between the private caches (L1 + VC) and L2. A
+ * non-inclusive L2 is filled on L1 misses and never looks back; an
+ * inclusive L2 back-invalidates the private copies of the blocks it
+ * evicts; an exclusive L2 hands its blocks up on a hit and is filled only
+ * by the blocks leaving the private caches.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_INCL_H_
+#define CACHE_INCL_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_INCL_DEFAULT          0   /* non-inclusive, no extra stats*/
+#define CACHE_INCL_NON_INCLUSIVE    1
+#define CACHE_INCL_INCLUSIVE        2
+#define CACHE_INCL_EXCLUSIVE        3
+
+/* Blocks held by the whole hierarchy, at the end of the run */
+typedef struct cache_incl_usage__ {
+    uint64_t    num_blocks;             /* capacity of L1s, VCs and L2  */
+    uint64_t    num_valid;              /* valid blocks, duplicates too */
+    uint64_t    num_unique;             /* distinct blocks              */
+    uint32_t    blk_size;               /* block size in bytes          */
+} cache_incl_usage_t;
+
+
+/* Externs */
+extern uint8_t          g_cache_incl;
+extern const char       *g_cache_incl_names[];
+
+
+/* Function declarations */
+cache_rv
+cache_incl_init(void);
+void
+cache_incl_back_inval(cache_generic_t *l2, uint32_t set, uint32_t way);
+boolean
+cache_incl_take(cache_generic_t *l2, uint32_t addr);
+void
+cache_incl_victim_fill(cache_generic_t *cache, uint32_t set, uint32_t way);
+void
+cache_incl_get_usage(cache_incl_usage_t *usage);
+
+#endif /* CACHE_INCL_H_ */
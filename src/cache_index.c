@@ -0,0 +1,191 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the hashed set index functions and the per set
+ * conflict counters (see cache_index.h).
+ *
+ *      xor:    index = addr[index] ^ tag[k-1:0] ^ tag[2k-1:k] ^ ...
+ *      prime:  index = (addr >> offset) % P, tag = (addr >> offset) / P
+ *
+ * where k is the # of index bits and P the largest prime not above the #
+ * of sets. The XOR tag is the usual one, so the index bits come back by
+ * folding it again; the prime tag is the quotient. Caches with a single
+ * set always use the address bits.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_arena.h"
+#include "cache_index.h"
+
+/* Globals */
+const char      *g_cache_index_names[] = { "bits", "xor", "prime", NULL };
+
+
+/* Returns the largest prime not above num; num is at least 2. */
+static uint32_t
+cache_index_get_prime(uint32_t num)
+{
+    uint32_t    div = 0;
+
+    for (; num > 2; --num) {
+        for (div = 2; (div * div) <= num; ++div) {
+            if (!(num % div))
+                break;
+        }
+        if ((div * div) > num)
+            break;
+    }
+
+    return num;
+}
+
+
+/* Returns the tag folded down to the index bits by XOR. */
+static inline uint32_t
+cache_index_fold(cache_tagstore_t *tagstore, uint32_t tag)
+{
+    uint32_t    fold = 0;
+    uint32_t    mask = (tagstore->num_sets - 1);
+
+    for (; tag; tag >>= tagstore->num_index_bits)
+        fold ^= (tag & mask);
+
+    return fold;
+}
+
+
+/***************************************************************************
+ * Name:    cache_index_init
+ *
+ * Desc:    Sets up the index function of a tagstore, and its per set
+ *          conflict counters if asked for, from the arena. The geometry
+ *          has to be set up already.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  index_fn    CACHE_INDEX_*
+ *  set_stats   TRUE to count the fills and evictions of every set
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_index_init(cache_tagstore_t *tagstore, uint8_t index_fn,
+        boolean set_stats)
+{
+    cache_sets_t    *sets = NULL;
+
+    /* A single set has nothing to hash. */
+    tagstore->index_fn = ((tagstore->num_sets > 1) ? index_fn :
+            CACHE_INDEX_BITS);
+    tagstore->num_index_sets = tagstore->num_sets;
+    if (CACHE_INDEX_PRIME == tagstore->index_fn)
+        tagstore->num_index_sets = cache_index_get_prime(tagstore->num_sets);
+
+    tagstore->sets = NULL;
+    if (!set_stats)
+        return CACHE_RV_OK;
+
+    sets = cache_arena_calloc(1, sizeof(*sets));
+    if (!sets)
+        return CACHE_RV_ERR;
+    sets->fills = cache_arena_calloc(tagstore->num_sets, sizeof(uint64_t));
+    sets->evicts = cache_arena_calloc(tagstore->num_sets, sizeof(uint64_t));
+    if ((!sets->fills) || (!sets->evicts))
+        return CACHE_RV_ERR;
+    tagstore->sets = sets;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_index_decode
+ *
+ * Desc:    Decodes an address into the tag, set and block offset of a
+ *          tagstore with a hashed index.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  addr        32-bit memory address
+ *  line        ptr to store the decoded addr
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_index_decode(cache_tagstore_t *tagstore, uint32_t addr,
+        cache_line_t *line)
+{
+    uint32_t    blk = (addr >> tagstore->num_offset_bits);
+
+    line->offset = (addr & ((1U << tagstore->num_offset_bits) - 1));
+    if (CACHE_INDEX_PRIME == tagstore->index_fn) {
+        line->tag = (blk / tagstore->num_index_sets);
+        line->index = (blk % tagstore->num_index_sets);
+    } else {
+        line->tag = (blk >> tagstore->num_index_bits);
+        line->index = ((blk & (tagstore->num_sets - 1)) ^
+                cache_index_fold(tagstore, line->tag));
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_index_encode
+ *
+ * Desc:    Rebuilds the block address of a tag and set of a tagstore with
+ *          a hashed index; the reverse of cache_index_decode.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  line        ptr to the line with the tag & set
+ *
+ * Returns: uint32_t
+ *  address of the first byte of the block
+ **************************************************************************/
+uint32_t
+cache_index_encode(cache_tagstore_t *tagstore, cache_line_t *line)
+{
+    uint32_t    blk = 0;
+
+    if (CACHE_INDEX_PRIME == tagstore->index_fn) {
+        blk = ((line->tag * tagstore->num_index_sets) + line->index);
+    } else {
+        blk = ((line->tag << tagstore->num_index_bits) |
+                (line->index ^ cache_index_fold(tagstore, line->tag)));
+    }
+
+    return (blk << tagstore->num_offset_bits);
+}
+
+
+/* Counts a block placed in a set. */
+void
+cache_index_fill(cache_tagstore_t *tagstore, uint32_t set)
+{
+    tagstore->sets->fills[set] += 1;
+
+    return;
+}
+
+
+/* Counts a valid block replaced in a set. */
+void
+cache_index_evict(cache_tagstore_t *tagstore, uint32_t set)
+{
+    tagstore->sets->evicts[set] += 1;
+
+    return;
+}
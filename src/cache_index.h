@@ -0,0 +1,52 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the set index functions and the per set conflict counters. By default
+ * the index is a slice of the address bits; XOR folding hashes the whole
+ * tag into it, and prime modulo takes the block address modulo the
+ * largest prime # of sets, leaving the sets above it unused. Either way
+ * the tag is kept such that the address of a block can be rebuilt from
+ * its tag and set, for write-backs and moves to the VC.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_INDEX_H_
+#define CACHE_INDEX_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_INDEX_BITS            0
+#define CACHE_INDEX_XOR             1
+#define CACHE_INDEX_PRIME           2
+
+/* Per set conflict counters of a tagstore */
+typedef struct cache_sets__ {
+    uint64_t    *fills;                 /* # of blocks placed per set   */
+    uint64_t    *evicts;                /* # of blocks replaced per set */
+} cache_sets_t;
+
+
+/* Externs */
+extern const char       *g_cache_index_names[];
+
+
+/* Function declarations */
+cache_rv
+cache_index_init(cache_tagstore_t *tagstore, uint8_t index_fn,
+        boolean set_stats);
+void
+cache_index_decode(cache_tagstore_t *tagstore, uint32_t addr,
+        cache_line_t *line);
+uint32_t
+cache_index_encode(cache_tagstore_t *tagstore, cache_line_t *line);
+void
+cache_index_fill(cache_tagstore_t *tagstore, uint32_t set);
+void
+cache_index_evict(cache_tagstore_t *tagstore, uint32_t set);
+
+#endif /* CACHE_INDEX_H_ */
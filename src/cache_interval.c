@@ -0,0 +1,460 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements interval (time-series) statistics. At every
+ * interval boundary, the delta of each level's counters since the previous
+ * boundary is appended to an in-memory buffer. Full buffers are handed
+ * over to a writer thread which formats (CSV) and writes them out, so the
+ * simulation never waits on the file I/O unless both buffers are full.
+ * Progress lines, if asked for, also hand the records so far over, so the
+ * file keeps up with a live trace.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_interval.h"
+#include "cache_results.h"
+
+/* Globals */
+uint32_t                g_interval_countdown;   /* refs to next snapshot
+                                                   or progress line     */
+
+static FILE             *g_int_fptr;            /* output file          */
+static uint8_t          g_int_fmt;              /* CACHE_INTERVAL_FMT_* */
+static uint32_t         g_int_last_ref;         /* ref ID of last snap  */
+static uint32_t         g_int_next_snap;        /* ref ID of next; 0 =
+                                                   no interval stats    */
+static uint32_t         g_int_next_prog;        /* ref ID of the next
+                                                   progress line; 0 = none */
+static uint32_t         g_int_prog_ref;         /* ref ID of last line  */
+static double           g_int_prog_time;        /* secs at last line    */
+static uint32_t         g_int_num_caches;       /* # of levels tracked  */
+static cache_generic_t  *g_int_caches[CACHE_INTERVAL_MAX_LEVELS];
+static cache_stats_t    g_int_prev[CACHE_INTERVAL_MAX_LEVELS];
+
+/* Double buffering between the simulator and the writer thread. */
+static cache_interval_rec_t g_int_bufs[2][CACHE_INTERVAL_BUF_RECS];
+static uint8_t          g_int_active;           /* buffer being filled  */
+static uint32_t         g_int_fill;             /* # of recs in active  */
+static uint8_t          g_int_pending;          /* buffer being written */
+static uint32_t         g_int_pending_count;    /* 0 if nothing pending */
+static boolean          g_int_exit;             /* writer should quit   */
+static pthread_t        g_int_writer;
+static pthread_mutex_t  g_int_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   g_int_work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t   g_int_free_cv = PTHREAD_COND_INITIALIZER;
+
+
+/***************************************************************************
+ * Name:    cache_interval_level_name
+ *
+ * Desc:    Returns the printable name for a cache level.
+ *
+ * Params:
+ *  level   CACHE_LEVEL_* of the cache
+ *
+ * Returns: const char *
+ **************************************************************************/
+static const char *
+cache_interval_level_name(uint32_t level)
+{
+    switch (level) {
+        case CACHE_LEVEL_1:
+            return g_l1_name;
+        case CACHE_LEVEL_L1_VICTIM:
+            return g_vic_name;
+        case CACHE_LEVEL_2:
+            return g_l2_name;
+        default:
+            return "-";
+    }
+}
+
+
+/***************************************************************************
+ * Name:    cache_interval_write_recs
+ *
+ * Desc:    Writes the given records to the output file in the configured
+ *          format. Runs on the writer thread.
+ *
+ * Params:
+ *  recs    ptr to the records
+ *  count   # of records
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_interval_write_recs(cache_interval_rec_t *recs, uint32_t count)
+{
+    uint32_t                iter = 0;
+    cache_interval_rec_t    *rec = NULL;
+
+    if (CACHE_INTERVAL_FMT_BIN == g_int_fmt) {
+        fwrite(recs, sizeof(*recs), count, g_int_fptr);
+        return;
+    }
+
+    for (iter = 0; iter < count; ++iter) {
+        rec = &recs[iter];
+        fprintf(g_int_fptr, "%u,", rec->ref_id);
+
+        /* Private caches go by their core with more than one, eg. C3-L1. */
+        if ((g_num_cores > 1) && (CACHE_LEVEL_2 != rec->level))
+            fprintf(g_int_fptr, "C%u-", rec->core);
+        fprintf(g_int_fptr, "%s,%u,%u,%u,%u,%u,%u,%u,%u\n",
+                cache_interval_level_name(rec->level), rec->num_reads,
+                rec->num_writes, rec->num_hits,
+                rec->num_read_misses, rec->num_write_misses,
+                rec->num_write_backs, rec->num_swaps,
+                rec->num_blk_mem_traffic);
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_interval_writer
+ *
+ * Desc:    Writer thread. Waits for a full buffer, writes it out and hands
+ *          it back to the simulator.
+ *
+ * Params:
+ *  arg     unused
+ *
+ * Returns: NULL
+ **************************************************************************/
+static void *
+cache_interval_writer(void *arg)
+{
+    uint8_t     buf_id = 0;
+    uint32_t    count = 0;
+
+    pthread_mutex_lock(&g_int_lock);
+    while (TRUE) {
+        while ((!g_int_pending_count) && (!g_int_exit))
+            pthread_cond_wait(&g_int_work_cv, &g_int_lock);
+
+        if (!g_int_pending_count)
+            break;
+
+        buf_id = g_int_pending;
+        count = g_int_pending_count;
+        pthread_mutex_unlock(&g_int_lock);
+
+        cache_interval_write_recs(g_int_bufs[buf_id], count);
+        fflush(g_int_fptr);
+
+        pthread_mutex_lock(&g_int_lock);
+        g_int_pending_count = 0;
+        pthread_cond_signal(&g_int_free_cv);
+    }
+    pthread_mutex_unlock(&g_int_lock);
+
+    return NULL;
+}
+
+
+/***************************************************************************
+ * Name:    cache_interval_handoff
+ *
+ * Desc:    Hands the active buffer over to the writer thread and switches
+ *          to the other buffer. Blocks only if the writer is still busy
+ *          with the other buffer.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_interval_handoff(void)
+{
+    if (!g_int_fill)
+        return;
+
+    pthread_mutex_lock(&g_int_lock);
+    while (g_int_pending_count)
+        pthread_cond_wait(&g_int_free_cv, &g_int_lock);
+
+    g_int_pending = g_int_active;
+    g_int_pending_count = g_int_fill;
+    pthread_cond_signal(&g_int_work_cv);
+    pthread_mutex_unlock(&g_int_lock);
+
+    g_int_active ^= 1;
+    g_int_fill = 0;
+
+    return;
+}
+
+
+/* Returns the monotonic time in seconds. */
+static double
+cache_interval_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+
+/* Counts down to the next snapshot or progress line, whichever is first. */
+static void
+cache_interval_arm(void)
+{
+    uint32_t    next = g_int_next_snap;
+
+    if ((g_int_next_prog) && ((!next) || (g_int_next_prog < next)))
+        next = g_int_next_prog;
+    g_interval_countdown = (next ? (next - g_addr_count) : 0);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_interval_init
+ *
+ * Desc:    Sets up interval stats, if enabled. Opens the output file,
+ *          writes the file header and starts the writer thread. Progress
+ *          lines need no setup but the countdown. Must be called after the
+ *          caches are initialized.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK if interval stats are disabled or set up successfully
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_interval_init(void)
+{
+    uint32_t                core = 0;
+    const char              *fpath = NULL;
+    cache_interval_hdr_t    hdr;
+
+    g_interval_countdown = 0;
+    g_int_next_snap = 0;
+    g_int_next_prog = g_cache_opts.progress;
+    g_int_prog_ref = 0;
+    g_int_prog_time = cache_interval_now();
+    if (!g_cache_opts.interval) {
+        cache_interval_arm();
+        return CACHE_RV_OK;
+    }
+
+    g_int_fmt = g_cache_opts.interval_fmt;
+    fpath = g_cache_opts.interval_file;
+    if (!fpath[0]) {
+        fpath = ((CACHE_INTERVAL_FMT_BIN == g_int_fmt) ?
+                "interval.bin" : "interval.csv");
+    }
+
+    g_int_fptr = fopen(fpath, ((CACHE_INTERVAL_FMT_BIN == g_int_fmt) ?
+                "wb" : "w"));
+    if (!g_int_fptr) {
+        dprint("Error: Unable to open interval stats file %s.\n", fpath);
+        return CACHE_RV_ERR;
+    }
+
+    if (CACHE_INTERVAL_FMT_BIN == g_int_fmt) {
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = CACHE_INTERVAL_MAGIC;
+        hdr.version = CACHE_INTERVAL_VERSION;
+        hdr.interval = g_cache_opts.interval;
+        hdr.rec_size = sizeof(cache_interval_rec_t);
+        fwrite(&hdr, sizeof(hdr), 1, g_int_fptr);
+    } else {
+        fprintf(g_int_fptr, "ref_id,level,reads,writes,hits,read_misses,"
+                "write_misses,write_backs,swaps,blk_mem_traffic\n");
+    }
+
+    /* Track the levels in the hierarchy order, core by core. */
+    g_int_num_caches = 0;
+    for (core = 0; core < g_num_cores; ++core) {
+        g_int_caches[g_int_num_caches++] = cache_util_get_l1(core);
+        if (cache_util_is_victim_present())
+            g_int_caches[g_int_num_caches++] = cache_util_get_vc(core);
+    }
+    if (cache_util_is_l2_present())
+        g_int_caches[g_int_num_caches++] = cache_util_get_l2();
+    memset(g_int_prev, 0, sizeof(g_int_prev));
+
+    g_int_active = 0;
+    g_int_fill = 0;
+    g_int_pending_count = 0;
+    g_int_exit = FALSE;
+    g_int_last_ref = 0;
+    if (pthread_create(&g_int_writer, NULL, cache_interval_writer, NULL)) {
+        dprint("Error: Unable to start interval stats writer.\n");
+        fclose(g_int_fptr);
+        g_int_fptr = NULL;
+        return CACHE_RV_ERR;
+    }
+
+    g_int_next_snap = g_cache_opts.interval;
+    cache_interval_arm();
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_interval_snapshot
+ *
+ * Desc:    Records the counter deltas of every level since the previous
+ *          snapshot. Called at interval boundaries, and at the end.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_interval_snapshot(void)
+{
+    uint32_t                iter = 0;
+    cache_stats_t           *curr = NULL;
+    cache_stats_t           *prev = NULL;
+    cache_interval_rec_t    *rec = NULL;
+
+    for (iter = 0; iter < g_int_num_caches; ++iter) {
+        if (CACHE_INTERVAL_BUF_RECS == g_int_fill)
+            cache_interval_handoff();
+
+        curr = &g_int_caches[iter]->stats;
+        prev = &g_int_prev[iter];
+        rec = &g_int_bufs[g_int_active][g_int_fill++];
+
+        rec->ref_id = g_addr_count;
+        rec->level = g_int_caches[iter]->level;
+        rec->core = g_int_caches[iter]->core;
+        rec->num_reads = (curr->num_reads - prev->num_reads);
+        rec->num_writes = (curr->num_writes - prev->num_writes);
+        rec->num_hits = ((curr->num_read_hits - prev->num_read_hits) +
+                (curr->num_write_hits - prev->num_write_hits));
+        rec->num_read_misses = (curr->num_read_misses - prev->num_read_misses);
+        rec->num_write_misses =
+            (curr->num_write_misses - prev->num_write_misses);
+        rec->num_write_backs = (curr->num_write_backs - prev->num_write_backs);
+        rec->num_swaps = (curr->num_swaps - prev->num_swaps);
+        rec->num_blk_mem_traffic =
+            (curr->num_blk_mem_traffic - prev->num_blk_mem_traffic);
+
+        memcpy(prev, curr, sizeof(*prev));
+    }
+
+    g_int_last_ref = g_addr_count;
+    g_int_next_snap = (g_addr_count + g_cache_opts.interval);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_interval_progress
+ *
+ * Desc:    Prints a line of running stats on stderr: the references so far,
+ *          the miss rates and average access time up to now, and the rate
+ *          of references since the last line. The interval records so far
+ *          are handed to the writer as well.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_interval_progress(void)
+{
+    double          now = cache_interval_now();
+    double          secs = (now - g_int_prog_time);
+    cache_results_t res;
+
+    cache_results_calc(cache_util_get_l1(0), &res);
+    fprintf(stderr, "progress: %u refs, L1 miss rate %.4f", g_addr_count,
+            res.l1_miss_rate);
+    if (res.l2_present)
+        fprintf(stderr, ", L2 miss rate %.4f", res.l2_miss_rate);
+    fprintf(stderr, ", AAT %.4f ns, %.0f refs/sec\n", res.avg_access_time,
+            ((secs > 0) ? ((g_addr_count - g_int_prog_ref) / secs) : 0));
+
+    if (g_int_fptr)
+        cache_interval_handoff();
+
+    g_int_prog_ref = g_addr_count;
+    g_int_prog_time = now;
+    g_int_next_prog = (g_addr_count + g_cache_opts.progress);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_interval_tick
+ *
+ * Desc:    Takes the snapshot and prints the progress line that are due.
+ *          Called by CACHE_INTERVAL_TICK when its countdown runs out.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_interval_tick(void)
+{
+    if (g_addr_count == g_int_next_snap)
+        cache_interval_snapshot();
+    if (g_addr_count == g_int_next_prog)
+        cache_interval_progress();
+    cache_interval_arm();
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_interval_cleanup
+ *
+ * Desc:    Records the last (partial) interval, flushes all the pending
+ *          records, stops the writer thread and closes the output file.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_interval_cleanup(void)
+{
+    g_int_next_prog = 0;
+    g_interval_countdown = 0;
+    if (!g_int_fptr)
+        return;
+
+    if (g_addr_count != g_int_last_ref)
+        cache_interval_snapshot();
+    cache_interval_handoff();
+
+    pthread_mutex_lock(&g_int_lock);
+    g_int_exit = TRUE;
+    pthread_cond_signal(&g_int_work_cv);
+    pthread_mutex_unlock(&g_int_lock);
+    pthread_join(g_int_writer, NULL);
+
+    fclose(g_int_fptr);
+    g_int_fptr = NULL;
+    g_interval_countdown = 0;
+
+    return;
+}
+
@@ -0,0 +1,75 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * interval (time-series) statistics. Every N references, the per-level
+ * counter deltas are recorded and written out by a separate writer thread.
+ * With --progress, a line of running stats is printed on stderr every so
+ * many references too, which is how a live (streamed) trace is watched.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_INTERVAL_H_
+#define CACHE_INTERVAL_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_INTERVAL_MAGIC        0x43495453  /* "CITS"               */
+#define CACHE_INTERVAL_VERSION      2
+#define CACHE_INTERVAL_BUF_RECS     4096        /* records per buffer   */
+#define CACHE_INTERVAL_MAX_LEVELS   ((2 * CACHE_MAX_CORES) + 1)
+                                    /* L1 and VC per core, and L2       */
+
+/* Binary file header */
+typedef struct cache_interval_hdr__ {
+    uint32_t    magic;                  /* CACHE_INTERVAL_MAGIC         */
+    uint32_t    version;                /* CACHE_INTERVAL_VERSION       */
+    uint32_t    interval;               /* # of refs per interval       */
+    uint32_t    rec_size;               /* sizeof(cache_interval_rec_t) */
+} cache_interval_hdr_t;
+
+/* One interval worth of counter deltas for one cache level */
+typedef struct cache_interval_rec__ {
+    uint32_t    ref_id;                 /* last reference of interval   */
+    uint16_t    level;                  /* CACHE_LEVEL_*                */
+    uint16_t    core;                   /* core of L1 and VC            */
+    uint32_t    num_reads;              /* # of reads                   */
+    uint32_t    num_writes;             /* # of writes                  */
+    uint32_t    num_hits;               /* # of read and write hits     */
+    uint32_t    num_read_misses;        /* # of read misses             */
+    uint32_t    num_write_misses;       /* # of write misses            */
+    uint32_t    num_write_backs;        /* # of write backs             */
+    uint32_t    num_swaps;              /* # of L1 & VC swaps           */
+    uint32_t    num_blk_mem_traffic;    /* # of blks transferred        */
+} cache_interval_rec_t;
+
+
+/* Externs */
+extern uint32_t         g_interval_countdown;
+
+
+/* Function declarations */
+cache_rv
+cache_interval_init(void);
+void
+cache_interval_tick(void);
+void
+cache_interval_cleanup(void);
+
+/*
+ * Per-reference hook for the main loop. Costs a test and a decrement unless
+ * an interval boundary or a progress line is due. g_interval_countdown
+ * stays 0 when interval stats and progress lines are disabled.
+ */
+#define CACHE_INTERVAL_TICK()                                           \
+    do {                                                                \
+        if ((g_interval_countdown) && (0 == --g_interval_countdown))    \
+            cache_interval_tick();                                      \
+    } while (0)
+
+#endif /* CACHE_INTERVAL_H_ */
+
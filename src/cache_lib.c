@@ -0,0 +1,330 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the libsimcache API (see cache_lib.h) over the
+ * same cache code sim_cache runs: a configuration sets the caches up the
+ * way the driver does from its command line, and a batch of references
+ * goes through the driver's per-reference steps.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_interval.h"
+#include "cache_timing.h"
+#include "cache_coherence.h"
+#include "cache_arena.h"
+#include "cache_incl.h"
+#include "cache_wbb.h"
+#include "cache_sector.h"
+#include "cache_model.h"
+#include "cache_results.h"
+#include "cache_prof.h"
+#include "cache_ptag.h"
+#include "cache_write.h"
+#include "cache_lib.h"
+
+/* Constants */
+#define CACHE_LIB_MAX_ARGS          64
+#define CACHE_LIB_CONFIG_LEN        1024
+
+/* Simulator handle */
+struct cache_lib__ {
+    boolean     configured;             /* caches are set up            */
+};
+
+/* Globals */
+static cache_lib_t  *g_cache_lib;       /* the live handle, if any      */
+
+
+/* Tears the caches of a configured handle down. */
+static void
+cache_lib_teardown(cache_lib_t *lib)
+{
+    if (!lib->configured)
+        return;
+
+    cache_timing_cleanup();
+    cache_interval_cleanup();
+    cache_coh_cleanup();
+    cache_cleanup_all();
+    cache_model_cleanup();
+    cache_arena_release();
+
+    /* The init functions only ever turn these on. */
+    g_cache_wbb_on = FALSE;
+    g_cache_sector_on = FALSE;
+    g_cache_ptag_on = FALSE;
+    g_addr_count = 0;
+    lib->configured = FALSE;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_lib_create
+ *
+ * Desc:    Creates the simulator handle; it has no caches until configured.
+ *
+ * Params:  None
+ *
+ * Returns: cache_lib_t *
+ *  ptr to the handle on success
+ *  NULL if there's a handle already, or no memory
+ **************************************************************************/
+cache_lib_t *
+cache_lib_create(void)
+{
+    cache_lib_t *lib = NULL;
+
+    g_cache_out = stderr;
+    if (g_cache_lib) {
+        dprint("Error: Only one simulator can be created at a time.\n");
+        return NULL;
+    }
+
+    lib = calloc(1, sizeof(*lib));
+    if (!lib) {
+        dprint("Error: Out of memory.\n");
+        return NULL;
+    }
+    g_cache_lib = lib;
+
+    return lib;
+}
+
+
+/***************************************************************************
+ * Name:    cache_lib_configure
+ *
+ * Desc:    Sets the caches up from a sim_cache command line without the
+ *          program name and the trace file, eg. "--l1-wbb=4 32 8192 4 0 0
+ *          0". Options that need the trace or the driver (--threads,
+ *          --cores, --prof, --results and OPT replacement) can't be used.
+ *
+ * Params:
+ *  lib     ptr to the handle
+ *  config  ptr to the configuration
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise; the handle stays unconfigured
+ **************************************************************************/
+cache_rv
+cache_lib_configure(cache_lib_t *lib, const char *config)
+{
+    int         argc = 1;
+    int         num_opts = 0;
+    int         level = 0;
+    uint32_t    blk_size = 0;
+    uint32_t    l2_blk_size = 0;
+    char        buf[CACHE_LIB_CONFIG_LEN];
+    char        *argv[CACHE_LIB_MAX_ARGS + 2];
+    char        *tok = NULL;
+    char        *save = NULL;
+
+    if ((!lib) || (!config) || (lib != g_cache_lib)) {
+        cache_assert(0);
+        return CACHE_RV_ERR;
+    }
+
+    if (lib->configured) {
+        dprint("Error: The simulator is configured already.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if (strlen(config) >= sizeof(buf)) {
+        dprint("Error: The configuration is too long.\n");
+        return CACHE_RV_ERR;
+    }
+    strcpy(buf, config);
+
+    /* The trace file name is only ever printed; there's none here. */
+    argv[0] = "libsimcache";
+    for (tok = strtok_r(buf, " \t\n", &save); tok;
+            tok = strtok_r(NULL, " \t\n", &save)) {
+        if (argc == CACHE_LIB_MAX_ARGS) {
+            dprint("Error: Too many arguments in the configuration.\n");
+            return CACHE_RV_ERR;
+        }
+        argv[argc++] = tok;
+    }
+    argv[argc++] = "-";
+    argv[argc] = NULL;
+
+    num_opts = cache_opts_parse(argc, argv);
+    if (CACHE_RV_ERR == num_opts)
+        return CACHE_RV_ERR;
+
+    for (level = 0; level < CACHE_OPTS_NUM_LEVELS; ++level) {
+        if (CACHE_REPL_PLCY_OPT == g_cache_opts.level[level].repl)
+            break;
+    }
+    if ((g_cache_opts.threads > 1) || (g_cache_opts.cores > 1) ||
+            (CACHE_PROF_OFF != g_cache_opts.prof) ||
+            (g_cache_opts.results_file[0]) ||
+            (level < CACHE_OPTS_NUM_LEVELS)) {
+        dprint("Error: --threads, --cores, --prof, --results and OPT "
+                "replacement need sim_cache.\n");
+        return CACHE_RV_ERR;
+    }
+
+    argv[num_opts] = argv[0];
+    argc -= num_opts;
+    if (CACHE_INPUT_NUM_ARGS != (argc - 1)) {
+        dprint("Error: Need <block size> <L1 size> <L1 assoc> <VC size> "
+                "<L2 size> <L2 assoc> after the options.\n");
+        return CACHE_RV_ERR;
+    }
+    blk_size = atoi(argv[num_opts + 1]);
+    l2_blk_size = g_cache_opts.level[CACHE_OPTS_L2].blk_size;
+    if ((!blk_size) || (!util_is_power_of_2(blk_size)) ||
+            ((l2_blk_size) && (!util_is_power_of_2(l2_blk_size)))) {
+        dprint("Error: The block sizes must be powers of 2.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if (CACHE_RV_OK != cache_arena_init())
+        return CACHE_RV_ERR;
+
+    g_num_cores = 1;
+    g_addr_count = 0;
+    cache_init(g_l1_caches, g_vic_caches, &g_l2_cache, argc,
+            (argv + num_opts));
+    lib->configured = TRUE;
+
+    if ((!cache_util_validate_caches()) ||
+            (CACHE_RV_OK != cache_incl_init()) ||
+            (CACHE_RV_OK != cache_sector_init()) ||
+            (CACHE_RV_OK != cache_write_init()) ||
+            (CACHE_RV_OK != cache_model_init()) ||
+            (CACHE_RV_OK != cache_sim_init())) {
+        cache_lib_teardown(lib);
+        return CACHE_RV_ERR;
+    }
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_lib_access_batch
+ *
+ * Desc:    Runs a batch of references through the caches, in order, just
+ *          like the references of a trace.
+ *
+ * Params:
+ *  lib         ptr to the configured handle
+ *  addrs       ptr to the addresses
+ *  types       ptr to the types, MEM_REF_TYPE_READ ('r') or
+ *              MEM_REF_TYPE_WRITE ('w'); NULL if all are reads
+ *  num_refs    # of references
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR on a bad type; the references before it are simulated
+ **************************************************************************/
+cache_rv
+cache_lib_access_batch(cache_lib_t *lib, const uint32_t *addrs,
+        const uint8_t *types, size_t num_refs)
+{
+    size_t      iter = 0;
+    mem_ref_t   mref;
+
+    if ((!lib) || ((!addrs) && (num_refs)) || (!lib->configured)) {
+        cache_assert(0);
+        return CACHE_RV_ERR;
+    }
+
+    memset(&mref, 0, sizeof(mref));
+    mref.ref_type = MEM_REF_TYPE_READ;
+    for (iter = 0; iter < num_refs; ++iter) {
+        if (types) {
+            mref.ref_type = types[iter];
+            if ((MEM_REF_TYPE_READ != mref.ref_type) &&
+                    (MEM_REF_TYPE_WRITE != mref.ref_type)) {
+                dprint("Error: Reference %zu of the batch has a bad type "
+                        "0x%x.\n", iter, mref.ref_type);
+                return CACHE_RV_ERR;
+            }
+        }
+        mref.ref_addr = addrs[iter];
+
+        g_addr_count += 1;
+        if (!cache_handle_memory_request(&g_l1_caches[0], &mref)) {
+            dprint("Error: Unable to handle reference %zu of the batch, "
+                    "type %c, addr 0x%x.\n", iter, mref.ref_type,
+                    mref.ref_addr);
+            return CACHE_RV_ERR;
+        }
+        CACHE_TIMING_TICK(&mref);
+        CACHE_INTERVAL_TICK();
+    }
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_lib_stats
+ *
+ * Desc:    Fills in the stats of all the references so far. Blocks still
+ *          waiting in write-back buffers are not counted as written yet.
+ *
+ * Params:
+ *  lib     ptr to the configured handle
+ *  stats   ptr to the stats to fill in
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_lib_stats(cache_lib_t *lib, cache_lib_stats_t *stats)
+{
+    if ((!lib) || (!stats) || (!lib->configured)) {
+        cache_assert(0);
+        return CACHE_RV_ERR;
+    }
+
+    cache_results_calc(&g_l1_caches[0], stats);
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_lib_destroy
+ *
+ * Desc:    Releases the caches and the handle. A new handle can be created
+ *          afterwards.
+ *
+ * Params:
+ *  lib     ptr to the handle
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_lib_destroy(cache_lib_t *lib)
+{
+    if ((!lib) || (lib != g_cache_lib)) {
+        cache_assert(0);
+        return;
+    }
+
+    cache_lib_teardown(lib);
+    free(lib);
+    g_cache_lib = NULL;
+    g_cache_out = NULL;
+
+    return;
+}
@@ -0,0 +1,55 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the API of libsimcache, the simulator as a library
+ * (libsimcache.a and libsimcache.so), for tools that make their own memory
+ * references, eg. binary instrumentation or emulators:
+ *
+ *  lib = cache_lib_create();
+ *  cache_lib_configure(lib, "--l1-repl=plru-tree 32 8192 4 0 262144 8");
+ *  cache_lib_access_batch(lib, addrs, types, num_refs);   (any # of times)
+ *  cache_lib_stats(lib, &stats);
+ *  cache_lib_destroy(lib);
+ *
+ * The configuration is the sim_cache command line without the program and
+ * the trace file: options first, then the six cache parameters. References
+ * are handed over in batches, so the per-call cost is paid once a batch.
+ * Nothing is printed on stdout; errors are reported on stderr and by the
+ * return values.
+ *
+ * The simulator keeps its caches in globals, so there can be one handle at
+ * a time in a process, and the library is not thread safe.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_LIB_H_
+#define CACHE_LIB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cache.h"
+#include "cache_results.h"
+
+/* Simulator handle */
+typedef struct cache_lib__ cache_lib_t;
+
+/* Stats of the run so far: the report's counters and derived metrics */
+typedef cache_results_t cache_lib_stats_t;
+
+
+/* Function declarations */
+cache_lib_t *
+cache_lib_create(void);
+cache_rv
+cache_lib_configure(cache_lib_t *lib, const char *config);
+cache_rv
+cache_lib_access_batch(cache_lib_t *lib, const uint32_t *addrs,
+        const uint8_t *types, size_t num_refs);
+cache_rv
+cache_lib_stats(cache_lib_t *lib, cache_lib_stats_t *stats);
+void
+cache_lib_destroy(cache_lib_t *lib);
+
+#endif /* CACHE_LIB_H_ */
@@ -0,0 +1,330 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module is the sim_cache driver: it parses the command line, runs
+ * the trace through the caches and prints the report. The caches
+ * themselves are in libsimcache (see cache_lib.h), which other programs
+ * can drive without a trace file.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_print.h"
+#include "cache_opts.h"
+#include "cache_interval.h"
+#include "cache_prefetch.h"
+#include "cache_repl.h"
+#include "cache_trace.h"
+#include "cache_timing.h"
+#include "cache_coherence.h"
+#include "cache_ring.h"
+#include "cache_arena.h"
+#include "cache_shard.h"
+#include "cache_incl.h"
+#include "cache_wbb.h"
+#include "cache_sector.h"
+#include "cache_model.h"
+#include "cache_results.h"
+#include "cache_prof.h"
+#include "cache_ptag.h"
+#include "cache_write.h"
+
+
+/*************************************************************************** 
+ * Name:    cache_simulate
+ *
+ * Desc:    Sets up the caches and runs every reference of the trace
+ *          through them, one at a time.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+static cache_rv
+cache_simulate(void)
+{
+    mem_ref_t       mem_ref;
+
+    memset(&mem_ref, 0, sizeof(mem_ref));
+
+    /* Set up the tagstores and the models, if asked for. */
+    if (CACHE_RV_OK != cache_sim_init())
+        return CACHE_RV_ERR;
+
+    /* Parse the trace on a thread of its own, unless asked not to. */
+    if (CACHE_RV_OK != cache_ring_reader_start())
+        return CACHE_RV_ERR;
+
+    /* 
+     * Read the trace file, fetch the address and process the memory access
+     * request for every request in the trace file. Between the references,
+     * the profiler (if on) charges the time to trace parsing.
+     */
+    cache_prof_start();
+    CACHE_PROF_SWITCH(CACHE_PROF_ST_PARSE);
+    while (cache_ring_reader_next(&mem_ref)) {
+        CACHE_PROF_SWITCH(CACHE_PROF_ST_OTHER);
+
+        /* All requests start at the L1 cache of the issuing core. */
+        g_addr_count += 1;
+        if (mem_ref.ref_core >= g_num_cores) {
+            printf("Error: Reference %u is from core %u, but only %u "
+                    "core(s) are simulated.\n", g_addr_count,
+                    mem_ref.ref_core, g_num_cores);
+            return CACHE_RV_ERR;
+        }
+        cache_repl_opt_tick(&mem_ref);
+
+        dprint_dbg("\n%u. Address %x %s\n", g_addr_count, mem_ref.ref_addr,
+                CACHE_GET_REF_TYPE_STR((&mem_ref)));
+
+#ifdef DBG_ON
+        {
+            cache_line_t    l1_line;
+            cache_line_t    vc_line;
+
+            cache_util_decode_mem_addr(g_l1_caches[0].tagstore, 
+                    mem_ref.ref_addr, &l1_line);
+            cache_util_decode_mem_addr(g_vic_caches[0].tagstore, 
+                    mem_ref.ref_addr, &vc_line);
+
+            dprint_dp("ADDR %x, L1 tag %x, VC tag %x\n",
+                    mem_ref.ref_addr, l1_line.tag, vc_line.tag);
+        }
+#endif /* DBG_ON */
+
+        dprint_info("mem_ref %c 0x%x\n", 
+                mem_ref.ref_type, mem_ref.ref_addr);
+        if (!cache_handle_memory_request(&g_l1_caches[mem_ref.ref_core],
+                    &mem_ref)) {
+            dprint_err("Error: Unable to handle memory reference request for "\
+                    "type %c, addr 0x%x.\n", 
+                    mem_ref.ref_type, mem_ref.ref_addr);
+            return CACHE_RV_ERR;
+        }
+
+        CACHE_TIMING_TICK(&mem_ref);
+        CACHE_INTERVAL_TICK();
+        CACHE_PROF_SWITCH(CACHE_PROF_ST_PARSE);
+    }
+    cache_prof_stop();
+    cache_ring_reader_stop();
+
+    cache_sim_finish();
+
+    return CACHE_RV_OK;
+}
+
+
+/* 42: Life, the Universe and Everything; including caches. */
+int
+main(int argc, char **argv)
+{
+    int             num_opts = 0;
+    uint32_t        core = 0;
+    const char      *trace_fpath = NULL;
+
+    /*
+     * Consume the optional "--key=value" arguments, if any. The remaining
+     * positional arguments are shifted down so that they are parsed just
+     * like before.
+     */
+    num_opts = cache_opts_parse(argc, argv);
+    if (CACHE_RV_ERR == num_opts) {
+        cache_print_usage(argv[0]);
+        goto usage_exit;
+    }
+
+    /* Open the results file; records carry the options given as well. */
+    if (CACHE_RV_OK != cache_results_open(num_opts, (argv + 1)))
+        goto usage_exit;
+
+    argv[num_opts] = argv[0];
+    argv += num_opts;
+    argc -= num_opts;
+
+    /* Error out in case of invalid arguments. */
+    if (FALSE == cache_util_validate_input(argc, argv)) {
+        printf("Error: Invalid input(s). See usage for help.\n");
+        cache_print_usage(argv[0]);
+        goto usage_exit;
+    }
+    trace_fpath = argv[argc - 1];
+
+    /* All the tagstores come out of one arena, released at exit. */
+    if (CACHE_RV_OK != cache_arena_init())
+        goto usage_exit;
+
+    /*
+     * Try opening the trace file(s). It's opened before the tagstores as
+     * the OPT replacement policy pre-scans the trace at init. A list of
+     * per-core traces needs a core for each of them.
+     */
+    g_cache_trace = cache_trace_open(trace_fpath);
+    if (!g_cache_trace) {
+        printf("Error: Unable to open trace file %s.\n", trace_fpath);
+        dprint_err("unable to open trace file %s.\n", trace_fpath);
+        goto usage_exit;
+    }
+
+    g_num_cores = (g_cache_opts.cores ? g_cache_opts.cores :
+            g_cache_trace->num_cores);
+    if ((g_num_cores > CACHE_MAX_CORES) ||
+            (g_num_cores < g_cache_trace->num_cores)) {
+        printf("Error: Need 1 to %u cores, and one for each trace.\n",
+                CACHE_MAX_CORES);
+        cache_trace_close(g_cache_trace);
+        goto usage_exit;
+    }
+
+    /* 
+     * Parse arguments and populate the data structure with 
+     * cache attributes. 
+     */
+    cache_init(g_l1_caches, g_vic_caches, &g_l2_cache, argc, argv);
+    if (!cache_util_validate_caches()) {
+        cache_trace_close(g_cache_trace);
+        goto usage_exit;
+    }
+
+    /* Pick the L1 - L2 inclusion policy. */
+    if (CACHE_RV_OK != cache_incl_init()) {
+        cache_trace_close(g_cache_trace);
+        goto usage_exit;
+    }
+
+    /* Split the blocks into sectors, if asked for. */
+    if (CACHE_RV_OK != cache_sector_init()) {
+        cache_trace_close(g_cache_trace);
+        goto usage_exit;
+    }
+
+    /* Bind the caches to their write policies. */
+    if (CACHE_RV_OK != cache_write_init()) {
+        cache_trace_close(g_cache_trace);
+        goto usage_exit;
+    }
+
+    /* Load the technology model; a bad table fails before the run. */
+    if (CACHE_RV_OK != cache_model_init()) {
+        cache_trace_close(g_cache_trace);
+        goto usage_exit;
+    }
+
+    /* Set up the hot path profiler, if asked for. */
+    if (CACHE_RV_OK != cache_prof_init()) {
+        cache_model_cleanup();
+        cache_trace_close(g_cache_trace);
+        goto usage_exit;
+    }
+
+    /*
+     * Run the whole trace through the caches; with --threads=, through
+     * shards of the sets that are simulated in parallel.
+     */
+    if (CACHE_RV_OK != ((g_cache_opts.threads > 1) ? cache_shard_run() :
+                cache_simulate()))
+        goto error_exit;
+
+#ifdef DBG_ON
+    if (!g_cache_shards)
+        cache_print_cache_dbg_data(&g_l1_caches[0]);
+#endif /* DBG_ON */
+
+    /* Dump the cache simulator configuration, cache state and statistics. */
+    dprint_dbg("\n");
+    cache_print_sim_config(&g_l1_caches[0]);
+
+    if (g_cache_shards) {
+        cache_shard_print_contents();
+    } else {
+        for (core = 0; core < g_num_cores; ++core) {
+            cache_print_cache_data(&g_l1_caches[core]);
+            if (cache_util_is_victim_present())
+                cache_print_cache_data(&g_vic_caches[core]);
+        }
+        if (cache_util_is_l2_present())
+            cache_print_cache_data(&g_l2_cache);
+    }
+
+    cache_print_sim_stats(&g_l1_caches[0]);
+    if (CACHE_RV_OK != cache_results_write(&g_l1_caches[0]))
+        goto error_exit;
+
+    for (core = 0; core < g_num_cores; ++core) {
+        if (g_l1_caches[core].pf)
+            cache_print_pf_stats(&g_l1_caches[core]);
+    }
+    if ((cache_util_is_l2_present()) && (g_l2_cache.pf))
+        cache_print_pf_stats(&g_l2_cache);
+
+    if (g_cache_coh)
+        cache_print_coh_stats(g_cache_coh);
+
+    if (CACHE_INCL_DEFAULT != g_cache_opts.inclusion)
+        cache_print_incl_stats();
+
+    if (g_cache_wbb_on)
+        cache_print_wbb_stats();
+
+    if (g_cache_sector_on)
+        cache_print_sector_stats();
+
+    /* The shards have filters of their own, not counted here. */
+    if ((g_cache_ptag_on) && (!g_cache_shards))
+        cache_print_ptag_stats();
+
+    if (g_cache_opts.set_stats)
+        cache_print_set_stats(g_cache_opts.set_stats);
+
+    if (g_cache_timing)
+        cache_print_timing_stats(g_cache_timing);
+
+    if ((g_cache_reader) && (CACHE_PIPELINE_STATS == g_cache_opts.pipeline))
+        cache_print_ring_stats(g_cache_reader);
+
+    if (g_cache_prof_on)
+        cache_print_prof_stats();
+
+    /* Cleanup and exit normally. */
+    cache_ring_reader_cleanup();
+    cache_timing_cleanup();
+    cache_coh_cleanup();
+    cache_shard_cleanup();
+    cache_trace_close(g_cache_trace);
+    cache_cleanup_all();
+    cache_model_cleanup();
+    cache_prof_cleanup();
+    cache_results_close();
+    cache_arena_release();
+
+    return 0;
+
+usage_exit:
+    return -1;
+
+error_exit:
+    cache_ring_reader_cleanup();
+    cache_interval_cleanup();
+    cache_timing_cleanup();
+    cache_coh_cleanup();
+    cache_shard_cleanup();
+    cache_trace_close(g_cache_trace);
+    cache_cleanup_all();
+    cache_model_cleanup();
+    cache_prof_cleanup();
+    cache_results_close();
+    cache_arena_release();
+
+    return -1;
+}
@@ -0,0 +1,468 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the technology models behind the average access
+ * time, the energy and the area of a configuration.
+ *
+ * The course model is the project formula, and has no energy or area:
+ *  hit time (ns)       = 0.25 (L1) or 2.5 (L2) + 2.5 * size / 512kB
+ *                          + 0.025 * blk_size / 16 + 0.025 * assoc
+ *  miss penalty (ns)   = 20 + 0.5 * blk_size / 16
+ *
+ * The table model reads a CACTI-style table, one row per configuration:
+ *  <l1|vc|l2|mem> <size> <assoc> <blk-size> <ns> <nJ/access> <mm^2>
+ * Memory rows give 0 for the size and associativity. A configuration that
+ * is not in the table is interpolated from its neighbours, linearly in the
+ * log2 of the size, the associativity and the block size; the neighbours
+ * must all be in the table. Configurations outside the table are errors.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_model.h"
+
+/* Constants */
+#define CACHE_MODEL_LINE_LEN        256
+#define CACHE_MODEL_NUM_DIMS        3   /* size, assoc, blk_size        */
+
+#define CACHE_MODEL_KIND_L1         0
+#define CACHE_MODEL_KIND_VC         1
+#define CACHE_MODEL_KIND_L2         2
+#define CACHE_MODEL_KIND_MEM        3
+
+/* One row of the table model */
+typedef struct cache_model_row__ {
+    uint8_t             kind;           /* CACHE_MODEL_KIND_*           */
+    uint32_t            dims[CACHE_MODEL_NUM_DIMS];
+    cache_model_point_t pt;
+} cache_model_row_t;
+
+
+static cache_rv cache_model_course_level(cache_generic_t *cache,
+        cache_model_point_t *pt);
+static cache_rv cache_model_course_mem(uint32_t blk_size,
+        cache_model_point_t *pt);
+static cache_rv cache_model_table_level(cache_generic_t *cache,
+        cache_model_point_t *pt);
+static cache_rv cache_model_table_mem(uint32_t blk_size,
+        cache_model_point_t *pt);
+
+/* Globals */
+static const cache_model_ops_t g_cache_model_course = {
+    "course", FALSE, cache_model_course_level, cache_model_course_mem
+};
+static const cache_model_ops_t g_cache_model_table = {
+    "table", TRUE, cache_model_table_level, cache_model_table_mem
+};
+const cache_model_ops_t *g_cache_model = &g_cache_model_course;
+
+static const char *g_model_kind_names[] = { "l1", "vc", "l2", "mem", NULL };
+static cache_model_row_t    *g_model_rows = NULL;
+static uint32_t             g_model_num_rows = 0;
+
+
+/* Course model: project hit time formula; VC numbers are as for L1. */
+static cache_rv
+cache_model_course_level(cache_generic_t *cache, cache_model_point_t *pt)
+{
+    memset(pt, 0, sizeof(*pt));
+    pt->lat_ns = ((CACHE_IS_L2(cache) ? 2.5 : 0.25) +
+            (2.5 * (((double) cache->size) / (512 * 1024))) +
+            (0.025 * (((double) cache->blk_size) / 16)) +
+            (0.025 * cache->set_assoc));
+
+    return CACHE_RV_OK;
+}
+
+
+/* Course model: project miss penalty formula. */
+static cache_rv
+cache_model_course_mem(uint32_t blk_size, cache_model_point_t *pt)
+{
+    memset(pt, 0, sizeof(*pt));
+    pt->lat_ns = (20 + (0.5 * (((double) blk_size) / 16)));
+
+    return CACHE_RV_OK;
+}
+
+
+/* Returns the table row of a configuration, or NULL. */
+static cache_model_row_t *
+cache_model_table_find(uint8_t kind, uint32_t *dims)
+{
+    uint32_t    iter = 0;
+
+    for (iter = 0; iter < g_model_num_rows; ++iter) {
+        if ((kind == g_model_rows[iter].kind) &&
+                (!memcmp(dims, g_model_rows[iter].dims,
+                         sizeof(g_model_rows[iter].dims))))
+            return &g_model_rows[iter];
+    }
+
+    return NULL;
+}
+
+
+/***************************************************************************
+ * Name:    cache_model_table_lookup
+ *
+ * Desc:    Looks a configuration up in the table. Along each dimension, the
+ *          nearest table values below and above the asked one are picked,
+ *          and the numbers of the (up to 8) neighbouring rows are weighed
+ *          by the distance in log2.
+ *
+ * Params:
+ *  kind    CACHE_MODEL_KIND_*
+ *  dims    size, assoc and block size of the configuration
+ *  pt      ptr to the numbers to fill in
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR if the configuration can't be looked up
+ **************************************************************************/
+static cache_rv
+cache_model_table_lookup(uint8_t kind, uint32_t *dims,
+        cache_model_point_t *pt)
+{
+    uint32_t            iter = 0;
+    uint32_t            dim = 0;
+    uint32_t            corner = 0;
+    uint32_t            val = 0;
+    uint32_t            lo[CACHE_MODEL_NUM_DIMS];
+    uint32_t            hi[CACHE_MODEL_NUM_DIMS];
+    uint32_t            at[CACHE_MODEL_NUM_DIMS];
+    double              frac[CACHE_MODEL_NUM_DIMS];
+    double              weight = 0.0;
+    boolean             found_lo = FALSE;
+    boolean             found_hi = FALSE;
+    cache_model_row_t   *row = NULL;
+
+    memset(pt, 0, sizeof(*pt));
+    for (dim = 0; dim < CACHE_MODEL_NUM_DIMS; ++dim) {
+        found_lo = FALSE;
+        found_hi = FALSE;
+        for (iter = 0; iter < g_model_num_rows; ++iter) {
+            if (kind != g_model_rows[iter].kind)
+                continue;
+            val = g_model_rows[iter].dims[dim];
+            if ((val <= dims[dim]) && ((!found_lo) || (val > lo[dim]))) {
+                lo[dim] = val;
+                found_lo = TRUE;
+            }
+            if ((val >= dims[dim]) && ((!found_hi) || (val < hi[dim]))) {
+                hi[dim] = val;
+                found_hi = TRUE;
+            }
+        }
+
+        if ((!found_lo) || (!found_hi))
+            goto out_of_range;
+
+        frac[dim] = ((lo[dim] == hi[dim]) ? 0.0 :
+                ((log2(dims[dim]) - log2(lo[dim])) /
+                 (log2(hi[dim]) - log2(lo[dim]))));
+    }
+
+    for (corner = 0; corner < (1U << CACHE_MODEL_NUM_DIMS); ++corner) {
+        weight = 1.0;
+        for (dim = 0; dim < CACHE_MODEL_NUM_DIMS; ++dim) {
+            if (corner & (1U << dim)) {
+                at[dim] = hi[dim];
+                weight *= frac[dim];
+            } else {
+                at[dim] = lo[dim];
+                weight *= (1.0 - frac[dim]);
+            }
+        }
+        if (0.0 == weight)
+            continue;
+
+        row = cache_model_table_find(kind, at);
+        if (!row) {
+            dprint("Error: Model table has no %s row for %u %u %u, needed "
+                    "for %u %u %u.\n", g_model_kind_names[kind], at[0], at[1],
+                    at[2], dims[0], dims[1], dims[2]);
+            return CACHE_RV_ERR;
+        }
+        pt->lat_ns += (weight * row->pt.lat_ns);
+        pt->energy_nj += (weight * row->pt.energy_nj);
+        pt->area_mm2 += (weight * row->pt.area_mm2);
+    }
+
+    return CACHE_RV_OK;
+
+out_of_range:
+    dprint("Error: %s %u %u %u is outside the model table.\n",
+            g_model_kind_names[kind], dims[0], dims[1], dims[2]);
+    return CACHE_RV_ERR;
+}
+
+
+/* Table model: numbers of a cache level. */
+static cache_rv
+cache_model_table_level(cache_generic_t *cache, cache_model_point_t *pt)
+{
+    uint8_t     kind = CACHE_MODEL_KIND_L1;
+    uint32_t    dims[CACHE_MODEL_NUM_DIMS];
+
+    if (CACHE_IS_VC(cache))
+        kind = CACHE_MODEL_KIND_VC;
+    else if (CACHE_IS_L2(cache))
+        kind = CACHE_MODEL_KIND_L2;
+
+    dims[0] = cache->size;
+    dims[1] = cache->set_assoc;
+    dims[2] = cache->blk_size;
+
+    return cache_model_table_lookup(kind, dims, pt);
+}
+
+
+/* Table model: numbers of a memory access. */
+static cache_rv
+cache_model_table_mem(uint32_t blk_size, cache_model_point_t *pt)
+{
+    uint32_t    dims[CACHE_MODEL_NUM_DIMS] = { 0, 0, blk_size };
+
+    return cache_model_table_lookup(CACHE_MODEL_KIND_MEM, dims, pt);
+}
+
+
+/* Parses one line of a table file into a row; FALSE on a bad line. */
+static boolean
+cache_model_parse_row(const char *line, cache_model_row_t *row)
+{
+    char        kind[8];
+    char        extra[2];
+    uint8_t     iter = 0;
+
+    memset(row, 0, sizeof(*row));
+    if (7 != sscanf(line, "%7s %u %u %u %lf %lf %lf %1s", kind,
+                &row->dims[0], &row->dims[1], &row->dims[2],
+                &row->pt.lat_ns, &row->pt.energy_nj, &row->pt.area_mm2,
+                extra))
+        return FALSE;
+
+    for (iter = 0; g_model_kind_names[iter]; ++iter) {
+        if (!strcmp(g_model_kind_names[iter], kind))
+            break;
+    }
+    if (!g_model_kind_names[iter])
+        return FALSE;
+    row->kind = iter;
+
+    /* Memory has no size or associativity; caches need all three. */
+    if (CACHE_MODEL_KIND_MEM == row->kind)
+        return ((!row->dims[0]) && (!row->dims[1]) && (row->dims[2]));
+
+    return ((row->dims[0]) && (row->dims[1]) && (row->dims[2]));
+}
+
+
+/***************************************************************************
+ * Name:    cache_model_load
+ *
+ * Desc:    Reads a table file into the table model. Blank lines and lines
+ *          starting with a '#' are skipped.
+ *
+ * Params:
+ *  fpath   ptr to the table file path
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR on a read or format error
+ **************************************************************************/
+static cache_rv
+cache_model_load(const char *fpath)
+{
+    char                line[CACHE_MODEL_LINE_LEN];
+    const char          *start = NULL;
+    uint32_t            line_num = 0;
+    uint32_t            max_rows = 0;
+    cache_model_row_t   row;
+    cache_model_row_t   *rows = NULL;
+    FILE                *fptr = NULL;
+
+    fptr = fopen(fpath, "r");
+    if (!fptr) {
+        dprint("Error: Unable to open model file %s.\n", fpath);
+        return CACHE_RV_ERR;
+    }
+
+    while (fgets(line, sizeof(line), fptr)) {
+        line_num += 1;
+        start = (line + strspn(line, " \t"));
+        if (('#' == *start) || ('\n' == *start) || ('\0' == *start))
+            continue;
+
+        if (!cache_model_parse_row(start, &row)) {
+            dprint("Error: Bad row at %s:%u.\n", fpath, line_num);
+            goto error_exit;
+        }
+        if (cache_model_table_find(row.kind, row.dims)) {
+            dprint("Error: Duplicate row at %s:%u.\n", fpath, line_num);
+            goto error_exit;
+        }
+
+        if (g_model_num_rows == max_rows) {
+            max_rows = (max_rows ? (2 * max_rows) : 64);
+            rows = realloc(g_model_rows, (max_rows * sizeof(*rows)));
+            if (!rows) {
+                dprint("Error: Unable to allocate memory for the model "
+                        "table.\n");
+                goto error_exit;
+            }
+            g_model_rows = rows;
+        }
+        g_model_rows[g_model_num_rows++] = row;
+    }
+
+    fclose(fptr);
+    return CACHE_RV_OK;
+
+error_exit:
+    fclose(fptr);
+    cache_model_cleanup();
+    return CACHE_RV_ERR;
+}
+
+
+/***************************************************************************
+ * Name:    cache_model_init
+ *
+ * Desc:    Picks the technology model: the table in --model=, if given, or
+ *          the course formula. Every level of the configuration, and the
+ *          memory, is looked up right away, so that a table that doesn't
+ *          cover it fails before the simulation. Must be called after the
+ *          caches are set up.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR on a bad table
+ **************************************************************************/
+cache_rv
+cache_model_init(void)
+{
+    cache_model_point_t pt;
+    cache_generic_t     *last = cache_util_get_l1(0);
+
+    g_cache_model = &g_cache_model_course;
+    if (!g_cache_opts.model_file[0])
+        return CACHE_RV_OK;
+
+    if (CACHE_RV_OK != cache_model_load(g_cache_opts.model_file))
+        return CACHE_RV_ERR;
+
+    if (cache_util_is_l2_present())
+        last = cache_util_get_l2();
+
+    if ((CACHE_RV_OK != cache_model_table_level(cache_util_get_l1(0), &pt)) ||
+            ((cache_util_is_victim_present()) &&
+             (CACHE_RV_OK != cache_model_table_level(cache_util_get_vc(0),
+                                                     &pt))) ||
+            ((cache_util_is_l2_present()) &&
+             (CACHE_RV_OK != cache_model_table_level(cache_util_get_l2(),
+                                                     &pt))) ||
+            (CACHE_RV_OK != cache_model_table_mem(last->blk_size, &pt))) {
+        cache_model_cleanup();
+        return CACHE_RV_ERR;
+    }
+
+    g_cache_model = &g_cache_model_table;
+
+    return CACHE_RV_OK;
+}
+
+
+/* Frees the model table, if any. */
+void
+cache_model_cleanup(void)
+{
+    free(g_model_rows);
+    g_model_rows = NULL;
+    g_model_num_rows = 0;
+
+    return;
+}
+
+
+/* Adds a level to the cost of a configuration. */
+static void
+cache_model_add_level(cache_model_cost_t *cost, const char *name,
+        uint32_t count, uint64_t accesses, cache_model_point_t *pt)
+{
+    cache_model_level_cost_t    *level = &cost->levels[cost->num_levels++];
+
+    level->name = name;
+    level->count = count;
+    level->accesses = accesses;
+    level->pt = *pt;
+    cost->energy_nj += (pt->energy_nj * accesses);
+    cost->area_mm2 += (pt->area_mm2 * count);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_model_get_cost
+ *
+ * Desc:    Works out the energy and area of the simulated configuration,
+ *          level by level, with the current model. L1s and VCs are counted
+ *          once per core. Every L1 miss looks the VC up, and every block of
+ *          memory traffic is a memory access.
+ *
+ * Params:
+ *  l1_stats    ptr to the L1 stats, summed over the cores
+ *  vc_stats    ptr to the VC stats, summed over the cores; NULL if no VC
+ *  mem_refs    # of memory accesses
+ *  cost        ptr to the cost to fill in
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_model_get_cost(cache_stats_t *l1_stats, cache_stats_t *vc_stats,
+        uint32_t mem_refs, cache_model_cost_t *cost)
+{
+    cache_model_point_t pt;
+    cache_generic_t     *cache = cache_util_get_l1(0);
+
+    memset(cost, 0, sizeof(*cost));
+
+    g_cache_model->level(cache, &pt);
+    cache_model_add_level(cost, CACHE_GET_NAME(cache), g_num_cores,
+            ((uint64_t) l1_stats->num_reads + l1_stats->num_writes), &pt);
+
+    if (vc_stats) {
+        cache = cache_util_get_vc(0);
+        g_cache_model->level(cache, &pt);
+        cache_model_add_level(cost, CACHE_GET_NAME(cache), g_num_cores,
+                ((uint64_t) l1_stats->num_read_misses +
+                 l1_stats->num_write_misses), &pt);
+    }
+
+    if (cache_util_is_l2_present()) {
+        cache = cache_util_get_l2();
+        g_cache_model->level(cache, &pt);
+        cache_model_add_level(cost, CACHE_GET_NAME(cache), 1,
+                ((uint64_t) cache->stats.num_reads + cache->stats.num_writes),
+                &pt);
+    }
+
+    g_cache_model->mem(cache->blk_size, &pt);
+    cache_model_add_level(cost, "memory", 1, mem_refs, &pt);
+
+    return;
+}
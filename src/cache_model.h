@@ -0,0 +1,66 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the technology models, which give the hit latency, the energy per access
+ * and the area of a cache level and the latency and energy of a memory
+ * access. The built-in model is the course formula; --model= loads a table
+ * of technology numbers instead.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_MODEL_H_
+#define CACHE_MODEL_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Technology numbers of one cache level or memory */
+typedef struct cache_model_point__ {
+    double      lat_ns;                 /* hit or access latency in ns  */
+    double      energy_nj;              /* energy per access in nJ      */
+    double      area_mm2;               /* area in mm^2; 0 for memory   */
+} cache_model_point_t;
+
+/* Energy and area of one level of a configuration */
+typedef struct cache_model_level_cost__ {
+    const char          *name;          /* level name; "memory"         */
+    uint32_t            count;          /* # of copies, eg. per core    */
+    uint64_t            accesses;       /* # of accesses, all copies    */
+    cache_model_point_t pt;             /* numbers of one copy          */
+} cache_model_level_cost_t;
+
+/* Energy and area of a configuration: L1, VC, L2 and memory */
+#define CACHE_MODEL_MAX_LEVELS      4
+typedef struct cache_model_cost__ {
+    uint32_t                    num_levels;
+    cache_model_level_cost_t    levels[CACHE_MODEL_MAX_LEVELS];
+    double                      energy_nj;  /* total energy             */
+    double                      area_mm2;   /* total area               */
+} cache_model_cost_t;
+
+/* Model ops */
+typedef struct cache_model_ops__ {
+    const char  *name;
+    boolean     has_cost;               /* gives energy and area        */
+    cache_rv    (*level)(cache_generic_t *cache, cache_model_point_t *pt);
+    cache_rv    (*mem)(uint32_t blk_size, cache_model_point_t *pt);
+} cache_model_ops_t;
+
+
+/* Externs */
+extern const cache_model_ops_t  *g_cache_model;
+
+
+/* Function declarations */
+cache_rv
+cache_model_init(void);
+void
+cache_model_cleanup(void);
+void
+cache_model_get_cost(cache_stats_t *l1_stats, cache_stats_t *vc_stats,
+        uint32_t mem_refs, cache_model_cost_t *cost);
+
+#endif /* CACHE_MODEL_H_ */
@@ -0,0 +1,417 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module parses the optional "--key=value" simulator arguments. All
+ * the options are described by a single table (g_cache_opt_table) and new
+ * options need nothing more than a new table entry and a field in
+ * cache_opts_t.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_prefetch.h"
+#include "cache_repl.h"
+#include "cache_incl.h"
+#include "cache_wbb.h"
+#include "cache_results.h"
+#include "cache_prof.h"
+#include "cache_ptag.h"
+#include "cache_index.h"
+#include "cache_write.h"
+
+#define CACHE_OPT_ENTRY(NAME, TYPE, FIELD, ENUMS, HELP)                 \
+    { NAME, TYPE, CACHE_OPTS_LVL_NONE, offsetof(cache_opts_t, FIELD),   \
+        sizeof(((cache_opts_t *) 0)->FIELD), ENUMS, HELP }
+#define CACHE_OPT_LEVEL_ENTRY(NAME, TYPE, LEVELS, FIELD, ENUMS, HELP)   \
+    { NAME, TYPE, LEVELS, offsetof(cache_level_opts_t, FIELD),          \
+        sizeof(((cache_level_opts_t *) 0)->FIELD), ENUMS, HELP }
+
+/* Globals */
+cache_opts_t    g_cache_opts;           /* optional simulator arguments */
+
+static const char *g_interval_fmt_names[] = { "csv", "bin", NULL };
+static const char *g_timing_names[] = { "off", "on", NULL };
+static const char *g_pipeline_names[] = { "on", "off", "stats", NULL };
+static const char *g_hugepages_names[] = { "off", "thp", "hugetlb", NULL };
+static const char *g_level_prefixes[CACHE_OPTS_NUM_LEVELS] =
+    { "l1-", "vc-", "l2-" };
+
+static const cache_opt_desc_t g_cache_opt_table[] = {
+    CACHE_OPT_ENTRY("interval", CACHE_OPT_TYPE_UINT, interval, NULL,
+            "snapshot per-level stats every N references; 0 disables"),
+    CACHE_OPT_ENTRY("interval-file", CACHE_OPT_TYPE_STR, interval_file, NULL,
+            "interval stats output file (default: interval.csv/.bin)"),
+    CACHE_OPT_ENTRY("interval-fmt", CACHE_OPT_TYPE_ENUM, interval_fmt,
+            g_interval_fmt_names, "interval stats format: csv, bin"),
+    CACHE_OPT_ENTRY("progress", CACHE_OPT_TYPE_UINT, progress, NULL,
+            "print running stats on stderr every N references; 0 disables"),
+    CACHE_OPT_ENTRY("cores", CACHE_OPT_TYPE_UINT, cores, NULL,
+            "# of cores, up to 64, sharing L2 (default: # of traces)"),
+    CACHE_OPT_ENTRY("quantum", CACHE_OPT_TYPE_UINT, quantum, NULL,
+            "refs per core per turn over per-core traces (default 1)"),
+    CACHE_OPT_ENTRY("threads", CACHE_OPT_TYPE_UINT, threads, NULL,
+            "simulate the sets over N threads, a power of 2 (default 1)"),
+    CACHE_OPT_ENTRY("pipeline", CACHE_OPT_TYPE_ENUM, pipeline,
+            g_pipeline_names, "parse the trace on its own thread: on, off, "
+            "stats"),
+    CACHE_OPT_ENTRY("hugepages", CACHE_OPT_TYPE_ENUM, hugepages,
+            g_hugepages_names, "huge pages for the tagstores: off, thp, "
+            "hugetlb"),
+    CACHE_OPT_ENTRY("arena-align", CACHE_OPT_TYPE_UINT, arena_align, NULL,
+            "alignment of the tagstore arrays in bytes (default 64)"),
+    CACHE_OPT_ENTRY("inclusion", CACHE_OPT_TYPE_ENUM, inclusion,
+            g_cache_incl_names, "L2 inclusion: non-inclusive (default), "
+            "inclusive, exclusive"),
+    CACHE_OPT_ENTRY("model", CACHE_OPT_TYPE_STR, model_file, NULL,
+            "latency/energy/area table file (default: course formula)"),
+    CACHE_OPT_ENTRY("results", CACHE_OPT_TYPE_STR, results_file, NULL,
+            "append a machine readable results record to the file"),
+    CACHE_OPT_ENTRY("results-fmt", CACHE_OPT_TYPE_ENUM, results_fmt,
+            g_cache_results_fmt_names, "results format: jsonl, csv"),
+    CACHE_OPT_ENTRY("prof", CACHE_OPT_TYPE_ENUM, prof, g_cache_prof_names,
+            "hot path cycle breakdown: off, tsc, hw (PROF builds)"),
+    CACHE_OPT_ENTRY("seed", CACHE_OPT_TYPE_UINT, seed, NULL,
+            "seed for the random and BRRIP replacement policies"),
+    CACHE_OPT_LEVEL_ENTRY("repl", CACHE_OPT_TYPE_ENUM,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_VC | CACHE_OPTS_LVL_L2), repl,
+            g_cache_repl_names, "replacement: lru, lfu, fifo, random, "
+            "plru-tree, plru-bit, srrip, brrip, opt (L1 only)"),
+    CACHE_OPT_ENTRY("timing", CACHE_OPT_TYPE_ENUM, timing, g_timing_names,
+            "cycle-level timing with MSHRs: off, on"),
+    CACHE_OPT_ENTRY("mem-lat", CACHE_OPT_TYPE_UINT, mem_lat, NULL,
+            "timing: memory latency in cycles (default 100)"),
+    CACHE_OPT_LEVEL_ENTRY("hit-lat", CACHE_OPT_TYPE_UINT,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_VC | CACHE_OPTS_LVL_L2),
+            hit_lat, NULL,
+            "timing: hit latency in cycles (default 2, 1, 10)"),
+    CACHE_OPT_LEVEL_ENTRY("mshrs", CACHE_OPT_TYPE_UINT,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_L2), mshrs, NULL,
+            "timing: # of MSHRs, up to 64 (default 8, 16)"),
+    CACHE_OPT_LEVEL_ENTRY("prefetch", CACHE_OPT_TYPE_ENUM,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_L2), prefetch,
+            g_cache_pf_type_names,
+            "prefetcher: none, next-line, stride, stream"),
+    CACHE_OPT_LEVEL_ENTRY("pf-degree", CACHE_OPT_TYPE_UINT,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_L2), pf_degree, NULL,
+            "# of blocks fetched per prefetch trigger (default 1)"),
+    CACHE_OPT_LEVEL_ENTRY("pf-latency", CACHE_OPT_TYPE_UINT,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_L2), pf_latency, NULL,
+            "# of references before a prefetch fill lands"),
+    CACHE_OPT_LEVEL_ENTRY("wbb", CACHE_OPT_TYPE_UINT,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_VC | CACHE_OPTS_LVL_L2), wbb,
+            NULL, "write-back buffer entries, up to 256; 0 disables"),
+    CACHE_OPT_LEVEL_ENTRY("wbb-drain", CACHE_OPT_TYPE_ENUM,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_VC | CACHE_OPTS_LVL_L2),
+            wbb_drain, g_cache_wbb_drain_names,
+            "write-back buffer drain: eager, lazy, watermark"),
+    CACHE_OPT_LEVEL_ENTRY("sectors", CACHE_OPT_TYPE_UINT,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_L2), sectors, NULL,
+            "sectors per block, a power of 2 up to 32; 1 disables"),
+    CACHE_OPT_LEVEL_ENTRY("ptags", CACHE_OPT_TYPE_ENUM,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_L2), ptags,
+            g_cache_ptag_names, "partial tag miss filter: off, on"),
+    CACHE_OPT_LEVEL_ENTRY("index", CACHE_OPT_TYPE_ENUM,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_L2), index_fn,
+            g_cache_index_names, "set index function: bits, xor, prime"),
+    CACHE_OPT_LEVEL_ENTRY("blk-size", CACHE_OPT_TYPE_UINT,
+            CACHE_OPTS_LVL_L2, blk_size, NULL,
+            "block size, a power of 2 (default: the block size argument)"),
+    CACHE_OPT_ENTRY("set-stats", CACHE_OPT_TYPE_UINT, set_stats, NULL,
+            "per set conflict stats with the N hottest sets; 0 disables"),
+    CACHE_OPT_LEVEL_ENTRY("write", CACHE_OPT_TYPE_ENUM,
+            (CACHE_OPTS_LVL_L1 | CACHE_OPTS_LVL_L2), write_plcy,
+            g_cache_write_names, "write policy: wbwa (default), wtna"),
+    CACHE_OPT_ENTRY(CACHE_OPTS_CONFIG, CACHE_OPT_TYPE_STR, config_file, NULL,
+            "more options from the file, one key=value per line"),
+    { NULL, 0, 0, 0, 0, NULL, NULL }
+};
+
+
+/***************************************************************************
+ * Name:    cache_opts_set_value
+ *
+ * Desc:    Converts the given option value as per the option type and
+ *          stores it in the global options.
+ *
+ * Params:
+ *  desc    ptr to the option table entry
+ *  base    ptr to the options (cache_opts_t or cache_level_opts_t)
+ *  value   ptr to the user given value string
+ *
+ * Returns: boolean
+ *  TRUE if the value is good
+ *  FALSE otherwise
+ **************************************************************************/
+static boolean
+cache_opts_set_value(const cache_opt_desc_t *desc, void *base,
+        const char *value)
+{
+    char            *end = NULL;
+    uint8_t         *dst = NULL;
+    uint32_t        iter = 0;
+    unsigned long   num = 0;
+
+    dst = ((uint8_t *) base) + desc->offset;
+
+    switch (desc->type) {
+        case CACHE_OPT_TYPE_UINT:
+            num = strtoul(value, &end, 0);
+            if ((end == value) || (*end) || (num > UINT32_MAX))
+                return FALSE;
+            *((uint32_t *) dst) = (uint32_t) num;
+            break;
+
+        case CACHE_OPT_TYPE_STR:
+            if (strlen(value) >= desc->size)
+                return FALSE;
+            strncpy((char *) dst, value, (desc->size - 1));
+            break;
+
+        case CACHE_OPT_TYPE_ENUM:
+            for (iter = 0; desc->enum_names[iter]; ++iter) {
+                if (!strcmp(desc->enum_names[iter], value)) {
+                    *dst = (uint8_t) iter;
+                    return TRUE;
+                }
+            }
+            return FALSE;
+
+        default:
+            cache_assert(0);
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/***************************************************************************
+ * Name:    cache_opts_apply
+ *
+ * Desc:    Looks up a "key=value" option, less the prefix, in the option
+ *          table and stores its value.
+ *
+ * Params:
+ *  arg     ptr to the option, past the prefix
+ *  src     ptr to the option as given, for the error messages
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK if the option is good
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+static cache_rv
+cache_opts_apply(const char *arg, const char *src)
+{
+    int                     level = 0;
+    size_t                  name_len = 0;
+    void                    *base = NULL;
+    const char              *value = NULL;
+    const cache_opt_desc_t  *desc = NULL;
+
+    value = strchr(arg, '=');
+    if (!value) {
+        dprint("Error: Option %s needs a value.\n", src);
+        return CACHE_RV_ERR;
+    }
+    name_len = (value - arg);
+    value += 1;
+
+    /* Per-level options carry a level prefix; strip it first. */
+    base = &g_cache_opts;
+    for (level = 0; level < CACHE_OPTS_NUM_LEVELS; ++level) {
+        if (!strncmp(arg, g_level_prefixes[level],
+                    strlen(g_level_prefixes[level]))) {
+            arg += strlen(g_level_prefixes[level]);
+            name_len -= strlen(g_level_prefixes[level]);
+            base = &g_cache_opts.level[level];
+            break;
+        }
+    }
+
+    for (desc = g_cache_opt_table; desc->name; ++desc) {
+        if ((strlen(desc->name) == name_len) &&
+                (!strncmp(desc->name, arg, name_len)))
+            break;
+    }
+
+    if ((!desc->name) ||
+            ((base == &g_cache_opts) != (!desc->levels)) ||
+            ((desc->levels) && (!(desc->levels & (1 << level))))) {
+        dprint("Error: Unknown option %s.\n", src);
+        return CACHE_RV_ERR;
+    }
+
+    if (!cache_opts_set_value(desc, base, value)) {
+        dprint("Error: Bad value for option %s.\n", src);
+        return CACHE_RV_ERR;
+    }
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_opts_load
+ *
+ * Desc:    Reads the options of a --config= file: one "key=value" per
+ *          line, with or without the "--" prefix. Blank lines and lines
+ *          starting with '#' are skipped. A config file can't name another
+ *          one.
+ *
+ * Params:
+ *  file    ptr to the config file name
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK if all the options are good
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+static cache_rv
+cache_opts_load(const char *file)
+{
+    char        line[CACHE_OPTS_LINE_LEN];
+    char        src[CACHE_OPTS_LINE_LEN + CACHE_TRACE_FILE_LEN + 16];
+    char        *arg = NULL;
+    char        *end = NULL;
+    FILE        *fp = NULL;
+    uint32_t    line_num = 0;
+    cache_rv    rv = CACHE_RV_OK;
+
+    fp = fopen(file, "r");
+    if (!fp) {
+        dprint("Error: Unable to open config file %s.\n", file);
+        return CACHE_RV_ERR;
+    }
+
+    while ((CACHE_RV_OK == rv) && (fgets(line, sizeof(line), fp))) {
+        line_num += 1;
+        if ((!strchr(line, '\n')) && (!feof(fp))) {
+            dprint("Error: Line %u of %s is too long.\n", line_num, file);
+            rv = CACHE_RV_ERR;
+            break;
+        }
+
+        /* Trim the line; the option is what's left. */
+        for (arg = line; ((' ' == *arg) || ('\t' == *arg)); ++arg)
+            ;
+        end = (arg + strlen(arg));
+        while ((end > arg) && (strchr(" \t\r\n", *(end - 1))))
+            --end;
+        *end = '\0';
+        if ((!*arg) || ('#' == *arg))
+            continue;
+        if (!strncmp(arg, CACHE_OPTS_PREFIX, strlen(CACHE_OPTS_PREFIX)))
+            arg += strlen(CACHE_OPTS_PREFIX);
+
+        snprintf(src, sizeof(src), "%s (%s, line %u)", arg, file, line_num);
+        if (!strncmp(arg, CACHE_OPTS_CONFIG "=",
+                    strlen(CACHE_OPTS_CONFIG "="))) {
+            dprint("Error: Option %s can't name another config file.\n",
+                    src);
+            rv = CACHE_RV_ERR;
+            break;
+        }
+        rv = cache_opts_apply(arg, src);
+    }
+
+    fclose(fp);
+    return rv;
+}
+
+
+/***************************************************************************
+ * Name:    cache_opts_parse
+ *
+ * Desc:    Parses the leading "--key=value" arguments into g_cache_opts.
+ *          Parsing stops at the first argument without the option prefix;
+ *          rest of the arguments are the positional cache configuration.
+ *          The options of a --config= file are taken in its place, so the
+ *          ones given after it win.
+ *
+ * Params:
+ *  nargs   # of input arguments
+ *  args    ptr to user entered arguments
+ *
+ * Returns: int
+ *  # of option arguments consumed
+ *  CACHE_RV_ERR on a bad option
+ **************************************************************************/
+int
+cache_opts_parse(int nargs, char **args)
+{
+    int         arg_iter = 1;
+    const char  *arg = NULL;
+
+    memset(&g_cache_opts, 0, sizeof(g_cache_opts));
+
+    for (arg_iter = 1; arg_iter < nargs; ++arg_iter) {
+        arg = args[arg_iter];
+        if (strncmp(arg, CACHE_OPTS_PREFIX, strlen(CACHE_OPTS_PREFIX)))
+            break;
+
+        arg += strlen(CACHE_OPTS_PREFIX);
+        if (CACHE_RV_OK != cache_opts_apply(arg, args[arg_iter]))
+            return CACHE_RV_ERR;
+
+        if ((!strncmp(arg, CACHE_OPTS_CONFIG "=",
+                        strlen(CACHE_OPTS_CONFIG "="))) &&
+                (CACHE_RV_OK != cache_opts_load(g_cache_opts.config_file)))
+            return CACHE_RV_ERR;
+    }
+
+    return (arg_iter - 1);
+}
+
+
+/***************************************************************************
+ * Name:    cache_opts_print_usage
+ *
+ * Desc:    Prints the help text for all optional arguments.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_opts_print_usage(void)
+{
+    char                    name[CACHE_OPTS_NAME_LEN + 8];
+    char                    levels[CACHE_OPTS_NAME_LEN];
+    int                     level = 0;
+    const cache_opt_desc_t  *desc = NULL;
+
+    dprint("Options (given before <block-size>):\n");
+    for (desc = g_cache_opt_table; desc->name; ++desc) {
+        if (!desc->levels) {
+            snprintf(name, sizeof(name), "%s%s=",
+                    CACHE_OPTS_PREFIX, desc->name);
+            dprint("    %-26s: %s\n", name, desc->help);
+            continue;
+        }
+
+        /* Per-level options are shown as --<lvl>-<name>, eg. --l1-.. */
+        levels[0] = '\0';
+        for (level = 0; level < CACHE_OPTS_NUM_LEVELS; ++level) {
+            if (!(desc->levels & (1 << level)))
+                continue;
+            strncat(levels, g_level_prefixes[level], 2);
+            strcat(levels, ",");
+        }
+        levels[strlen(levels) - 1] = '\0';
+        snprintf(name, sizeof(name), "%s<lvl>-%s=",
+                CACHE_OPTS_PREFIX, desc->name);
+        dprint("    %-26s: %s\n", name, desc->help);
+        dprint("    %-26s  <lvl>: %s\n", "", levels);
+    }
+
+    return;
+}
+
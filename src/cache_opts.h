@@ -0,0 +1,114 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the optional "--key=value" simulator arguments. Optional arguments are
+ * given before the positional cache configuration arguments.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_OPTS_H_
+#define CACHE_OPTS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_OPTS_PREFIX           "--"
+#define CACHE_OPTS_NAME_LEN         32
+#define CACHE_OPTS_LINE_LEN         256
+#define CACHE_OPTS_CONFIG           "config"
+
+#define CACHE_INTERVAL_FMT_CSV      0
+#define CACHE_INTERVAL_FMT_BIN      1
+
+/* Per-level option slots; level options are given as --<lvl>-<name>. */
+#define CACHE_OPTS_L1               0
+#define CACHE_OPTS_VC               1
+#define CACHE_OPTS_L2               2
+#define CACHE_OPTS_NUM_LEVELS       3
+
+#define CACHE_OPTS_LVL_NONE         0x0
+#define CACHE_OPTS_LVL_L1           (1 << CACHE_OPTS_L1)
+#define CACHE_OPTS_LVL_VC           (1 << CACHE_OPTS_VC)
+#define CACHE_OPTS_LVL_L2           (1 << CACHE_OPTS_L2)
+
+/* Option value types */
+typedef enum cache_opt_type__ {
+    CACHE_OPT_TYPE_UINT = 0,            /* unsigned 32-bit integer      */
+    CACHE_OPT_TYPE_STR,                 /* string (file names)          */
+    CACHE_OPT_TYPE_ENUM                 /* one of a list of names       */
+} cache_opt_type_t;
+
+/* Optional per-level arguments */
+typedef struct cache_level_opts__ {
+    uint8_t     repl;                   /* CACHE_REPL_PLCY_*            */
+    uint32_t    hit_lat;                /* timing: hit latency, cycles  */
+    uint32_t    mshrs;                  /* timing: # of MSHRs           */
+    uint8_t     prefetch;               /* CACHE_PF_TYPE_*              */
+    uint32_t    pf_degree;              /* # of blocks per prefetch     */
+    uint32_t    pf_latency;             /* prefetch fill delay in refs  */
+    uint32_t    wbb;                    /* write-back buffer entries    */
+    uint8_t     wbb_drain;              /* CACHE_WBB_DRAIN_*            */
+    uint32_t    sectors;                /* sectors per block; 0/1 = none*/
+    uint8_t     ptags;                  /* CACHE_PTAGS_*                */
+    uint8_t     index_fn;               /* CACHE_INDEX_*                */
+    uint32_t    blk_size;               /* block size; 0 = the argument */
+    uint8_t     write_plcy;             /* CACHE_WRITE_PLCY_*           */
+} cache_level_opts_t;
+
+/* Optional simulator arguments */
+typedef struct cache_opts__ {
+    uint32_t    interval;               /* stats snapshot interval      */
+    uint8_t     interval_fmt;           /* CACHE_INTERVAL_FMT_*         */
+    char        interval_file[CACHE_TRACE_FILE_LEN];
+    uint32_t    progress;               /* refs per progress line       */
+    uint32_t    seed;                   /* seed for random policies     */
+    uint8_t     timing;                 /* CACHE_TIMING_ON/OFF          */
+    uint32_t    mem_lat;                /* timing: memory latency       */
+    uint32_t    cores;                  /* # of cores; 0 = # of traces  */
+    uint32_t    quantum;                /* refs per core per turn       */
+    uint32_t    threads;                /* # of set shards; 0/1 = serial*/
+    uint8_t     pipeline;               /* CACHE_PIPELINE_*             */
+    uint8_t     hugepages;              /* CACHE_HUGEPAGES_*            */
+    uint32_t    arena_align;            /* tagstore array alignment     */
+    uint8_t     inclusion;              /* CACHE_INCL_*                 */
+    char        model_file[CACHE_TRACE_FILE_LEN];   /* technology table */
+    char        results_file[CACHE_TRACE_FILE_LEN]; /* results to append*/
+    uint8_t     results_fmt;            /* CACHE_RESULTS_FMT_*          */
+    uint8_t     prof;                   /* CACHE_PROF_*                 */
+    uint32_t    set_stats;              /* # of hottest sets to print;
+                                           0 = no set stats             */
+    char        config_file[CACHE_TRACE_FILE_LEN];  /* more options     */
+    cache_level_opts_t  level[CACHE_OPTS_NUM_LEVELS];
+} cache_opts_t;
+
+/* Option table entry */
+typedef struct cache_opt_desc__ {
+    const char          *name;          /* name, without the prefix     */
+    cache_opt_type_t    type;           /* value type                   */
+    uint8_t             levels;         /* CACHE_OPTS_LVL_* mask; none
+                                           for simulator wide options   */
+    size_t              offset;         /* offset within cache_opts_t or
+                                           within cache_level_opts_t    */
+    size_t              size;           /* size of the destination      */
+    const char          **enum_names;   /* names for ENUM types         */
+    const char          *help;          /* one line help text           */
+} cache_opt_desc_t;
+
+
+/* Externs */
+extern cache_opts_t     g_cache_opts;
+
+
+/* Function declarations */
+int
+cache_opts_parse(int nargs, char **args);
+void
+cache_opts_print_usage(void);
+
+#endif /* CACHE_OPTS_H_ */
+
@@ -0,0 +1,600 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the hardware prefetcher models: next-line,
+ * stride (PC-less; strides are learnt per 4KB region) and stream. The
+ * prefetchers only produce candidate block addresses; the common code
+ * here filters the candidates, keeps track of in-flight prefetches and
+ * hands the fills over to cache_prefetch_fill().
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_prefetch.h"
+
+/* Stride prefetcher tunables */
+#define CACHE_PF_STRIDE_ENTRIES     64      /* direct mapped RPT        */
+#define CACHE_PF_STRIDE_REGION_BITS 12      /* 4KB regions              */
+#define CACHE_PF_STRIDE_CONF_MAX    3
+#define CACHE_PF_STRIDE_CONF_ISSUE  2
+
+/* Stream prefetcher tunables */
+#define CACHE_PF_STREAM_ENTRIES     16      /* # of tracked streams     */
+#define CACHE_PF_STREAM_WINDOW      16      /* blks to match a stream   */
+#define CACHE_PF_STREAM_DISTANCE    16      /* max. blks ahead          */
+#define CACHE_PF_STREAM_CONF_ISSUE  2
+
+/* Stride prefetcher table entry */
+typedef struct cache_pf_stride_ent__ {
+    uint32_t    region;                 /* region tag                   */
+    uint32_t    last_blk;               /* last block in the region     */
+    int32_t     stride;                 /* last seen stride (in blks)   */
+    uint8_t     conf;                   /* saturating confidence        */
+    uint8_t     valid;
+} cache_pf_stride_ent_t;
+
+/* Stream prefetcher tracker */
+typedef struct cache_pf_stream_ent__ {
+    uint32_t    last_blk;               /* last block in the stream     */
+    uint32_t    next_pf_blk;            /* next block to prefetch       */
+    uint32_t    lru;                    /* last use stamp               */
+    int8_t      dir;                    /* +1, -1 or 0 (training)       */
+    uint8_t     conf;
+    uint8_t     valid;
+} cache_pf_stream_ent_t;
+
+typedef struct cache_pf_stream__ {
+    uint32_t                clock;
+    cache_pf_stream_ent_t   ent[CACHE_PF_STREAM_ENTRIES];
+} cache_pf_stream_t;
+
+/* Globals */
+const char *g_cache_pf_type_names[] =
+    { "none", "next-line", "stride", "stream", NULL };
+
+
+/***************************************************************************
+ * Name:    cache_pf_next_line_access
+ *
+ * Desc:    Next-line (tagged) prefetcher. On a demand miss or on the first
+ *          hit to a prefetched block, prefetches the next 'degree' blocks.
+ *
+ * Params:
+ *  pf      ptr to the prefetcher
+ *  blk     demand block address
+ *  event   CACHE_PF_EV_*
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_pf_next_line_access(cache_pf_t *pf, uint32_t blk, uint8_t event)
+{
+    uint32_t    iter = 0;
+
+    if (CACHE_PF_EV_HIT == event)
+        return;
+
+    for (iter = 1; iter <= pf->degree; ++iter)
+        cache_pf_add_candidate(pf, (blk + iter));
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_stride_init
+ *
+ * Desc:    Allocates the stride prefetcher's reference prediction table.
+ *
+ * Params:
+ *  pf      ptr to the prefetcher
+ *
+ * Returns: cache_rv
+ **************************************************************************/
+static cache_rv
+cache_pf_stride_init(cache_pf_t *pf)
+{
+    pf->state = calloc(CACHE_PF_STRIDE_ENTRIES, sizeof(cache_pf_stride_ent_t));
+    return (pf->state ? CACHE_RV_OK : CACHE_RV_ERR);
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_stride_access
+ *
+ * Desc:    PC-less stride prefetcher. Learns the block stride between two
+ *          consecutive accesses to the same region. Once the same stride
+ *          is seen CACHE_PF_STRIDE_CONF_ISSUE times in a row, prefetches
+ *          'degree' blocks along the stride.
+ *
+ * Params:
+ *  pf      ptr to the prefetcher
+ *  blk     demand block address
+ *  event   CACHE_PF_EV_*
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_pf_stride_access(cache_pf_t *pf, uint32_t blk, uint8_t event)
+{
+    int32_t                 stride = 0;
+    uint32_t                iter = 0;
+    uint32_t                region = 0;
+    cache_pf_stride_ent_t   *ent = NULL;
+
+    /* A region is at least a block. */
+    region = blk;
+    if (pf->blk_bits < CACHE_PF_STRIDE_REGION_BITS)
+        region = (blk >> (CACHE_PF_STRIDE_REGION_BITS - pf->blk_bits));
+    ent = &((cache_pf_stride_ent_t *) pf->state)
+        [region % CACHE_PF_STRIDE_ENTRIES];
+
+    if ((!ent->valid) || (ent->region != region)) {
+        memset(ent, 0, sizeof(*ent));
+        ent->valid = 1;
+        ent->region = region;
+        ent->last_blk = blk;
+        return;
+    }
+
+    stride = (int32_t) (blk - ent->last_blk);
+    if (!stride)
+        return;
+
+    if (stride == ent->stride) {
+        if (ent->conf < CACHE_PF_STRIDE_CONF_MAX)
+            ent->conf += 1;
+    } else {
+        ent->stride = stride;
+        ent->conf = 0;
+    }
+    ent->last_blk = blk;
+
+    if (ent->conf < CACHE_PF_STRIDE_CONF_ISSUE)
+        return;
+
+    for (iter = 1; iter <= pf->degree; ++iter)
+        cache_pf_add_candidate(pf, (blk + (iter * stride)));
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_stream_init
+ *
+ * Desc:    Allocates the stream prefetcher's stream trackers.
+ *
+ * Params:
+ *  pf      ptr to the prefetcher
+ *
+ * Returns: cache_rv
+ **************************************************************************/
+static cache_rv
+cache_pf_stream_init(cache_pf_t *pf)
+{
+    pf->state = calloc(1, sizeof(cache_pf_stream_t));
+    return (pf->state ? CACHE_RV_OK : CACHE_RV_ERR);
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_stream_access
+ *
+ * Desc:    Stream prefetcher. Misses close to an existing stream (within
+ *          CACHE_PF_STREAM_WINDOW blocks) train its direction; confirmed
+ *          streams prefetch 'degree' blocks per trigger, staying at most
+ *          CACHE_PF_STREAM_DISTANCE blocks ahead of the demand stream.
+ *          Other misses allocate the LRU tracker.
+ *
+ * Params:
+ *  pf      ptr to the prefetcher
+ *  blk     demand block address
+ *  event   CACHE_PF_EV_*
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_pf_stream_access(cache_pf_t *pf, uint32_t blk, uint8_t event)
+{
+    int8_t                  dir = 0;
+    int64_t                 delta = 0;
+    int64_t                 ahead = 0;
+    uint32_t                iter = 0;
+    cache_pf_stream_t       *st = NULL;
+    cache_pf_stream_ent_t   *ent = NULL;
+    cache_pf_stream_ent_t   *lru_ent = NULL;
+
+    if (CACHE_PF_EV_HIT == event)
+        return;
+
+    st = (cache_pf_stream_t *) pf->state;
+    st->clock += 1;
+
+    for (iter = 0; iter < CACHE_PF_STREAM_ENTRIES; ++iter) {
+        ent = &st->ent[iter];
+        if (!ent->valid) {
+            lru_ent = ent;
+            continue;
+        }
+
+        delta = ((int64_t) blk - (int64_t) ent->last_blk);
+        if ((delta) && (delta <= CACHE_PF_STREAM_WINDOW) &&
+                (delta >= -CACHE_PF_STREAM_WINDOW) &&
+                ((!ent->dir) || ((delta > 0) == (ent->dir > 0))))
+            break;
+
+        if ((!lru_ent) || ((lru_ent->valid) && (ent->lru < lru_ent->lru)))
+            lru_ent = ent;
+    }
+
+    if (CACHE_PF_STREAM_ENTRIES == iter) {
+        /* No matching stream; start tracking a new one. */
+        memset(lru_ent, 0, sizeof(*lru_ent));
+        lru_ent->valid = 1;
+        lru_ent->last_blk = blk;
+        lru_ent->next_pf_blk = blk;
+        lru_ent->lru = st->clock;
+        return;
+    }
+
+    dir = ((delta > 0) ? 1 : -1);
+    if (!ent->dir)
+        ent->dir = dir;
+    if (ent->conf < CACHE_PF_STREAM_CONF_ISSUE)
+        ent->conf += 1;
+    ent->last_blk = blk;
+    ent->lru = st->clock;
+
+    if (ent->conf < CACHE_PF_STREAM_CONF_ISSUE)
+        return;
+
+    /* Never prefetch behind the demand stream. */
+    ahead = ((int64_t) ent->next_pf_blk - (int64_t) blk) * ent->dir;
+    if (ahead <= 0)
+        ent->next_pf_blk = (blk + ent->dir);
+
+    for (iter = 0; iter < pf->degree; ++iter) {
+        ahead = ((int64_t) ent->next_pf_blk - (int64_t) blk) * ent->dir;
+        if (ahead > CACHE_PF_STREAM_DISTANCE)
+            break;
+        cache_pf_add_candidate(pf, ent->next_pf_blk);
+        ent->next_pf_blk += ent->dir;
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_free_state
+ *
+ * Desc:    Frees the prefetcher private state.
+ *
+ * Params:
+ *  pf      ptr to the prefetcher
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_pf_free_state(cache_pf_t *pf)
+{
+    if (pf->state)
+        free(pf->state);
+    pf->state = NULL;
+
+    return;
+}
+
+
+/* Prefetcher implementations, indexed by CACHE_PF_TYPE_*. */
+static const cache_pf_ops_t g_cache_pf_ops[] = {
+    { "none", NULL, NULL, NULL },
+    { "next-line", NULL, NULL, cache_pf_next_line_access },
+    { "stride", cache_pf_stride_init, cache_pf_free_state,
+        cache_pf_stride_access },
+    { "stream", cache_pf_stream_init, cache_pf_free_state,
+        cache_pf_stream_access },
+};
+
+
+/***************************************************************************
+ * Name:    cache_pf_init
+ *
+ * Desc:    Sets up the prefetcher for a cache as per the user given level
+ *          options. Must be called after the tagstore init.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *  opts    ptr to the options for the cache level
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK if no prefetcher is asked for or on a successful setup
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_pf_init(cache_generic_t *cache, cache_level_opts_t *opts)
+{
+    cache_pf_t  *pf = NULL;
+
+    if ((!cache) || (!opts)) {
+        cache_assert(0);
+        goto error_exit;
+    }
+
+    cache->pf = NULL;
+    if (CACHE_PF_TYPE_NONE == opts->prefetch)
+        return CACHE_RV_OK;
+
+    pf = calloc(1, sizeof(*pf));
+    if (!pf)
+        goto error_exit;
+
+    pf->filter = calloc(CACHE_PF_FILTER_LEN, sizeof(uint32_t));
+    if (!pf->filter)
+        goto error_exit;
+
+    pf->ops = &g_cache_pf_ops[opts->prefetch];
+    pf->cache = cache;
+    pf->type = opts->prefetch;
+    pf->blk_bits = cache->tagstore->num_offset_bits;
+    pf->degree = (opts->pf_degree ? opts->pf_degree : 1);
+    if (pf->degree > CACHE_PF_MAX_DEGREE)
+        pf->degree = CACHE_PF_MAX_DEGREE;
+    pf->latency = opts->pf_latency;
+
+    if ((pf->ops->init) && (CACHE_RV_OK != pf->ops->init(pf)))
+        goto error_exit;
+
+    cache->pf = pf;
+    dprint_info("%s, %s prefetcher init successful\n",
+            CACHE_GET_NAME(cache), pf->ops->name);
+
+    return CACHE_RV_OK;
+
+error_exit:
+    dprint("Error: Unable to set up the prefetcher for cache %s.\n",
+            (cache ? CACHE_GET_NAME(cache) : "-"));
+    if (pf) {
+        if (pf->filter)
+            free(pf->filter);
+        free(pf);
+    }
+    return CACHE_RV_ERR;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_cleanup
+ *
+ * Desc:    Frees the prefetcher of a cache, if any.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_pf_cleanup(cache_generic_t *cache)
+{
+    cache_pf_t  *pf = NULL;
+
+    if ((!cache) || (!cache->pf))
+        return;
+
+    pf = cache->pf;
+    if (pf->ops->cleanup)
+        pf->ops->cleanup(pf);
+    free(pf->filter);
+    free(pf);
+    cache->pf = NULL;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_add_candidate
+ *
+ * Desc:    Adds a block address to the list of blocks to be prefetched at
+ *          the end of the current access. Used by the prefetchers.
+ *
+ * Params:
+ *  pf      ptr to the prefetcher
+ *  blk     block address to be prefetched
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_pf_add_candidate(cache_pf_t *pf, uint32_t blk)
+{
+    /* Drop the blocks beyond the 32-bit address space. */
+    if ((pf->blk_bits) && (blk >> (CACHE_ADDR_32BIT_LEN - pf->blk_bits)))
+        return;
+
+    if (pf->num_cands < CACHE_PF_MAX_DEGREE)
+        pf->cands[pf->num_cands++] = blk;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_is_in_flight
+ *
+ * Desc:    Looks up the in-flight prefetch queue for a block.
+ *
+ * Params:
+ *  pf      ptr to the prefetcher
+ *  blk     block address
+ *
+ * Returns: int32_t
+ *  queue slot of the request, if found
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+static int32_t
+cache_pf_is_in_flight(cache_pf_t *pf, uint32_t blk)
+{
+    uint32_t    iter = 0;
+    uint32_t    slot = 0;
+
+    for (iter = 0; iter < pf->q_count; ++iter) {
+        slot = ((pf->q_head + iter) % CACHE_PF_QUEUE_LEN);
+        if (pf->queue[slot].blk == blk)
+            return slot;
+    }
+
+    return CACHE_RV_ERR;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_retire
+ *
+ * Desc:    Fills all the in-flight prefetches that are due by now. Called
+ *          at the start of every demand access to the cache.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_pf_retire(cache_generic_t *cache)
+{
+    cache_pf_t      *pf = cache->pf;
+    cache_pf_req_t  *req = NULL;
+
+    while (pf->q_count) {
+        req = &pf->queue[pf->q_head];
+        if (req->ready_ref > g_addr_count)
+            break;
+
+        /* A dropped (late) request has its blk set to the invalid 0. */
+        if (req->blk)
+            cache_prefetch_fill(cache, (req->blk << pf->blk_bits));
+
+        pf->q_head = ((pf->q_head + 1) % CACHE_PF_QUEUE_LEN);
+        pf->q_count -= 1;
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_demand_miss
+ *
+ * Desc:    Accounts a demand miss against the prefetcher. A miss on a block
+ *          which is still in-flight is a late prefetch; the demand fetch
+ *          takes over the request. A miss on a block that was evicted by a
+ *          prefetch fill is counted as pollution.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *  blk     demand block address
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_pf_demand_miss(cache_generic_t *cache, uint32_t blk)
+{
+    int32_t     slot = CACHE_RV_ERR;
+    uint32_t    *filter_ent = NULL;
+    cache_pf_t  *pf = cache->pf;
+
+    if (CACHE_RV_ERR != (slot = cache_pf_is_in_flight(pf, blk))) {
+        pf->queue[slot].blk = 0;
+        cache->stats.num_pf_late += 1;
+    }
+
+    filter_ent = &pf->filter[blk % CACHE_PF_FILTER_LEN];
+    if (*filter_ent == (blk + 1)) {
+        cache->stats.num_pf_polluting += 1;
+        *filter_ent = 0;
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_note_evict
+ *
+ * Desc:    Remembers a valid block evicted by a prefetch fill, to detect
+ *          cache pollution.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *  blk     evicted block address
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_pf_note_evict(cache_generic_t *cache, uint32_t blk)
+{
+    cache->pf->filter[blk % CACHE_PF_FILTER_LEN] = (blk + 1);
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_pf_on_access
+ *
+ * Desc:    Trains the prefetcher with a demand access and issues all the
+ *          resulting prefetches. Blocks that are already cached or are
+ *          in-flight are not prefetched again. With a zero prefetch
+ *          latency the fills happen right away; otherwise the requests
+ *          are queued and land after 'latency' references.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *  blk     demand block address
+ *  event   CACHE_PF_EV_*
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_pf_on_access(cache_generic_t *cache, uint32_t blk, uint8_t event)
+{
+    uint32_t        iter = 0;
+    uint32_t        cand = 0;
+    cache_pf_t      *pf = cache->pf;
+    cache_pf_req_t  *req = NULL;
+
+    pf->num_cands = 0;
+    pf->ops->on_access(pf, blk, event);
+
+    for (iter = 0; iter < pf->num_cands; ++iter) {
+        cand = pf->cands[iter];
+        if ((!cand) || (cache_is_block_present(cache, (cand << pf->blk_bits))))
+            continue;
+
+        if (!pf->latency) {
+            if (cache_prefetch_fill(cache, (cand << pf->blk_bits)))
+                cache->stats.num_pf_issued += 1;
+            continue;
+        }
+
+        if ((CACHE_PF_QUEUE_LEN == pf->q_count) ||
+                (CACHE_RV_ERR != cache_pf_is_in_flight(pf, cand)))
+            continue;
+
+        req = &pf->queue[(pf->q_head + pf->q_count) % CACHE_PF_QUEUE_LEN];
+        req->blk = cand;
+        req->ready_ref = (g_addr_count + pf->latency);
+        pf->q_count += 1;
+        cache->stats.num_pf_issued += 1;
+    }
+
+    return;
+}
+
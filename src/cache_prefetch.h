@@ -0,0 +1,91 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the hardware prefetcher models. Every cache level can have one
+ * prefetcher, which is trained on the demand accesses of that level and
+ * fills the prefetched blocks through the regular cache fill path.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_PREFETCH_H_
+#define CACHE_PREFETCH_H_
+
+#include <stdint.h>
+#include "cache.h"
+#include "cache_opts.h"
+
+/* Constants */
+#define CACHE_PF_TYPE_NONE          0
+#define CACHE_PF_TYPE_NEXT_LINE     1
+#define CACHE_PF_TYPE_STRIDE        2
+#define CACHE_PF_TYPE_STREAM        3
+
+#define CACHE_PF_EV_MISS            0   /* demand miss                  */
+#define CACHE_PF_EV_HIT             1   /* demand hit                   */
+#define CACHE_PF_EV_PF_HIT          2   /* first hit on prefetched blk  */
+
+#define CACHE_PF_MAX_DEGREE         16  /* max. candidates per trigger  */
+#define CACHE_PF_QUEUE_LEN          64  /* max. in-flight prefetches    */
+#define CACHE_PF_FILTER_LEN         1024 /* pollution filter entries    */
+
+struct cache_pf__;
+
+/* Prefetcher operations; one instance per prefetcher type */
+typedef struct cache_pf_ops__ {
+    const char  *name;
+    cache_rv    (*init)(struct cache_pf__ *pf);
+    void        (*cleanup)(struct cache_pf__ *pf);
+    /* Trains on a demand access and adds prefetch candidates, if any. */
+    void        (*on_access)(struct cache_pf__ *pf, uint32_t blk,
+                    uint8_t event);
+} cache_pf_ops_t;
+
+/* In-flight prefetch request */
+typedef struct cache_pf_req__ {
+    uint32_t    blk;                    /* block address                */
+    uint32_t    ready_ref;              /* ref ID at which it lands     */
+} cache_pf_req_t;
+
+/* Per-level prefetcher */
+typedef struct cache_pf__ {
+    const cache_pf_ops_t *ops;          /* prefetcher implementation    */
+    cache_generic_t     *cache;         /* ptr to the parent cache      */
+    uint8_t             type;           /* CACHE_PF_TYPE_*              */
+    uint8_t             blk_bits;       /* log2 of the block size       */
+    uint32_t            degree;         /* # of blocks per trigger      */
+    uint32_t            latency;        /* fill delay in references     */
+    void                *state;         /* prefetcher private state     */
+    uint32_t            num_cands;      /* # of candidates to issue     */
+    uint32_t            cands[CACHE_PF_MAX_DEGREE];
+    uint32_t            q_head;         /* oldest in-flight request     */
+    uint32_t            q_count;        /* # of in-flight requests      */
+    cache_pf_req_t      queue[CACHE_PF_QUEUE_LEN];
+    uint32_t            *filter;        /* blks evicted by pf fills + 1 */
+} cache_pf_t;
+
+
+/* Externs */
+extern const char       *g_cache_pf_type_names[];
+
+
+/* Function declarations */
+cache_rv
+cache_pf_init(cache_generic_t *cache, cache_level_opts_t *opts);
+void
+cache_pf_cleanup(cache_generic_t *cache);
+void
+cache_pf_add_candidate(cache_pf_t *pf, uint32_t blk);
+void
+cache_pf_retire(cache_generic_t *cache);
+void
+cache_pf_demand_miss(cache_generic_t *cache, uint32_t blk);
+void
+cache_pf_note_evict(cache_generic_t *cache, uint32_t blk);
+void
+cache_pf_on_access(cache_generic_t *cache, uint32_t blk, uint8_t event);
+
+#endif /* CACHE_PREFETCH_H_ */
+
@@ -11,10 +11,25 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <math.h>
 
 #include "cache.h"
 #include "cache_utils.h"
 #include "cache_print.h"
+#include "cache_opts.h"
+#include "cache_prefetch.h"
+#include "cache_repl.h"
+#include "cache_timing.h"
+#include "cache_coherence.h"
+#include "cache_ring.h"
+#include "cache_incl.h"
+#include "cache_wbb.h"
+#include "cache_sector.h"
+#include "cache_model.h"
+#include "cache_results.h"
+#include "cache_prof.h"
+#include "cache_ptag.h"
+#include "cache_index.h"
 
 /*************************************************************************** 
  * Name:    cache_print_sim_config 
@@ -31,11 +46,15 @@ cache_print_sim_config(cache_generic_t *cache)
 {
     uint16_t  l2_assoc = 0; 
     uint32_t l2_size = 0;
+    uint32_t l2_blk_size = cache->blk_size;
+    uint8_t l2_write_plcy = CACHE_WRITE_PLCY_WBWA;
 
     if (cache_util_is_l2_present()) {
         cache_generic_t *l2 = cache_util_get_l2();
         l2_size = l2->size;
         l2_assoc = l2->set_assoc;
+        l2_blk_size = l2->blk_size;
+        l2_write_plcy = l2->write_plcy;
     }
 
     dprint("===== Simulator configuration =====\n");
@@ -45,17 +64,61 @@ cache_print_sim_config(cache_generic_t *cache)
     dprint("Victim_Cache_SIZE: %16u\n", cache->victim_size);
     dprint("L2_SIZE: %26u\n", l2_size);
     dprint("L2_ASSOC: %25u\n", l2_assoc);
+    if (l2_blk_size != cache->blk_size)
+        dprint("L2_BLOCKSIZE: %21u\n", l2_blk_size);
+    if (CACHE_WRITE_PLCY_WTNA == cache->write_plcy)
+        dprint("L1_WRITE_POLICY: %18s\n", "WTNA");
+    if (CACHE_WRITE_PLCY_WTNA == l2_write_plcy)
+        dprint("L2_WRITE_POLICY: %18s\n", "WTNA");
     dprint("trace_file: %23s\n", cache->trace_file);
+    if (g_num_cores > 1)
+        dprint("CORES: %28u\n", g_num_cores);
     dprint("===================================\n");
 
     return;
 }
 
 
+/***************************************************************************
+ * Name:    cache_print_model_stats
+ *
+ * Desc:    Prints the numbers of a technology model with energy and area:
+ *          per level, the latency, energy per access, area and accesses,
+ *          and the totals of the configuration.
+ *
+ * Params:
+ *  cost    ptr to the energy and area of the configuration
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_print_model_stats(cache_model_cost_t *cost)
+{
+    uint32_t                    iter = 0;
+    cache_model_level_cost_t    *level = NULL;
+
+    dprint("==== Technology model (%s) ====\n", g_cache_opts.model_file);
+    dprint("%-6s %5s %10s %10s %10s %12s %14s\n", "cache", "count", "ns",
+            "nJ/access", "mm^2", "accesses", "energy (nJ)");
+    for (iter = 0; iter < cost->num_levels; ++iter) {
+        level = &cost->levels[iter];
+        dprint("%-6s %5u %10.4f %10.4f %10.4f %12lu %14.4f\n", level->name,
+                level->count, level->pt.lat_ns, level->pt.energy_nj,
+                level->pt.area_mm2, level->accesses,
+                (level->pt.energy_nj * level->accesses));
+    }
+    dprint("total energy: %23.4f nJ\n", cost->energy_nj);
+    dprint("total area: %25.4f mm^2\n", cost->area_mm2);
+
+    return;
+}
+
+
 /*************************************************************************** 
  * Name:    cache_print_sim_stats
  *
- * Desc:    Prints the simulator statistics in TA's style. 
+ * Desc:    Prints the simulator statistics in TA's style. With more than
+ *          one core, L1 and VC numbers are summed over all the cores.
  *
  * Params:
  *  cache   ptr to the main cache data structure
@@ -65,109 +128,11 @@ cache_print_sim_config(cache_generic_t *cache)
 void
 cache_print_sim_stats(cache_generic_t *cache)
 {
-    double          l1_miss_rate = 0.0;
-    double          l1_hit_time = 0.0;
-    cache_stats_t   *l1_stats = NULL;
-
-    uint32_t        vc_num_swaps = 0;
-    uint32_t        vc_num_write_backs = 0;
-    boolean         vc_present = FALSE;
-    cache_stats_t   *vc_stats = NULL;
-    cache_generic_t *vc = NULL;
-
-    uint32_t        l2_num_reads = 0;
-    uint32_t        l2_num_writes = 0;
-    uint32_t        l2_num_read_misses = 0;
-    uint32_t        l2_num_write_misses = 0;
-    uint32_t        l2_num_write_backs = 0;
-    double          l2_hit_time = 0.0;
-    double          l2_miss_rate = 0.0;
-    double          l2_miss_penalty = 0.0;
-    boolean         l2_present = FALSE;
-    cache_stats_t   *l2_stats;
-    cache_generic_t *l2 = NULL;
-
-    double          miss_penalty = 0.0;
-    double          avg_access_time = 0.0;
-    double          b_512kb = (512 * 1024);
-    uint32_t        total_traffic = 0;
-
-    l1_stats = &(cache->stats);
-
-    if (cache_util_is_victim_present()) {
-        vc_present = TRUE;
-        vc = cache_util_get_vc();
-        vc_stats = &vc->stats;
-    }
+    cache_results_t res;
+    cache_stats_t   *l1_stats = &res.l1;
+    cache_stats_t   *l2_stats = &res.l2;
 
-    if (cache_util_is_l2_present()) {
-        l2_present = TRUE;
-        l2 = cache_util_get_l2();
-        l2_stats = &l2->stats;
-    }
-
-
-    /* 
-     * Calculation of avg. access time (from project web-page):
-     * Some fixed parameters to use in your project:
-     *  1. L2 Miss_Penalty (in ns) = 20 ns + 0.5*(L2_BLOCKSIZE / 16 B/ns) 
-     *      (in the case that there is only L1 cache, use
-     *      L1 miss penalty (in ns) = 20 ns + 0.5*(L1_BLOCKSIZE / 16 B/ns))
-     *  2. L1 Cache Hit Time (in ns) = 0.25ns + 2.5ns * (L1_Cache Size / 512kB)
-     *      + 0.025ns * (L1_BLOCKSIZE / 16B) + 0.025ns * L1_SET_ASSOCIATIVITY
-     * 3.  L2 Cache Hit Time (in ns) = 2.5ns + 2.5ns * (L2_Cache Size / 512kB) 
-     *      + 0.025ns * (L2_BLOCKSIZE / 16B) + 0.025ns * L2_SET_ASSOCIATIVITY
-     * 4.  Area Budget = 512kB for both L1 and L2 Caches
-     * 5. Average access time =  HTL1 + (MRL1 *(HTL2+MRL2*Miss PenaltyL2))
-     */
-
-    if (l2_present) {
-        l2_num_reads = l2_stats->num_reads;
-        l2_num_read_misses = l2_stats->num_read_misses;
-        l2_num_writes = l2_stats->num_writes;
-        l2_num_write_misses = l2_stats->num_write_misses;
-        l2_num_write_backs = l2_stats->num_write_backs;
-        l2_miss_penalty = (20 + (0.5 * (((double) l2->blk_size) / 16)));
-
-        /* Only read misses are to be accounted for. */
-        l2_miss_rate =
-            ((double) (l2_stats->num_read_misses) /
-                (double) (l2_stats->num_reads));
-        l2_hit_time = (2.5 + (2.5 * (((double) l2->size) / b_512kb)) +
-                (0.025 * (((double) l2->blk_size) / 16)) +
-                (0.025 * l2->set_assoc));
-    } 
-
-    if (vc_present) {
-        vc_num_swaps = vc_stats->num_swaps;
-        vc_num_write_backs = vc_stats->num_write_backs;
-    }
-
-    l1_miss_rate =
-       ((double) (l1_stats->num_read_misses + l1_stats->num_write_misses) /
-        (double) (l1_stats->num_reads + l1_stats->num_writes));
-    l1_hit_time = (0.25 + (2.5 * (((double) cache->size) / b_512kb)) + (0.025 *
-            (((double) cache->blk_size) / 16)) + (0.025 * cache->set_assoc));
-    miss_penalty = (20 + (0.5 * (((double) cache->blk_size) / 16)));
-
-    if (l2_present) {
-        total_traffic = (l2_stats->num_read_misses + 
-                         l2_stats->num_write_misses +
-                         l2_stats->num_write_backs);
-        avg_access_time = (l1_hit_time +
-            (l1_miss_rate * (l2_hit_time + l2_miss_rate * l2_miss_penalty)));
-    }
-    else if (vc_present) {
-        total_traffic = (l1_stats->num_read_misses +
-                         l1_stats->num_write_misses +
-                         vc_stats->num_write_backs);
-        avg_access_time = (l1_hit_time +
-            (l1_miss_rate * (miss_penalty)));
-    } else {
-        total_traffic = l1_stats->num_blk_mem_traffic; 
-        avg_access_time = (l1_hit_time +
-            (l1_miss_rate * (miss_penalty)));
-    }
+    cache_results_calc(cache, &res);
 
     dprint("====== Simulation results (raw) ======\n");
 
@@ -176,35 +141,702 @@ cache_print_sim_stats(cache_generic_t *cache)
     dprint("b. number of L1 read misses: %14u\n", l1_stats->num_read_misses);
     dprint("c. number of L1 writes: %19u\n", l1_stats->num_writes);
     dprint("d. number of L1 write misses: %13u\n", l1_stats->num_write_misses);
-    dprint("e. L1 miss rate: %26.4f\n", l1_miss_rate);
+    dprint("e. L1 miss rate: %26.4f\n", res.l1_miss_rate);
 
     /* Victim cache data. */
-    dprint("f. number of swaps: %23u\n", vc_num_swaps);
+    dprint("f. number of swaps: %23u\n", res.vc.num_swaps);
     dprint("g. number of victim cache writeback: %6u\n", 
-            vc_num_write_backs);
+            res.vc.num_write_backs);
 
     /* L2 cache data. */
-    dprint("h. number of L2 reads: %20u\n", l2_num_reads);
-    dprint("i. number of L2 read misses: %14u\n", l2_num_read_misses);
-    dprint("j. number of L2 writes: %19u\n", l2_num_writes);
-    dprint("k. number of L2 write misses: %13u\n", l2_num_write_misses);
+    dprint("h. number of L2 reads: %20u\n", l2_stats->num_reads);
+    dprint("i. number of L2 read misses: %14u\n", l2_stats->num_read_misses);
+    dprint("j. number of L2 writes: %19u\n", l2_stats->num_writes);
+    dprint("k. number of L2 write misses: %13u\n", l2_stats->num_write_misses);
 
     /*
      * An ugly hack to match the weird format given by the TAs.
      * When L2 isn't present, L2 miss rate (which is a float), is printed
      * as just 0. No decimals!
      * */
-    if (l2_present)
-        dprint("l. L2 miss rate: %26.4f\n", l2_miss_rate);
+    if (res.l2_present)
+        dprint("l. L2 miss rate: %26.4f\n", res.l2_miss_rate);
     else
         dprint("l. L2 miss rate: %26u\n", 0);
 
-    dprint("m. number of L2 writebacks: %15u\n", l2_num_write_backs);
+    dprint("m. number of L2 writebacks: %15u\n", l2_stats->num_write_backs);
 
-    dprint("n. total memory traffic: %18u\n", total_traffic);
+    dprint("n. total memory traffic: %18u\n", res.total_traffic);
+
+    /* Blocks of L1 and L2 differ in size; the bytes tell them apart. */
+    if ((res.l2_present) &&
+            (cache_util_get_l2()->blk_size != cache->blk_size))
+        dprint("o. total memory traffic in bytes: %9lu\n", res.total_bytes);
+
+    /* Writes passed on by the WTNA caches. */
+    if (CACHE_WRITE_PLCY_WTNA == cache->write_plcy) {
+        dprint("p. number of L1 write throughs: %11u\n",
+                l1_stats->num_write_throughs);
+    }
+    if ((res.l2_present) &&
+            (CACHE_WRITE_PLCY_WTNA == cache_util_get_l2()->write_plcy)) {
+        dprint("q. number of L2 write throughs: %11u\n",
+                l2_stats->num_write_throughs);
+    }
 
     dprint("==== Simulation results (performance) ====\n");
-    dprint("1. average access time: %14.4f ns\n", avg_access_time);
+    dprint("1. average access time: %14.4f ns\n", res.avg_access_time);
+
+    if (g_cache_model->has_cost)
+        cache_print_model_stats(&res.cost);
+
+    return;
+}
+
+
+/*************************************************************************** 
+ * Name:    cache_print_pf_stats
+ *
+ * Desc:    Prints the prefetcher statistics of a cache. Accuracy is the
+ *          fraction of the issued prefetches that were used by a demand
+ *          access before eviction.
+ *
+ * Params:
+ *  cache   ptr to the cache with a prefetcher
+ *
+ * Returns: Nothing 
+ **************************************************************************/
+void
+cache_print_pf_stats(cache_generic_t *cache)
+{
+    double          accuracy = 0.0;
+    cache_stats_t   *stats = NULL;
+
+    if ((!cache) || (!cache->pf)) {
+        cache_assert(0);
+        return;
+    }
+
+    stats = &cache->stats;
+    if (stats->num_pf_issued) {
+        accuracy = (((double) stats->num_pf_useful) /
+                ((double) stats->num_pf_issued));
+    }
+
+    dprint("==== %s prefetcher (%s, degree %u) ====\n",
+            CACHE_GET_NAME(cache), cache->pf->ops->name, cache->pf->degree);
+    dprint("number of prefetches issued: %14u\n", stats->num_pf_issued);
+    dprint("number of useful prefetches: %14u\n", stats->num_pf_useful);
+    dprint("number of late prefetches: %16u\n", stats->num_pf_late);
+    dprint("number of polluting prefetches: %11u\n",
+            stats->num_pf_polluting);
+    dprint("prefetch accuracy: %24.4f\n", accuracy);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_mshr_stats
+ *
+ * Desc:    Prints the MSHR counters and the occupancy histogram (% of the
+ *          simulated cycles spent with N MSHRs in use) of one level.
+ *
+ * Params:
+ *  name    ptr to the level name
+ *  mshrs   ptr to the MSHR file of the level
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_print_mshr_stats(const char *name, cache_mshr_file_t *mshrs)
+{
+    uint32_t    iter = 0;
+    uint64_t    total = 0;
+
+    for (iter = 0; iter <= mshrs->num_mshrs; ++iter)
+        total += mshrs->hist[iter];
+
+    dprint("==== %s MSHRs (%u) ====\n", name, mshrs->num_mshrs);
+    dprint("number of primary misses: %17lu\n", mshrs->num_allocs);
+    dprint("number of merged misses: %18lu\n", mshrs->num_merges);
+    dprint("number of MSHR full events: %15lu\n", mshrs->num_full);
+    dprint("occupancy (busy MSHRs: cycles, %% of cycles):\n");
+    for (iter = 0; iter <= mshrs->num_mshrs; ++iter) {
+        dprint("%4u: %16lu %10.4f\n", iter, mshrs->hist[iter],
+                (total ? ((100.0 * mshrs->hist[iter]) / total) : 0.0));
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_timing_stats
+ *
+ * Desc:    Prints the results of the cycle-level timing model. Effective
+ *          AMAT is the average # of cycles from issue to completion of a
+ *          reference, with overlapping misses.
+ *
+ * Params:
+ *  tm      ptr to the timing model
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_timing_stats(cache_timing_t *tm)
+{
+    double      amat = 0.0;
+
+    if (!tm) {
+        cache_assert(0);
+        return;
+    }
+
+    if (tm->num_refs)
+        amat = (((double) tm->total_lat) / ((double) tm->num_refs));
+
+    dprint("==== Simulation results (timing) ====\n");
+    dprint("latencies (cycles): L1 %u, VC %u, L2 %u, memory %u\n",
+            tm->l1_lat, tm->vc_lat, tm->l2_lat, tm->mem_lat);
+    dprint("number of references: %21lu\n", tm->num_refs);
+    dprint("total cycles: %29lu\n", tm->last_done);
+    dprint("effective AMAT: %20.4f cycles\n", amat);
+    dprint("stall cycles: %29lu\n", tm->stall_cycles);
+    dprint("number of delayed hits: %19lu\n", tm->num_delayed_hits);
+    if (g_cache_wbb_on)
+        dprint("write buffer stall cycles: %16lu\n", tm->wbb_stall_cycles);
+
+    cache_print_mshr_stats(g_l1_name, &tm->l1_mshrs);
+    if (tm->l2_present)
+        cache_print_mshr_stats(g_l2_name, &tm->l2_mshrs);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_coh_line
+ *
+ * Desc:    Prints the coherence counters of one private cache.
+ *
+ * Params:
+ *  name    ptr to the cache name
+ *  stats   ptr to the cache statistics
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_print_coh_line(const char *name, cache_stats_t *stats)
+{
+    dprint("%-10s %14u %12u %10u %12u\n", name, stats->num_coh_invals,
+            stats->num_coh_downgrades, stats->num_coh_upgrades,
+            stats->num_coh_write_backs);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_coh_stats
+ *
+ * Desc:    Prints the MESI coherence statistics: invalidations, downgrades,
+ *          upgrades and coherence write backs of every private cache, their
+ *          totals per level and the traffic seen by the L2 side directory.
+ *
+ * Params:
+ *  coh     ptr to the coherence state
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_coh_stats(cache_coh_t *coh)
+{
+    uint32_t        core = 0;
+    cache_stats_t   l1_sum;
+    cache_stats_t   vc_sum;
+    cache_generic_t *cache = NULL;
+
+    if (!coh) {
+        cache_assert(0);
+        return;
+    }
+
+    memset(&l1_sum, 0, sizeof(l1_sum));
+    memset(&vc_sum, 0, sizeof(vc_sum));
+
+    dprint("==== Coherence (MESI, %u cores) ====\n", g_num_cores);
+    dprint("%-10s %14s %12s %10s %12s\n", "cache", "invalidations",
+            "downgrades", "upgrades", "writebacks");
+    for (core = 0; core < g_num_cores; ++core) {
+        cache = cache_util_get_l1(core);
+        cache_print_coh_line(CACHE_GET_NAME(cache), &cache->stats);
+        cache_util_add_stats(&l1_sum, &cache->stats);
+
+        if (cache_util_is_victim_present()) {
+            cache = cache_util_get_vc(core);
+            cache_print_coh_line(CACHE_GET_NAME(cache), &cache->stats);
+            cache_util_add_stats(&vc_sum, &cache->stats);
+        }
+    }
+    cache_print_coh_line("L1 total", &l1_sum);
+    if (cache_util_is_victim_present())
+        cache_print_coh_line("VC total", &vc_sum);
+
+    dprint("==== L2 directory ====\n");
+    dprint("number of directory lookups: %14lu\n", coh->num_lookups);
+    dprint("number of invalidations sent: %13lu\n", coh->num_inval_msgs);
+    dprint("number of downgrades sent: %16lu\n", coh->num_downgrade_msgs);
+    dprint("number of coherence writebacks: %11lu\n",
+            coh->num_write_backs);
+    dprint("peak directory entries: %19u\n", coh->peak);
+
+    return;
+}
+
+
+/* Prints the back-invalidations of a private cache. */
+static void
+cache_print_incl_line(const char *name, cache_stats_t *stats)
+{
+    dprint("%-10s %14u %12u\n", name, stats->num_back_invals,
+            stats->num_back_inval_wbs);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_incl_stats
+ *
+ * Desc:    Prints the inclusion policy statistics: back-invalidations of
+ *          every private cache, L2 fills from their victims, and how much
+ *          of the capacity of the hierarchy holds distinct blocks at the
+ *          end of the run.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_incl_stats(void)
+{
+    uint32_t            core = 0;
+    double              used = 0.0;
+    cache_generic_t     *cache = NULL;
+    cache_incl_usage_t  usage;
+
+    cache_incl_get_usage(&usage);
+    if (usage.num_blocks)
+        used = ((double) usage.num_unique / (double) usage.num_blocks);
+
+    dprint("==== L2 inclusion (%s) ====\n", g_cache_incl_names[g_cache_incl]);
+    dprint("%-10s %14s %12s\n", "cache", "back-invals", "dirty");
+    for (core = 0; core < g_num_cores; ++core) {
+        cache = cache_util_get_l1(core);
+        cache_print_incl_line(CACHE_GET_NAME(cache), &cache->stats);
+
+        if (cache_util_is_victim_present()) {
+            cache = cache_util_get_vc(core);
+            cache_print_incl_line(CACHE_GET_NAME(cache), &cache->stats);
+        }
+    }
+    dprint("number of L2 victim fills: %16u\n",
+            cache_util_get_l2()->stats.num_victim_fills);
+    dprint("capacity in blocks: %23lu\n", usage.num_blocks);
+    dprint("valid blocks: %29lu\n", usage.num_valid);
+    dprint("distinct blocks: %26lu\n", usage.num_unique);
+    dprint("effective capacity used: %14lu KB (%.2f%%)\n",
+            ((usage.num_unique * usage.blk_size) >> 10), (100 * used));
+
+    return;
+}
+
+
+/* Prints the write-back buffer counters of a cache, if it has a buffer. */
+static void
+cache_print_wbb_line(cache_generic_t *cache)
+{
+    cache_stats_t   *stats = &cache->stats;
+
+    if (!cache->wbb)
+        return;
+
+    dprint("%-6s %6u %10s %6u %10u %10u %10u %8u\n", CACHE_GET_NAME(cache),
+            cache->wbb->depth, g_cache_wbb_drain_names[cache->wbb->drain],
+            cache->wbb->peak, stats->num_wbb_writes, stats->num_wbb_coalesced,
+            stats->num_write_backs, stats->num_wbb_full_stalls);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_wbb_stats
+ *
+ * Desc:    Prints the write-back buffer statistics of every cache that has
+ *          one: write backs put in the buffer, coalesced into a waiting
+ *          entry, and written out, and the number of them that found the
+ *          buffer full. Coalesced write backs of the last level never make
+ *          it to the total memory traffic.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_wbb_stats(void)
+{
+    uint32_t        core = 0;
+    uint32_t        saved = 0;
+    cache_generic_t *cache = NULL;
+
+    dprint("==== Write-back buffers ====\n");
+    dprint("%-6s %6s %10s %6s %10s %10s %10s %8s\n", "cache", "depth",
+            "drain", "peak", "writes", "coalesced", "drained", "stalls");
+    for (core = 0; core < g_num_cores; ++core) {
+        cache = cache_util_get_l1(core);
+        while (cache) {
+            /* The shared L2 is printed once, after all the cores. */
+            if (CACHE_IS_L2(cache))
+                break;
+            cache_print_wbb_line(cache);
+            if ((cache->wbb) && (!cache->next_cache))
+                saved += cache->stats.num_wbb_coalesced;
+            cache = cache->next_cache;
+        }
+    }
+    if (cache_util_is_l2_present()) {
+        cache = cache_util_get_l2();
+        cache_print_wbb_line(cache);
+        if (cache->wbb)
+            saved += cache->stats.num_wbb_coalesced;
+    }
+    dprint("memory writes saved by coalescing: %8u\n", saved);
+
+    return;
+}
+
+
+/* Prints the sector counters and the tagstore size of a cache. */
+static void
+cache_print_sector_line(cache_generic_t *cache)
+{
+    uint32_t        sectors = (cache->num_sectors ? cache->num_sectors : 1);
+    uint32_t        num_blocks = (cache->size / cache->blk_size);
+    uint32_t        tag_bits = 0;
+    uint64_t        ts_bytes = 0;
+    cache_stats_t   *stats = &cache->stats;
+
+    /* Tag, plus a valid and a dirty bit per sector, for every block. */
+    tag_bits = (CACHE_ADDR_32BIT_LEN - util_log_base_2(cache->blk_size) -
+            util_log_base_2(num_blocks / cache->set_assoc));
+    ts_bytes = ((((uint64_t) num_blocks * (tag_bits + (2 * sectors))) + 7) /
+            8);
+
+    dprint("%-6s %7u %7u %12u %14lu %14lu %10lu\n", CACHE_GET_NAME(cache),
+            sectors, (cache->blk_size / sectors), stats->num_sector_misses,
+            stats->num_fill_bytes, stats->num_wb_bytes, ts_bytes);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_sector_stats
+ *
+ * Desc:    Prints the sectored cache statistics: sector misses, the bytes
+ *          every cache read and wrote back, the size of its tags and state
+ *          bits, and the memory traffic in bytes. The latter adds up the
+ *          same transfers as the total memory traffic in blocks.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_sector_stats(void)
+{
+    uint32_t        core = 0;
+    cache_results_t res;
+    cache_generic_t *l2 = NULL;
+
+    cache_results_calc(cache_util_get_l1(0), &res);
+    if (cache_util_is_l2_present())
+        l2 = cache_util_get_l2();
+
+    dprint("==== Sectored caches ====\n");
+    dprint("%-6s %7s %7s %12s %14s %14s %10s\n", "cache", "sectors",
+            "bytes", "sector-miss", "fill bytes", "wb bytes", "tag bytes");
+    for (core = 0; core < g_num_cores; ++core)
+        cache_print_sector_line(cache_util_get_l1(core));
+    if (l2)
+        cache_print_sector_line(l2);
+    dprint("memory traffic in bytes: %18lu\n", res.total_bytes);
+
+    return;
+}
+
+
+/* Prints the partial tag filter counters of a cache, if it has a filter. */
+static void
+cache_print_ptag_line(cache_generic_t *cache)
+{
+    uint64_t        misses = 0;
+    cache_ptag_t    *ptag = cache->tagstore->ptag;
+
+    if (!ptag)
+        return;
+
+    /* Every compare that isn't a false match is a hit. */
+    misses = (ptag->num_lookups - (ptag->num_compares - ptag->num_false));
+    dprint("%-6s %5u %12lu %12lu %9.2f%% %10.3f %12lu\n",
+            CACHE_GET_NAME(cache), cache->set_assoc, ptag->num_lookups,
+            misses, (misses ? ((100.0 * ptag->num_filtered) / misses) : 0),
+            (ptag->num_lookups ? (((double) ptag->num_compares) /
+                                  ptag->num_lookups) : 0),
+            ptag->num_false);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_ptag_stats
+ *
+ * Desc:    Prints the partial tag filter statistics: the lookups and misses
+ *          of every filtered cache, the share of the misses told apart by
+ *          the tag hashes alone, the full tags read per lookup, out of the
+ *          ways of a set, and the hash matches of other tags.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_ptag_stats(void)
+{
+    uint32_t        core = 0;
+
+    dprint("==== Partial tag filters ====\n");
+    dprint("%-6s %5s %12s %12s %10s %10s %12s\n", "cache", "ways",
+            "lookups", "misses", "filtered", "tags/look", "false match");
+    for (core = 0; core < g_num_cores; ++core)
+        cache_print_ptag_line(cache_util_get_l1(core));
+    if (cache_util_is_l2_present())
+        cache_print_ptag_line(cache_util_get_l2());
+
+    return;
+}
+
+
+/* Evictions per set, for sorting the sets of a cache by them. */
+static const uint64_t   *g_print_set_evicts;
+
+/* Orders sets by evictions, most first; ties by set. */
+static int
+cache_print_set_cmp(const void *a, const void *b)
+{
+    uint32_t    set_a = *((const uint32_t *) a);
+    uint32_t    set_b = *((const uint32_t *) b);
+
+    if (g_print_set_evicts[set_a] != g_print_set_evicts[set_b])
+        return ((g_print_set_evicts[set_a] > g_print_set_evicts[set_b]) ?
+                -1 : 1);
+    return ((set_a < set_b) ? -1 : (set_a > set_b));
+}
+
+
+/* Prints the conflict counters of a cache and its hottest sets. */
+static void
+cache_print_set_line(cache_generic_t *cache, uint32_t num_hot)
+{
+    uint32_t            set = 0;
+    uint32_t            used = 0;
+    uint32_t            num_sets = cache->tagstore->num_index_sets;
+    uint32_t            num_top = ((num_sets + 9) / 10);
+    uint32_t            *order = NULL;
+    uint64_t            fills = 0;
+    uint64_t            evicts = 0;
+    uint64_t            top = 0;
+    double              mean = 0.0;
+    double              var = 0.0;
+    cache_sets_t        *sets = cache->tagstore->sets;
+
+    if (!sets)
+        return;
+
+    order = malloc(num_sets * sizeof(*order));
+    if (!order) {
+        dprint("Error: Unable to allocate memory for the set stats.\n");
+        return;
+    }
+
+    for (set = 0; set < num_sets; ++set) {
+        order[set] = set;
+        used += (sets->fills[set] ? 1 : 0);
+        fills += sets->fills[set];
+        evicts += sets->evicts[set];
+    }
+    mean = (((double) evicts) / num_sets);
+    for (set = 0; set < num_sets; ++set)
+        var += ((sets->evicts[set] - mean) * (sets->evicts[set] - mean));
+    var /= num_sets;
+
+    g_print_set_evicts = sets->evicts;
+    qsort(order, num_sets, sizeof(*order), cache_print_set_cmp);
+    for (set = 0; set < num_top; ++set)
+        top += sets->evicts[order[set]];
+
+    dprint("%-6s %-5s %6u %6u %10lu %10lu %8.2f %7lu %5.2f %7.2f%%\n",
+            CACHE_GET_NAME(cache),
+            g_cache_index_names[cache->tagstore->index_fn], num_sets, used,
+            fills, evicts, mean, sets->evicts[order[0]],
+            ((mean > 0) ? (sqrt(var) / mean) : 0),
+            (evicts ? ((100.0 * top) / evicts) : 0));
+
+    for (set = 0; (set < num_hot) && (set < num_sets); ++set) {
+        if (!sets->evicts[order[set]])
+            break;
+        dprint("       set %-8u %10lu fills %10lu evictions\n",
+                order[set], sets->fills[order[set]],
+                sets->evicts[order[set]]);
+    }
+    free(order);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_set_stats
+ *
+ * Desc:    Prints the per set conflict statistics of L1 and L2: the sets
+ *          the index function maps to and how many of them were used, the
+ *          fills and the evictions, the evictions per set, the most of
+ *          any set, their coefficient of variation over the sets and the
+ *          share of them in the hottest 10% of the sets; then the sets
+ *          with the most evictions.
+ *
+ * Params:
+ *  num_hot     # of hottest sets to list per cache
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_set_stats(uint32_t num_hot)
+{
+    uint32_t        core = 0;
+
+    dprint("==== Set conflicts ====\n");
+    dprint("%-6s %-5s %6s %6s %10s %10s %8s %7s %5s %8s\n", "cache",
+            "index", "sets", "used", "fills", "evictions", "per set",
+            "max", "cov", "hot 10%");
+    for (core = 0; core < g_num_cores; ++core)
+        cache_print_set_line(cache_util_get_l1(core), num_hot);
+    if (cache_util_is_l2_present())
+        cache_print_set_line(cache_util_get_l2(), num_hot);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_ring_stats
+ *
+ * Desc:    Prints the metrics of the trace reader ring. A mostly full ring
+ *          means the simulation is the bottleneck, a mostly empty one that
+ *          parsing is.
+ *
+ * Params:
+ *  ring    ptr to the trace reader ring
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_ring_stats(cache_ring_t *ring)
+{
+    uint32_t    iter = 0;
+    uint64_t    sum = 0;
+    double      avg = 0.0;
+
+    if (!ring) {
+        cache_assert(0);
+        return;
+    }
+
+    for (iter = 0; iter <= ring->num_slots; ++iter)
+        sum += (iter * ring->hist[iter]);
+    if (ring->num_batches)
+        avg = (((double) sum) / ((double) ring->num_batches));
+
+    dprint("==== Trace pipeline (%u x %u refs) ====\n", ring->num_slots,
+            CACHE_RING_BATCH_REFS);
+    dprint("number of references: %21lu\n", ring->num_refs);
+    dprint("number of batches: %24lu\n", ring->num_batches);
+    dprint("parser stalls (ring full): %16lu\n", ring->num_full_waits);
+    dprint("simulator stalls (ring empty): %12lu\n", ring->num_empty_waits);
+    dprint("average ready batches: %20.4f\n", avg);
+    dprint("bottleneck: %31s\n",
+            ((ring->num_full_waits >= ring->num_empty_waits) ?
+             "simulation" : "parsing"));
+    dprint("occupancy (ready batches: batches, %% of batches):\n");
+    for (iter = 1; iter <= ring->num_slots; ++iter) {
+        dprint("%4u: %16lu %10.4f\n", iter, ring->hist[iter],
+                (ring->num_batches ?
+                 ((100.0 * ring->hist[iter]) / ring->num_batches) : 0.0));
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_print_prof_stats
+ *
+ * Desc:    Prints the profiler's per-reference breakdown of the simulation
+ *          loop, and the hardware counters, if they were open. The cost of
+ *          the stage switches themselves is part of the stages; it's shown
+ *          so that the tiny stages can be read with care.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_print_prof_stats(void)
+{
+    uint32_t    iter = 0;
+    uint64_t    total = 0;
+    double      refs = (g_addr_count ? g_addr_count : 1);
+    uint64_t    *hw = g_cache_prof.hw;
+
+    for (iter = 0; iter < CACHE_PROF_NUM_STAGES; ++iter)
+        total += g_cache_prof.ticks[iter];
+
+    dprint("==== Hot path profile (%s per reference) ====\n",
+            g_cache_prof_unit);
+    for (iter = 0; iter < CACHE_PROF_NUM_STAGES; ++iter) {
+        dprint("%-10s %20.2f %10.2f%%\n", g_cache_prof_stage_names[iter],
+                (g_cache_prof.ticks[iter] / refs),
+                (total ? ((100.0 * g_cache_prof.ticks[iter]) / total) : 0.0));
+    }
+    dprint("%-10s %20.2f\n", "total", (total / refs));
+    dprint("stage switches per reference: %12.2f\n",
+            (g_cache_prof.num_switches / refs));
+    dprint("%s per switch (in the above): %8.2f\n", g_cache_prof_unit,
+            g_cache_prof.switch_cost);
+
+    if (g_cache_prof.hw_fds[0] < 0)
+        return;
+
+    dprint("==== Hardware counters (per reference) ====\n");
+    for (iter = 0; iter < CACHE_PROF_NUM_HW; ++iter) {
+        dprint("%-14s %16.2f\n", g_cache_prof_hw_names[iter],
+                (hw[iter] / refs));
+    }
+    dprint("%-14s %16.2f\n", "IPC", (hw[0] ? (((double) hw[1]) / hw[0]) :
+                0.0));
 
     return;
 }
@@ -222,23 +854,47 @@ cache_print_sim_stats(cache_generic_t *cache)
  **************************************************************************/
 void
 cache_print_cache_data(cache_generic_t *cache)
+{
+    cache_print_cache_shards(&cache, 1);
+
+    return;
+}
+
+
+/*************************************************************************** 
+ * Name:    cache_print_cache_shards
+ *
+ * Desc:    Prints the contents of a cache whose sets are split over shards,
+ *          in the same format as cache_print_cache_data. Set N of the
+ *          whole cache is set (N / num_shards) of shard (N % num_shards).
+ *
+ * Params:
+ *  shards      ptr to the shards of the cache, in shard ID order
+ *  num_shards  # of shards; 1 for a regular cache
+ *
+ * Returns: Nothing 
+ **************************************************************************/
+void
+cache_print_cache_shards(cache_generic_t **shards, uint32_t num_shards)
 {
     char                *title = NULL;
+    char                core_title[CACHE_NAME_LEN + 32];
     uint32_t            index = 0;
     uint32_t            tag_index = 0;
     uint32_t            id = 0;
     uint32_t            block_id = 0;
     uint32_t            num_sets = 0;
     uint32_t            num_blocks_per_set = 0;
+    uint32_t            num_valid = 0;
     uint32_t            *tags = NULL;
-    uint64_t            *tag_ages = NULL;
+    uint32_t            *ways = NULL;
+    cache_generic_t     *cache = shards[0];
     cache_tag_data_t    *tag_data = NULL;
     cache_tagstore_t    *tagstore = NULL;
 
-    tagstore = cache->tagstore;
-    num_sets = tagstore->num_sets;
-    num_blocks_per_set = tagstore->num_blocks_per_set;
-    tag_ages = (uint64_t *) calloc(1, (num_blocks_per_set * sizeof(uint64_t)));
+    num_sets = (cache->tagstore->num_sets * num_shards);
+    num_blocks_per_set = cache->tagstore->num_blocks_per_set;
+    ways = (uint32_t *) calloc(1, (num_blocks_per_set * sizeof(uint32_t)));
 
     switch (cache->level) {
         case CACHE_LEVEL_1:
@@ -256,40 +912,37 @@ cache_print_cache_data(cache_generic_t *cache)
             cache_assert(0);
     }
 
+    /* Private caches of the cores, eg. "===== Core 3 L1 contents =====". */
+    if ((g_num_cores > 1) && (!CACHE_IS_L2(cache))) {
+        snprintf(core_title, sizeof(core_title), "===== Core %u %s",
+                cache->core, (title + strlen("===== ")));
+        title = core_title;
+    }
+
     dprint("%s\n", title);
     for (index = 0; index < num_sets; ++index) {
-        tag_index = (index * num_blocks_per_set);
+        tagstore = shards[index % num_shards]->tagstore;
+        tag_index = ((index / num_shards) * num_blocks_per_set);
         tags = &tagstore->tags[tag_index];
         tag_data = &tagstore->tag_data[tag_index];
 
         /*
-         * Copy the tag ages for sorting. TAs decided to print the tags by
-         * their ages. Recent tags goes first.
-         *
-         * qsort the tags, match them back to the block IDs and print the
-         * tags accordingly!
+         * TAs decided to print the tags by their ages. Recent tags goes
+         * first. The replacement policy knows the recency order; policies
+         * without one print the tags by block ID.
          */
-        for (block_id = 0; block_id < num_blocks_per_set; ++block_id)
-            tag_ages[block_id] = tag_data[block_id].age;
+        num_valid = cache_repl_order(tagstore, (index / num_shards), ways);
 
-        qsort(tag_ages, num_blocks_per_set,
-                sizeof(uint64_t), util_compare_uint64);
-        
         dprint("set%4u: ", index);
-        for (id = 0; id < num_blocks_per_set; ++id) {
-            for (block_id = 0; block_id < num_blocks_per_set; ++block_id) {
-                if ((tag_ages[id]) &&
-                        (tag_data[block_id].age == tag_ages[id])) {
-                    dprint(" %7x %s",
-                        tags[block_id],
-                        (tag_data[block_id].dirty) ? g_dirty : " ");
-                    tag_ages[id] = 0;
-                }
-            }
+        for (id = 0; id < num_valid; ++id) {
+            block_id = ways[id];
+            dprint(" %7x %s",
+                tags[block_id],
+                (tag_data[block_id].dirty) ? g_dirty : " ");
         }
         dprint("\n");
     }
-    free(tag_ages);
+    free(ways);
 
     return;
 }
@@ -323,7 +976,8 @@ cache_print_usage(const char *prog)
             "disables L2 cache.\n");
     dprint("    l2-set-assoc        : set associativity of the L2 cache.\n");
     dprint("    trace-file          : CPU memory access file with full "     \
-            "path.\n");
+            "path; - for stdin.\n");
+    cache_opts_print_usage();
 
     return;
 }
@@ -356,7 +1010,7 @@ cache_print_cache_dbg_data(cache_generic_t *pcache)
     printf("Block Size         : %u\n", pcache->blk_size);
     printf("Total Size         : %u\n", pcache->size);
     dprint("Set Associativity  : %u\n", pcache->set_assoc);
-    printf("Replacement Policy : %s\n", pcache->repl_plcy ? "LFU" : "LRU");
+    printf("Replacement Policy : %s\n", g_cache_repl_names[pcache->repl_plcy]);
     printf("Write Policy       : %s\n", pcache->write_plcy ? "WTNA" : "WBWA");
     dprint("Prev Cache         : %s\n", 
             (pcache->prev_cache ? pcache->prev_cache->name : "None"));
@@ -469,7 +1123,6 @@ void
 cache_print_tags(cache_generic_t *cache, cache_line_t *line)
 {
     char                *dirty_str = NULL;
-    int32_t             lru_id = -1;
     uint32_t            *tags = NULL;
     uint32_t            num_blocks = 0;
     uint32_t            block_id = 0;
@@ -482,11 +1135,10 @@ cache_print_tags(cache_generic_t *cache, cache_line_t *line)
     tag_index = (line->index * num_blocks);
     tags = &tagstore->tags[tag_index];
     tag_data = &tagstore->tag_data[tag_index];
-    lru_id = cache_util_get_lru_block_id(tagstore, line);
 
-    dprint("%6u %s [%2u, %d, %7x]: ",
+    dprint("%6u %s [%2u, %7x]: ",
             g_addr_count, CACHE_GET_NAME(cache),
-            line->index, lru_id, line->tag);
+            line->index, line->tag);
 
     for (block_id = 0; block_id < num_blocks; ++block_id) {
         dirty_str = ((tag_data[block_id].dirty) ? "D" : "");
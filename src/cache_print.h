@@ -20,6 +20,31 @@ cache_print_sim_stats(cache_generic_t *cache);
 void
 cache_print_cache_data(cache_generic_t *cache);
 void
+cache_print_cache_shards(cache_generic_t **shards, uint32_t num_shards);
+void
+cache_print_pf_stats(cache_generic_t *cache);
+struct cache_timing__;
+void
+cache_print_timing_stats(struct cache_timing__ *tm);
+struct cache_coh__;
+void
+cache_print_coh_stats(struct cache_coh__ *coh);
+void
+cache_print_incl_stats(void);
+void
+cache_print_wbb_stats(void);
+void
+cache_print_sector_stats(void);
+void
+cache_print_ptag_stats(void);
+void
+cache_print_set_stats(uint32_t num_hot);
+struct cache_ring__;
+void
+cache_print_ring_stats(struct cache_ring__ *ring);
+void
+cache_print_prof_stats(void);
+void
 cache_print_sim_config(cache_generic_t *cache);
 void
 cache_print_stats(cache_stats_t *pcache_stats, boolean detail);
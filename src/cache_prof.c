@@ -0,0 +1,208 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module sets up the hot path profiler (see cache_prof.h): it checks
+ * that the profiler can run, measures the cost of a stage switch, and
+ * opens, starts and reads the hardware counters on Linux.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif /* __linux__ */
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_prof.h"
+
+/* Constants */
+#define CACHE_PROF_CALIB_SWITCHES   10000
+
+/* Globals */
+boolean         g_cache_prof_on = FALSE;
+cache_prof_t    g_cache_prof;
+const char      *g_cache_prof_names[] = { "off", "tsc", "hw", NULL };
+const char      *g_cache_prof_stage_names[CACHE_PROF_NUM_STAGES] =
+    { "parse", "decode", "l1", "vc", "l2", "writeback", "prefetch",
+      "other" };
+const char      *g_cache_prof_hw_names[CACHE_PROF_NUM_HW] =
+    { "cycles", "instructions", "cache misses", "branch misses" };
+#if defined(__x86_64__) || defined(__i386__)
+const char      *g_cache_prof_unit = "TSC cycles";
+#else
+const char      *g_cache_prof_unit = "ns";
+#endif
+
+
+#ifdef __linux__
+/* Opens the hardware counters as one group; FALSE if not allowed. */
+static boolean
+cache_prof_hw_open(void)
+{
+    int                     iter = 0;
+    int                     fd = 0;
+    struct perf_event_attr  attr;
+    static const uint64_t   configs[CACHE_PROF_NUM_HW] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+    for (iter = 0; iter < CACHE_PROF_NUM_HW; ++iter) {
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[iter];
+        attr.disabled = (0 == iter);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1,
+                g_cache_prof.hw_fds[0], 0);
+        if (fd < 0) {
+            cache_prof_cleanup();
+            return FALSE;
+        }
+        g_cache_prof.hw_fds[iter] = fd;
+    }
+
+    return TRUE;
+}
+#endif /* __linux__ */
+
+
+/***************************************************************************
+ * Name:    cache_prof_init
+ *
+ * Desc:    Sets up the profiler as per --prof. The stages are tracked by a
+ *          single set of counters, so the sharded simulation is not
+ *          profiled. Hardware counters that can't be opened (not Linux, or
+ *          not allowed by perf_event_paranoid) are left out with a warning.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_prof_init(void)
+{
+    uint32_t    iter = 0;
+    uint64_t    start = 0;
+
+    memset(&g_cache_prof, 0, sizeof(g_cache_prof));
+    for (iter = 0; iter < CACHE_PROF_NUM_HW; ++iter)
+        g_cache_prof.hw_fds[iter] = -1;
+
+    if (CACHE_PROF_OFF == g_cache_opts.prof)
+        return CACHE_RV_OK;
+
+#ifndef CACHE_PROF_ON
+    dprint("Error: --prof needs a build with "
+            "make PROF=\"-D CACHE_PROF_ON\".\n");
+    return CACHE_RV_ERR;
+#endif /* CACHE_PROF_ON */
+
+    if (g_cache_opts.threads > 1) {
+        dprint("Error: --prof can't be used with --threads.\n");
+        return CACHE_RV_ERR;
+    }
+
+    /* Every switch adds its own cost to some stage; measure it. */
+    start = cache_prof_now();
+    g_cache_prof.last = start;
+    for (iter = 0; iter < CACHE_PROF_CALIB_SWITCHES; ++iter)
+        cache_prof_switch(CACHE_PROF_ST_OTHER);
+    g_cache_prof.switch_cost = ((double) (cache_prof_now() - start) /
+            CACHE_PROF_CALIB_SWITCHES);
+
+    if (CACHE_PROF_HW == g_cache_opts.prof) {
+#ifdef __linux__
+        if (!cache_prof_hw_open())
+#endif /* __linux__ */
+            dprint("Warning: Hardware counters are not available; "
+                    "profiling without them.\n");
+    }
+
+    g_cache_prof_on = TRUE;
+
+    return CACHE_RV_OK;
+}
+
+
+/* Starts charging the stages, and the hardware counters, if open. */
+void
+cache_prof_start(void)
+{
+    if (!g_cache_prof_on)
+        return;
+
+    memset(g_cache_prof.ticks, 0, sizeof(g_cache_prof.ticks));
+    g_cache_prof.num_switches = 0;
+    g_cache_prof.depth = 0;
+    g_cache_prof.stage = CACHE_PROF_ST_OTHER;
+#ifdef __linux__
+    if (g_cache_prof.hw_fds[0] >= 0) {
+        ioctl(g_cache_prof.hw_fds[0], PERF_EVENT_IOC_RESET,
+                PERF_IOC_FLAG_GROUP);
+        ioctl(g_cache_prof.hw_fds[0], PERF_EVENT_IOC_ENABLE,
+                PERF_IOC_FLAG_GROUP);
+    }
+#endif /* __linux__ */
+    g_cache_prof.last = cache_prof_now();
+
+    return;
+}
+
+
+/* Charges the last stage and reads the hardware counters. */
+void
+cache_prof_stop(void)
+{
+#ifdef __linux__
+    uint64_t    vals[CACHE_PROF_NUM_HW + 1];
+#endif /* __linux__ */
+
+    if (!g_cache_prof_on)
+        return;
+
+    cache_prof_switch(CACHE_PROF_ST_OTHER);
+    g_cache_prof.num_switches -= 1;
+#ifdef __linux__
+    if (g_cache_prof.hw_fds[0] >= 0) {
+        ioctl(g_cache_prof.hw_fds[0], PERF_EVENT_IOC_DISABLE,
+                PERF_IOC_FLAG_GROUP);
+        if ((sizeof(vals) == read(g_cache_prof.hw_fds[0], vals,
+                        sizeof(vals))) && (CACHE_PROF_NUM_HW == vals[0]))
+            memcpy(g_cache_prof.hw, &vals[1], sizeof(g_cache_prof.hw));
+    }
+#endif /* __linux__ */
+
+    return;
+}
+
+
+/* Closes the hardware counters. */
+void
+cache_prof_cleanup(void)
+{
+    uint32_t    iter = 0;
+
+    for (iter = 0; iter < CACHE_PROF_NUM_HW; ++iter) {
+        if (g_cache_prof.hw_fds[iter] >= 0)
+            close(g_cache_prof.hw_fds[iter]);
+        g_cache_prof.hw_fds[iter] = -1;
+    }
+
+    return;
+}
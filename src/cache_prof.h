@@ -0,0 +1,164 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the hot path profiler. Built with CACHE_PROF_ON, eg.
+ * make PROF="-D CACHE_PROF_ON", and run with --prof=tsc or --prof=hw, the
+ * simulation loop charges the time stamp counter ticks to the stage running
+ * at the time: trace parsing, address decode, the work at each cache level,
+ * write backs, prefetching and the rest of the per-reference bookkeeping.
+ * Stages nest (an L1 miss runs L2), and a stage is charged only its own
+ * time, so the stages add up to the whole loop. --prof=hw adds hardware
+ * counters (perf_event_open) over the loop. Without CACHE_PROF_ON, the hooks
+ * compile to nothing.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_PROF_H_
+#define CACHE_PROF_H_
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "cache.h"
+
+/* Constants */
+#define CACHE_PROF_OFF              0
+#define CACHE_PROF_TSC              1   /* time stamp counter stages    */
+#define CACHE_PROF_HW               2   /* stages + hardware counters   */
+
+#define CACHE_PROF_ST_PARSE         0   /* trace read and parse         */
+#define CACHE_PROF_ST_DECODE        1   /* address to tag/index/offset  */
+#define CACHE_PROF_ST_L1            2   /* L1 lookup, hit and fill      */
+#define CACHE_PROF_ST_VC            3   /* VC lookup and swap           */
+#define CACHE_PROF_ST_L2            4   /* L2 lookup and fill           */
+#define CACHE_PROF_ST_WB            5   /* dirty evictions              */
+#define CACHE_PROF_ST_PF            6   /* prefetcher training/issue    */
+#define CACHE_PROF_ST_OTHER         7   /* stats and per-ref hooks      */
+#define CACHE_PROF_NUM_STAGES       8
+
+#define CACHE_PROF_MAX_DEPTH        32  /* max. nesting of stages       */
+#define CACHE_PROF_NUM_HW           4   /* hardware counters            */
+
+/* Profiler state */
+typedef struct cache_prof__ {
+    uint8_t     stage;                  /* stage being charged          */
+    uint8_t     depth;                  /* # of stages pushed           */
+    uint8_t     stack[CACHE_PROF_MAX_DEPTH];    /* stages to go back to */
+    uint64_t    last;                   /* ticks at the last switch     */
+    uint64_t    ticks[CACHE_PROF_NUM_STAGES];
+    uint64_t    num_switches;
+    double      switch_cost;            /* ticks per switch, measured   */
+    int         hw_fds[CACHE_PROF_NUM_HW];  /* perf fds; leader first  */
+    uint64_t    hw[CACHE_PROF_NUM_HW];  /* counts over the loop         */
+} cache_prof_t;
+
+
+/* Externs */
+extern boolean          g_cache_prof_on;
+extern cache_prof_t     g_cache_prof;
+extern const char       *g_cache_prof_names[];
+extern const char       *g_cache_prof_stage_names[];
+extern const char       *g_cache_prof_hw_names[];
+extern const char       *g_cache_prof_unit;
+
+
+/* Function declarations */
+cache_rv
+cache_prof_init(void);
+void
+cache_prof_start(void);
+void
+cache_prof_stop(void);
+void
+cache_prof_cleanup(void);
+
+
+/* Returns the current time stamp counter; ns where there's none. */
+static inline uint64_t
+cache_prof_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+#endif
+}
+
+
+/* Charges the ticks since the last switch and moves on to a stage. */
+static inline void
+cache_prof_switch(uint8_t stage)
+{
+    uint64_t    now = cache_prof_now();
+
+    g_cache_prof.ticks[g_cache_prof.stage] += (now - g_cache_prof.last);
+    g_cache_prof.last = now;
+    g_cache_prof.stage = stage;
+    g_cache_prof.num_switches += 1;
+
+    return;
+}
+
+
+/* Enters a nested stage; CACHE_PROF_POP() goes back to the outer one. */
+static inline void
+cache_prof_push(uint8_t stage)
+{
+    if (g_cache_prof.depth < CACHE_PROF_MAX_DEPTH)
+        g_cache_prof.stack[g_cache_prof.depth] = g_cache_prof.stage;
+    g_cache_prof.depth += 1;
+    cache_prof_switch(stage);
+
+    return;
+}
+
+static inline void
+cache_prof_pop(void)
+{
+    g_cache_prof.depth -= 1;
+    if (g_cache_prof.depth < CACHE_PROF_MAX_DEPTH)
+        cache_prof_switch(g_cache_prof.stack[g_cache_prof.depth]);
+
+    return;
+}
+
+
+/* Hot path hooks; nothing at all without CACHE_PROF_ON. */
+#ifdef CACHE_PROF_ON
+#define CACHE_PROF_SWITCH(STAGE)                                        \
+    do {                                                                \
+        if (g_cache_prof_on)                                            \
+            cache_prof_switch(STAGE);                                   \
+    } while (0)
+
+#define CACHE_PROF_PUSH(STAGE)                                          \
+    do {                                                                \
+        if (g_cache_prof_on)                                            \
+            cache_prof_push(STAGE);                                     \
+    } while (0)
+
+#define CACHE_PROF_POP()                                                \
+    do {                                                                \
+        if (g_cache_prof_on)                                            \
+            cache_prof_pop();                                           \
+    } while (0)
+#else
+#define CACHE_PROF_SWITCH(STAGE)    do { } while (0)
+#define CACHE_PROF_PUSH(STAGE)      do { } while (0)
+#define CACHE_PROF_POP()            do { } while (0)
+#endif /* CACHE_PROF_ON */
+
+/* Stage of the given cache level. */
+#define CACHE_PROF_LEVEL(CACHE)                                         \
+    (((!(CACHE)) || (CACHE_IS_L1(CACHE))) ? CACHE_PROF_ST_L1 :          \
+     ((CACHE_IS_VC(CACHE)) ? CACHE_PROF_ST_VC : CACHE_PROF_ST_L2))
+
+#endif /* CACHE_PROF_H_ */
@@ -0,0 +1,230 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the partial tag filter (see cache_ptag.h).
+ *
+ * The hashes are kept up to date by the fill and invalidate hooks of the
+ * tagstore, like the tag index of the fully associative ones, and by the
+ * cache core where it drops a block it refills right away; a hash is 0 if
+ * and only if the block is invalid. A matching hash only picks the ways to
+ * check; a way counts only if it's valid and holds the tag. A lookup XORs
+ * 8 hashes at a time with the one looked for and finds the 0 bytes with a
+ * few word operations, in way order, so it finds the same way as a scan of
+ * the tags would; the free way search looks for 0 hashes the same way.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_arena.h"
+#include "cache_ptag.h"
+
+/* Constants */
+#define CACHE_PTAG_WAYS_PER_WORD    8
+#define CACHE_PTAG_ONES             0x0101010101010101ULL
+#define CACHE_PTAG_LOW7             0x7f7f7f7f7f7f7f7fULL
+
+/*
+ * Way within a word of the first 0x80 of a match mask, the mask without
+ * it, and the mask of the first N ways of a word.
+ */
+#if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define CACHE_PTAG_FIRST(MASK)      (__builtin_clzll(MASK) >> 3)
+#define CACHE_PTAG_DROP(MASK)       ((MASK) & ~(0x8000000000000000ULL >>  \
+                                        __builtin_clzll(MASK)))
+#define CACHE_PTAG_HEAD(N)          (~(~0ULL >> (8 * (N))))
+#else
+#define CACHE_PTAG_FIRST(MASK)      (__builtin_ctzll(MASK) >> 3)
+#define CACHE_PTAG_DROP(MASK)       ((MASK) & ((MASK) - 1))
+#define CACHE_PTAG_HEAD(N)          ((1ULL << (8 * (N))) - 1)
+#endif
+
+/* Globals */
+boolean         g_cache_ptag_on = FALSE;    /* any level is filtered    */
+const char      *g_cache_ptag_names[] = { "off", "on", NULL };
+
+
+/* Returns 0x80 in the 0 bytes of a word, and 0 in all the other bits. */
+static inline uint64_t
+cache_ptag_zeros(uint64_t word)
+{
+    return ~((((word & CACHE_PTAG_LOW7) + CACHE_PTAG_LOW7) | word) |
+            CACHE_PTAG_LOW7);
+}
+
+
+/* Returns the 0 bytes of the word of hashes at a way of a set. */
+static inline uint64_t
+cache_ptag_match(const uint8_t *sigs, uint32_t way, uint32_t ways,
+        uint64_t pattern)
+{
+    uint64_t    word = 0;
+    uint64_t    match = 0;
+
+    memcpy(&word, (sigs + way), sizeof(word));
+    match = cache_ptag_zeros(word ^ pattern);
+
+    /* Bytes past the set are of the next one. */
+    if ((ways - way) < CACHE_PTAG_WAYS_PER_WORD)
+        match &= CACHE_PTAG_HEAD(ways - way);
+
+    return match;
+}
+
+
+/* Returns the 8-bit hash of a tag; never 0, which marks empty ways. */
+static inline uint8_t
+cache_ptag_sig(uint32_t tag)
+{
+    uint8_t     sig = ((tag * 0x9e3779b9U) >> 24);
+
+    return (sig ? sig : 1);
+}
+
+
+/***************************************************************************
+ * Name:    cache_ptag_init
+ *
+ * Desc:    Sets up an empty partial tag filter for a tagstore, from the
+ *          arena.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore; geometry set up already
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_ptag_init(cache_tagstore_t *tagstore)
+{
+    cache_ptag_t    *ptag = NULL;
+
+    ptag = cache_arena_calloc(1, sizeof(*ptag));
+    if (!ptag)
+        return CACHE_RV_ERR;
+
+    /* A word can always be read; the last set may be shorter than one. */
+    ptag->sigs = cache_arena_calloc((tagstore->num_blocks +
+                CACHE_PTAG_WAYS_PER_WORD), sizeof(uint8_t));
+    if (!ptag->sigs)
+        return CACHE_RV_ERR;
+
+    tagstore->ptag = ptag;
+    g_cache_ptag_on = TRUE;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ptag_lookup
+ *
+ * Desc:    Looks up a tag in a set. Only the ways whose hash matches the
+ *          tag's have their tag and valid bit read.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  set         set to look in
+ *  tag         tag to look for
+ *
+ * Returns: int32_t
+ *  ID of the way holding the tag
+ *  CACHE_RV_ERR if none does
+ **************************************************************************/
+int32_t
+cache_ptag_lookup(cache_tagstore_t *tagstore, uint32_t set, uint32_t tag)
+{
+    uint32_t        way = 0;
+    uint32_t        hit = 0;
+    uint32_t        ways = tagstore->num_blocks_per_set;
+    uint32_t        base = (set * ways);
+    uint64_t        match = 0;
+    uint64_t        compares = 0;
+    uint64_t        pattern = (cache_ptag_sig(tag) * CACHE_PTAG_ONES);
+    cache_ptag_t    *ptag = tagstore->ptag;
+    const uint8_t   *sigs = &ptag->sigs[base];
+
+    ptag->num_lookups += 1;
+    for (way = 0; way < ways; way += CACHE_PTAG_WAYS_PER_WORD) {
+        match = cache_ptag_match(sigs, way, ways, pattern);
+        for (; match; match = CACHE_PTAG_DROP(match)) {
+            hit = (base + way + CACHE_PTAG_FIRST(match));
+            compares += 1;
+            if ((tagstore->tag_data[hit].valid) &&
+                    (tagstore->tags[hit] == tag)) {
+                ptag->num_compares += compares;
+                ptag->num_false += (compares - 1);
+                return (hit - base);
+            }
+        }
+    }
+
+    ptag->num_compares += compares;
+    ptag->num_false += compares;
+    ptag->num_filtered += (!compares);
+
+    return CACHE_RV_ERR;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ptag_first_invalid
+ *
+ * Desc:    Returns the lowest free way of a set, as a scan of the valid
+ *          bits would, from the hashes alone.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  set         set to look in
+ *
+ * Returns: int32_t
+ *  ID of the lowest free way
+ *  CACHE_RV_ERR if all the ways are in use
+ **************************************************************************/
+int32_t
+cache_ptag_first_invalid(cache_tagstore_t *tagstore, uint32_t set)
+{
+    uint32_t        way = 0;
+    uint32_t        ways = tagstore->num_blocks_per_set;
+    uint64_t        match = 0;
+    const uint8_t   *sigs = &tagstore->ptag->sigs[set * ways];
+
+    for (way = 0; way < ways; way += CACHE_PTAG_WAYS_PER_WORD) {
+        match = cache_ptag_match(sigs, way, ways, 0);
+        if (match)
+            return (way + CACHE_PTAG_FIRST(match));
+    }
+
+    return CACHE_RV_ERR;
+}
+
+
+/* Records the hash of a block just filled; its tag is written already. */
+void
+cache_ptag_fill(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    uint32_t    blk = ((set * tagstore->num_blocks_per_set) + way);
+
+    tagstore->ptag->sigs[blk] = cache_ptag_sig(tagstore->tags[blk]);
+
+    return;
+}
+
+
+/* Clears the hash of an invalidated block. */
+void
+cache_ptag_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    tagstore->ptag->sigs[(set * tagstore->num_blocks_per_set) + way] = 0;
+
+    return;
+}
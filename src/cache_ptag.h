@@ -0,0 +1,58 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the partial tag filter of set associative tagstores. Every block has an
+ * 8-bit hash of its tag next to the full one, 0 while the block is empty,
+ * and a lookup compares the hashes of a set 8 ways at a time first. Only
+ * the ways whose hash matches have their full tag and valid bit read, so
+ * most misses, and most of the other ways on a hit, never touch the tag
+ * arrays; nor does the search for a free way on a miss, as empty ways are
+ * the ones with a 0 hash. It pays off for the big, highly associative
+ * levels; the fully associative ones (the VC) have a tag index instead
+ * (see cache_fa.h).
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_PTAG_H_
+#define CACHE_PTAG_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_PTAGS_OFF             0
+#define CACHE_PTAGS_ON              1
+
+/* Partial tag filter of a tagstore */
+typedef struct cache_ptag__ {
+    uint8_t     *sigs;                  /* tag hash per block; 0 if empty */
+    uint64_t    num_lookups;            /* # of lookups                 */
+    uint64_t    num_filtered;           /* # of lookups no hash matched */
+    uint64_t    num_compares;           /* # of full tags compared      */
+    uint64_t    num_false;              /* # of hash matches of other
+                                           tags                         */
+} cache_ptag_t;
+
+
+/* Externs */
+extern boolean          g_cache_ptag_on;
+extern const char       *g_cache_ptag_names[];
+
+
+/* Function declarations */
+cache_rv
+cache_ptag_init(cache_tagstore_t *tagstore);
+int32_t
+cache_ptag_lookup(cache_tagstore_t *tagstore, uint32_t set, uint32_t tag);
+int32_t
+cache_ptag_first_invalid(cache_tagstore_t *tagstore, uint32_t set);
+void
+cache_ptag_fill(cache_tagstore_t *tagstore, uint32_t set, uint32_t way);
+void
+cache_ptag_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way);
+
+#endif /* CACHE_PTAG_H_ */
@@ -0,0 +1,1221 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the replacement policies: LRU, LFU, FIFO,
+ * seeded random, tree-PLRU, bit-PLRU (MRU bits), SRRIP and BRRIP. Each
+ * policy allocates only the metadata it needs, from the simulation arena:
+ *
+ *      LRU         8B age per block; 8B list links per block when fully
+ *                  associative
+ *      LFU         8B age + 4B ref count per block, 4B count per set
+ *      FIFO        8B fill time per block
+ *      random      4B generator state per tagstore
+ *      tree-PLRU   assoc bits per set, (assoc - 1) of them in use
+ *      bit-PLRU    assoc bits per set
+ *      SRRIP/BRRIP 2 bits per block
+ *      OPT         4B next use per reference, 12B per distinct block of the
+ *                  trace, 12B per block (next use and heap links)
+ *
+ * LRU and LFU keep ages since the contents dump is ordered by recency;
+ * FIFO keeps the fill time as the age, so holes left by invalidations
+ * are refilled as the newest blocks.
+ * Fully associative LRU tagstores (eg. a large VC) keep a recency list
+ * instead, so that the victim is found without scanning all the ways.
+ * OPT (Belady) is offline and L1 only: the trace is pre-scanned at init
+ * for the next use of every reference and the block with the farthest
+ * next use in the set is evicted.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_repl.h"
+#include "cache_trace.h"
+#include "cache_arena.h"
+
+#define CACHE_RRPV_BITS         2
+#define CACHE_RRPV_MAX          ((1 << CACHE_RRPV_BITS) - 1)
+#define CACHE_RRPV_PER_BYTE     (8 / CACHE_RRPV_BITS)
+#define CACHE_BRRIP_LONG_ODDS   32      /* 1 in 32 BRRIP fills are long */
+#define CACHE_OPT_NEVER         UINT32_MAX /* no further use            */
+#define CACHE_OPT_HASH_INIT     4096    /* initial block hash size      */
+
+/* LRU and LFU state */
+typedef struct cache_repl_age__ {
+    uint64_t    clock;                  /* logical time of the tagstore */
+    uint64_t    *age;                   /* last use time per block      */
+    uint32_t    *ref_count;             /* LFU: ref. count per block    */
+    uint32_t    *set_ref_count;         /* LFU: row-wise ref count      */
+} cache_repl_age_t;
+
+/* LRU recency list of a single set; the extra node is the list head */
+typedef struct cache_repl_list__ {
+    uint32_t    *prev;                  /* towards MRU; self if unlinked*/
+    uint32_t    *next;                  /* towards LRU; self if unlinked*/
+} cache_repl_list_t;
+
+/* Random state */
+typedef struct cache_repl_rand__ {
+    uint32_t    rng;                    /* xorshift32 state             */
+} cache_repl_rand_t;
+
+/* Tree-PLRU and bit-PLRU state */
+typedef struct cache_repl_plru__ {
+    uint32_t    bytes_per_set;          /* bitmap size per set          */
+    uint32_t    levels;                 /* tree-PLRU: log2(assoc)       */
+    uint8_t     *bits;                  /* per set bitmaps              */
+} cache_repl_plru_t;
+
+/* SRRIP and BRRIP state */
+typedef struct cache_repl_rrip__ {
+    uint32_t    rng;                    /* BRRIP: xorshift32 state      */
+    uint8_t     *rrpv;                  /* packed 2-bit RRPV per block  */
+} cache_repl_rrip_t;
+
+/* OPT: trace block; empty if first is 0 */
+typedef struct cache_repl_opt_blk__ {
+    uint32_t    blk;                    /* block address                */
+    uint32_t    first;                  /* first ref ID of the block    */
+    uint32_t    last;                   /* latest ref ID so far, or 0   */
+} cache_repl_opt_blk_t;
+
+/* OPT state */
+typedef struct cache_repl_opt__ {
+    cache_tagstore_t        *tagstore;  /* ptr to the owner tagstore    */
+    uint32_t                num_refs;   /* # of refs in the trace       */
+    uint32_t                *next_use;  /* next ref ID of the same blk,
+                                           indexed by ref ID            */
+    uint32_t                hash_mask;  /* # of hash slots - 1          */
+    uint32_t                hash_count; /* # of distinct blocks         */
+    cache_repl_opt_blk_t    *hash;      /* block -> first/last ref ID   */
+    uint32_t                cur_ref;    /* current ref ID               */
+    uint32_t                cur_blk;    /* block of the current ref     */
+    uint32_t                *key;       /* next use per block           */
+    uint32_t                *heap;      /* per set max-heap of ways     */
+    uint32_t                *heap_pos;  /* heap slot per block          */
+    struct cache_repl_opt__ *next;      /* next OPT tagstore            */
+} cache_repl_opt_t;
+
+/* Globals; indexed by CACHE_REPL_PLCY_* */
+const char *g_cache_repl_names[] = {
+    "lru", "lfu", "fifo", "random", "plru-tree", "plru-bit", "srrip",
+    "brrip", "opt", NULL
+};
+
+static cache_repl_opt_t *g_cache_repl_opt_list; /* all OPT tagstores  */
+
+
+/***************************************************************************
+ * Name:    cache_repl_seed
+ *
+ * Desc:    Returns the random seed for a tagstore. Derived from the user
+ *          given seed, the cache level and the core, so that every cache
+ *          has its own, reproducible, random sequence.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *
+ * Returns: uint32_t
+ *  A non-zero xorshift32 seed
+ **************************************************************************/
+static uint32_t
+cache_repl_seed(cache_tagstore_t *tagstore)
+{
+    uint32_t        seed = 0;
+    cache_generic_t *cache = (cache_generic_t *) tagstore->cache;
+
+    seed = ((g_cache_opts.seed ? g_cache_opts.seed : 1) ^
+            (0x9e3779b9 * cache->level) ^ (0x85ebca6b * cache->core));
+
+    return (seed ? seed : 1);
+}
+
+
+static inline uint32_t
+cache_repl_bit_get(uint8_t *bits, uint32_t bit)
+{
+    return ((bits[bit >> 3] >> (bit & 7)) & 1);
+}
+
+
+static inline void
+cache_repl_bit_set(uint8_t *bits, uint32_t bit, uint32_t val)
+{
+    if (val)
+        bits[bit >> 3] |= (1 << (bit & 7));
+    else
+        bits[bit >> 3] &= ~(1 << (bit & 7));
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_sort_by_age
+ *
+ * Desc:    Orders the valid ways of a set by age, youngest first. Used by
+ *          LRU, LFU and FIFO for the contents dump.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  set         set index
+ *  ways        ptr to the output way IDs (num_blocks_per_set entries)
+ *
+ * Returns: uint32_t
+ *  # of valid ways
+ **************************************************************************/
+static uint32_t
+cache_repl_sort_by_age(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t *ways)
+{
+    uint32_t            way = 0;
+    uint32_t            iter = 0;
+    uint32_t            count = 0;
+    uint32_t            base = (set * tagstore->num_blocks_per_set);
+    uint64_t            *age = ((cache_repl_age_t *)
+                                tagstore->repl_state)->age + base;
+    cache_tag_data_t    *tag_data = &tagstore->tag_data[base];
+
+    /* Insertion sort; sets are small and mostly sorted already. */
+    for (way = 0; way < tagstore->num_blocks_per_set; ++way) {
+        if (!tag_data[way].valid)
+            continue;
+
+        for (iter = count; (iter) && (age[ways[iter - 1]] < age[way]); --iter)
+            ways[iter] = ways[iter - 1];
+        ways[iter] = way;
+        count += 1;
+    }
+
+    return count;
+}
+
+
+/* LRU */
+static cache_rv
+cache_repl_age_init(cache_tagstore_t *tagstore)
+{
+    cache_repl_age_t *state = cache_arena_calloc(1, sizeof(*state));
+
+    if (!state)
+        return CACHE_RV_ERR;
+
+    tagstore->repl_state = state;
+    state->age = cache_arena_calloc(tagstore->num_blocks, sizeof(uint64_t));
+
+    return (state->age ? CACHE_RV_OK : CACHE_RV_ERR);
+}
+
+
+static void
+cache_repl_lru_touch(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_repl_age_t *state = tagstore->repl_state;
+
+    state->clock += 1;
+    state->age[(set * tagstore->num_blocks_per_set) + way] = state->clock;
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_lru_victim
+ *
+ * Desc:    Returns the LRU block ID for the given set; the first way on a
+ *          tie.
+ **************************************************************************/
+static uint32_t
+cache_repl_lru_victim(cache_tagstore_t *tagstore, uint32_t set)
+{
+    uint32_t            way = 0;
+    uint32_t            min_way = 0;
+    uint32_t            base = (set * tagstore->num_blocks_per_set);
+    uint64_t            *age = ((cache_repl_age_t *)
+                                tagstore->repl_state)->age + base;
+
+    for (way = 1; way < tagstore->num_blocks_per_set; ++way) {
+        if (age[way] < age[min_way])
+            min_way = way;
+    }
+
+    return min_way;
+}
+
+
+static void
+cache_repl_age_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    cache_repl_age_t *state = tagstore->repl_state;
+
+    state->age[(set * tagstore->num_blocks_per_set) + way] = 0;
+    if (state->ref_count)
+        state->ref_count[(set * tagstore->num_blocks_per_set) + way] = 0;
+}
+
+
+/* LRU, fully associative */
+static cache_rv
+cache_repl_list_init(cache_tagstore_t *tagstore)
+{
+    uint32_t            node = 0;
+    uint32_t            num_nodes = (tagstore->num_blocks + 1);
+    cache_repl_list_t   *state = cache_arena_calloc(1, sizeof(*state));
+
+    if (!state)
+        return CACHE_RV_ERR;
+
+    tagstore->repl_state = state;
+    state->prev = cache_arena_calloc(num_nodes, sizeof(uint32_t));
+    state->next = cache_arena_calloc(num_nodes, sizeof(uint32_t));
+    if ((!state->prev) || (!state->next))
+        return CACHE_RV_ERR;
+
+    for (node = 0; node < num_nodes; ++node)
+        state->prev[node] = state->next[node] = node;
+
+    return CACHE_RV_OK;
+}
+
+
+static void
+cache_repl_list_unlink(cache_repl_list_t *state, uint32_t way)
+{
+    state->next[state->prev[way]] = state->next[way];
+    state->prev[state->next[way]] = state->prev[way];
+    state->prev[way] = state->next[way] = way;
+}
+
+
+/* Moves the way to the MRU end of the list. */
+static void
+cache_repl_list_touch(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    uint32_t            head = tagstore->num_blocks;
+    cache_repl_list_t   *state = tagstore->repl_state;
+
+    cache_repl_list_unlink(state, way);
+    state->prev[way] = head;
+    state->next[way] = state->next[head];
+    state->prev[state->next[head]] = way;
+    state->next[head] = way;
+}
+
+
+/*
+ * The victim is at the LRU end. Sets are full when a victim is picked, and
+ * every valid way has a distinct last use, so it's the way the age based
+ * LRU would pick.
+ */
+static uint32_t
+cache_repl_list_victim(cache_tagstore_t *tagstore, uint32_t set)
+{
+    cache_repl_list_t   *state = tagstore->repl_state;
+
+    return state->prev[tagstore->num_blocks];
+}
+
+
+static void
+cache_repl_list_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    cache_repl_list_unlink(tagstore->repl_state, way);
+}
+
+
+/* Orders the valid ways from the MRU end. */
+static uint32_t
+cache_repl_list_order(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t *ways)
+{
+    uint32_t            way = 0;
+    uint32_t            count = 0;
+    uint32_t            head = tagstore->num_blocks;
+    cache_repl_list_t   *state = tagstore->repl_state;
+
+    for (way = state->next[head]; way != head; way = state->next[way]) {
+        if (tagstore->tag_data[way].valid)
+            ways[count++] = way;
+    }
+
+    return count;
+}
+
+
+/* LFU */
+static cache_rv
+cache_repl_lfu_init(cache_tagstore_t *tagstore)
+{
+    cache_repl_age_t *state = NULL;
+
+    if (CACHE_RV_OK != cache_repl_age_init(tagstore))
+        return CACHE_RV_ERR;
+
+    state = tagstore->repl_state;
+    state->ref_count = cache_arena_calloc(tagstore->num_blocks,
+            sizeof(uint32_t));
+    state->set_ref_count = cache_arena_calloc(tagstore->num_sets,
+            sizeof(uint32_t));
+
+    return (((state->ref_count) && (state->set_ref_count)) ?
+            CACHE_RV_OK : CACHE_RV_ERR);
+}
+
+
+static void
+cache_repl_lfu_hit(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_repl_age_t *state = tagstore->repl_state;
+
+    cache_repl_lru_touch(tagstore, set, way);
+    state->ref_count[(set * tagstore->num_blocks_per_set) + way] += 1;
+}
+
+
+/*
+ * According to LFU policy, a new block starts off with the row ref count
+ * (ref count of the last evicted block in the set) + 1.
+ */
+static void
+cache_repl_lfu_fill(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_repl_age_t *state = tagstore->repl_state;
+
+    cache_repl_lru_touch(tagstore, set, way);
+    state->ref_count[(set * tagstore->num_blocks_per_set) + way] =
+        (state->set_ref_count[set] + 1);
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_lfu_victim
+ *
+ * Desc:    Returns the LFU block ID for the given set; the first way on a
+ *          tie. The row ref count is set to the ref count of the block
+ *          being evicted and the evicted block ref count is reset.
+ **************************************************************************/
+static uint32_t
+cache_repl_lfu_victim(cache_tagstore_t *tagstore, uint32_t set)
+{
+    uint32_t            way = 0;
+    uint32_t            min_way = 0;
+    uint32_t            base = (set * tagstore->num_blocks_per_set);
+    cache_repl_age_t    *state = tagstore->repl_state;
+    uint32_t            *ref_count = (state->ref_count + base);
+
+    for (way = 1; way < tagstore->num_blocks_per_set; ++way) {
+        if (ref_count[way] < ref_count[min_way])
+            min_way = way;
+    }
+
+    state->set_ref_count[set] = ref_count[min_way];
+    ref_count[min_way] = 0;
+
+    return min_way;
+}
+
+
+static void
+cache_repl_nop(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    return;
+}
+
+
+/*
+ * FIFO: the age of a block is its fill time, which hits leave alone, so
+ * the LRU victim is the oldest fill; refilled holes included.
+ */
+static void
+cache_repl_fifo_fill(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_repl_lru_touch(tagstore, set, way);
+
+    return;
+}
+
+
+/* Random */
+static cache_rv
+cache_repl_rand_init(cache_tagstore_t *tagstore)
+{
+    cache_repl_rand_t *state = cache_arena_calloc(1, sizeof(*state));
+
+    if (!state)
+        return CACHE_RV_ERR;
+
+    state->rng = cache_repl_seed(tagstore);
+    tagstore->repl_state = state;
+
+    return CACHE_RV_OK;
+}
+
+
+static uint32_t
+cache_repl_rand_victim(cache_tagstore_t *tagstore, uint32_t set)
+{
+    cache_repl_rand_t *state = tagstore->repl_state;
+
+    return (util_xorshift32(&state->rng) % tagstore->num_blocks_per_set);
+}
+
+
+/* PLRU state shared by the tree and bit variants */
+static cache_rv
+cache_repl_plru_init(cache_tagstore_t *tagstore, uint32_t bits_per_set)
+{
+    cache_repl_plru_t *state = cache_arena_calloc(1, sizeof(*state));
+
+    if (!state)
+        return CACHE_RV_ERR;
+
+    tagstore->repl_state = state;
+    state->bytes_per_set = ((bits_per_set + 7) / 8);
+    state->levels = util_log_base_2(tagstore->num_blocks_per_set);
+    state->bits = cache_arena_calloc(tagstore->num_sets,
+            state->bytes_per_set);
+
+    return (state->bits ? CACHE_RV_OK : CACHE_RV_ERR);
+}
+
+
+/* Tree-PLRU */
+static cache_rv
+cache_repl_tree_plru_init(cache_tagstore_t *tagstore)
+{
+    if (!util_is_power_of_2(tagstore->num_blocks_per_set)) {
+        dprint("Error: tree-PLRU needs a power of 2 set associativity.\n");
+        return CACHE_RV_ERR;
+    }
+
+    /* Nodes are heap indexed from 1; bit 0 is unused. */
+    return cache_repl_plru_init(tagstore, tagstore->num_blocks_per_set);
+}
+
+
+/*
+ * Walks from the root to the leaf of the way and points every node on the
+ * path away from it. A node bit of 1 means the victim is on the right.
+ */
+static void
+cache_repl_tree_plru_touch(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    uint32_t            level = 0;
+    uint32_t            node = 1;
+    uint32_t            dir = 0;
+    cache_repl_plru_t   *state = tagstore->repl_state;
+    uint8_t             *bits = &state->bits[set * state->bytes_per_set];
+
+    for (level = 0; level < state->levels; ++level) {
+        dir = ((way >> (state->levels - 1 - level)) & 1);
+        cache_repl_bit_set(bits, node, !dir);
+        node = ((node << 1) | dir);
+    }
+}
+
+
+static uint32_t
+cache_repl_tree_plru_victim(cache_tagstore_t *tagstore, uint32_t set)
+{
+    uint32_t            level = 0;
+    uint32_t            node = 1;
+    cache_repl_plru_t   *state = tagstore->repl_state;
+    uint8_t             *bits = &state->bits[set * state->bytes_per_set];
+
+    for (level = 0; level < state->levels; ++level)
+        node = ((node << 1) | cache_repl_bit_get(bits, node));
+
+    return (node - tagstore->num_blocks_per_set);
+}
+
+
+/* Bit-PLRU */
+static cache_rv
+cache_repl_bit_plru_init(cache_tagstore_t *tagstore)
+{
+    return cache_repl_plru_init(tagstore, tagstore->num_blocks_per_set);
+}
+
+
+/*
+ * Sets the MRU bit of the way. Once all the bits are set, all but the
+ * current way's are cleared.
+ */
+static void
+cache_repl_bit_plru_touch(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    uint32_t            iter = 0;
+    cache_repl_plru_t   *state = tagstore->repl_state;
+    uint8_t             *bits = &state->bits[set * state->bytes_per_set];
+
+    cache_repl_bit_set(bits, way, 1);
+    for (iter = 0; iter < tagstore->num_blocks_per_set; ++iter) {
+        if (!cache_repl_bit_get(bits, iter))
+            return;
+    }
+
+    memset(bits, 0, state->bytes_per_set);
+    cache_repl_bit_set(bits, way, 1);
+}
+
+
+static uint32_t
+cache_repl_bit_plru_victim(cache_tagstore_t *tagstore, uint32_t set)
+{
+    uint32_t            way = 0;
+    cache_repl_plru_t   *state = tagstore->repl_state;
+    uint8_t             *bits = &state->bits[set * state->bytes_per_set];
+
+    for (way = 0; way < tagstore->num_blocks_per_set; ++way) {
+        if (!cache_repl_bit_get(bits, way))
+            return way;
+    }
+
+    return 0;
+}
+
+
+static void
+cache_repl_bit_plru_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    cache_repl_plru_t   *state = tagstore->repl_state;
+
+    cache_repl_bit_set(&state->bits[set * state->bytes_per_set], way, 0);
+}
+
+
+/* SRRIP and BRRIP */
+static inline uint32_t
+cache_repl_rrpv_get(cache_repl_rrip_t *state, uint32_t blk)
+{
+    return ((state->rrpv[blk / CACHE_RRPV_PER_BYTE] >>
+                ((blk % CACHE_RRPV_PER_BYTE) * CACHE_RRPV_BITS)) &
+            CACHE_RRPV_MAX);
+}
+
+
+static inline void
+cache_repl_rrpv_set(cache_repl_rrip_t *state, uint32_t blk, uint32_t val)
+{
+    uint32_t    shift = ((blk % CACHE_RRPV_PER_BYTE) * CACHE_RRPV_BITS);
+    uint8_t     *byte = &state->rrpv[blk / CACHE_RRPV_PER_BYTE];
+
+    *byte = ((*byte & ~(CACHE_RRPV_MAX << shift)) | (val << shift));
+}
+
+
+static cache_rv
+cache_repl_rrip_init(cache_tagstore_t *tagstore)
+{
+    uint32_t            blk = 0;
+    cache_repl_rrip_t   *state = cache_arena_calloc(1, sizeof(*state));
+
+    if (!state)
+        return CACHE_RV_ERR;
+
+    tagstore->repl_state = state;
+    state->rng = cache_repl_seed(tagstore);
+    state->rrpv = cache_arena_calloc(((tagstore->num_blocks +
+                    CACHE_RRPV_PER_BYTE - 1) / CACHE_RRPV_PER_BYTE), 1);
+    if (!state->rrpv)
+        return CACHE_RV_ERR;
+
+    for (blk = 0; blk < tagstore->num_blocks; ++blk)
+        cache_repl_rrpv_set(state, blk, CACHE_RRPV_MAX);
+
+    return CACHE_RV_OK;
+}
+
+
+/* Hits are predicted to be re-referenced in the near-immediate future. */
+static void
+cache_repl_rrip_hit(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_repl_rrpv_set(tagstore->repl_state,
+            ((set * tagstore->num_blocks_per_set) + way), 0);
+}
+
+
+/* SRRIP inserts with a long re-reference interval. */
+static void
+cache_repl_srrip_fill(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_repl_rrpv_set(tagstore->repl_state,
+            ((set * tagstore->num_blocks_per_set) + way),
+            (CACHE_RRPV_MAX - 1));
+}
+
+
+/* BRRIP inserts mostly with a distant, rarely with a long interval. */
+static void
+cache_repl_brrip_fill(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_repl_rrip_t   *state = tagstore->repl_state;
+    uint32_t            rrpv = CACHE_RRPV_MAX;
+
+    if (!(util_xorshift32(&state->rng) % CACHE_BRRIP_LONG_ODDS))
+        rrpv = (CACHE_RRPV_MAX - 1);
+
+    cache_repl_rrpv_set(state,
+            ((set * tagstore->num_blocks_per_set) + way), rrpv);
+}
+
+
+/*
+ * The victim is the first way with a distant re-reference prediction. If
+ * there's none, all the blocks of the set are aged until there is one.
+ */
+static uint32_t
+cache_repl_rrip_victim(cache_tagstore_t *tagstore, uint32_t set)
+{
+    uint32_t            way = 0;
+    uint32_t            max_rrpv = 0;
+    uint32_t            rrpv = 0;
+    uint32_t            max_way = 0;
+    uint32_t            base = (set * tagstore->num_blocks_per_set);
+    cache_repl_rrip_t   *state = tagstore->repl_state;
+
+    for (way = 0; way < tagstore->num_blocks_per_set; ++way) {
+        rrpv = cache_repl_rrpv_get(state, (base + way));
+        if (rrpv > max_rrpv) {
+            max_rrpv = rrpv;
+            max_way = way;
+        }
+        if (CACHE_RRPV_MAX == rrpv)
+            return way;
+    }
+
+    /* Age everyone by the same amount in one go. */
+    for (way = 0; way < tagstore->num_blocks_per_set; ++way) {
+        rrpv = cache_repl_rrpv_get(state, (base + way));
+        cache_repl_rrpv_set(state, (base + way),
+                (rrpv + (CACHE_RRPV_MAX - max_rrpv)));
+    }
+
+    return max_way;
+}
+
+
+static void
+cache_repl_rrip_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    cache_repl_rrpv_set(tagstore->repl_state,
+            ((set * tagstore->num_blocks_per_set) + way), CACHE_RRPV_MAX);
+}
+
+
+/* OPT */
+static inline uint32_t
+cache_repl_opt_hash(uint32_t blk)
+{
+    return (blk * 0x9e3779b1);
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_opt_lookup
+ *
+ * Desc:    Looks up a block in the OPT block hash; adds it if asked to.
+ *
+ * Params:
+ *  state   ptr to the OPT state
+ *  blk     block address
+ *  add     TRUE to add the block if it's not present
+ *
+ * Returns: cache_repl_opt_blk_t *
+ *  ptr to the hash entry
+ *  NULL if the block is not present (and not added)
+ **************************************************************************/
+static cache_repl_opt_blk_t *
+cache_repl_opt_lookup(cache_repl_opt_t *state, uint32_t blk, boolean add)
+{
+    uint32_t                slot = 0;
+    cache_repl_opt_blk_t    *ent = NULL;
+
+    slot = (cache_repl_opt_hash(blk) & state->hash_mask);
+    for (;;) {
+        ent = &state->hash[slot];
+        if (!ent->first)
+            break;
+        if (ent->blk == blk)
+            return ent;
+        slot = ((slot + 1) & state->hash_mask);
+    }
+
+    if (!add)
+        return NULL;
+
+    ent->blk = blk;
+    state->hash_count += 1;
+    return ent;
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_opt_grow
+ *
+ * Desc:    Doubles the OPT block hash, keeping the load under one half.
+ *
+ * Params:
+ *  state   ptr to the OPT state
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+static cache_rv
+cache_repl_opt_grow(cache_repl_opt_t *state)
+{
+    uint32_t                iter = 0;
+    uint32_t                old_size = (state->hash_mask + 1);
+    cache_repl_opt_blk_t    *old_hash = state->hash;
+    cache_repl_opt_blk_t    *ent = NULL;
+
+    state->hash = calloc((old_size * 2), sizeof(*state->hash));
+    if (!state->hash) {
+        state->hash = old_hash;
+        return CACHE_RV_ERR;
+    }
+    state->hash_mask = ((old_size * 2) - 1);
+    state->hash_count = 0;
+
+    for (iter = 0; iter < old_size; ++iter) {
+        if (!old_hash[iter].first)
+            continue;
+        ent = cache_repl_opt_lookup(state, old_hash[iter].blk, TRUE);
+        *ent = old_hash[iter];
+    }
+    free(old_hash);
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_opt_scan
+ *
+ * Desc:    Pre-scans the trace once and links every reference to the next
+ *          reference of the same block. Leaves the trace rewound.
+ *
+ * Params:
+ *  state   ptr to the OPT state
+ *  trace   ptr to the open trace
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+static cache_rv
+cache_repl_opt_scan(cache_repl_opt_t *state, cache_trace_t *trace)
+{
+    uint32_t                ref_id = 0;
+    uint32_t                iter = 0;
+    uint8_t                 offset_bits = state->tagstore->num_offset_bits;
+    mem_ref_t               mref;
+    cache_repl_opt_blk_t    *ent = NULL;
+
+    state->num_refs = cache_trace_count(trace);
+    state->next_use = malloc((state->num_refs + 1) * sizeof(uint32_t));
+    state->hash_mask = (CACHE_OPT_HASH_INIT - 1);
+    state->hash = calloc(CACHE_OPT_HASH_INIT, sizeof(*state->hash));
+    if ((!state->next_use) || (!state->hash))
+        return CACHE_RV_ERR;
+    memset(state->next_use, 0xff, ((state->num_refs + 1) * sizeof(uint32_t)));
+
+    memset(&mref, 0, sizeof(mref));
+    cache_trace_rewind(trace);
+    while ((ref_id < state->num_refs) && (cache_trace_next(trace, &mref))) {
+        ref_id += 1;
+
+        if ((state->hash_count * 2) >= state->hash_mask) {
+            if (CACHE_RV_OK != cache_repl_opt_grow(state))
+                return CACHE_RV_ERR;
+        }
+
+        ent = cache_repl_opt_lookup(state, (mref.ref_addr >> offset_bits),
+                TRUE);
+        if (ent->first)
+            state->next_use[ent->last] = ref_id;
+        else
+            ent->first = ref_id;
+        ent->last = ref_id;
+    }
+    cache_trace_rewind(trace);
+
+    /* From here on, last tracks the simulation. */
+    for (iter = 0; iter <= state->hash_mask; ++iter)
+        state->hash[iter].last = 0;
+
+    return CACHE_RV_OK;
+}
+
+
+static cache_rv
+cache_repl_opt_init(cache_tagstore_t *tagstore)
+{
+    uint32_t            set = 0;
+    uint32_t            way = 0;
+    uint32_t            num_ways = tagstore->num_blocks_per_set;
+    cache_repl_opt_t    *state = cache_arena_calloc(1, sizeof(*state));
+
+    if (!state)
+        return CACHE_RV_ERR;
+
+    tagstore->repl_state = state;
+    state->tagstore = tagstore;
+
+    /*
+     * Next uses are of the CPU reference stream, which only L1 sees. The
+     * lower levels see what L1 filters through, so they can't use OPT.
+     */
+    if (!CACHE_IS_L1(((cache_generic_t *) tagstore->cache))) {
+        dprint("Error: OPT replacement is only supported for L1.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if (g_num_cores > 1) {
+        dprint("Error: OPT replacement supports a single core only.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if ((!g_cache_trace) || (g_cache_trace->stream)) {
+        dprint("Error: OPT replacement needs a seekable trace file.\n");
+        return CACHE_RV_ERR;
+    }
+
+    state->key = cache_arena_calloc(tagstore->num_blocks, sizeof(uint32_t));
+    state->heap = cache_arena_calloc(tagstore->num_blocks, sizeof(uint32_t));
+    state->heap_pos = cache_arena_calloc(tagstore->num_blocks,
+            sizeof(uint32_t));
+    if ((!state->key) || (!state->heap) || (!state->heap_pos))
+        return CACHE_RV_ERR;
+
+    /* All keys are 0 to start with, so any order is a valid heap. */
+    for (set = 0; set < tagstore->num_sets; ++set) {
+        for (way = 0; way < num_ways; ++way) {
+            state->heap[(set * num_ways) + way] = way;
+            state->heap_pos[(set * num_ways) + way] = way;
+        }
+    }
+
+    if (CACHE_RV_OK != cache_repl_opt_scan(state, g_cache_trace))
+        return CACHE_RV_ERR;
+
+    state->next = g_cache_repl_opt_list;
+    g_cache_repl_opt_list = state;
+
+    return CACHE_RV_OK;
+}
+
+
+/*
+ * The next use and block hash arrays are sized by the trace and the hash
+ * grows during the scan, so they are kept out of the arena.
+ */
+static void
+cache_repl_opt_cleanup(cache_tagstore_t *tagstore)
+{
+    cache_repl_opt_t    *state = tagstore->repl_state;
+    cache_repl_opt_t    **prev = &g_cache_repl_opt_list;
+
+    if (!state)
+        return;
+
+    for (; *prev; prev = &(*prev)->next) {
+        if (*prev == state) {
+            *prev = state->next;
+            break;
+        }
+    }
+
+    free(state->next_use);
+    free(state->hash);
+    tagstore->repl_state = NULL;
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_opt_next_use
+ *
+ * Desc:    Returns the ref ID of the next use of the block in the given way,
+ *          after the current reference. Blocks of the current reference
+ *          are looked up directly; others (write backs, victim cache fills,
+ *          prefetches) through the block hash.
+ **************************************************************************/
+static uint32_t
+cache_repl_opt_next_use(cache_repl_opt_t *state, uint32_t set, uint32_t way)
+{
+    uint32_t                blk = 0;
+    mem_ref_t               mref;
+    cache_line_t            line;
+    cache_tagstore_t        *tagstore = state->tagstore;
+    cache_repl_opt_blk_t    *ent = NULL;
+
+    line.tag = tagstore->tags[(set * tagstore->num_blocks_per_set) + way];
+    line.index = set;
+    cache_util_encode_mem_addr(tagstore, &line, &mref);
+    blk = (mref.ref_addr >> tagstore->num_offset_bits);
+
+    if ((state->cur_ref) && (blk == state->cur_blk))
+        return state->next_use[state->cur_ref];
+
+    ent = cache_repl_opt_lookup(state, blk, FALSE);
+    if (!ent)
+        return CACHE_OPT_NEVER;
+
+    return (ent->last ? state->next_use[ent->last] : ent->first);
+}
+
+
+static void
+cache_repl_opt_heap_swap(cache_repl_opt_t *state, uint32_t base,
+        uint32_t a, uint32_t b)
+{
+    uint32_t    way_a = state->heap[base + a];
+    uint32_t    way_b = state->heap[base + b];
+
+    state->heap[base + a] = way_b;
+    state->heap[base + b] = way_a;
+    state->heap_pos[base + way_a] = b;
+    state->heap_pos[base + way_b] = a;
+}
+
+
+/* Restores the heap order after the key of the given way changed. */
+static void
+cache_repl_opt_heap_fix(cache_repl_opt_t *state, uint32_t set, uint32_t way)
+{
+    uint32_t    num_ways = state->tagstore->num_blocks_per_set;
+    uint32_t    base = (set * num_ways);
+    uint32_t    slot = state->heap_pos[base + way];
+    uint32_t    child = 0;
+    uint32_t    *heap = &state->heap[base];
+    uint32_t    *key = &state->key[base];
+
+    while ((slot) && (key[heap[(slot - 1) / 2]] < key[heap[slot]])) {
+        cache_repl_opt_heap_swap(state, base, slot, ((slot - 1) / 2));
+        slot = ((slot - 1) / 2);
+    }
+
+    for (;;) {
+        child = ((2 * slot) + 1);
+        if (child >= num_ways)
+            break;
+        if (((child + 1) < num_ways) &&
+                (key[heap[child + 1]] > key[heap[child]]))
+            child += 1;
+        if (key[heap[child]] <= key[heap[slot]])
+            break;
+        cache_repl_opt_heap_swap(state, base, slot, child);
+        slot = child;
+    }
+}
+
+
+static void
+cache_repl_opt_touch(cache_tagstore_t *tagstore, uint32_t set, uint32_t way)
+{
+    cache_repl_opt_t    *state = tagstore->repl_state;
+
+    state->key[(set * tagstore->num_blocks_per_set) + way] =
+        cache_repl_opt_next_use(state, set, way);
+    cache_repl_opt_heap_fix(state, set, way);
+}
+
+
+static uint32_t
+cache_repl_opt_victim(cache_tagstore_t *tagstore, uint32_t set)
+{
+    cache_repl_opt_t    *state = tagstore->repl_state;
+
+    return state->heap[set * tagstore->num_blocks_per_set];
+}
+
+
+static void
+cache_repl_opt_invalidate(cache_tagstore_t *tagstore, uint32_t set,
+        uint32_t way)
+{
+    cache_repl_opt_t    *state = tagstore->repl_state;
+
+    state->key[(set * tagstore->num_blocks_per_set) + way] = 0;
+    cache_repl_opt_heap_fix(state, set, way);
+}
+
+
+/* Policy implementations, indexed by CACHE_REPL_PLCY_*. */
+static const cache_repl_ops_t g_cache_repl_ops[] = {
+    { "lru", cache_repl_age_init, NULL,
+        cache_repl_lru_touch, cache_repl_lru_touch, cache_repl_lru_victim,
+        cache_repl_age_invalidate, cache_repl_sort_by_age },
+    { "lfu", cache_repl_lfu_init, NULL,
+        cache_repl_lfu_hit, cache_repl_lfu_fill, cache_repl_lfu_victim,
+        cache_repl_age_invalidate, cache_repl_sort_by_age },
+    { "fifo", cache_repl_age_init, NULL,
+        cache_repl_nop, cache_repl_fifo_fill, cache_repl_lru_victim,
+        cache_repl_age_invalidate, cache_repl_sort_by_age },
+    { "random", cache_repl_rand_init, NULL,
+        cache_repl_nop, cache_repl_nop, cache_repl_rand_victim,
+        cache_repl_nop, NULL },
+    { "plru-tree", cache_repl_tree_plru_init, NULL,
+        cache_repl_tree_plru_touch, cache_repl_tree_plru_touch,
+        cache_repl_tree_plru_victim, cache_repl_nop, NULL },
+    { "plru-bit", cache_repl_bit_plru_init, NULL,
+        cache_repl_bit_plru_touch, cache_repl_bit_plru_touch,
+        cache_repl_bit_plru_victim, cache_repl_bit_plru_invalidate, NULL },
+    { "srrip", cache_repl_rrip_init, NULL,
+        cache_repl_rrip_hit, cache_repl_srrip_fill, cache_repl_rrip_victim,
+        cache_repl_rrip_invalidate, NULL },
+    { "brrip", cache_repl_rrip_init, NULL,
+        cache_repl_rrip_hit, cache_repl_brrip_fill, cache_repl_rrip_victim,
+        cache_repl_rrip_invalidate, NULL },
+    { "opt", cache_repl_opt_init, cache_repl_opt_cleanup,
+        cache_repl_opt_touch, cache_repl_opt_touch, cache_repl_opt_victim,
+        cache_repl_opt_invalidate, NULL },
+};
+
+
+/* LRU for fully associative tagstores. */
+static const cache_repl_ops_t g_cache_repl_list_ops = {
+    "lru", cache_repl_list_init, NULL,
+    cache_repl_list_touch, cache_repl_list_touch, cache_repl_list_victim,
+    cache_repl_list_invalidate, cache_repl_list_order
+};
+
+
+/***************************************************************************
+ * Name:    cache_repl_init
+ *
+ * Desc:    Binds a replacement policy to the tagstore and allocates the
+ *          policy state. The tagstore geometry must be set up already.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  repl_plcy   CACHE_REPL_PLCY_*
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_repl_init(cache_tagstore_t *tagstore, uint8_t repl_plcy)
+{
+    if ((!tagstore) || (repl_plcy >= CACHE_REPL_PLCY_MAX)) {
+        cache_assert(0);
+        return CACHE_RV_ERR;
+    }
+
+    tagstore->repl = &g_cache_repl_ops[repl_plcy];
+    if ((CACHE_REPL_PLCY_LRU == repl_plcy) && (1 == tagstore->num_sets))
+        tagstore->repl = &g_cache_repl_list_ops;
+    tagstore->repl_state = NULL;
+    if (CACHE_RV_OK != tagstore->repl->init(tagstore)) {
+        cache_repl_cleanup(tagstore);
+        return CACHE_RV_ERR;
+    }
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_cleanup
+ *
+ * Desc:    Frees the replacement policy state of the tagstore that is not
+ *          part of the simulation arena.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_repl_cleanup(cache_tagstore_t *tagstore)
+{
+    if ((!tagstore) || (!tagstore->repl))
+        return;
+
+    if (tagstore->repl->cleanup)
+        tagstore->repl->cleanup(tagstore);
+    tagstore->repl = NULL;
+    tagstore->repl_state = NULL;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_order
+ *
+ * Desc:    Orders the valid ways of a set for the contents dump, as per
+ *          the policy; by way ID if the policy has no notion of recency.
+ *
+ * Params:
+ *  tagstore    ptr to the tagstore
+ *  set         set index
+ *  ways        ptr to the output way IDs (num_blocks_per_set entries)
+ *
+ * Returns: uint32_t
+ *  # of valid ways
+ **************************************************************************/
+uint32_t
+cache_repl_order(cache_tagstore_t *tagstore, uint32_t set, uint32_t *ways)
+{
+    uint32_t            way = 0;
+    uint32_t            count = 0;
+    cache_tag_data_t    *tag_data = NULL;
+
+    if (tagstore->repl->order)
+        return tagstore->repl->order(tagstore, set, ways);
+
+    tag_data = &tagstore->tag_data[set * tagstore->num_blocks_per_set];
+    for (way = 0; way < tagstore->num_blocks_per_set; ++way) {
+        if (tag_data[way].valid)
+            ways[count++] = way;
+    }
+
+    return count;
+}
+
+
+/***************************************************************************
+ * Name:    cache_repl_opt_tick
+ *
+ * Desc:    Per-reference hook for OPT. Records the reference as the latest
+ *          use of its block in every OPT tagstore. Does nothing unless a
+ *          level uses OPT replacement.
+ *
+ * Params:
+ *  mref    ptr to the current memory reference
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_repl_opt_tick(mem_ref_t *mref)
+{
+    cache_repl_opt_t        *state = NULL;
+    cache_repl_opt_blk_t    *ent = NULL;
+
+    for (state = g_cache_repl_opt_list; state; state = state->next) {
+        if (g_addr_count > state->num_refs)
+            continue;
+
+        state->cur_ref = g_addr_count;
+        state->cur_blk = (mref->ref_addr >> state->tagstore->num_offset_bits);
+        ent = cache_repl_opt_lookup(state, state->cur_blk, FALSE);
+        if (ent)
+            ent->last = g_addr_count;
+    }
+
+    return;
+}
@@ -0,0 +1,64 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the replacement policy interface. Every tagstore
+ * is bound to one policy at init; the policy keeps its own (per-set or
+ * per-block) state and the cache core only calls the hooks below.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_REPL_H_
+#define CACHE_REPL_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Replacement policy operations; one instance per policy */
+typedef struct cache_repl_ops__ {
+    const char  *name;
+    /* Allocates the policy state for the tagstore, from the arena. */
+    cache_rv    (*init)(cache_tagstore_t *tagstore);
+    /* Frees the state kept outside of the arena; NULL if there's none. */
+    void        (*cleanup)(cache_tagstore_t *tagstore);
+    /* A valid block was referenced. */
+    void        (*on_hit)(cache_tagstore_t *tagstore, uint32_t set,
+                    uint32_t way);
+    /* A new block was placed in the way. */
+    void        (*on_fill)(cache_tagstore_t *tagstore, uint32_t set,
+                    uint32_t way);
+    /*
+     * Picks the way to be replaced in a full set. Called only when the
+     * block is actually going to be replaced, so policies may update
+     * their state (eg. RRIP aging, LFU set count) here.
+     */
+    uint32_t    (*choose_victim)(cache_tagstore_t *tagstore, uint32_t set);
+    /* The block in the way was invalidated. */
+    void        (*on_invalidate)(cache_tagstore_t *tagstore, uint32_t set,
+                    uint32_t way);
+    /*
+     * Orders the valid ways of a set for the cache contents dump, most
+     * recently used first. NULL orders by way ID.
+     */
+    uint32_t    (*order)(cache_tagstore_t *tagstore, uint32_t set,
+                    uint32_t *ways);
+} cache_repl_ops_t;
+
+
+/* Externs */
+extern const char       *g_cache_repl_names[];
+
+
+/* Function declarations */
+cache_rv
+cache_repl_init(cache_tagstore_t *tagstore, uint8_t repl_plcy);
+void
+cache_repl_cleanup(cache_tagstore_t *tagstore);
+uint32_t
+cache_repl_order(cache_tagstore_t *tagstore, uint32_t set, uint32_t *ways);
+void
+cache_repl_opt_tick(mem_ref_t *mref);
+
+#endif /* CACHE_REPL_H_ */
+
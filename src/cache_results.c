@@ -0,0 +1,564 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module works out the derived metrics of a run and writes the
+ * machine readable results (--results=).
+ *
+ * A record has the cache configuration, the options given, every field of
+ * the L1, VC and L2 stats and the derived metrics, flattened into a fixed
+ * set of columns, so that the records of different configurations line up.
+ * Records are appended to the results file: as a JSON object per line, or
+ * as a CSV row, with a header line if the file is empty. A record is built
+ * in memory and goes out with a single write(), under an flock() of the
+ * file, so many runs, or many processes of a sweep, can append to it.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_model.h"
+#include "cache_results.h"
+
+/* Constants */
+#define CACHE_RESULTS_BUF_SIZE      8192    /* initial record buffer    */
+
+/* What a pass over the record fields emits */
+#define CACHE_RESULTS_EMIT_JSON     0   /* "name":value pairs           */
+#define CACHE_RESULTS_EMIT_HDR      1   /* CSV column names             */
+#define CACHE_RESULTS_EMIT_ROW      2   /* CSV values                   */
+
+#define CACHE_RESULTS_STAT(FIELD)                                       \
+    { #FIELD, offsetof(cache_stats_t, FIELD),                           \
+        sizeof(((cache_stats_t *) 0)->FIELD) }
+
+/* Stats field descriptor */
+typedef struct cache_results_stat__ {
+    const char  *name;
+    size_t      offset;                 /* offset within cache_stats_t  */
+    size_t      size;                   /* 4 or 8 bytes                 */
+} cache_results_stat_t;
+
+/* Globals */
+const char *g_cache_results_fmt_names[] = { "jsonl", "csv", NULL };
+
+static const cache_results_stat_t g_cache_results_stats[] = {
+    CACHE_RESULTS_STAT(num_swaps),
+    CACHE_RESULTS_STAT(num_reads),
+    CACHE_RESULTS_STAT(num_writes),
+    CACHE_RESULTS_STAT(num_read_hits),
+    CACHE_RESULTS_STAT(num_write_hits),
+    CACHE_RESULTS_STAT(num_read_misses),
+    CACHE_RESULTS_STAT(num_write_misses),
+    CACHE_RESULTS_STAT(num_write_backs),
+    CACHE_RESULTS_STAT(num_write_throughs),
+    CACHE_RESULTS_STAT(num_blk_mem_traffic),
+    CACHE_RESULTS_STAT(num_pf_issued),
+    CACHE_RESULTS_STAT(num_pf_useful),
+    CACHE_RESULTS_STAT(num_pf_late),
+    CACHE_RESULTS_STAT(num_pf_polluting),
+    CACHE_RESULTS_STAT(num_pf_fills),
+    CACHE_RESULTS_STAT(num_coh_invals),
+    CACHE_RESULTS_STAT(num_coh_downgrades),
+    CACHE_RESULTS_STAT(num_coh_upgrades),
+    CACHE_RESULTS_STAT(num_coh_write_backs),
+    CACHE_RESULTS_STAT(num_back_invals),
+    CACHE_RESULTS_STAT(num_back_inval_wbs),
+    CACHE_RESULTS_STAT(num_victim_fills),
+    CACHE_RESULTS_STAT(num_wbb_writes),
+    CACHE_RESULTS_STAT(num_wbb_coalesced),
+    CACHE_RESULTS_STAT(num_wbb_full_stalls),
+    CACHE_RESULTS_STAT(num_sector_misses),
+    CACHE_RESULTS_STAT(num_fill_bytes),
+    CACHE_RESULTS_STAT(num_wb_bytes),
+    { NULL, 0, 0 }
+};
+
+static int      g_res_fd = -1;          /* results file                 */
+static uint8_t  g_res_fmt;              /* CACHE_RESULTS_FMT_*          */
+static uint8_t  g_res_emit;             /* CACHE_RESULTS_EMIT_*         */
+static boolean  g_res_first;            /* no field emitted yet         */
+static char     *g_res_args = NULL;     /* options given, space joined  */
+static char     *g_res_buf = NULL;      /* record being built           */
+static size_t   g_res_len = 0;
+static size_t   g_res_size = 0;
+
+
+/***************************************************************************
+ * Name:    cache_results_calc
+ *
+ * Desc:    Works out the results of a run, as reported: the stats of every
+ *          level, the miss rates, the memory traffic and, with the hit
+ *          times and miss penalties of the technology model, the average
+ *          access time.
+ *
+ * Params:
+ *  cache   ptr to the (core 0) L1 cache
+ *  res     ptr to the results to fill in
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_results_calc(cache_generic_t *cache, cache_results_t *res)
+{
+    uint32_t            core = 0;
+    cache_generic_t     *l2 = NULL;
+    cache_model_point_t pt;
+
+    memset(res, 0, sizeof(*res));
+    for (core = 0; core < g_num_cores; ++core)
+        cache_util_add_stats(&res->l1, &cache_util_get_l1(core)->stats);
+
+    if (cache_util_is_victim_present()) {
+        res->vc_present = TRUE;
+        for (core = 0; core < g_num_cores; ++core)
+            cache_util_add_stats(&res->vc, &cache_util_get_vc(core)->stats);
+    }
+
+    if (cache_util_is_l2_present()) {
+        res->l2_present = TRUE;
+        l2 = cache_util_get_l2();
+        cache_util_add_stats(&res->l2, &l2->stats);
+    }
+
+    /*
+     * Calculation of avg. access time (from project web-page), with the
+     * hit times and miss penalties of the technology model. The defaults
+     * are the fixed parameters of the project:
+     *  1. L2 Miss_Penalty (in ns) = 20 ns + 0.5*(L2_BLOCKSIZE / 16 B/ns)
+     *      (in the case that there is only L1 cache, use
+     *      L1 miss penalty (in ns) = 20 ns + 0.5*(L1_BLOCKSIZE / 16 B/ns))
+     *  2. L1 Cache Hit Time (in ns) = 0.25ns + 2.5ns * (L1_Cache Size / 512kB)
+     *      + 0.025ns * (L1_BLOCKSIZE / 16B) + 0.025ns * L1_SET_ASSOCIATIVITY
+     * 3.  L2 Cache Hit Time (in ns) = 2.5ns + 2.5ns * (L2_Cache Size / 512kB)
+     *      + 0.025ns * (L2_BLOCKSIZE / 16B) + 0.025ns * L2_SET_ASSOCIATIVITY
+     * 4.  Area Budget = 512kB for both L1 and L2 Caches
+     * 5. Average access time =  HTL1 + (MRL1 *(HTL2+MRL2*Miss PenaltyL2))
+     */
+    res->l1_miss_rate =
+       ((double) (res->l1.num_read_misses + res->l1.num_write_misses) /
+        (double) (res->l1.num_reads + res->l1.num_writes));
+    g_cache_model->level(cache, &pt);
+    res->l1_hit_time = pt.lat_ns;
+
+    if (res->l2_present) {
+        /* Only read misses are to be accounted for. */
+        res->l2_miss_rate =
+            ((double) (res->l2.num_read_misses) /
+                (double) (res->l2.num_reads));
+        g_cache_model->level(l2, &pt);
+        res->l2_hit_time = pt.lat_ns;
+        g_cache_model->mem(l2->blk_size, &pt);
+        res->miss_penalty = pt.lat_ns;
+        res->avg_access_time = (res->l1_hit_time + (res->l1_miss_rate *
+                    (res->l2_hit_time +
+                     (res->l2_miss_rate * res->miss_penalty))));
+    } else {
+        g_cache_model->mem(cache->blk_size, &pt);
+        res->miss_penalty = pt.lat_ns;
+        res->avg_access_time = (res->l1_hit_time +
+            (res->l1_miss_rate * res->miss_penalty));
+    }
+
+    /*
+     * Blocks prefetched by the last level cache are read from memory as
+     * well. Prefetch fills of L1 (over L2) show up as L2 misses. A WTNA
+     * L2 fills nothing on a write miss, but writes every write through.
+     */
+    if (res->l2_present) {
+        res->total_traffic = (res->l2.num_read_misses +
+                              res->l2.num_write_backs +
+                              res->l2.num_pf_fills);
+        res->total_traffic += ((CACHE_WRITE_PLCY_WTNA == l2->write_plcy) ?
+                res->l2.num_write_throughs : res->l2.num_write_misses);
+    } else if (res->vc_present) {
+        res->total_traffic = (res->l1.num_read_misses +
+                              res->l1.num_write_misses +
+                              res->vc.num_write_backs +
+                              res->l1.num_pf_fills);
+    } else {
+        res->total_traffic = res->l1.num_blk_mem_traffic;
+    }
+
+    /* Without L2, blocks flushed for coherence go to memory as well. */
+    if (!res->l2_present) {
+        res->total_traffic += res->l1.num_coh_write_backs;
+        if (res->vc_present)
+            res->total_traffic += res->vc.num_coh_write_backs;
+    }
+
+    /*
+     * The same transfers in bytes; they add up blocks of the last level,
+     * or the sectors of them that were moved.
+     */
+    if (res->l2_present) {
+        res->total_bytes = (res->l2.num_fill_bytes + res->l2.num_wb_bytes);
+    } else {
+        res->total_bytes = (res->l1.num_fill_bytes +
+                ((uint64_t) cache->blk_size * (res->l1.num_coh_write_backs +
+                                               res->vc.num_coh_write_backs)));
+        res->total_bytes += (res->vc_present ? res->vc.num_wb_bytes :
+                res->l1.num_wb_bytes);
+    }
+
+    if (g_cache_model->has_cost) {
+        cache_model_get_cost(&res->l1, (res->vc_present ? &res->vc : NULL),
+                res->total_traffic, &res->cost);
+    }
+
+    return;
+}
+
+
+/* Appends formatted text to the record being built. */
+static boolean
+cache_results_printf(const char *fmt, ...)
+{
+    int         len = 0;
+    size_t      size = 0;
+    char        *buf = NULL;
+    va_list     args;
+
+    for (;;) {
+        va_start(args, fmt);
+        len = vsnprintf((g_res_buf + g_res_len), (g_res_size - g_res_len),
+                fmt, args);
+        va_end(args);
+        if (len < 0)
+            return FALSE;
+        if ((g_res_len + len) < g_res_size)
+            break;
+
+        size = (2 * (g_res_size + len));
+        buf = realloc(g_res_buf, size);
+        if (!buf)
+            return FALSE;
+        g_res_buf = buf;
+        g_res_size = size;
+    }
+    g_res_len += len;
+
+    return TRUE;
+}
+
+
+/* Emits the separator before a field, and its name as needed. */
+static void
+cache_results_put_name(const char *prefix, const char *name)
+{
+    if (!g_res_first)
+        cache_results_printf(",");
+    g_res_first = FALSE;
+
+    if (CACHE_RESULTS_EMIT_JSON == g_res_emit)
+        cache_results_printf("\"%s%s\":", prefix, name);
+    else if (CACHE_RESULTS_EMIT_HDR == g_res_emit)
+        cache_results_printf("%s%s", prefix, name);
+
+    return;
+}
+
+
+/* Emits a string field; quoted and escaped for JSON and CSV alike. */
+static void
+cache_results_put_str(const char *name, const char *val)
+{
+    const char  *iter = NULL;
+
+    cache_results_put_name("", name);
+    if (CACHE_RESULTS_EMIT_HDR == g_res_emit)
+        return;
+
+    cache_results_printf("\"");
+    for (iter = val; *iter; ++iter) {
+        if ('"' == *iter) {
+            cache_results_printf((CACHE_RESULTS_EMIT_JSON == g_res_emit) ?
+                    "\\\"" : "\"\"");
+        } else if (('\\' == *iter) && (CACHE_RESULTS_EMIT_JSON == g_res_emit)) {
+            cache_results_printf("\\\\");
+        } else if (((unsigned char) *iter) < 0x20) {
+            cache_results_printf(" ");
+        } else {
+            cache_results_printf("%c", *iter);
+        }
+    }
+    cache_results_printf("\"");
+
+    return;
+}
+
+
+/* Emits an unsigned integer field. */
+static void
+cache_results_put_uint(const char *prefix, const char *name, uint64_t val)
+{
+    cache_results_put_name(prefix, name);
+    if (CACHE_RESULTS_EMIT_HDR != g_res_emit)
+        cache_results_printf("%lu", val);
+
+    return;
+}
+
+
+/* Emits a real field; null (JSON) or empty (CSV) if not a number. */
+static void
+cache_results_put_double(const char *name, double val)
+{
+    cache_results_put_name("", name);
+    if (CACHE_RESULTS_EMIT_HDR == g_res_emit)
+        return;
+
+    if (isfinite(val))
+        cache_results_printf("%.10g", val);
+    else if (CACHE_RESULTS_EMIT_JSON == g_res_emit)
+        cache_results_printf("null");
+
+    return;
+}
+
+
+/* Emits every field of the stats of a level, prefixed with its name. */
+static void
+cache_results_put_stats(const char *prefix, cache_stats_t *stats)
+{
+    uint64_t                    val = 0;
+    const uint8_t               *base = (const uint8_t *) stats;
+    const cache_results_stat_t  *desc = NULL;
+
+    for (desc = g_cache_results_stats; desc->name; ++desc) {
+        if (sizeof(uint64_t) == desc->size)
+            val = *((const uint64_t *) (base + desc->offset));
+        else
+            val = *((const uint32_t *) (base + desc->offset));
+        cache_results_put_uint(prefix, desc->name, val);
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_results_put_record
+ *
+ * Desc:    Emits all the fields of a record, in the current emit mode, into
+ *          the record buffer. The same pass gives the CSV header, so the
+ *          columns always match the values.
+ *
+ * Params:
+ *  cache   ptr to the (core 0) L1 cache
+ *  res     ptr to the results of the run
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_results_put_record(cache_generic_t *cache, cache_results_t *res)
+{
+    cache_generic_t *l2 = (res->l2_present ? cache_util_get_l2() : NULL);
+
+    g_res_first = TRUE;
+    if (CACHE_RESULTS_EMIT_JSON == g_res_emit)
+        cache_results_printf("{");
+
+    /* Configuration */
+    cache_results_put_str("trace", cache->trace_file);
+    cache_results_put_str("args", (g_res_args ? g_res_args : ""));
+    cache_results_put_uint("", "blk_size", cache->blk_size);
+    cache_results_put_uint("", "l1_size", cache->size);
+    cache_results_put_uint("", "l1_assoc", cache->set_assoc);
+    cache_results_put_uint("", "vc_size", cache->victim_size);
+    cache_results_put_uint("", "l2_size", (l2 ? l2->size : 0));
+    cache_results_put_uint("", "l2_assoc", (l2 ? l2->set_assoc : 0));
+    cache_results_put_uint("", "l2_blk_size", (l2 ? l2->blk_size : 0));
+    cache_results_put_uint("", "cores", g_num_cores);
+
+    /* Stats */
+    cache_results_put_stats("l1_", &res->l1);
+    cache_results_put_stats("vc_", &res->vc);
+    cache_results_put_stats("l2_", &res->l2);
+
+    /* Derived metrics */
+    cache_results_put_double("l1_miss_rate", res->l1_miss_rate);
+    cache_results_put_double("l2_miss_rate", res->l2_miss_rate);
+    cache_results_put_double("l1_hit_time_ns", res->l1_hit_time);
+    cache_results_put_double("l2_hit_time_ns", res->l2_hit_time);
+    cache_results_put_double("miss_penalty_ns", res->miss_penalty);
+    cache_results_put_double("avg_access_time_ns", res->avg_access_time);
+    cache_results_put_uint("", "total_mem_traffic", res->total_traffic);
+    cache_results_put_uint("", "total_mem_bytes", res->total_bytes);
+    cache_results_put_str("model", g_cache_model->name);
+    cache_results_put_double("energy_nj",
+            (g_cache_model->has_cost ? res->cost.energy_nj : NAN));
+    cache_results_put_double("area_mm2",
+            (g_cache_model->has_cost ? res->cost.area_mm2 : NAN));
+
+    if (CACHE_RESULTS_EMIT_JSON == g_res_emit)
+        cache_results_printf("}");
+    cache_results_printf("\n");
+
+    return;
+}
+
+
+/* Writes out the record buffer with a single write, if possible. */
+static cache_rv
+cache_results_flush(void)
+{
+    size_t      done = 0;
+    ssize_t     rv = 0;
+
+    while (done < g_res_len) {
+        rv = write(g_res_fd, (g_res_buf + done), (g_res_len - done));
+        if (rv < 0) {
+            if (EINTR == errno)
+                continue;
+            dprint("Error: Unable to write the results file %s.\n",
+                    g_cache_opts.results_file);
+            return CACHE_RV_ERR;
+        }
+        done += rv;
+    }
+    g_res_len = 0;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_results_open
+ *
+ * Desc:    Opens the results file of --results=, for appending, and keeps
+ *          a copy of the options given for the records.
+ *
+ * Params:
+ *  nopts   # of option arguments
+ *  opts    ptr to the option arguments
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK if no results file is asked for or on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_results_open(int nopts, char **opts)
+{
+    int         iter = 0;
+    size_t      len = 1;
+
+    if (!g_cache_opts.results_file[0])
+        return CACHE_RV_OK;
+
+    g_res_fmt = g_cache_opts.results_fmt;
+    g_res_fd = open(g_cache_opts.results_file,
+            (O_WRONLY | O_CREAT | O_APPEND), 0644);
+    if (g_res_fd < 0) {
+        dprint("Error: Unable to open results file %s.\n",
+                g_cache_opts.results_file);
+        return CACHE_RV_ERR;
+    }
+
+    for (iter = 0; iter < nopts; ++iter)
+        len += (strlen(opts[iter]) + 1);
+    g_res_args = calloc(1, len);
+    g_res_size = CACHE_RESULTS_BUF_SIZE;
+    g_res_buf = malloc(g_res_size);
+    if ((!g_res_args) || (!g_res_buf)) {
+        dprint("Error: Unable to allocate memory for the results.\n");
+        cache_results_close();
+        return CACHE_RV_ERR;
+    }
+
+    for (iter = 0; iter < nopts; ++iter) {
+        if (iter)
+            strcat(g_res_args, " ");
+        strcat(g_res_args, opts[iter]);
+    }
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_results_write
+ *
+ * Desc:    Appends the record of a run to the results file, if any; CSV
+ *          files get a header line first if they are empty. The file is
+ *          locked from the check for empty through the write, so only one
+ *          of the processes sharing a new file writes the header.
+ *
+ * Params:
+ *  cache   ptr to the (core 0) L1 cache
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK if no results file is asked for or on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_results_write(cache_generic_t *cache)
+{
+    struct stat     st;
+    cache_results_t res;
+    cache_rv        rv = CACHE_RV_OK;
+
+    if (g_res_fd < 0)
+        return CACHE_RV_OK;
+
+    cache_results_calc(cache, &res);
+
+    while (flock(g_res_fd, LOCK_EX)) {
+        if (EINTR != errno) {
+            dprint("Error: Unable to lock the results file %s.\n",
+                    g_cache_opts.results_file);
+            return CACHE_RV_ERR;
+        }
+    }
+
+    g_res_len = 0;
+    if (CACHE_RESULTS_FMT_JSONL == g_res_fmt) {
+        g_res_emit = CACHE_RESULTS_EMIT_JSON;
+    } else {
+        if ((!fstat(g_res_fd, &st)) && (!st.st_size)) {
+            g_res_emit = CACHE_RESULTS_EMIT_HDR;
+            cache_results_put_record(cache, &res);
+        }
+        g_res_emit = CACHE_RESULTS_EMIT_ROW;
+    }
+    cache_results_put_record(cache, &res);
+
+    rv = cache_results_flush();
+    flock(g_res_fd, LOCK_UN);
+
+    return rv;
+}
+
+
+/* Closes the results file, if any. */
+void
+cache_results_close(void)
+{
+    if (g_res_fd >= 0)
+        close(g_res_fd);
+    g_res_fd = -1;
+
+    free(g_res_args);
+    g_res_args = NULL;
+    free(g_res_buf);
+    g_res_buf = NULL;
+    g_res_len = 0;
+    g_res_size = 0;
+
+    return;
+}
@@ -0,0 +1,56 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the simulation results: the derived metrics of the report, and their
+ * machine readable output as JSON lines or CSV rows, one record per run.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_RESULTS_H_
+#define CACHE_RESULTS_H_
+
+#include <stdint.h>
+#include "cache.h"
+#include "cache_model.h"
+
+/* Constants */
+#define CACHE_RESULTS_FMT_JSONL     0
+#define CACHE_RESULTS_FMT_CSV       1
+
+/* Results of a run; L1 and VC numbers are summed over all the cores */
+typedef struct cache_results__ {
+    cache_stats_t       l1;             /* L1 stats                     */
+    cache_stats_t       vc;             /* VC stats; 0s if no VC        */
+    cache_stats_t       l2;             /* L2 stats; 0s if no L2        */
+    boolean             vc_present;
+    boolean             l2_present;
+    double              l1_miss_rate;
+    double              l2_miss_rate;   /* read misses only             */
+    double              l1_hit_time;    /* ns, as per the model         */
+    double              l2_hit_time;    /* ns, as per the model         */
+    double              miss_penalty;   /* ns, of the last level        */
+    double              avg_access_time;    /* ns                       */
+    uint32_t            total_traffic;  /* blks to and from memory      */
+    uint64_t            total_bytes;    /* bytes to and from memory     */
+    cache_model_cost_t  cost;           /* if the model has cost        */
+} cache_results_t;
+
+
+/* Externs */
+extern const char       *g_cache_results_fmt_names[];
+
+
+/* Function declarations */
+void
+cache_results_calc(cache_generic_t *cache, cache_results_t *res);
+cache_rv
+cache_results_open(int nopts, char **opts);
+cache_rv
+cache_results_write(cache_generic_t *cache);
+void
+cache_results_close(void);
+
+#endif /* CACHE_RESULTS_H_ */
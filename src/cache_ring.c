@@ -0,0 +1,372 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the lock-free SPSC ring of reference batches and
+ * the trace reader thread.
+ *
+ * The producer fills the batch at the tail and publishes it by bumping
+ * tail with release order; the consumer reads the batch at the head and
+ * frees it by bumping head the same way. Neither side ever writes the
+ * other's index, so no locks are needed. A full ring stalls the producer
+ * (backpressure) and an empty one the consumer; both spin for a while and
+ * then yield the CPU, as the other side may need it to make progress.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_trace.h"
+#include "cache_ring.h"
+
+/* Globals */
+cache_ring_t        *g_cache_reader;    /* NULL unless parsing is pipelined */
+
+
+/* Waits a little for the other side of the ring. */
+static void
+cache_ring_wait(uint32_t *spins)
+{
+    if (*spins < CACHE_RING_SPINS)
+        *spins += 1;
+    else
+        sched_yield();
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ring_create
+ *
+ * Desc:    Allocates an empty ring.
+ *
+ * Params:
+ *  num_slots   # of batches in the ring; a power of 2, up to
+ *              CACHE_RING_MAX_SLOTS
+ *
+ * Returns: cache_ring_t *
+ *  ptr to the ring on success
+ *  NULL otherwise
+ **************************************************************************/
+cache_ring_t *
+cache_ring_create(uint32_t num_slots)
+{
+    cache_ring_t    *ring = NULL;
+
+    if ((!util_is_power_of_2(num_slots)) ||
+            (num_slots > CACHE_RING_MAX_SLOTS)) {
+        cache_assert(0);
+        return NULL;
+    }
+
+    ring = calloc(1, sizeof(*ring));
+    if (!ring)
+        return NULL;
+
+    ring->slots = calloc(num_slots, sizeof(cache_ring_batch_t));
+    if (!ring->slots) {
+        free(ring);
+        return NULL;
+    }
+    ring->num_slots = num_slots;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->closed, 0);
+    atomic_init(&ring->aborted, 0);
+
+    return ring;
+}
+
+
+/* Frees the ring; both sides must be done with it. */
+void
+cache_ring_destroy(cache_ring_t *ring)
+{
+    if (!ring)
+        return;
+
+    free(ring->slots);
+    free(ring);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ring_get_free
+ *
+ * Desc:    Producer side. Returns the next batch to fill, waiting while the
+ *          ring is full. The batch is handed over with cache_ring_push.
+ *
+ * Params:
+ *  ring    ptr to the ring
+ *
+ * Returns: cache_ring_batch_t *
+ *  ptr to an empty batch
+ *  NULL if the consumer gave up
+ **************************************************************************/
+cache_ring_batch_t *
+cache_ring_get_free(cache_ring_t *ring)
+{
+    uint32_t            spins = 0;
+    boolean             waited = FALSE;
+    uint64_t            tail = 0;
+    cache_ring_batch_t  *batch = NULL;
+
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while ((tail - atomic_load_explicit(&ring->head, memory_order_acquire))
+            >= ring->num_slots) {
+        if (atomic_load_explicit(&ring->aborted, memory_order_relaxed))
+            return NULL;
+        if (!waited) {
+            ring->num_full_waits += 1;
+            waited = TRUE;
+        }
+        cache_ring_wait(&spins);
+    }
+
+    batch = &ring->slots[tail & (ring->num_slots - 1)];
+    batch->count = 0;
+
+    return batch;
+}
+
+
+/* Producer side. Publishes the batch returned by cache_ring_get_free. */
+void
+cache_ring_push(cache_ring_t *ring)
+{
+    atomic_fetch_add_explicit(&ring->tail, 1, memory_order_release);
+
+    return;
+}
+
+
+/* Producer side. No more batches will be pushed. */
+void
+cache_ring_close(cache_ring_t *ring)
+{
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ring_peek
+ *
+ * Desc:    Consumer side. Returns the oldest batch, waiting while the ring
+ *          is empty. The batch is freed with cache_ring_pop.
+ *
+ * Params:
+ *  ring    ptr to the ring
+ *
+ * Returns: cache_ring_batch_t *
+ *  ptr to the oldest batch
+ *  NULL if the ring is empty and closed
+ **************************************************************************/
+cache_ring_batch_t *
+cache_ring_peek(cache_ring_t *ring)
+{
+    uint32_t    spins = 0;
+    boolean     waited = FALSE;
+    uint64_t    head = 0;
+    uint64_t    tail = 0;
+
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (head == (tail = atomic_load_explicit(&ring->tail,
+                    memory_order_acquire))) {
+        /* Closed after the last push; recheck the tail once. */
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            if (head == atomic_load_explicit(&ring->tail,
+                        memory_order_acquire))
+                return NULL;
+            continue;
+        }
+        if (!waited) {
+            ring->num_empty_waits += 1;
+            waited = TRUE;
+        }
+        cache_ring_wait(&spins);
+    }
+
+    ring->hist[tail - head] += 1;
+
+    return &ring->slots[head & (ring->num_slots - 1)];
+}
+
+
+/* Consumer side. Frees the batch returned by cache_ring_peek. */
+void
+cache_ring_pop(cache_ring_t *ring)
+{
+    uint64_t    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    ring->num_batches += 1;
+    ring->num_refs += ring->slots[head & (ring->num_slots - 1)].count;
+    atomic_store_explicit(&ring->head, (head + 1), memory_order_release);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ring_reader_main
+ *
+ * Desc:    Thread body of the trace reader. Parses the trace into batches
+ *          until the end of the trace, or until the consumer gives up. A
+ *          batch of a stream goes out early, rather than wait for the
+ *          writer, so a live trace is simulated as it comes.
+ *
+ * Params:
+ *  arg     ptr to the ring to fill
+ *
+ * Returns: void *
+ *  NULL always
+ **************************************************************************/
+static void *
+cache_ring_reader_main(void *arg)
+{
+    boolean             more = TRUE;
+    cache_ring_t        *ring = arg;
+    cache_ring_batch_t  *batch = NULL;
+
+    while ((more) && (batch = cache_ring_get_free(ring))) {
+        while ((batch->count < CACHE_RING_BATCH_REFS) &&
+                ((!batch->count) || (cache_trace_ready(g_cache_trace))) &&
+                (more = cache_trace_next(g_cache_trace,
+                                         &batch->refs[batch->count])))
+            batch->count += 1;
+
+        if (batch->count)
+            cache_ring_push(ring);
+    }
+    cache_ring_close(ring);
+
+    return NULL;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ring_reader_start
+ *
+ * Desc:    Starts the trace reader thread on g_cache_trace, unless parsing
+ *          is inline (--pipeline=off). To be called right before the first
+ *          cache_ring_reader_next.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success or if parsing is inline
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_ring_reader_start(void)
+{
+    cache_ring_t    *ring = NULL;
+
+    if (CACHE_PIPELINE_OFF == g_cache_opts.pipeline)
+        return CACHE_RV_OK;
+
+    ring = cache_ring_create(CACHE_RING_READER_SLOTS);
+    if (!ring) {
+        dprint("Error: Unable to allocate memory for the trace reader.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if (pthread_create(&ring->thread, NULL, cache_ring_reader_main, ring)) {
+        dprint("Error: Unable to start the trace reader thread.\n");
+        cache_ring_destroy(ring);
+        return CACHE_RV_ERR;
+    }
+    ring->started = TRUE;
+    g_cache_reader = ring;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ring_reader_next
+ *
+ * Desc:    Returns the next reference of the trace, from the reader thread
+ *          if there is one, or straight from the trace otherwise.
+ *
+ * Params:
+ *  mref    ptr to the reference to fill in
+ *
+ * Returns: boolean
+ *  TRUE if a reference was read, FALSE at the end of the trace
+ **************************************************************************/
+boolean
+cache_ring_reader_next(mem_ref_t *mref)
+{
+    cache_ring_t    *ring = g_cache_reader;
+
+    if (!ring)
+        return cache_trace_next(g_cache_trace, mref);
+
+    if ((ring->cur) && (ring->pos == ring->cur->count)) {
+        cache_ring_pop(ring);
+        ring->cur = NULL;
+    }
+
+    if (!ring->cur) {
+        ring->cur = cache_ring_peek(ring);
+        ring->pos = 0;
+        if (!ring->cur)
+            return FALSE;
+    }
+
+    *mref = ring->cur->refs[ring->pos++];
+
+    return TRUE;
+}
+
+
+/***************************************************************************
+ * Name:    cache_ring_reader_stop
+ *
+ * Desc:    Stops the trace reader thread, if it's running, and waits for
+ *          it. The ring and its metrics stay around for printing.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_ring_reader_stop(void)
+{
+    cache_ring_t    *ring = g_cache_reader;
+
+    if ((!ring) || (!ring->started))
+        return;
+
+    atomic_store_explicit(&ring->aborted, 1, memory_order_relaxed);
+    pthread_join(ring->thread, NULL);
+    ring->started = FALSE;
+
+    return;
+}
+
+
+/* Stops the trace reader, if any, and frees its ring. */
+void
+cache_ring_reader_cleanup(void)
+{
+    cache_ring_reader_stop();
+    cache_ring_destroy(g_cache_reader);
+    g_cache_reader = NULL;
+
+    return;
+}
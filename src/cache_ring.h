@@ -0,0 +1,106 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the lock-free single producer, single consumer ring of reference
+ * batches, and for the trace reader thread built on it. The reader parses
+ * the trace into batches while the simulation consumes them, so the
+ * parsing cost hides behind the simulation.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_RING_H_
+#define CACHE_RING_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_PIPELINE_ON           0   /* parse on a reader thread     */
+#define CACHE_PIPELINE_OFF          1   /* parse inline                 */
+#define CACHE_PIPELINE_STATS        2   /* on, and print the ring stats */
+
+#define CACHE_RING_BATCH_REFS       1024    /* refs per batch           */
+#define CACHE_RING_MAX_SLOTS        64      /* batches per ring, max    */
+#define CACHE_RING_READER_SLOTS     32      /* batches of the reader    */
+#define CACHE_RING_SPINS            64      /* spins before yielding    */
+#define CACHE_RING_PAD              64      /* cache line size          */
+
+/* A batch of references, in trace order */
+typedef struct cache_ring_batch__ {
+    uint32_t            count;          /* # of refs in the batch       */
+    mem_ref_t           refs[CACHE_RING_BATCH_REFS];
+} cache_ring_batch_t;
+
+/*
+ * SPSC ring of batches. head and tail only grow and are each written by
+ * one side only; the slot being filled by the producer is
+ * slots[tail % num_slots], the one being read by the consumer is
+ * slots[head % num_slots]. Both are on cache lines of their own.
+ */
+typedef struct cache_ring__ {
+    uint32_t            num_slots;      /* # of batches; power of 2     */
+    cache_ring_batch_t  *slots;
+    char                pad0[CACHE_RING_PAD];
+    atomic_uint_fast64_t head;          /* # of batches consumed        */
+    char                pad1[CACHE_RING_PAD];
+    atomic_uint_fast64_t tail;          /* # of batches produced        */
+    char                pad2[CACHE_RING_PAD];
+    atomic_int          closed;         /* producer is done             */
+    atomic_int          aborted;        /* consumer gave up             */
+
+    /* Consumer side of cache_ring_next */
+    cache_ring_batch_t  *cur;           /* batch being read, or NULL    */
+    uint32_t            pos;            /* next ref in the batch        */
+
+    /* Trace reader thread, if the ring has one */
+    pthread_t           thread;
+    boolean             started;
+
+    /*
+     * Backpressure metrics. Full waits are producer stalls (consumer is
+     * the bottleneck), empty waits are consumer stalls (producer is the
+     * bottleneck). hist[n] counts the batches consumed while n batches
+     * were ready, including the one consumed.
+     */
+    uint64_t            num_batches;    /* # of batches consumed        */
+    uint64_t            num_refs;       /* # of refs consumed           */
+    uint64_t            num_full_waits; /* # of times the ring was full */
+    uint64_t            num_empty_waits;/* # of times it was empty      */
+    uint64_t            hist[CACHE_RING_MAX_SLOTS + 1];
+} cache_ring_t;
+
+
+/* Externs */
+extern cache_ring_t     *g_cache_reader;
+
+
+/* Function declarations */
+cache_ring_t *
+cache_ring_create(uint32_t num_slots);
+void
+cache_ring_destroy(cache_ring_t *ring);
+cache_ring_batch_t *
+cache_ring_get_free(cache_ring_t *ring);
+void
+cache_ring_push(cache_ring_t *ring);
+void
+cache_ring_close(cache_ring_t *ring);
+cache_ring_batch_t *
+cache_ring_peek(cache_ring_t *ring);
+void
+cache_ring_pop(cache_ring_t *ring);
+cache_rv
+cache_ring_reader_start(void);
+boolean
+cache_ring_reader_next(mem_ref_t *mref);
+void
+cache_ring_reader_stop(void);
+void
+cache_ring_reader_cleanup(void);
+
+#endif /* CACHE_RING_H_ */
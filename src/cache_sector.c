@@ -0,0 +1,109 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module sets up the sectored caches.
+ *
+ * The sector state lives in the tagstore, next to the tag data: a valid
+ * and a dirty mask per block, with a bit per sector. A reference that
+ * finds its tag but not all of its sectors is a sector miss; it fetches
+ * the missing sectors from the next level without evicting anything. A
+ * fill of a new tag brings in only the sectors asked for, and a dirty
+ * block is written back as a single request that carries just its dirty
+ * sectors. Caches that are not sectored are handled as having a single
+ * sector, the block.
+ *
+ * Requests between the levels carry the # of bytes they cover, so that a
+ * sectored L2 knows which of its sectors an L1 fill or write back needs.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_incl.h"
+#include "cache_sector.h"
+
+/* Globals */
+boolean         g_cache_sector_on = FALSE;  /* any level is sectored    */
+
+
+/* Checks the # of sectors asked for a cache; 0 and 1 mean none. */
+static boolean
+cache_sector_check(cache_generic_t *cache, uint32_t sectors)
+{
+    if (sectors <= 1)
+        return TRUE;
+
+    if ((sectors > CACHE_SECTOR_MAX) || (!util_is_power_of_2(sectors)) ||
+            ((cache->blk_size / sectors) < CACHE_SECTOR_MIN_SIZE)) {
+        dprint("Error: %s sectors must be a power of 2, up to %u, and at "
+                "least %u bytes each.\n", CACHE_GET_NAME(cache),
+                CACHE_SECTOR_MAX, CACHE_SECTOR_MIN_SIZE);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/***************************************************************************
+ * Name:    cache_sector_init
+ *
+ * Desc:    Sets the # of sectors per block of L1 and L2 as per the user
+ *          given level options. The VC swaps whole blocks with L1, so a
+ *          sectored L1 needs no VC; and the exclusive L2 moves whole blocks
+ *          between the levels, so it can't be used with sectors at all.
+ *          Must be called before the tagstores are set up.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR on an unsupported configuration
+ **************************************************************************/
+cache_rv
+cache_sector_init(void)
+{
+    uint32_t    core = 0;
+    uint32_t    l1_sectors = g_cache_opts.level[CACHE_OPTS_L1].sectors;
+    uint32_t    l2_sectors = g_cache_opts.level[CACHE_OPTS_L2].sectors;
+
+    if ((l1_sectors <= 1) && (l2_sectors <= 1))
+        return CACHE_RV_OK;
+
+    if ((l2_sectors > 1) && (!cache_util_is_l2_present())) {
+        dprint("Error: --l2-sectors needs an L2 cache.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if ((l1_sectors > 1) && (cache_util_is_victim_present())) {
+        dprint("Error: --l1-sectors can't be used with a victim cache.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if (CACHE_INCL_EXCLUSIVE == g_cache_incl) {
+        dprint("Error: Sectored caches can't be used with "
+                "--inclusion=exclusive.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if ((!cache_sector_check(cache_util_get_l1(0), l1_sectors)) ||
+            ((cache_util_is_l2_present()) &&
+             (!cache_sector_check(cache_util_get_l2(), l2_sectors))))
+        return CACHE_RV_ERR;
+
+    for (core = 0; core < g_num_cores; ++core)
+        cache_util_get_l1(core)->num_sectors = l1_sectors;
+    if (cache_util_is_l2_present())
+        cache_util_get_l2()->num_sectors = l2_sectors;
+    g_cache_sector_on = TRUE;
+
+    return CACHE_RV_OK;
+}
@@ -0,0 +1,99 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the constants and function declarations for the
+ * sectored (sub-blocked) caches. A tag of a sectored cache covers the
+ * whole block, but the block is split into sectors with a valid and a
+ * dirty bit each; a miss fetches only the sectors asked for, and a write
+ * back writes only the dirty ones.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_SECTOR_H_
+#define CACHE_SECTOR_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_SECTOR_MAX            32  /* sectors per block; mask bits */
+#define CACHE_SECTOR_MIN_SIZE       4   /* min. sector size in bytes    */
+
+/* Bytes covered by a mask of sectors */
+#define CACHE_SECTOR_BYTES(TS, MASK)                                    \
+    (((uint64_t) __builtin_popcount(MASK)) << (TS)->num_sector_bits)
+
+
+/* Externs */
+extern boolean          g_cache_sector_on;
+
+
+/* Function declarations */
+cache_rv
+cache_sector_init(void);
+
+
+/* Returns the mask of all the sectors of a block; 1 if not sectored. */
+static inline uint32_t
+cache_sector_all(cache_tagstore_t *tagstore)
+{
+    return ((uint32_t) ((1ULL << (1U << (tagstore->num_offset_bits -
+                            tagstore->num_sector_bits))) - 1));
+}
+
+
+/*
+ * Returns the mask of the sectors of its block that a reference covers;
+ * 1 if not sectored. Requests from a previous level cover 2^ref_size_bits
+ * bytes, aligned; trace references (size bits 0) cover a single byte.
+ */
+static inline uint32_t
+cache_sector_mask(cache_tagstore_t *tagstore, mem_ref_t *mref)
+{
+    uint8_t     size_bits = mref->ref_size_bits;
+    uint8_t     sec_bits = tagstore->num_sector_bits;
+    uint32_t    first = 0;
+    uint32_t    count = 1;
+
+    if (!tagstore->sec_valid)
+        return 1;
+
+    if (size_bits > tagstore->num_offset_bits)
+        size_bits = tagstore->num_offset_bits;
+    if (size_bits > sec_bits)
+        count = (1U << (size_bits - sec_bits));
+
+    first = ((mref->ref_addr & ((1U << tagstore->num_offset_bits) - 1)) >>
+            sec_bits);
+    first &= ~(count - 1);
+
+    return ((uint32_t) (((1ULL << count) - 1) << first));
+}
+
+
+/*
+ * Points a request at the smallest aligned run of sectors of its block
+ * that holds all the given ones; the whole block if not sectored.
+ */
+static inline void
+cache_sector_set_range(cache_tagstore_t *tagstore, uint32_t sectors,
+        mem_ref_t *mref)
+{
+    uint32_t    first = __builtin_ctz(sectors);
+    uint32_t    span = 0;
+
+    if (sectors & (sectors - 1))
+        span = (32 - __builtin_clz(first ^ (31 - __builtin_clz(sectors))));
+    first &= ~((1U << span) - 1);
+
+    mref->ref_addr = ((mref->ref_addr &
+                ~((1U << tagstore->num_offset_bits) - 1)) |
+            (first << tagstore->num_sector_bits));
+    mref->ref_size_bits = (tagstore->num_sector_bits + span);
+
+    return;
+}
+
+#endif /* CACHE_SECTOR_H_ */
@@ -0,0 +1,404 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the set-sharded parallel simulation.
+ *
+ * A reference only ever touches one set per level, and the lowest S index
+ * bits pick the same shard at L1 and at L2 when both use the same block
+ * size and have at least 2^S sets. Dirty blocks written back from L1 keep
+ * their index bits too, so the shards never interact. Every shard is the
+ * hierarchy with 1/2^S of the sets; references are handed to it with the
+ * shard bits taken out of the address, which keeps the tags unchanged:
+ *
+ *      addr:   | tag | index[high] | index[S-1:0] | offset |
+ *      shard:  |  0  | tag | index[high] | offset |
+ *
+ * Each shard sees its references in trace order and the replacement
+ * state is per set, so every set ends up exactly as in a serial run. The
+ * calling thread deals the references out to the shards in batches, over
+ * one SPSC ring per shard.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_print.h"
+#include "cache_opts.h"
+#include "cache_trace.h"
+#include "cache_prefetch.h"
+#include "cache_timing.h"
+#include "cache_ring.h"
+#include "cache_index.h"
+#include "cache_shard.h"
+
+/* Globals */
+cache_shards_t      *g_cache_shards;    /* NULL unless the run is sharded */
+
+
+/* Returns TRUE if the policy only looks at the referenced set. */
+static boolean
+cache_shard_is_repl_ok(uint8_t repl_plcy)
+{
+    return ((CACHE_REPL_PLCY_RANDOM != repl_plcy) &&
+            (CACHE_REPL_PLCY_BRRIP != repl_plcy) &&
+            (CACHE_REPL_PLCY_OPT != repl_plcy));
+}
+
+
+/***************************************************************************
+ * Name:    cache_shard_check
+ *
+ * Desc:    Checks that the sets of the configured hierarchy can be split
+ *          over the asked # of threads.
+ *
+ * Params:  None
+ *
+ * Returns: boolean
+ *  TRUE if the run can be sharded, FALSE otherwise
+ **************************************************************************/
+static boolean
+cache_shard_check(void)
+{
+    uint32_t            threads = g_cache_opts.threads;
+    cache_generic_t     *l1 = cache_util_get_l1(0);
+    cache_generic_t     *l2 = cache_util_get_l2();
+    cache_level_opts_t  *l1_opts = &g_cache_opts.level[CACHE_OPTS_L1];
+    cache_level_opts_t  *l2_opts = &g_cache_opts.level[CACHE_OPTS_L2];
+
+    if ((threads > CACHE_SHARD_MAX_THREADS) ||
+            (!util_is_power_of_2(threads))) {
+        dprint("Error: --threads must be a power of 2, up to %u.\n",
+                CACHE_SHARD_MAX_THREADS);
+        return FALSE;
+    }
+
+    /*
+     * The VC and the write-back buffers are shared by all the sets,
+     * prefetchers fetch blocks of other sets, and the rest need the
+     * references in global order.
+     */
+    if ((g_num_cores > 1) || (cache_util_is_victim_present()) ||
+            (CACHE_PF_TYPE_NONE != l1_opts->prefetch) ||
+            (CACHE_PF_TYPE_NONE != l2_opts->prefetch) ||
+            (l1_opts->wbb) || (l2_opts->wbb) ||
+            (g_cache_opts.interval) || (g_cache_opts.progress) ||
+            (CACHE_TIMING_ON == g_cache_opts.timing) ||
+            (CACHE_INDEX_BITS != l1_opts->index_fn) ||
+            (CACHE_INDEX_BITS != l2_opts->index_fn) ||
+            (g_cache_opts.set_stats) ||
+            (!cache_shard_is_repl_ok(l1->repl_plcy)) ||
+            ((cache_util_is_l2_present()) &&
+             (!cache_shard_is_repl_ok(l2->repl_plcy)))) {
+        dprint("Error: --threads needs a single core, no VC, prefetchers, "
+                "write-back buffers, interval stats, progress or timing, "
+                "the address bits as the set index, no set stats, and "
+                "neither random, BRRIP nor OPT replacement.\n");
+        return FALSE;
+    }
+
+    if ((!util_is_power_of_2(l1->size / (l1->set_assoc * l1->blk_size))) ||
+            ((l1->size / (l1->set_assoc * l1->blk_size)) < threads) ||
+            ((cache_util_is_l2_present()) &&
+             ((!util_is_power_of_2(l2->size /
+                                   (l2->set_assoc * l2->blk_size))) ||
+              ((l2->size / (l2->set_assoc * l2->blk_size)) < threads) ||
+              (l2->blk_size != l1->blk_size)))) {
+        dprint("Error: --threads=%u needs at least %u sets, a power of 2, "
+                "in every cache, and one block size.\n", threads, threads);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/***************************************************************************
+ * Name:    cache_shard_init_caches
+ *
+ * Desc:    Sets up the caches of a shard as copies of the configured ones,
+ *          with 1/Nth of the sets.
+ *
+ * Params:
+ *  shards  ptr to the sharded run state
+ *  shard   ptr to the shard
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR if a tagstore can't be set up
+ **************************************************************************/
+static cache_rv
+cache_shard_init_caches(cache_shards_t *shards, cache_shard_t *shard)
+{
+    memcpy(&shard->l1, cache_util_get_l1(0), sizeof(shard->l1));
+    memset(&shard->l1.stats, 0, sizeof(shard->l1.stats));
+    shard->l1.stats.cache = &shard->l1;
+    shard->l1.size /= shards->num_shards;
+    shard->l1.next_cache = NULL;
+
+    if (cache_util_is_l2_present()) {
+        memcpy(&shard->l2, cache_util_get_l2(), sizeof(shard->l2));
+        memset(&shard->l2.stats, 0, sizeof(shard->l2.stats));
+        shard->l2.stats.cache = &shard->l2;
+        shard->l2.size /= shards->num_shards;
+        shard->l2.prev_cache = &shard->l1;
+        shard->l1.next_cache = &shard->l2;
+        if (CACHE_RV_OK != cache_tagstore_init(&shard->l2, &shard->l2_ts))
+            return CACHE_RV_ERR;
+    }
+
+    return cache_tagstore_init(&shard->l1, &shard->l1_ts);
+}
+
+
+/***************************************************************************
+ * Name:    cache_shard_main
+ *
+ * Desc:    Thread body of a shard. Simulates the batches handed over to the
+ *          shard until the reader is done with the trace.
+ *
+ * Params:
+ *  arg     ptr to the shard
+ *
+ * Returns: void *
+ *  NULL always
+ **************************************************************************/
+static void *
+cache_shard_main(void *arg)
+{
+    uint32_t            iter = 0;
+    uint32_t            addr = 0;
+    uint8_t             blk_bits = g_cache_shards->blk_bits;
+    uint8_t             shard_bits = g_cache_shards->shard_bits;
+    uint32_t            offset_mask = ((1U << blk_bits) - 1);
+    cache_shard_t       *shard = arg;
+    cache_ring_batch_t  *batch = NULL;
+    mem_ref_t           *mref = NULL;
+
+    while ((batch = cache_ring_peek(shard->ring))) {
+        /* After a failure the batches are only drained. */
+        for (iter = 0; (!shard->failed) && (iter < batch->count); ++iter) {
+            mref = &batch->refs[iter];
+            addr = mref->ref_addr;
+            mref->ref_addr = (((addr >> (blk_bits + shard_bits)) <<
+                        blk_bits) | (addr & offset_mask));
+
+            if (!cache_handle_memory_request(&shard->l1, mref)) {
+                dprint_err("Error: Unable to handle memory reference "
+                        "request for type %c, addr 0x%x.\n",
+                        mref->ref_type, addr);
+                shard->failed = TRUE;
+            }
+        }
+        cache_ring_pop(shard->ring);
+    }
+
+    return NULL;
+}
+
+
+/* Tells the shard threads there is no more work and waits for them. */
+static void
+cache_shard_stop(cache_shards_t *shards)
+{
+    uint32_t        iter = 0;
+    cache_shard_t   *shard = NULL;
+
+    for (iter = 0; iter < shards->num_shards; ++iter) {
+        shard = &shards->shards[iter];
+        if (shard->started) {
+            cache_ring_close(shard->ring);
+            pthread_join(shard->thread, NULL);
+        }
+        shard->started = FALSE;
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_shard_run
+ *
+ * Desc:    Simulates the whole trace over --threads= shards and sums the
+ *          statistics of the shards into the configured caches, which are
+ *          then printed as usual. The configured caches have no tagstore
+ *          of their own in a sharded run; the contents are printed from
+ *          the shards with cache_shard_print_contents.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_shard_run(void)
+{
+    uint32_t            iter = 0;
+    uint32_t            id = 0;
+    cache_rv            rc = CACHE_RV_ERR;
+    cache_shards_t      *shards = NULL;
+    cache_shard_t       *shard = NULL;
+    cache_ring_batch_t  *cur[CACHE_SHARD_MAX_THREADS];
+    mem_ref_t           mem_ref;
+
+    if (!cache_shard_check())
+        return CACHE_RV_ERR;
+
+    shards = calloc(1, sizeof(*shards));
+    if (shards)
+        shards->shards = calloc(g_cache_opts.threads, sizeof(cache_shard_t));
+    if ((!shards) || (!shards->shards)) {
+        dprint("Error: Unable to allocate memory for the shards.\n");
+        free(shards);
+        return CACHE_RV_ERR;
+    }
+    g_cache_shards = shards;
+
+    shards->num_shards = g_cache_opts.threads;
+    shards->shard_bits = util_log_base_2(shards->num_shards);
+    shards->blk_bits = util_log_base_2(cache_util_get_l1(0)->blk_size);
+
+    for (iter = 0; iter < shards->num_shards; ++iter) {
+        shard = &shards->shards[iter];
+        shard->id = iter;
+        if (CACHE_RV_OK != cache_shard_init_caches(shards, shard))
+            goto exit;
+        shard->ring = cache_ring_create(CACHE_SHARD_RING_SLOTS);
+        if (!shard->ring) {
+            dprint("Error: Unable to allocate memory for the shards.\n");
+            goto exit;
+        }
+        cur[iter] = cache_ring_get_free(shard->ring);
+    }
+
+    for (iter = 0; iter < shards->num_shards; ++iter) {
+        shard = &shards->shards[iter];
+        if (pthread_create(&shard->thread, NULL, cache_shard_main, shard)) {
+            dprint("Error: Unable to start the shard threads.\n");
+            goto exit;
+        }
+        shard->started = TRUE;
+    }
+
+    if (CACHE_RV_OK != cache_ring_reader_start())
+        goto exit;
+
+    memset(&mem_ref, 0, sizeof(mem_ref));
+    while (cache_ring_reader_next(&mem_ref)) {
+        g_addr_count += 1;
+        if (mem_ref.ref_core >= g_num_cores) {
+            printf("Error: Reference %u is from core %u, but only %u "
+                    "core(s) are simulated.\n", g_addr_count,
+                    mem_ref.ref_core, g_num_cores);
+            goto exit;
+        }
+
+        id = ((mem_ref.ref_addr >> shards->blk_bits) &
+                (shards->num_shards - 1));
+        cur[id]->refs[cur[id]->count++] = mem_ref;
+        if (CACHE_RING_BATCH_REFS == cur[id]->count) {
+            cache_ring_push(shards->shards[id].ring);
+            cur[id] = cache_ring_get_free(shards->shards[id].ring);
+        }
+    }
+
+    for (iter = 0; iter < shards->num_shards; ++iter) {
+        if (cur[iter]->count)
+            cache_ring_push(shards->shards[iter].ring);
+    }
+    rc = CACHE_RV_OK;
+
+exit:
+    cache_ring_reader_stop();
+    cache_shard_stop(shards);
+
+    /* Merge in shard order, so that the sums never depend on timing. */
+    for (iter = 0; iter < shards->num_shards; ++iter) {
+        shard = &shards->shards[iter];
+        if (shard->failed)
+            rc = CACHE_RV_ERR;
+        cache_util_add_stats(&cache_util_get_l1(0)->stats, &shard->l1.stats);
+        if (cache_util_is_l2_present())
+            cache_util_add_stats(&cache_util_get_l2()->stats,
+                    &shard->l2.stats);
+    }
+
+    return rc;
+}
+
+
+/***************************************************************************
+ * Name:    cache_shard_print_contents
+ *
+ * Desc:    Prints the contents of the sharded caches, set by set in the
+ *          order of the whole cache.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_shard_print_contents(void)
+{
+    uint32_t            iter = 0;
+    cache_shards_t      *shards = g_cache_shards;
+    cache_generic_t     *caches[CACHE_SHARD_MAX_THREADS];
+
+    for (iter = 0; iter < shards->num_shards; ++iter)
+        caches[iter] = &shards->shards[iter].l1;
+    cache_print_cache_shards(caches, shards->num_shards);
+
+    if (cache_util_is_l2_present()) {
+        for (iter = 0; iter < shards->num_shards; ++iter)
+            caches[iter] = &shards->shards[iter].l2;
+        cache_print_cache_shards(caches, shards->num_shards);
+    }
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_shard_cleanup
+ *
+ * Desc:    Frees the shards and their caches, if the run was sharded.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_shard_cleanup(void)
+{
+    uint32_t        iter = 0;
+    cache_shards_t  *shards = g_cache_shards;
+    cache_shard_t   *shard = NULL;
+
+    if (!shards)
+        return;
+
+    cache_shard_stop(shards);
+    for (iter = 0; iter < shards->num_shards; ++iter) {
+        shard = &shards->shards[iter];
+        if (shard->l1.tagstore)
+            cache_cleanup(&shard->l1);
+        if (shard->l2.tagstore)
+            cache_cleanup(&shard->l2);
+        cache_ring_destroy(shard->ring);
+    }
+
+    free(shards->shards);
+    free(shards);
+    g_cache_shards = NULL;
+
+    return;
+}
@@ -0,0 +1,59 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the set-sharded parallel simulation. The sets of the hierarchy are split
+ * by the lowest index bits, which L1 and L2 share, so that every shard is a
+ * smaller copy of the hierarchy that no other shard's references ever
+ * touch. The shards run on their own threads, fed by the trace reader.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_SHARD_H_
+#define CACHE_SHARD_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_SHARD_MAX_THREADS     64
+#define CACHE_SHARD_RING_SLOTS      8       /* batches per shard ring   */
+
+/* One shard: an L1 (and L2) with 1/Nth of the sets, and its input ring */
+typedef struct cache_shard__ {
+    uint32_t            id;             /* shard ID; low index bits     */
+    cache_generic_t     l1;
+    cache_generic_t     l2;
+    cache_tagstore_t    l1_ts;
+    cache_tagstore_t    l2_ts;
+    struct cache_ring__ *ring;          /* batches from the reader      */
+    pthread_t           thread;
+    boolean             started;        /* thread is running            */
+    boolean             failed;         /* a reference failed           */
+} cache_shard_t;
+
+/* Sharded run state */
+typedef struct cache_shards__ {
+    uint32_t            num_shards;     /* power of 2                   */
+    uint8_t             shard_bits;     /* log2 of num_shards           */
+    uint8_t             blk_bits;       /* log2 of the block size       */
+    cache_shard_t       *shards;
+} cache_shards_t;
+
+
+/* Externs */
+extern cache_shards_t   *g_cache_shards;
+
+
+/* Function declarations */
+cache_rv
+cache_shard_run(void);
+void
+cache_shard_print_contents(void);
+void
+cache_shard_cleanup(void);
+
+#endif /* CACHE_SHARD_H_ */
@@ -0,0 +1,371 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the cycle-level, non-blocking timing model.
+ *
+ * The core issues one reference per cycle and never waits for data; it
+ * only stalls when a miss needs an L1 MSHR and all of them are busy. A
+ * miss to a block that is already being fetched merges into its MSHR,
+ * and a hit to such a block (a delayed hit) completes when the fill does.
+ * L1 misses that go to memory take an L2 MSHR as well; requests waiting
+ * for a free L2 MSHR are served in order.
+ *
+ * Write backs are assumed to be absorbed by write buffers and cost
+ * nothing here, except when a modelled write-back buffer (--<lvl>-wbb)
+ * is full: the core then waits for the oldest entry to be written to the
+ * next level. Prefetch fills are not timed either.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_timing.h"
+
+/* Globals */
+uint8_t         g_cache_ref_src;        /* CACHE_TIMING_SRC_* of the ref */
+cache_timing_t  *g_cache_timing;        /* NULL unless timing is on     */
+
+
+/***************************************************************************
+ * Name:    cache_mshr_advance
+ *
+ * Desc:    Moves the MSHR file to the given cycle, retiring all the misses
+ *          filled by then and accounting the cycles spent at every
+ *          occupancy level.
+ *
+ * Params:
+ *  mshrs   ptr to the MSHR file
+ *  now     cycle to move to; earlier cycles are ignored
+ *
+ * Returns: Nothing
+ **************************************************************************/
+static void
+cache_mshr_advance(cache_mshr_file_t *mshrs, uint64_t now)
+{
+    uint64_t    cur = mshrs->now;
+
+    if (now <= cur)
+        return;
+
+    while ((mshrs->count) && (mshrs->done[0] <= now)) {
+        if (mshrs->done[0] > cur) {
+            mshrs->hist[mshrs->count] += (mshrs->done[0] - cur);
+            cur = mshrs->done[0];
+        }
+
+        mshrs->count -= 1;
+        memmove(&mshrs->blk[0], &mshrs->blk[1],
+                (mshrs->count * sizeof(mshrs->blk[0])));
+        memmove(&mshrs->done[0], &mshrs->done[1],
+                (mshrs->count * sizeof(mshrs->done[0])));
+    }
+
+    mshrs->hist[mshrs->count] += (now - cur);
+    mshrs->now = now;
+
+    return;
+}
+
+
+/* Returns the MSHR fetching the block, or -1. */
+static int32_t
+cache_mshr_find(cache_mshr_file_t *mshrs, uint32_t blk)
+{
+    uint32_t    iter = 0;
+
+    for (iter = 0; iter < mshrs->count; ++iter) {
+        if (mshrs->blk[iter] == blk)
+            return iter;
+    }
+
+    return -1;
+}
+
+
+/* Takes a free MSHR; keeps the entries sorted by fill cycle. */
+static void
+cache_mshr_alloc(cache_mshr_file_t *mshrs, uint32_t blk, uint64_t done)
+{
+    uint32_t    iter = mshrs->count;
+
+    for (; (iter) && (mshrs->done[iter - 1] > done); --iter) {
+        mshrs->blk[iter] = mshrs->blk[iter - 1];
+        mshrs->done[iter] = mshrs->done[iter - 1];
+    }
+    mshrs->blk[iter] = blk;
+    mshrs->done[iter] = done;
+    mshrs->count += 1;
+    mshrs->num_allocs += 1;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_timing_init
+ *
+ * Desc:    Sets up the timing model if it's turned on, with the user given
+ *          latencies and MSHR counts, or the defaults. To be called after
+ *          the caches are set up.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success or if timing is off
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_timing_init(void)
+{
+    cache_timing_t      *tm = NULL;
+    cache_level_opts_t  *l1_opts = &g_cache_opts.level[CACHE_OPTS_L1];
+    cache_level_opts_t  *vc_opts = &g_cache_opts.level[CACHE_OPTS_VC];
+    cache_level_opts_t  *l2_opts = &g_cache_opts.level[CACHE_OPTS_L2];
+
+    if (CACHE_TIMING_ON != g_cache_opts.timing)
+        return CACHE_RV_OK;
+
+    if (g_num_cores > 1) {
+        dprint("Error: The timing model supports a single core only.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if ((l1_opts->mshrs > CACHE_TIMING_MAX_MSHRS) ||
+            (l2_opts->mshrs > CACHE_TIMING_MAX_MSHRS)) {
+        dprint("Error: At most %u MSHRs per level are supported.\n",
+                CACHE_TIMING_MAX_MSHRS);
+        return CACHE_RV_ERR;
+    }
+
+    tm = calloc(1, sizeof(*tm));
+    if (!tm) {
+        dprint("Error: Unable to allocate memory for the timing model.\n");
+        return CACHE_RV_ERR;
+    }
+
+    tm->vc_present = cache_util_is_victim_present();
+    tm->l2_present = cache_util_is_l2_present();
+    tm->l1_blk_bits = cache_util_get_l1(0)->tagstore->num_offset_bits;
+    if (tm->l2_present)
+        tm->l2_blk_bits = cache_util_get_l2()->tagstore->num_offset_bits;
+
+    tm->l1_lat = (l1_opts->hit_lat ? l1_opts->hit_lat :
+            CACHE_TIMING_DEF_L1_LAT);
+    tm->vc_lat = (vc_opts->hit_lat ? vc_opts->hit_lat :
+            CACHE_TIMING_DEF_VC_LAT);
+    tm->l2_lat = (l2_opts->hit_lat ? l2_opts->hit_lat :
+            CACHE_TIMING_DEF_L2_LAT);
+    tm->mem_lat = (g_cache_opts.mem_lat ? g_cache_opts.mem_lat :
+            CACHE_TIMING_DEF_MEM_LAT);
+    tm->l1_mshrs.num_mshrs = (l1_opts->mshrs ? l1_opts->mshrs :
+            CACHE_TIMING_DEF_L1_MSHRS);
+    tm->l2_mshrs.num_mshrs = (l2_opts->mshrs ? l2_opts->mshrs :
+            CACHE_TIMING_DEF_L2_MSHRS);
+
+    g_cache_timing = tm;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_timing_lower
+ *
+ * Desc:    Times an L1 miss below L1. Returns the cycle at which the block
+ *          is back at L1.
+ *
+ * Params:
+ *  tm      ptr to the timing model
+ *  addr    address of the reference
+ *  now     cycle at which the miss leaves L1
+ *
+ * Returns: uint64_t
+ *  Fill cycle of the block
+ **************************************************************************/
+static uint64_t
+cache_timing_lower(cache_timing_t *tm, uint32_t addr, uint64_t now)
+{
+    int32_t             id = -1;
+    uint32_t            blk = 0;
+    uint64_t            done = 0;
+    cache_mshr_file_t   *mshrs = &tm->l2_mshrs;
+
+    if (!tm->l2_present)
+        return (now + tm->mem_lat);
+
+    /* Requests are served in order; none overtakes one waiting for MSHRs. */
+    if (now < mshrs->now)
+        now = mshrs->now;
+    cache_mshr_advance(mshrs, now);
+
+    blk = (addr >> tm->l2_blk_bits);
+    id = cache_mshr_find(mshrs, blk);
+    if (id >= 0) {
+        mshrs->num_merges += 1;
+        done = (now + tm->l2_lat);
+        return ((mshrs->done[id] > done) ? mshrs->done[id] : done);
+    }
+
+    if (CACHE_TIMING_SRC_L2 == g_cache_ref_src)
+        return (now + tm->l2_lat);
+
+    if (mshrs->count == mshrs->num_mshrs) {
+        mshrs->num_full += 1;
+        cache_mshr_advance(mshrs, mshrs->done[0]);
+        now = mshrs->now;
+    }
+
+    done = (now + tm->l2_lat + tm->mem_lat);
+    cache_mshr_alloc(mshrs, blk, done);
+
+    return done;
+}
+
+
+/***************************************************************************
+ * Name:    cache_timing_ref
+ *
+ * Desc:    Times the current reference. To be called after the functional
+ *          simulation of the reference, which sets g_cache_ref_src.
+ *
+ * Params:
+ *  mref    ptr to the current memory reference
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_timing_ref(mem_ref_t *mref)
+{
+    int32_t             id = -1;
+    uint32_t            blk = 0;
+    uint64_t            now = 0;
+    uint64_t            done = 0;
+    cache_timing_t      *tm = g_cache_timing;
+    cache_mshr_file_t   *mshrs = &tm->l1_mshrs;
+
+    /* One reference per cycle, unless the previous one stalled. */
+    now = (tm->num_refs ? (tm->issue + 1) : 0);
+    if (tm->wbb_pending) {
+        now += tm->wbb_pending;
+        tm->stall_cycles += tm->wbb_pending;
+        tm->wbb_pending = 0;
+    }
+    cache_mshr_advance(mshrs, now);
+
+    blk = (mref->ref_addr >> tm->l1_blk_bits);
+    id = cache_mshr_find(mshrs, blk);
+    if (id >= 0) {
+        /* The block is on its way; wait for the fill. */
+        done = (now + tm->l1_lat);
+        if (mshrs->done[id] > done)
+            done = mshrs->done[id];
+        if (CACHE_TIMING_SRC_L1 == g_cache_ref_src)
+            tm->num_delayed_hits += 1;
+        else
+            mshrs->num_merges += 1;
+    } else if (CACHE_TIMING_SRC_L1 == g_cache_ref_src) {
+        done = (now + tm->l1_lat);
+    } else if (CACHE_TIMING_SRC_VC == g_cache_ref_src) {
+        done = (now + tm->l1_lat + tm->vc_lat);
+    } else {
+        /* A new miss; stall the core until an MSHR frees up. */
+        if (mshrs->count == mshrs->num_mshrs) {
+            mshrs->num_full += 1;
+            tm->stall_cycles += (mshrs->done[0] - now);
+            now = mshrs->done[0];
+            cache_mshr_advance(mshrs, now);
+        }
+
+        done = (now + tm->l1_lat + (tm->vc_present ? tm->vc_lat : 0));
+        done = cache_timing_lower(tm, mref->ref_addr, done);
+        cache_mshr_alloc(mshrs, blk, done);
+    }
+
+    tm->issue = now;
+    tm->num_refs += 1;
+    tm->total_lat += (done - now);
+    if (done > tm->last_done)
+        tm->last_done = done;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_timing_wbb_stall
+ *
+ * Desc:    Charges the current reference for a write back that found the
+ *          write-back buffer of its cache full, i.e. for writing the
+ *          oldest entry to the next level first.
+ *
+ * Params:
+ *  cache   ptr to the cache with the full buffer
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_timing_wbb_stall(cache_generic_t *cache)
+{
+    uint32_t        lat = 0;
+    cache_timing_t  *tm = g_cache_timing;
+
+    lat = (cache->next_cache ? tm->l2_lat : tm->mem_lat);
+    tm->wbb_pending += lat;
+    tm->wbb_stall_cycles += lat;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_timing_finish
+ *
+ * Desc:    Drains all the outstanding misses, so that the occupancy
+ *          histograms cover the whole run.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_timing_finish(void)
+{
+    cache_timing_t  *tm = g_cache_timing;
+
+    if (!tm)
+        return;
+
+    cache_mshr_advance(&tm->l1_mshrs, tm->last_done);
+    if (tm->l2_present)
+        cache_mshr_advance(&tm->l2_mshrs, tm->last_done);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_timing_cleanup
+ *
+ * Desc:    Frees the timing model.
+ *
+ * Params:  None
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_timing_cleanup(void)
+{
+    if (g_cache_timing)
+        free(g_cache_timing);
+    g_cache_timing = NULL;
+
+    return;
+}
@@ -0,0 +1,115 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the optional cycle-level timing model. The functional simulation decides
+ * where every reference is served from (L1, VC, L2 or memory); the timing
+ * model then assigns an issue and a completion cycle to the reference,
+ * with misses tracked by per-level MSHRs so that they can overlap.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_TIMING_H_
+#define CACHE_TIMING_H_
+
+#include <stdint.h>
+#include "cache.h"
+#include "cache_opts.h"
+
+/* Constants */
+#define CACHE_TIMING_OFF            0
+#define CACHE_TIMING_ON             1
+
+/* Where the current demand reference was served from */
+#define CACHE_TIMING_SRC_L1         0
+#define CACHE_TIMING_SRC_VC         1
+#define CACHE_TIMING_SRC_L2         2
+#define CACHE_TIMING_SRC_MEM        3
+
+/* Defaults, in cycles, for the latencies and MSHR counts not given */
+#define CACHE_TIMING_DEF_L1_LAT     2
+#define CACHE_TIMING_DEF_VC_LAT     1   /* on top of the L1 latency     */
+#define CACHE_TIMING_DEF_L2_LAT     10
+#define CACHE_TIMING_DEF_MEM_LAT    100
+#define CACHE_TIMING_DEF_L1_MSHRS   8
+#define CACHE_TIMING_DEF_L2_MSHRS   16
+#define CACHE_TIMING_MAX_MSHRS      64
+
+/*
+ * MSHR file of one level. Entries are kept sorted by completion cycle, so
+ * the oldest miss is always retired first. The occupancy histogram is
+ * time weighted: hist[n] is the # of cycles with n MSHRs in use.
+ */
+typedef struct cache_mshr_file__ {
+    uint32_t    num_mshrs;              /* # of MSHRs                   */
+    uint32_t    count;                  /* # of MSHRs in use            */
+    uint32_t    blk[CACHE_TIMING_MAX_MSHRS];    /* block being fetched  */
+    uint64_t    done[CACHE_TIMING_MAX_MSHRS];   /* fill cycle           */
+    uint64_t    now;                    /* cycle of the last update     */
+    uint64_t    num_allocs;             /* # of primary misses          */
+    uint64_t    num_merges;             /* # of misses to in-flight blks*/
+    uint64_t    num_full;               /* # of times all MSHRs busy    */
+    uint64_t    hist[CACHE_TIMING_MAX_MSHRS + 1];
+} cache_mshr_file_t;
+
+/* Timing model state */
+typedef struct cache_timing__ {
+    uint8_t             l1_blk_bits;    /* log2 of L1 block size        */
+    uint8_t             l2_blk_bits;    /* log2 of L2 block size        */
+    boolean             vc_present;     /* L1 misses probe the VC       */
+    boolean             l2_present;     /* L1 misses go to L2           */
+    uint32_t            l1_lat;         /* L1 hit latency               */
+    uint32_t            vc_lat;         /* extra latency of a VC swap   */
+    uint32_t            l2_lat;         /* L2 hit latency               */
+    uint32_t            mem_lat;        /* memory latency               */
+    uint64_t            issue;          /* issue cycle of the last ref  */
+    uint64_t            last_done;      /* latest completion cycle      */
+    uint64_t            num_refs;       /* # of timed references        */
+    uint64_t            total_lat;      /* sum of all ref latencies     */
+    uint64_t            stall_cycles;   /* issue cycles lost to MSHRs   */
+    uint64_t            num_delayed_hits; /* hits on in-flight blocks   */
+    uint64_t            wbb_pending;    /* write buffer stall cycles not
+                                           yet charged to the core      */
+    uint64_t            wbb_stall_cycles; /* stalls on full write bufs  */
+    cache_mshr_file_t   l1_mshrs;
+    cache_mshr_file_t   l2_mshrs;
+} cache_timing_t;
+
+
+/* Externs */
+extern uint8_t          g_cache_ref_src;
+extern cache_timing_t   *g_cache_timing;
+
+
+/* Function declarations */
+cache_rv
+cache_timing_init(void);
+void
+cache_timing_ref(mem_ref_t *mref);
+void
+cache_timing_wbb_stall(cache_generic_t *cache);
+void
+cache_timing_finish(void);
+void
+cache_timing_cleanup(void);
+
+/*
+ * Demand accesses: all of L1 and the reads L1 misses send down. Always
+ * false with timing off, so that g_cache_ref_src is only ever written by
+ * the thread that times the references.
+ */
+#define CACHE_TIMING_IS_DEMAND(CACHE, MREF)                             \
+    ((g_cache_timing) && ((CACHE_IS_L1(CACHE)) ||                       \
+        ((IS_MEM_REF_READ(MREF)) &&                                     \
+         (!((MREF)->ref_flags & MEM_REF_F_PREFETCH)))))
+
+/* Per-reference hook for the main loop; free when timing is off. */
+#define CACHE_TIMING_TICK(MREF)                                         \
+    do {                                                                \
+        if (g_cache_timing)                                             \
+            cache_timing_ref(MREF);                                     \
+    } while (0)
+
+#endif /* CACHE_TIMING_H_ */
@@ -0,0 +1,577 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the trace reader. The whole trace is mmap'ed, so
+ * reading a reference is a few loads and the trace can be walked more than
+ * once (eg. the OPT replacement pre-scan) without any extra I/O. Pipes and
+ * FIFOs are read into a buffer instead, and a reference is parsed only once
+ * all of it is in, so it doesn't matter where the writer's chunks end.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_trace.h"
+
+/* Globals */
+cache_trace_t   *g_cache_trace;         /* trace being simulated        */
+
+
+/***************************************************************************
+ * Name:    cache_trace_open_multi
+ *
+ * Desc:    Opens a comma separated list of traces, one per core. The i-th
+ *          trace drives core i.
+ *
+ * Params:
+ *  paths   ptr to the trace file paths
+ *
+ * Returns: cache_trace_t *
+ *  ptr to the open trace on success
+ *  NULL otherwise
+ **************************************************************************/
+static cache_trace_t *
+cache_trace_open_multi(const char *paths)
+{
+    char            *list = NULL;
+    char            *fpath = NULL;
+    char            *next = NULL;
+    cache_trace_t   *trace = NULL;
+
+    trace = calloc(1, sizeof(*trace));
+    list = strdup(paths);
+    if ((!trace) || (!list))
+        goto error_exit;
+
+    trace->fd = -1;
+    trace->fmt = CACHE_TRACE_FMT_MULTI;
+    trace->quantum = (g_cache_opts.quantum ? g_cache_opts.quantum : 1);
+    trace->left = trace->quantum;
+    trace->subs = calloc(CACHE_MAX_CORES, sizeof(*trace->subs));
+    if (!trace->subs)
+        goto error_exit;
+
+    for (fpath = list; fpath; fpath = next) {
+        next = strchr(fpath, ',');
+        if (next)
+            *next++ = '\0';
+        if (CACHE_MAX_CORES == trace->num_cores) {
+            dprint("Error: At most %u per-core traces are supported.\n",
+                    CACHE_MAX_CORES);
+            goto error_exit;
+        }
+        trace->subs[trace->num_cores] = cache_trace_open(fpath);
+        if (!trace->subs[trace->num_cores])
+            goto error_exit;
+        trace->num_cores += 1;
+    }
+    free(list);
+
+    return trace;
+
+error_exit:
+    free(list);
+    cache_trace_close(trace);
+    return NULL;
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_stream_fill
+ *
+ * Desc:    Reads whatever the stream has next into the buffer, after moving
+ *          what's left of it to the front. Waits until there's some input,
+ *          or the writer is gone; as the simulator reads only as fast as it
+ *          simulates, a writer faster than that blocks on the full pipe.
+ *
+ * Params:
+ *  trace   ptr to the open stream
+ *
+ * Returns: boolean
+ *  TRUE if something was read
+ *  FALSE at the end of the stream, or on an error
+ **************************************************************************/
+static boolean
+cache_trace_stream_fill(cache_trace_t *trace)
+{
+    char        *buf = NULL;
+    ssize_t     len = 0;
+
+    if (trace->pos) {
+        memmove(trace->buf, (trace->buf + trace->pos),
+                (trace->size - trace->pos));
+        trace->size -= trace->pos;
+        trace->pos = 0;
+        trace->start = 0;
+    }
+
+    /* A line longer than the buffer; make room for the rest of it. */
+    if (trace->size == trace->cap) {
+        buf = realloc(trace->buf, (2 * trace->cap));
+        if (!buf) {
+            dprint("Error: Out of memory reading the trace stream.\n");
+            trace->eof = TRUE;
+            return FALSE;
+        }
+        trace->buf = buf;
+        trace->map = buf;
+        trace->cap *= 2;
+    }
+
+    do {
+        len = read(trace->fd, (trace->buf + trace->size),
+                (trace->cap - trace->size));
+    } while ((len < 0) && (EINTR == errno));
+
+    if (len <= 0) {
+        if (len < 0)
+            dprint("Error: Unable to read the trace stream.\n");
+        trace->eof = TRUE;
+        return FALSE;
+    }
+    trace->size += len;
+
+    return TRUE;
+}
+
+
+/* TRUE once a whole reference is buffered, or the stream is over. */
+static boolean
+cache_trace_stream_wait(cache_trace_t *trace, boolean wait)
+{
+    const char  *map = NULL;
+
+    while (TRUE) {
+        map = trace->map;
+        if (CACHE_TRACE_FMT_BIN == trace->fmt) {
+            if ((trace->pos + sizeof(cache_trace_rec_t)) <= trace->size)
+                return TRUE;
+        } else {
+            /* Skip blank lines; the next one must be complete. */
+            while ((trace->pos < trace->size) &&
+                    ((' ' == map[trace->pos]) || ('\t' == map[trace->pos]) ||
+                     ('\r' == map[trace->pos]) || ('\n' == map[trace->pos])))
+                trace->pos += 1;
+            if ((trace->pos < trace->size) && (memchr((map + trace->pos),
+                            '\n', (trace->size - trace->pos))))
+                return TRUE;
+        }
+
+        if (trace->eof)
+            return TRUE;
+        if (!wait)
+            return FALSE;
+        cache_trace_stream_fill(trace);
+    }
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_open_stream
+ *
+ * Desc:    Sets up an open pipe or FIFO to be read as a stream, and detects
+ *          its format from the first bytes. The reference count of a binary
+ *          header isn't checked; streams are read till the writer is done.
+ *
+ * Params:
+ *  trace   ptr to the trace, with the file open
+ *  path    ptr to the trace file path
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+static cache_rv
+cache_trace_open_stream(cache_trace_t *trace, const char *path)
+{
+    uint32_t            magic = 0;
+    cache_trace_hdr_t   hdr;
+
+    trace->stream = TRUE;
+    trace->cap = CACHE_TRACE_STREAM_BUF;
+    trace->buf = malloc(trace->cap);
+    if (!trace->buf)
+        return CACHE_RV_ERR;
+    trace->map = trace->buf;
+    trace->size = 0;
+    trace->fmt = CACHE_TRACE_FMT_TEXT;
+
+    while ((trace->size < sizeof(magic)) && (!trace->eof))
+        cache_trace_stream_fill(trace);
+    if (trace->size >= sizeof(magic))
+        memcpy(&magic, trace->buf, sizeof(magic));
+    if (CACHE_TRACE_MAGIC != magic)
+        return CACHE_RV_OK;
+
+    while ((trace->size < sizeof(hdr)) && (!trace->eof))
+        cache_trace_stream_fill(trace);
+    if (trace->size >= sizeof(hdr))
+        memcpy(&hdr, trace->buf, sizeof(hdr));
+    if ((trace->size < sizeof(hdr)) ||
+            (CACHE_TRACE_VERSION != hdr.version) ||
+            (sizeof(cache_trace_rec_t) != hdr.rec_size)) {
+        dprint("Error: Bad binary trace header in %s.\n", path);
+        return CACHE_RV_ERR;
+    }
+    trace->fmt = CACHE_TRACE_FMT_BIN;
+    trace->start = sizeof(hdr);
+    trace->pos = trace->start;
+
+    return CACHE_RV_OK;
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_open
+ *
+ * Desc:    Opens and mmaps the given trace file and detects its format.
+ *          Binary traces start with a cache_trace_hdr_t; anything else is
+ *          taken as a text trace. A comma separated list of files is
+ *          opened as per-core traces. "-" is stdin; it and other files
+ *          that aren't regular (eg. FIFOs) are read as streams.
+ *
+ * Params:
+ *  path    ptr to the trace file path
+ *
+ * Returns: cache_trace_t *
+ *  ptr to the open trace on success
+ *  NULL otherwise
+ **************************************************************************/
+cache_trace_t *
+cache_trace_open(const char *path)
+{
+    struct stat         st;
+    cache_trace_t       *trace = NULL;
+    cache_trace_hdr_t   *hdr = NULL;
+
+    if (!path) {
+        cache_assert(0);
+        goto error_exit;
+    }
+
+    if (strchr(path, ','))
+        return cache_trace_open_multi(path);
+
+    trace = calloc(1, sizeof(*trace));
+    if (!trace)
+        goto error_exit;
+    trace->num_cores = 1;
+
+    if (!strcmp(path, "-"))
+        trace->fd = dup(STDIN_FILENO);
+    else
+        trace->fd = open(path, O_RDONLY);
+    if ((trace->fd < 0) || (fstat(trace->fd, &st)))
+        goto error_exit;
+
+    if (!S_ISREG(st.st_mode)) {
+        if (CACHE_RV_OK != cache_trace_open_stream(trace, path))
+            goto error_exit;
+        return trace;
+    }
+
+    /* Nothing to map for empty traces; they just have no references. */
+    trace->size = st.st_size;
+    trace->fmt = CACHE_TRACE_FMT_TEXT;
+    if (!trace->size)
+        return trace;
+
+    trace->map = mmap(NULL, trace->size, PROT_READ, MAP_PRIVATE, trace->fd, 0);
+    if (MAP_FAILED == trace->map) {
+        trace->map = NULL;
+        goto error_exit;
+    }
+    madvise((void *) trace->map, trace->size, MADV_SEQUENTIAL);
+
+    hdr = (cache_trace_hdr_t *) trace->map;
+    if ((trace->size >= sizeof(*hdr)) && (CACHE_TRACE_MAGIC == hdr->magic)) {
+        if ((CACHE_TRACE_VERSION != hdr->version) ||
+                (sizeof(cache_trace_rec_t) != hdr->rec_size) ||
+                (trace->size < (sizeof(*hdr) +
+                    ((size_t) hdr->num_refs * sizeof(cache_trace_rec_t))))) {
+            dprint("Error: Bad binary trace header in %s.\n", path);
+            goto error_exit;
+        }
+        trace->fmt = CACHE_TRACE_FMT_BIN;
+        trace->num_refs = hdr->num_refs;
+        trace->start = sizeof(*hdr);
+    }
+    trace->pos = trace->start;
+
+    return trace;
+
+error_exit:
+    cache_trace_close(trace);
+    return NULL;
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_close
+ *
+ * Desc:    Unmaps, or frees the stream buffer of, and closes the trace.
+ *
+ * Params:
+ *  trace   ptr to the open trace
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_trace_close(cache_trace_t *trace)
+{
+    uint32_t    core = 0;
+
+    if (!trace)
+        return;
+
+    if (CACHE_TRACE_FMT_MULTI == trace->fmt) {
+        for (core = 0; (trace->subs) && (core < trace->num_cores); ++core)
+            cache_trace_close(trace->subs[core]);
+        free(trace->subs);
+    }
+
+    if (trace->stream)
+        free(trace->buf);
+    else if (trace->map)
+        munmap((void *) trace->map, trace->size);
+    if (trace->fd >= 0)
+        close(trace->fd);
+    free(trace);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_rewind
+ *
+ * Desc:    Moves the trace back to the first reference.
+ *
+ * Params:
+ *  trace   ptr to the open trace
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_trace_rewind(cache_trace_t *trace)
+{
+    uint32_t    core = 0;
+
+    if (CACHE_TRACE_FMT_MULTI == trace->fmt) {
+        for (core = 0; core < trace->num_cores; ++core)
+            cache_trace_rewind(trace->subs[core]);
+        trace->cur = 0;
+        trace->left = trace->quantum;
+    }
+
+    trace->pos = trace->start;
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_next_multi
+ *
+ * Desc:    Reads the next reference from the per-core traces. Cores take
+ *          turns of a quantum of references each; cores whose trace is
+ *          over are skipped.
+ *
+ * Params:
+ *  trace   ptr to the open per-core traces
+ *  mref    ptr to the memory reference to be filled in
+ *
+ * Returns: boolean
+ *  TRUE if a reference was read
+ *  FALSE at the end of all the traces
+ **************************************************************************/
+static boolean
+cache_trace_next_multi(cache_trace_t *trace, mem_ref_t *mref)
+{
+    uint32_t    turn = 0;
+
+    for (turn = 0; turn <= trace->num_cores; ++turn) {
+        if ((trace->left) &&
+                (cache_trace_next(trace->subs[trace->cur], mref))) {
+            trace->left -= 1;
+            mref->ref_core = trace->cur;
+            return TRUE;
+        }
+
+        trace->cur = ((trace->cur + 1) % trace->num_cores);
+        trace->left = trace->quantum;
+    }
+
+    return FALSE;
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_next
+ *
+ * Desc:    Reads the next reference from the trace. Text lines are of the
+ *          form "<r|w> <hex-addr> [core]"; blank lines are skipped.
+ *
+ * Params:
+ *  trace   ptr to the open trace
+ *  mref    ptr to the memory reference to be filled in
+ *
+ * Returns: boolean
+ *  TRUE if a reference was read
+ *  FALSE at the end of the trace
+ **************************************************************************/
+boolean
+cache_trace_next(cache_trace_t *trace, mem_ref_t *mref)
+{
+    char                c = 0;
+    uint32_t            addr = 0;
+    uint32_t            core = 0;
+    const char          *map = NULL;
+    size_t              pos = 0;
+    size_t              size = 0;
+    cache_trace_rec_t   *rec = NULL;
+
+    if (CACHE_TRACE_FMT_MULTI == trace->fmt)
+        return cache_trace_next_multi(trace, mref);
+
+    if ((trace->stream) && (!trace->eof))
+        cache_trace_stream_wait(trace, TRUE);
+    map = trace->map;
+    pos = trace->pos;
+    size = trace->size;
+
+    if (CACHE_TRACE_FMT_BIN == trace->fmt) {
+        if ((pos + sizeof(*rec)) > size)
+            return FALSE;
+        rec = (cache_trace_rec_t *) (map + pos);
+        mref->ref_type = rec->type;
+        mref->ref_core = rec->core;
+        mref->ref_addr = rec->addr;
+        trace->pos = (pos + sizeof(*rec));
+        return TRUE;
+    }
+
+    /* Reference type; skip any white space before it. */
+    while ((pos < size) && ((' ' == map[pos]) || ('\t' == map[pos]) ||
+                ('\r' == map[pos]) || ('\n' == map[pos])))
+        pos += 1;
+    if (pos >= size) {
+        trace->pos = pos;
+        return FALSE;
+    }
+    mref->ref_type = map[pos++];
+
+    while ((pos < size) && ((' ' == map[pos]) || ('\t' == map[pos])))
+        pos += 1;
+
+    /* Hex address, with or without the 0x prefix. */
+    if (((pos + 1) < size) && ('0' == map[pos]) &&
+            (('x' == map[pos + 1]) || ('X' == map[pos + 1])))
+        pos += 2;
+    for (; pos < size; ++pos) {
+        c = map[pos];
+        if ((c >= '0') && (c <= '9'))
+            addr = ((addr << 4) | (c - '0'));
+        else if ((c >= 'a') && (c <= 'f'))
+            addr = ((addr << 4) | (c - 'a' + 10));
+        else if ((c >= 'A') && (c <= 'F'))
+            addr = ((addr << 4) | (c - 'A' + 10));
+        else
+            break;
+    }
+    mref->ref_addr = addr;
+
+    /* Optional decimal core ID. */
+    while ((pos < size) && ((' ' == map[pos]) || ('\t' == map[pos])))
+        pos += 1;
+    for (; (pos < size) && (map[pos] >= '0') && (map[pos] <= '9'); ++pos)
+        core = ((core * 10) + (map[pos] - '0'));
+    mref->ref_core = ((core > UINT8_MAX) ? UINT8_MAX : core);
+
+    /* Ignore the rest of the line. */
+    while ((pos < size) && ('\n' != map[pos]))
+        pos += 1;
+    trace->pos = pos;
+
+    return TRUE;
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_ready
+ *
+ * Desc:    Tells if the next reference can be read without waiting for the
+ *          writer of a stream; always TRUE for mapped files.
+ *
+ * Params:
+ *  trace   ptr to the open trace
+ *
+ * Returns: boolean
+ *  TRUE if cache_trace_next won't wait for input
+ *  FALSE otherwise
+ **************************************************************************/
+boolean
+cache_trace_ready(cache_trace_t *trace)
+{
+    if (CACHE_TRACE_FMT_MULTI == trace->fmt)
+        return cache_trace_ready(trace->subs[trace->cur]);
+
+    if ((!trace->stream) || (trace->eof))
+        return TRUE;
+
+    return cache_trace_stream_wait(trace, FALSE);
+}
+
+
+/***************************************************************************
+ * Name:    cache_trace_count
+ *
+ * Desc:    Returns the # of references in the trace. Text traces are
+ *          walked once and the count is remembered. The read offset is
+ *          left untouched.
+ *
+ * Params:
+ *  trace   ptr to the open trace
+ *
+ * Returns: uint32_t
+ *  # of references in the trace
+ **************************************************************************/
+uint32_t
+cache_trace_count(cache_trace_t *trace)
+{
+    size_t      pos = 0;
+    uint32_t    core = 0;
+    uint32_t    count = 0;
+    mem_ref_t   mref;
+
+    if ((trace->num_refs) || (CACHE_TRACE_FMT_BIN == trace->fmt))
+        return trace->num_refs;
+
+    if (CACHE_TRACE_FMT_MULTI == trace->fmt) {
+        for (core = 0; core < trace->num_cores; ++core)
+            count += cache_trace_count(trace->subs[core]);
+        trace->num_refs = count;
+        return count;
+    }
+
+    pos = trace->pos;
+    trace->pos = trace->start;
+    while (cache_trace_next(trace, &mref))
+        count += 1;
+    trace->pos = pos;
+    trace->num_refs = count;
+
+    return count;
+}
@@ -0,0 +1,97 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the trace reader. Traces are mmap'ed and come in two formats: the usual
+ * text format ("r 7b0342a0" per line) and a binary format with a header
+ * and fixed size records. The format is detected from the file contents.
+ * Both formats can carry the ID of the issuing core ("r 7b0342a0 3" in
+ * text); references without one are from core 0.
+ *
+ * A comma separated list of traces gives one trace per core instead; the
+ * reader then interleaves them round robin, a quantum at a time.
+ *
+ * "-" (stdin), a FIFO or any other file that can't be mapped is read as a
+ * stream instead: a chunk at a time into a buffer, as the writer produces
+ * it, so a tracer can feed the simulator live. A stream can't be walked
+ * twice, so OPT replacement needs a regular file.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_TRACE_H_
+#define CACHE_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cache.h"
+
+/* Constants */
+#define CACHE_TRACE_MAGIC           0x43545243  /* "CTRC"               */
+#define CACHE_TRACE_VERSION         1
+
+#define CACHE_TRACE_FMT_TEXT        0
+#define CACHE_TRACE_FMT_BIN         1
+#define CACHE_TRACE_FMT_MULTI       2   /* per-core traces              */
+
+#define CACHE_TRACE_STREAM_BUF      (1 << 18)   /* stream read buffer   */
+
+/* Binary trace file header */
+typedef struct cache_trace_hdr__ {
+    uint32_t    magic;                  /* CACHE_TRACE_MAGIC            */
+    uint16_t    version;                /* CACHE_TRACE_VERSION          */
+    uint16_t    rec_size;               /* sizeof(cache_trace_rec_t)    */
+    uint32_t    num_refs;               /* # of records that follow     */
+    uint32_t    reserved;
+} cache_trace_hdr_t;
+
+/* Binary trace record */
+typedef struct cache_trace_rec__ {
+    uint32_t    addr;                   /* memory address               */
+    uint8_t     type;                   /* MEM_REF_TYPE_*               */
+    uint8_t     core;                   /* issuing core                 */
+    uint8_t     pad[2];
+} cache_trace_rec_t;
+
+/* Open trace */
+typedef struct cache_trace__ {
+    int         fd;                     /* trace file descriptor        */
+    uint8_t     fmt;                    /* CACHE_TRACE_FMT_*            */
+    const char  *map;                   /* mmap'ed file contents, or
+                                           the stream buffer            */
+    size_t      size;                   /* file size, or bytes buffered */
+    size_t      pos;                    /* read offset                  */
+    size_t      start;                  /* offset of the first ref      */
+    uint32_t    num_refs;               /* # of refs; 0 until counted   */
+    uint32_t    num_cores;              /* # of per-core traces         */
+    uint32_t    cur;                    /* multi: core being scheduled  */
+    uint32_t    left;                   /* multi: refs left in quantum  */
+    uint32_t    quantum;                /* multi: refs per turn         */
+    struct cache_trace__ **subs;        /* multi: per-core traces       */
+    boolean     stream;                 /* read as it comes, not mapped */
+    boolean     eof;                    /* stream: no more input        */
+    char        *buf;                   /* stream: read buffer          */
+    size_t      cap;                    /* stream: buffer size          */
+} cache_trace_t;
+
+
+/* Externs */
+extern cache_trace_t    *g_cache_trace;
+
+
+/* Function declarations */
+cache_trace_t *
+cache_trace_open(const char *path);
+void
+cache_trace_close(cache_trace_t *trace);
+void
+cache_trace_rewind(cache_trace_t *trace);
+boolean
+cache_trace_next(cache_trace_t *trace, mem_ref_t *mref);
+boolean
+cache_trace_ready(cache_trace_t *trace);
+uint32_t
+cache_trace_count(cache_trace_t *trace);
+
+#endif /* CACHE_TRACE_H_ */
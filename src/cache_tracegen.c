@@ -0,0 +1,637 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * Synthetic trace generator (sim_tracegen). Writes text or binary traces,
+ * as read by the simulator, from a mixture of parameterized patterns:
+ *
+ *  stream  sequential, or strided, references; wraps around the footprint
+ *  random  uniform random elements of the footprint
+ *  zipf    Zipfian element popularity (rejection-inversion sampling, so
+ *          any footprint is O(1) per reference); the hot elements are
+ *          scattered over the footprint
+ *  chase   pointer chasing: one pseudo random cycle through all the
+ *          elements (rounded down to a power of 2), each visited once a lap
+ *
+ * Every reference picks a pattern as per the pattern weights, and is a
+ * write with the pattern's write percentage. All randomness comes from a
+ * single seeded xorshift64* generator, so the same arguments always give
+ * the same trace. References are formatted into a large buffer by hand,
+ * without stdio formatting, so the generator runs at about disk speed.
+ *
+ * Usage: sim_tracegen [--key=value ...] (see --help)
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "cache.h"
+#include "cache_trace.h"
+
+/* Constants */
+#define CACHE_TG_MAX_PATTERNS       8
+#define CACHE_TG_BUF_SIZE           (1 << 20)   /* output buffer bytes  */
+#define CACHE_TG_TEXT_REC_MAX       16          /* "w ffffffff\n"       */
+#define CACHE_TG_ADDR_SPACE         (1ULL << 32)
+
+#define CACHE_TG_STREAM             0
+#define CACHE_TG_RANDOM             1
+#define CACHE_TG_ZIPF               2
+#define CACHE_TG_CHASE              3
+
+#define CACHE_TG_FMT_TEXT           0
+#define CACHE_TG_FMT_BIN            1
+
+/* One pattern of the mixture */
+typedef struct cache_tg_pattern__ {
+    uint8_t     kind;                   /* CACHE_TG_*                   */
+    uint32_t    weight;                 /* relative share of references */
+    uint64_t    base;                   /* first address                */
+    uint64_t    footprint;              /* bytes covered                */
+    uint64_t    stride;                 /* step, or element size        */
+    uint32_t    writes;                 /* % of writes                  */
+    double      alpha;                  /* zipf exponent                */
+
+    uint64_t    num_elems;              /* footprint / stride           */
+    uint64_t    pos;                    /* stream / chase position      */
+    uint64_t    write_cut;              /* writes, out of 2^32          */
+    uint64_t    mult;                   /* zipf scatter; coprime to n   */
+    uint32_t    bits;                   /* chase: log2 of # of elems    */
+    double      h_x1;                   /* zipf: sampler constants      */
+    double      h_n;
+    double      sv;
+} cache_tg_pattern_t;
+
+/* Generator settings */
+typedef struct cache_tg__ {
+    uint64_t    refs;                   /* # of references              */
+    uint64_t    seed;
+    uint8_t     fmt;                    /* CACHE_TG_FMT_*               */
+    const char  *out;                   /* output file; NULL = stdout   */
+    uint32_t    num_patterns;
+    uint32_t    total_weight;
+    cache_tg_pattern_t  patterns[CACHE_TG_MAX_PATTERNS];
+} cache_tg_t;
+
+/* Globals */
+static const char *g_tg_kind_names[] =
+    { "stream", "random", "zipf", "chase", NULL };
+static const char g_tg_hex[] = "0123456789abcdef";
+static uint64_t     g_tg_rng;           /* xorshift64* state            */
+static char         g_tg_buf[CACHE_TG_BUF_SIZE];
+
+
+/* Returns the next 64 random bits. */
+static inline uint64_t
+cache_tg_rand(void)
+{
+    g_tg_rng ^= (g_tg_rng >> 12);
+    g_tg_rng ^= (g_tg_rng << 25);
+    g_tg_rng ^= (g_tg_rng >> 27);
+    return (g_tg_rng * 0x2545F4914F6CDD1DULL);
+}
+
+
+/* Returns a random real in [0, 1). */
+static inline double
+cache_tg_rand_real(void)
+{
+    return ((cache_tg_rand() >> 11) * (1.0 / 9007199254740992.0));
+}
+
+
+/*
+ * Zipf sampler helpers, after Hormann and Derflinger, "Rejection-inversion
+ * to generate variates from monotone discrete distributions" (1996).
+ */
+static double
+cache_tg_helper1(double x)
+{
+    return ((fabs(x) > 1e-8) ? (log1p(x) / x) :
+            (1.0 - (x * (0.5 - (x * ((1.0 / 3.0) - (0.25 * x)))))));
+}
+
+static double
+cache_tg_helper2(double x)
+{
+    return ((fabs(x) > 1e-8) ? (expm1(x) / x) :
+            (1.0 + (x * 0.5 * (1.0 + (x * (1.0 / 3.0) *
+                                      (1.0 + (0.25 * x)))))));
+}
+
+static double
+cache_tg_h(double alpha, double x)
+{
+    return exp(-alpha * log(x));
+}
+
+static double
+cache_tg_h_integral(double alpha, double x)
+{
+    double  log_x = log(x);
+
+    return (cache_tg_helper2((1.0 - alpha) * log_x) * log_x);
+}
+
+static double
+cache_tg_h_integral_inv(double alpha, double x)
+{
+    double  t = (x * (1.0 - alpha));
+
+    if (t < -1.0)
+        t = -1.0;
+    return exp(cache_tg_helper1(t) * x);
+}
+
+
+/* Returns a Zipf distributed rank in [1, num_elems]. */
+static uint64_t
+cache_tg_zipf_rank(cache_tg_pattern_t *pat)
+{
+    uint64_t    rank = 0;
+    double      u = 0.0;
+    double      x = 0.0;
+
+    for (;;) {
+        u = (pat->h_n + (cache_tg_rand_real() * (pat->h_x1 - pat->h_n)));
+        x = cache_tg_h_integral_inv(pat->alpha, u);
+        rank = (uint64_t) (x + 0.5);
+        if (rank < 1)
+            rank = 1;
+        else if (rank > pat->num_elems)
+            rank = pat->num_elems;
+
+        if (((rank - x) <= pat->sv) ||
+                (u >= (cache_tg_h_integral(pat->alpha, rank + 0.5) -
+                       cache_tg_h(pat->alpha, rank))))
+            return rank;
+    }
+}
+
+
+/* Bijective mix of a number of the given # of bits. */
+static inline uint64_t
+cache_tg_mix(uint64_t x, uint32_t bits)
+{
+    uint64_t    mask = ((bits >= 64) ? ~0ULL : ((1ULL << bits) - 1));
+    uint32_t    shift = ((bits + 1) / 2);
+
+    x ^= (x >> shift);
+    x = ((x * 0x9E3779B97F4A7C15ULL) & mask);
+    x ^= (x >> shift);
+
+    return x;
+}
+
+
+/* Returns the greatest common divisor of two numbers. */
+static uint64_t
+cache_tg_gcd(uint64_t a, uint64_t b)
+{
+    uint64_t    t = 0;
+
+    while (b) {
+        t = (a % b);
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+
+/***************************************************************************
+ * Name:    cache_tg_next
+ *
+ * Desc:    Generates the next reference of a pattern.
+ *
+ * Params:
+ *  pat     ptr to the pattern
+ *  rnd     64 random bits for the reference
+ *  type    ptr to the reference type to fill in
+ *
+ * Returns: uint32_t
+ *  address of the reference
+ **************************************************************************/
+static inline uint32_t
+cache_tg_next(cache_tg_pattern_t *pat, uint64_t rnd, uint8_t *type)
+{
+    uint64_t    elem = 0;
+    uint64_t    mask = 0;
+
+    *type = (((rnd & 0xffffffff) < pat->write_cut) ?
+            MEM_REF_TYPE_WRITE : MEM_REF_TYPE_READ);
+
+    switch (pat->kind) {
+        case CACHE_TG_STREAM:
+            elem = pat->pos;
+            pat->pos = (((pat->pos + 1) < pat->num_elems) ?
+                    (pat->pos + 1) : 0);
+            break;
+
+        case CACHE_TG_RANDOM:
+            elem = (((rnd >> 32) * pat->num_elems) >> 32);
+            break;
+
+        case CACHE_TG_ZIPF:
+            elem = (((cache_tg_zipf_rank(pat) - 1) * pat->mult) %
+                    pat->num_elems);
+            break;
+
+        case CACHE_TG_CHASE:
+            mask = ((1ULL << pat->bits) - 1);
+            pat->pos = (((pat->pos * 6364136223846793005ULL) +
+                        1442695040888963407ULL) & mask);
+            elem = cache_tg_mix(pat->pos, pat->bits);
+            break;
+
+        default:
+            break;
+    }
+
+    return ((uint32_t) (pat->base + (elem * pat->stride)));
+}
+
+
+/* Parses a number with an optional K, M or G (x1024) suffix. */
+static boolean
+cache_tg_parse_num(const char *str, uint64_t *num)
+{
+    char    *end = NULL;
+
+    *num = strtoull(str, &end, 0);
+    if (end == str)
+        return FALSE;
+
+    switch (*end) {
+        case 'k': case 'K': *num <<= 10; ++end; break;
+        case 'm': case 'M': *num <<= 20; ++end; break;
+        case 'g': case 'G': *num <<= 30; ++end; break;
+        default: break;
+    }
+
+    return (!*end);
+}
+
+
+/***************************************************************************
+ * Name:    cache_tg_parse_pattern
+ *
+ * Desc:    Parses a pattern spec, "<kind>[,<key>=<value>...]", over the
+ *          defaults in the given pattern.
+ *
+ * Params:
+ *  spec    ptr to the pattern spec
+ *  pat     ptr to the pattern, with the defaults filled in
+ *
+ * Returns: boolean
+ *  TRUE if the spec is good
+ *  FALSE otherwise
+ **************************************************************************/
+static boolean
+cache_tg_parse_pattern(const char *spec, cache_tg_pattern_t *pat)
+{
+    char        buf[256];
+    char        *key = NULL;
+    char        *value = NULL;
+    char        *save = NULL;
+    uint8_t     iter = 0;
+    uint64_t    num = 0;
+
+    if (strlen(spec) >= sizeof(buf))
+        return FALSE;
+    strcpy(buf, spec);
+
+    key = strtok_r(buf, ",", &save);
+    for (iter = 0; (key) && (g_tg_kind_names[iter]); ++iter) {
+        if (!strcmp(g_tg_kind_names[iter], key))
+            break;
+    }
+    if ((!key) || (!g_tg_kind_names[iter]))
+        return FALSE;
+    pat->kind = iter;
+
+    /* Streams step by a word, the others pick whole blocks by default. */
+    if (!pat->stride)
+        pat->stride = ((CACHE_TG_STREAM == pat->kind) ? 4 : 64);
+
+    while ((key = strtok_r(NULL, ",", &save))) {
+        value = strchr(key, '=');
+        if (!value)
+            return FALSE;
+        *value++ = '\0';
+
+        if (!strcmp(key, "alpha")) {
+            pat->alpha = strtod(value, NULL);
+            continue;
+        }
+        if (!cache_tg_parse_num(value, &num))
+            return FALSE;
+
+        if (!strcmp(key, "weight"))
+            pat->weight = num;
+        else if (!strcmp(key, "base"))
+            pat->base = num;
+        else if (!strcmp(key, "footprint"))
+            pat->footprint = num;
+        else if (!strcmp(key, "stride"))
+            pat->stride = num;
+        else if (!strcmp(key, "writes"))
+            pat->writes = num;
+        else
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/* Works out the per-pattern sampling state; FALSE on bad parameters. */
+static boolean
+cache_tg_setup_pattern(cache_tg_pattern_t *pat)
+{
+    if ((!pat->weight) || (!pat->stride) || (pat->writes > 100) ||
+            (pat->footprint < pat->stride) ||
+            ((pat->base + pat->footprint) > CACHE_TG_ADDR_SPACE) ||
+            ((CACHE_TG_ZIPF == pat->kind) && (!(pat->alpha > 0.0))))
+        return FALSE;
+
+    pat->num_elems = (pat->footprint / pat->stride);
+    pat->write_cut = ((((uint64_t) pat->writes) << 32) / 100);
+    pat->pos = 0;
+
+    if (CACHE_TG_CHASE == pat->kind) {
+        for (pat->bits = 0; (2ULL << pat->bits) <= pat->num_elems;
+                ++pat->bits)
+            ;
+    }
+
+    if (CACHE_TG_ZIPF == pat->kind) {
+        pat->h_x1 = (cache_tg_h_integral(pat->alpha, 1.5) - 1.0);
+        pat->h_n = cache_tg_h_integral(pat->alpha, pat->num_elems + 0.5);
+        pat->sv = (2.0 - cache_tg_h_integral_inv(pat->alpha,
+                    (cache_tg_h_integral(pat->alpha, 2.5) -
+                     cache_tg_h(pat->alpha, 2.0))));
+
+        /* Rank r goes to element (r - 1) * mult mod n; a permutation. */
+        pat->mult = (((uint64_t) (pat->num_elems * 0.6180339887)) | 1);
+        while (1 != cache_tg_gcd(pat->mult, pat->num_elems))
+            pat->mult += 2;
+    }
+
+    return TRUE;
+}
+
+
+/* Prints the usage. */
+static void
+cache_tg_usage(const char *prog)
+{
+    printf("Usage: %s [--key=value ...]\n", prog);
+    printf("    --refs=N        : # of references (default 1M)\n");
+    printf("    --seed=N        : random seed (default 521)\n");
+    printf("    --format=F      : text (default) or bin\n");
+    printf("    --out=FILE      : output file (default stdout)\n");
+    printf("    --pattern=SPEC  : <kind>[,<key>=<value>...], up to %u;"
+            " kinds:\n", CACHE_TG_MAX_PATTERNS);
+    printf("                      stream, random, zipf, chase; keys:\n");
+    printf("                      weight, base, footprint, stride, "
+            "writes, alpha\n");
+    printf("    --footprint=N, --base=N, --stride=N, --writes=N, "
+            "--alpha=X\n");
+    printf("                    : defaults for all the patterns (64M, 0,"
+            " 4 for streams\n");
+    printf("                      and 64 otherwise, 30%%, 0.99)\n");
+    printf("Numbers take K, M and G (x1024) suffixes. Default pattern: "
+            "stream.\n");
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_tg_parse
+ *
+ * Desc:    Parses the generator arguments. The pattern defaults may be
+ *          given in any order relative to the patterns.
+ *
+ * Params:
+ *  tg      ptr to the generator settings to fill in
+ *  nargs   # of arguments
+ *  args    ptr to the arguments
+ *
+ * Returns: boolean
+ *  TRUE if all the arguments are good
+ *  FALSE otherwise
+ **************************************************************************/
+static boolean
+cache_tg_parse(cache_tg_t *tg, int nargs, char **args)
+{
+    int                 iter = 0;
+    uint32_t            pat_iter = 0;
+    uint64_t            num = 0;
+    const char          *arg = NULL;
+    const char          *value = NULL;
+    const char          *specs[CACHE_TG_MAX_PATTERNS];
+    cache_tg_pattern_t  defaults;
+
+    memset(tg, 0, sizeof(*tg));
+    memset(&defaults, 0, sizeof(defaults));
+    tg->refs = (1 << 20);
+    tg->seed = 521;
+    defaults.weight = 1;
+    defaults.footprint = (64 << 20);
+    defaults.writes = 30;
+    defaults.alpha = 0.99;
+
+    for (iter = 1; iter < nargs; ++iter) {
+        arg = args[iter];
+        value = strchr(arg, '=');
+        if ((strncmp(arg, "--", 2)) || (!value))
+            return FALSE;
+        arg += 2;
+        value += 1;
+
+#define CACHE_TG_IS_KEY(KEY)                                            \
+        ((!strncmp(arg, KEY, strlen(KEY))) && ('=' == arg[strlen(KEY)]))
+
+        if (CACHE_TG_IS_KEY("pattern")) {
+            if (tg->num_patterns == CACHE_TG_MAX_PATTERNS)
+                return FALSE;
+            specs[tg->num_patterns++] = value;
+        } else if (CACHE_TG_IS_KEY("format")) {
+            if (!strcmp(value, "text"))
+                tg->fmt = CACHE_TG_FMT_TEXT;
+            else if (!strcmp(value, "bin"))
+                tg->fmt = CACHE_TG_FMT_BIN;
+            else
+                return FALSE;
+        } else if (CACHE_TG_IS_KEY("out")) {
+            tg->out = value;
+        } else if (CACHE_TG_IS_KEY("alpha")) {
+            defaults.alpha = strtod(value, NULL);
+        } else {
+            if (!cache_tg_parse_num(value, &num))
+                return FALSE;
+            if (CACHE_TG_IS_KEY("refs"))
+                tg->refs = num;
+            else if (CACHE_TG_IS_KEY("seed"))
+                tg->seed = num;
+            else if (CACHE_TG_IS_KEY("footprint"))
+                defaults.footprint = num;
+            else if (CACHE_TG_IS_KEY("base"))
+                defaults.base = num;
+            else if (CACHE_TG_IS_KEY("stride"))
+                defaults.stride = num;
+            else if (CACHE_TG_IS_KEY("writes"))
+                defaults.writes = num;
+            else
+                return FALSE;
+        }
+#undef CACHE_TG_IS_KEY
+    }
+
+    if (!tg->num_patterns)
+        specs[tg->num_patterns++] = "stream";
+
+    for (pat_iter = 0; pat_iter < tg->num_patterns; ++pat_iter) {
+        tg->patterns[pat_iter] = defaults;
+        if ((!cache_tg_parse_pattern(specs[pat_iter],
+                        &tg->patterns[pat_iter])) ||
+                (!cache_tg_setup_pattern(&tg->patterns[pat_iter]))) {
+            printf("Error: Bad pattern %s.\n", specs[pat_iter]);
+            return FALSE;
+        }
+        tg->total_weight += tg->patterns[pat_iter].weight;
+    }
+
+    if ((CACHE_TG_FMT_BIN == tg->fmt) && (tg->refs > UINT32_MAX)) {
+        printf("Error: Binary traces hold up to %u references.\n",
+                UINT32_MAX);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/* Picks the pattern of the next reference as per the weights. */
+static inline cache_tg_pattern_t *
+cache_tg_pick(cache_tg_t *tg)
+{
+    uint32_t    iter = 0;
+    uint32_t    pick = 0;
+
+    if (1 == tg->num_patterns)
+        return &tg->patterns[0];
+
+    pick = (((cache_tg_rand() >> 32) * tg->total_weight) >> 32);
+    for (iter = 0; pick >= tg->patterns[iter].weight; ++iter)
+        pick -= tg->patterns[iter].weight;
+
+    return &tg->patterns[iter];
+}
+
+
+/***************************************************************************
+ * Name:    cache_tg_generate
+ *
+ * Desc:    Writes all the references of the trace to the output.
+ *
+ * Params:
+ *  tg      ptr to the generator settings
+ *  fptr    ptr to the output file
+ *
+ * Returns: boolean
+ *  TRUE on success
+ *  FALSE on a write error
+ **************************************************************************/
+static boolean
+cache_tg_generate(cache_tg_t *tg, FILE *fptr)
+{
+    int                 shift = 0;
+    size_t              len = 0;
+    uint8_t             type = 0;
+    uint32_t            addr = 0;
+    uint64_t            ref = 0;
+    cache_trace_hdr_t   hdr;
+    cache_trace_rec_t   *rec = NULL;
+
+    if (CACHE_TG_FMT_BIN == tg->fmt) {
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = CACHE_TRACE_MAGIC;
+        hdr.version = CACHE_TRACE_VERSION;
+        hdr.rec_size = sizeof(cache_trace_rec_t);
+        hdr.num_refs = tg->refs;
+        if (1 != fwrite(&hdr, sizeof(hdr), 1, fptr))
+            return FALSE;
+    }
+
+    for (ref = 0; ref < tg->refs; ++ref) {
+        addr = cache_tg_next(cache_tg_pick(tg), cache_tg_rand(), &type);
+
+        if (CACHE_TG_FMT_BIN == tg->fmt) {
+            rec = (cache_trace_rec_t *) (g_tg_buf + len);
+            rec->addr = addr;
+            rec->type = type;
+            rec->core = 0;
+            rec->pad[0] = rec->pad[1] = 0;
+            len += sizeof(*rec);
+        } else {
+            g_tg_buf[len++] = type;
+            g_tg_buf[len++] = ' ';
+            for (shift = 28; (shift > 0) && (!(addr >> shift)); shift -= 4)
+                ;
+            for (; shift >= 0; shift -= 4)
+                g_tg_buf[len++] = g_tg_hex[(addr >> shift) & 0xf];
+            g_tg_buf[len++] = '\n';
+        }
+
+        if ((len + CACHE_TG_TEXT_REC_MAX) > sizeof(g_tg_buf)) {
+            if (len != fwrite(g_tg_buf, 1, len, fptr))
+                return FALSE;
+            len = 0;
+        }
+    }
+
+    return (len == fwrite(g_tg_buf, 1, len, fptr));
+}
+
+
+int
+main(int argc, char **argv)
+{
+    boolean     ok = FALSE;
+    FILE        *fptr = stdout;
+    cache_tg_t  tg;
+
+    if (!cache_tg_parse(&tg, argc, argv)) {
+        cache_tg_usage(argv[0]);
+        return -1;
+    }
+
+    g_tg_rng = (tg.seed ? tg.seed : 521);
+    if (tg.out) {
+        fptr = fopen(tg.out, "wb");
+        if (!fptr) {
+            printf("Error: Unable to open %s.\n", tg.out);
+            return -1;
+        }
+    }
+    setvbuf(fptr, NULL, _IONBF, 0);
+
+    ok = cache_tg_generate(&tg, fptr);
+    if ((tg.out) && (fclose(fptr)))
+        ok = FALSE;
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to write the trace.\n");
+        return -1;
+    }
+
+    return 0;
+}
@@ -13,9 +13,13 @@
 #include <string.h>
 #include <stdint.h>
 #include <unistd.h>
-#include <sys/time.h>
 #include "cache.h"
 #include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_index.h"
+
+/* Globals */
+FILE                *g_cache_out;   /* dprint() stream; NULL = stdout   */
 
 
 /* Util functions */
@@ -76,57 +80,29 @@ util_get_field_mask(uint32_t start_bit, uint32_t end_bit)
 
 
 
-/*************************************************************************** 
- * Name:    util_get_curr_time
+/***************************************************************************
+ * Name:    util_xorshift32
  *
- * Desc:    Returns the current system time in useconds
+ * Desc:    Returns the next number of a xorshift32 pseudo random sequence.
+ *          Same seed gives the same sequence on every run.
  *
- * Params:  None
+ * Params:
+ *  state   ptr to the generator state; must be non-zero
  *
- * Returns: uint64_t
- *  Current system time in useconds
+ * Returns: uint32_t
+ *  Next pseudo random number
  **************************************************************************/
-inline uint64_t
-util_get_curr_time(void)
+uint32_t
+util_xorshift32(uint32_t *state)
 {
-    struct timeval  curr_time;
-
-    memset(&curr_time, 0, sizeof(curr_time));
-
-#ifndef DBG_ON
-    /*
-     * An ugly hack to prevent the same-time for different references due to
-     * a usecond timer bug in non-QA code. The perfomance is still reasonable;
-     * i.e., under 7s for an input trace of 100k references.
-     *
-     * QA code uses a lot of dprints, thus the time interval between two
-     * consecutinve references of a same block is substantially higher than
-     * in non-QA code.
-     */
-    usleep(1);
-#endif /* !DBG_ON */
-    gettimeofday(&curr_time, NULL);
-
-    return ((curr_time.tv_sec * 1000000) + curr_time.tv_usec);
-}
+    uint32_t x = *state;
 
+    x ^= (x << 13);
+    x ^= (x >> 17);
+    x ^= (x << 5);
+    *state = x;
 
-/*************************************************************************** 
- * Name:    util_get_block_ref_count
- *
- * Desc:    Returns the ref. count of the set where the block is present.
- *
- * Params:  
- *  tagstore    ptr to the tagstore containing the block
- *  line        cache line containing the index 
- *
- * Returns: uint32_t
- *  Current ref count of the set containing the block.
- **************************************************************************/
-inline uint32_t
-util_get_block_ref_count(cache_tagstore_t *tagstore, cache_line_t *line)
-{
-    return (tagstore->set_ref_count[line->index]);
+    return x;
 }
 
 
@@ -185,31 +161,6 @@ util_is_power_of_2(uint32_t num)
 }
 
 
-/***************************************************************************
- * Name:    util_compare_uint64
- *
- * Desc:    Non-increasing type qsort comparator for uint64_t
- *
- * Params:
- * a        ptr to data A
- * b        ptr to data B
- *
- * Returns: int
- * > 0, if b is greater than a
- * < 0, if a is greater than b
- * 0, if a and b are equal
- **************************************************************************/
-int
-util_compare_uint64(const void *a, const void *b)
-{
-    const uint64_t *loc_a = (const uint64_t *) a;
-    const uint64_t *loc_b = (const uint64_t *) b;
-
-    /* Sorts in non-inreasing order. */
-    return (*loc_b - *loc_a);
-}
-
-
 /***************************************************************************
  * Name:    cache_util_is_block_dirty
  *
@@ -273,33 +224,35 @@ cache_util_is_victim_present(void)
 /*************************************************************************** 
  * Name:    cache_util_get_l1 
  *
- * Desc:    Returns a ptr to the L1 cache, if present.
+ * Desc:    Returns a ptr to the L1 cache of a core.
  *
- * Params:  None
+ * Params:
+ *  core    ID of the core
  *
  * Returns: ptr to cache_generic_t, for L1 cache
  **************************************************************************/
 inline cache_generic_t *
-cache_util_get_l1(void)
+cache_util_get_l1(uint32_t core)
 {
-    return &g_l1_cache;
+    return &g_l1_caches[core];
 }
 
     
 /*************************************************************************** 
  * Name:    cache_util_get_vc
  *
- * Desc:    Returns a ptr to the victim cache, if present.
+ * Desc:    Returns a ptr to the victim cache of a core, if present.
  *
- * Params:  None
+ * Params:
+ *  core    ID of the core
  *
  * Returns: ptr to cache_generic_t
  * for victim cache, if present; NULL, otherwise
  **************************************************************************/
 inline cache_generic_t *
-cache_util_get_vc(void)
+cache_util_get_vc(uint32_t core)
 {
-    return &g_vic_cache;
+    return &g_vic_caches[core];
 }
 
     
@@ -326,8 +279,10 @@ cache_util_get_l2(void)
  * Desc:    Validates the user entered cache configuration. Checks the 
  *          following:
  *          1. Total # of cache config arguments to be 7
- *          2. Block size to be a power of 2.
- *          3. Given trace file is readable or not.
+ *          2. Block size, and the L2 one if given, to be a power of 2.
+ *          3. Given trace file is readable or not. A comma separated
+ *             list of per-core trace files is checked file by file. "-"
+ *             (stdin) can be one of them, once.
  *
  * Params:
  *  nargs   # of input arguments
@@ -341,6 +296,10 @@ boolean
 cache_util_validate_input(int nargs, char **args)
 {
     int         blk_size = 0;
+    int         num_stdin = 0;
+    char        *fpath = NULL;
+    char        *next = NULL;
+    char        *list = NULL;
 
     if (CACHE_INPUT_NUM_ARGS != (nargs - 1)) {
         dprint_err("bad number of args %u\n", nargs);
@@ -357,10 +316,52 @@ cache_util_validate_input(int nargs, char **args)
         dprint_err("block size not power of 2 %u\n", blk_size);
         return FALSE;
     }
+    blk_size = g_cache_opts.level[CACHE_OPTS_L2].blk_size;
+    if ((blk_size) && (!util_is_power_of_2(blk_size))) {
+        dprint_err("L2 block size not power of 2 %u\n", blk_size);
+        return FALSE;
+    }
+
+    /* Check if the trace-file(s) are present and readable. */
+    list = strdup(args[nargs - 1]);
+    if (!list)
+        return FALSE;
+    for (fpath = list; fpath; fpath = next) {
+        next = strchr(fpath, ',');
+        if (next)
+            *next++ = '\0';
+        if (!strcmp(fpath, "-")) {
+            num_stdin += 1;
+            if (num_stdin > 1) {
+                dprint_err("stdin given for more than one trace\n");
+                free(list);
+                return FALSE;
+            }
+            continue;
+        }
+        if ((!fpath[0]) || (access(fpath, (F_OK | R_OK)))) {
+            dprint_err("bad trace file %s\n", fpath);
+            free(list);
+            return FALSE;
+        }
+    }
+    free(list);
+
+    return TRUE;
+}
 
-    /* Check if the trace-file is present and is readable. */
-    if (access(args[nargs - 1], (F_OK | R_OK))) {
-        dprint_err("bad trace file %s\n", args[nargs - 1]);
+
+/* Checks that a cache is made of a power of 2 # of whole sets. */
+static boolean
+cache_util_check_geometry(cache_generic_t *cache)
+{
+    uint32_t    set_size = (cache->set_assoc * cache->blk_size);
+
+    if ((!cache->size) || (!set_size) || (cache->size % set_size) ||
+            (!util_is_power_of_2(cache->size / set_size))) {
+        dprint("Error: %s of %u bytes doesn't make a power of 2 # of sets "
+                "of %u blocks of %u bytes.\n", CACHE_GET_NAME(cache),
+                cache->size, cache->set_assoc, cache->blk_size);
         return FALSE;
     }
 
@@ -368,12 +369,45 @@ cache_util_validate_input(int nargs, char **args)
 }
 
 
+/***************************************************************************
+ * Name:    cache_util_validate_caches
+ *
+ * Desc:    Validates the geometry of the configured caches, before their
+ *          tagstores are set up: the size of L1, the VC and L2 (if any)
+ *          must split into a power of 2 # of sets of the given
+ *          associativity and block size. A VC is a single set.
+ *
+ * Params:  None
+ *
+ * Returns: boolean
+ *  TRUE if all the caches are good
+ *  FALSE otherwise
+ **************************************************************************/
+boolean
+cache_util_validate_caches(void)
+{
+    if (!cache_util_check_geometry(cache_util_get_l1(0)))
+        return FALSE;
+
+    if ((cache_util_is_victim_present()) &&
+            (!cache_util_check_geometry(cache_util_get_vc(0))))
+        return FALSE;
+
+    if ((cache_util_is_l2_present()) &&
+            (!cache_util_check_geometry(cache_util_get_l2())))
+        return FALSE;
+
+    return TRUE;
+}
+
+
 /*************************************************************************** 
  * Name:    cache_util_decode_mem_addr
  *
  * Desc:    Decodes the incoming memory address reference into cache 
  *          understandable format in a cache line.
  *          i.e., <addr> = <tag, index, block_offset>
+ *          A hashed index is left to cache_index_decode.
  *
  * Params:
  *  tagstore    ptr to the tagstore of the cache for which addr is decoded
@@ -407,6 +441,11 @@ cache_util_decode_mem_addr(cache_tagstore_t *tagstore, uint32_t addr,
         goto exit;
     }
 
+    if (tagstore->index_fn) {
+        cache_index_decode(tagstore, addr, line);
+        goto exit;
+    }
+
     tag_mask = util_get_msb_mask(tagstore->num_tag_bits);
     offset_mask = util_get_lsb_mask(tagstore->num_offset_bits);
     index_mask = 
@@ -455,8 +494,11 @@ cache_util_encode_mem_addr(cache_tagstore_t *tagstore, cache_line_t *line,
     num_index_bits = tagstore->num_index_bits;
     num_offset_bits = tagstore->num_offset_bits;
 
-    mref->ref_addr = ((line->tag << (num_index_bits + num_offset_bits)) |
-            (line->index << num_offset_bits));
+    if (tagstore->index_fn)
+        mref->ref_addr = cache_index_encode(tagstore, line);
+    else
+        mref->ref_addr = ((line->tag << (num_index_bits + num_offset_bits)) |
+                (line->index << num_offset_bits));
 
     dprint_info("%s, addr_encode tag 0x%x, index %u, addr 0x%x\n",
             CACHE_GET_NAME(cache), line->tag, line->index, mref->ref_addr);
@@ -467,48 +509,48 @@ exit:
 
 
 /***************************************************************************
- * Name:    cache_util_get_lru_block_id
+ * Name:    cache_util_add_stats
  *
- * Desc:    Gets the LRU block ID for a given cache line.
+ * Desc:    Adds the counters of one cache to another, eg. to sum up the
+ *          private caches of all the cores.
  *
  * Params:
- *  tagstore    ptr to the tagstore of the cache for which addr is decoded
- *  line        cache line whose LRU block ID is reuqired
+ *  dst     ptr to the stats to add to
+ *  src     ptr to the stats to be added
  *
- * Returns: int8_t
- *  LRU block ID if everything goes well
- *  CACHE_RV_ERR on failure
+ * Returns: Nothing
  **************************************************************************/
-int8_t
-cache_util_get_lru_block_id(cache_tagstore_t *tagstore, cache_line_t *line)
+void
+cache_util_add_stats(cache_stats_t *dst, cache_stats_t *src)
 {
-    uint8_t             block_id = 0;
-    uint8_t             min_block_id = 0;
-    uint64_t            min_block_age = 0;
-    uint32_t            num_blocks = 0;
-    cache_tag_data_t    *tag_data = NULL;
-
-    if ((!tagstore) || (!line)) {
-        cache_assert(0);
-        goto error_exit;
-    }
-
-    num_blocks = tagstore->num_blocks_per_set;
-    tag_data = &tagstore->tag_data[line->index * num_blocks];
-    
-    for (block_id = 0, min_block_age = tag_data[block_id].age; 
-            block_id < num_blocks; ++block_id) {
-        if ((tag_data[block_id].valid) && 
-                (tag_data[block_id].age < min_block_age)) {
-            min_block_id = block_id;
-            min_block_age = tag_data[block_id].age;
-        }
-    }
-
-    return min_block_id;
+    dst->num_swaps += src->num_swaps;
+    dst->num_reads += src->num_reads;
+    dst->num_writes += src->num_writes;
+    dst->num_read_hits += src->num_read_hits;
+    dst->num_write_hits += src->num_write_hits;
+    dst->num_read_misses += src->num_read_misses;
+    dst->num_write_misses += src->num_write_misses;
+    dst->num_write_backs += src->num_write_backs;
+    dst->num_write_throughs += src->num_write_throughs;
+    dst->num_blk_mem_traffic += src->num_blk_mem_traffic;
+    dst->num_pf_issued += src->num_pf_issued;
+    dst->num_pf_useful += src->num_pf_useful;
+    dst->num_pf_late += src->num_pf_late;
+    dst->num_pf_polluting += src->num_pf_polluting;
+    dst->num_pf_fills += src->num_pf_fills;
+    dst->num_coh_invals += src->num_coh_invals;
+    dst->num_coh_downgrades += src->num_coh_downgrades;
+    dst->num_coh_upgrades += src->num_coh_upgrades;
+    dst->num_coh_write_backs += src->num_coh_write_backs;
+    dst->num_back_invals += src->num_back_invals;
+    dst->num_back_inval_wbs += src->num_back_inval_wbs;
+    dst->num_victim_fills += src->num_victim_fills;
+    dst->num_wbb_writes += src->num_wbb_writes;
+    dst->num_wbb_coalesced += src->num_wbb_coalesced;
+    dst->num_wbb_full_stalls += src->num_wbb_full_stalls;
+    dst->num_sector_misses += src->num_sector_misses;
+    dst->num_fill_bytes += src->num_fill_bytes;
+    dst->num_wb_bytes += src->num_wb_bytes;
 
-error_exit:
-    return CACHE_RV_ERR;
+    return;
 }
-
-
@@ -12,12 +12,16 @@
 #ifndef CACHE_UTILS_H_
 #define CACHE_UTILS_H_
 
+#include <stdio.h>
 #include <assert.h>
 #include "cache.h"
 
 /* Constants */
 #define CACHE_INPUT_NUM_ARGS    7
 
+/* Stream of dprint(); stdout, unless the library points it elsewhere */
+#define CACHE_OUT               ((g_cache_out) ? g_cache_out : stdout)
+
 /* Util macros */
 #define IS_MEM_REF_READ(REF)    (MEM_REF_TYPE_READ == REF->ref_type)
 #define IS_MEM_REF_WRITE(REF)   (MEM_REF_TYPE_WRITE == REF->ref_type)
@@ -36,7 +40,7 @@
 #define dprint_dp(str, ...) printf(str, ##__VA_ARGS__)
 #define dprint_dbg(str, ...) printf(str, ##__VA_ARGS__)
 #endif
-#define dprint(str, ...)     printf(str, ##__VA_ARGS__)
+#define dprint(str, ...)     fprintf(CACHE_OUT, str, ##__VA_ARGS__)
 #define dprint_dbg(str, ...)
 #define dprint_dp(str, ...)  
 
@@ -63,39 +67,41 @@
 #endif /* DBG_ON */
 
 
+/* Externs */
+extern FILE             *g_cache_out;
+
+
 /* Function declarations */
-inline boolean
+boolean
 cache_util_is_block_dirty(cache_tagstore_t *tagstore, cache_line_t *line, 
         int32_t block_id);
 boolean
 cache_util_validate_input(int nargs, char **args);
+boolean
+cache_util_validate_caches(void);
 void
 cache_util_decode_mem_addr(cache_tagstore_t *tagstore, uint32_t addr, 
         cache_line_t *line);
 void
 cache_util_encode_mem_addr(cache_tagstore_t *tagstore, cache_line_t *line,
         mem_ref_t *mref);
-inline boolean
+boolean
 cache_util_is_l2_present(void);
-inline boolean
+boolean
 cache_util_is_victim_present(void);
-inline cache_generic_t *
-cache_util_get_l1(void);
-inline cache_generic_t *
-cache_util_get_vc(void);
-inline cache_generic_t *
+cache_generic_t *
+cache_util_get_l1(uint32_t core);
+cache_generic_t *
+cache_util_get_vc(uint32_t core);
+cache_generic_t *
 cache_util_get_l2(void);
-int8_t
-cache_util_get_lru_block_id(cache_tagstore_t *tagstore, cache_line_t *line);
 boolean
 util_is_power_of_2(uint32_t num);
 uint32_t
 util_log_base_2(uint32_t num);
-inline uint64_t
-util_get_curr_time(void);
-inline uint32_t
-util_get_block_ref_count(cache_tagstore_t *tagstore, cache_line_t *line);
-int
-util_compare_uint64(const void *a, const void *b);
+uint32_t
+util_xorshift32(uint32_t *state);
+void
+cache_util_add_stats(cache_stats_t *dst, cache_stats_t *src);
 #endif /* CACHE_UTILS_H_ */
 
@@ -0,0 +1,228 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the write-back buffers of the cache levels.
+ *
+ * The simulator has no notion of time outside the timing model, so the
+ * buffers drain in references, like the prefetch fills: every reference
+ * gives each buffer one slot to write its oldest entry to the next level
+ * (eager), one slot only while it is more than half full (watermark), or
+ * none at all (lazy). A write back that finds its buffer full stalls until
+ * the oldest entry is written out. Whatever is left is written out at the
+ * end of the run. A write back is counted, as num_write_backs and as
+ * traffic, when it leaves the buffer, so the coalesced ones never reach
+ * the next level or the memory traffic.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_timing.h"
+#include "cache_wbb.h"
+
+/* Globals */
+boolean         g_cache_wbb_on = FALSE; /* any level has a buffer       */
+const char      *g_cache_wbb_drain_names[] =
+    { "eager", "lazy", "watermark", NULL };
+
+
+/***************************************************************************
+ * Name:    cache_wbb_init
+ *
+ * Desc:    Sets up the write-back buffer of a cache as per the user given
+ *          level options.
+ *
+ * Params:
+ *  cache   ptr to the cache
+ *  opts    ptr to the options for the cache level
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK if no buffer is asked for or on a successful setup
+ *  CACHE_RV_ERR otherwise
+ **************************************************************************/
+cache_rv
+cache_wbb_init(cache_generic_t *cache, cache_level_opts_t *opts)
+{
+    cache_wbb_t *wbb = NULL;
+
+    if ((!cache) || (!opts)) {
+        cache_assert(0);
+        return CACHE_RV_ERR;
+    }
+
+    cache->wbb = NULL;
+    if (!opts->wbb)
+        return CACHE_RV_OK;
+
+    if (opts->wbb > CACHE_WBB_MAX_DEPTH) {
+        dprint("Error: %s write-back buffer can have up to %u entries.\n",
+                CACHE_GET_NAME(cache), CACHE_WBB_MAX_DEPTH);
+        return CACHE_RV_ERR;
+    }
+
+    /* L1 victims go to the VC, which has a buffer of its own if any. */
+    if ((cache->next_cache) && (CACHE_IS_VC(cache->next_cache))) {
+        dprint("Error: %s write backs go through the VC; use --vc-wbb.\n",
+                CACHE_GET_NAME(cache));
+        return CACHE_RV_ERR;
+    }
+
+    wbb = calloc(1, sizeof(*wbb));
+    if (!wbb) {
+        dprint("Error: Unable to allocate memory for the write-back "
+                "buffer.\n");
+        return CACHE_RV_ERR;
+    }
+
+    wbb->depth = opts->wbb;
+    wbb->drain = opts->wbb_drain;
+    cache->wbb = wbb;
+    g_cache_wbb_on = TRUE;
+
+    return CACHE_RV_OK;
+}
+
+
+/* Frees the write-back buffer of a cache, if any. */
+void
+cache_wbb_cleanup(cache_generic_t *cache)
+{
+    if ((!cache) || (!cache->wbb))
+        return;
+
+    free(cache->wbb);
+    cache->wbb = NULL;
+
+    return;
+}
+
+
+/* Writes the oldest entry of a buffer to the next level. */
+static void
+cache_wbb_drain_one(cache_generic_t *cache)
+{
+    uint32_t    addr = 0;
+    uint32_t    sectors = 0;
+    cache_wbb_t *wbb = cache->wbb;
+
+    /*
+     * Take the entry out first; the write may evict dirty blocks further
+     * down, into the buffers of the levels below.
+     */
+    addr = wbb->blks[wbb->head];
+    sectors = wbb->sectors[wbb->head];
+    wbb->head = ((wbb->head + 1) % wbb->depth);
+    wbb->count -= 1;
+
+    cache_write_back(cache, addr, sectors);
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_wbb_put
+ *
+ * Desc:    Parks a dirty block evicted from a cache in its write-back
+ *          buffer. A block already waiting there is coalesced, dirty
+ *          sectors and all; on a full buffer, the oldest entry is written
+ *          out first.
+ *
+ * Params:
+ *  cache   ptr to the cache with a buffer
+ *  addr    address of the evicted block
+ *  sectors mask of its dirty sectors; 1 if not sectored
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_wbb_put(cache_generic_t *cache, uint32_t addr, uint32_t sectors)
+{
+    uint32_t    iter = 0;
+    uint32_t    slot = 0;
+    cache_wbb_t *wbb = NULL;
+
+    if ((!cache) || (!cache->wbb)) {
+        cache_assert(0);
+        return;
+    }
+    wbb = cache->wbb;
+
+    cache->stats.num_wbb_writes += 1;
+    for (iter = 0; iter < wbb->count; ++iter) {
+        slot = ((wbb->head + iter) % wbb->depth);
+        if (addr == wbb->blks[slot]) {
+            wbb->sectors[slot] |= sectors;
+            cache->stats.num_wbb_coalesced += 1;
+            return;
+        }
+    }
+
+    if (wbb->count == wbb->depth) {
+        cache->stats.num_wbb_full_stalls += 1;
+        if (g_cache_timing)
+            cache_timing_wbb_stall(cache);
+        cache_wbb_drain_one(cache);
+    }
+
+    slot = ((wbb->head + wbb->count) % wbb->depth);
+    wbb->blks[slot] = addr;
+    wbb->sectors[slot] = sectors;
+    wbb->count += 1;
+    if (wbb->count > wbb->peak)
+        wbb->peak = wbb->count;
+
+    return;
+}
+
+
+/***************************************************************************
+ * Name:    cache_wbb_tick
+ *
+ * Desc:    Gives the buffers of a hierarchy their per-reference drain slot,
+ *          top down, as per the drain policy of every level.
+ *
+ * Params:
+ *  cache   ptr to the L1 cache of the hierarchy
+ *
+ * Returns: Nothing
+ **************************************************************************/
+void
+cache_wbb_tick(cache_generic_t *cache)
+{
+    cache_wbb_t *wbb = NULL;
+
+    for (; cache; cache = cache->next_cache) {
+        wbb = cache->wbb;
+        if ((!wbb) || (!wbb->count))
+            continue;
+
+        if ((CACHE_WBB_DRAIN_EAGER == wbb->drain) ||
+                ((CACHE_WBB_DRAIN_WATERMARK == wbb->drain) &&
+                 ((2 * wbb->count) > wbb->depth)))
+            cache_wbb_drain_one(cache);
+    }
+
+    return;
+}
+
+
+/* Writes out everything left in the buffers of a hierarchy, top down. */
+void
+cache_wbb_flush(cache_generic_t *cache)
+{
+    for (; cache; cache = cache->next_cache) {
+        while ((cache->wbb) && (cache->wbb->count))
+            cache_wbb_drain_one(cache);
+    }
+
+    return;
+}
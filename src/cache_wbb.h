@@ -0,0 +1,65 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the data structures and function declarations for
+ * the optional write-back buffers. A cache level with a buffer parks its
+ * dirty evictions there instead of writing them to the next level right
+ * away; a block written back again while still parked is coalesced into
+ * the waiting entry, and the entries leave, oldest first, as per the
+ * drain policy of the level.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_WBB_H_
+#define CACHE_WBB_H_
+
+#include <stdint.h>
+#include "cache.h"
+#include "cache_opts.h"
+
+/* Constants */
+#define CACHE_WBB_DRAIN_EAGER       0   /* one entry every reference    */
+#define CACHE_WBB_DRAIN_LAZY        1   /* only to make room            */
+#define CACHE_WBB_DRAIN_WATERMARK   2   /* one per ref while half full  */
+
+#define CACHE_WBB_MAX_DEPTH         256 /* max. entries per buffer      */
+
+/* Per-level write-back buffer; a ring of block addresses */
+typedef struct cache_wbb__ {
+    uint32_t    depth;                  /* # of entries                 */
+    uint8_t     drain;                  /* CACHE_WBB_DRAIN_*            */
+    uint32_t    head;                   /* oldest entry                 */
+    uint32_t    count;                  /* # of entries in use          */
+    uint32_t    peak;                   /* max. # of entries in use     */
+    uint32_t    blks[CACHE_WBB_MAX_DEPTH];  /* block addresses          */
+    uint32_t    sectors[CACHE_WBB_MAX_DEPTH];   /* dirty sectors of blks*/
+} cache_wbb_t;
+
+
+/* Externs */
+extern boolean          g_cache_wbb_on;
+extern const char       *g_cache_wbb_drain_names[];
+
+
+/* Function declarations */
+cache_rv
+cache_wbb_init(cache_generic_t *cache, cache_level_opts_t *opts);
+void
+cache_wbb_cleanup(cache_generic_t *cache);
+void
+cache_wbb_put(cache_generic_t *cache, uint32_t addr, uint32_t sectors);
+void
+cache_wbb_tick(cache_generic_t *cache);
+void
+cache_wbb_flush(cache_generic_t *cache);
+
+/* Per-reference hook; free when no level has a buffer. */
+#define CACHE_WBB_TICK(CACHE)                                           \
+    do {                                                                \
+        if (g_cache_wbb_on)                                             \
+            cache_wbb_tick(CACHE);                                      \
+    } while (0)
+
+#endif /* CACHE_WBB_H_ */
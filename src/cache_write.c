@@ -0,0 +1,170 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module implements the write policies (see cache_write.h).
+ *
+ * A write-through passes the write reference on as it is; the next cache
+ * sees it as a write, and memory as a block of traffic, as the course
+ * counts it. WTNA blocks are never dirty, so they need no write backs,
+ * and the VC, which swaps dirty bits with L1, stays WBWA.
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_utils.h"
+#include "cache_opts.h"
+#include "cache_incl.h"
+#include "cache_timing.h"
+#include "cache_write.h"
+
+/* Globals */
+const char      *g_cache_write_names[] = { "wbwa", "wtna", NULL };
+
+
+/* WBWA: the write dirties the block (or the sectors written). */
+static void
+cache_write_wbwa_hit(cache_generic_t *cache, mem_ref_t *mref, uint32_t set,
+        uint32_t way, uint32_t sectors)
+{
+    cache_tagstore_set_dirty(cache->tagstore, set, way, sectors);
+
+    return;
+}
+
+
+/* WBWA: write misses allocate. */
+static boolean
+cache_write_wbwa_miss(cache_generic_t *cache, mem_ref_t *mref)
+{
+    return FALSE;
+}
+
+
+/* Passes a write on to the next cache, if there's one, or to memory. */
+static void
+cache_write_through(cache_generic_t *cache, mem_ref_t *mref)
+{
+    mem_ref_t   write_ref;
+
+    if (cache->next_cache) {
+        memcpy(&write_ref, mref, sizeof(write_ref));
+        cache_evict_and_add_tag(cache->next_cache, &write_ref);
+    }
+
+    cache->stats.num_write_throughs += 1;
+    cache->stats.num_blk_mem_traffic += 1;
+    cache->stats.num_wb_bytes += cache->blk_size;
+
+    return;
+}
+
+
+/* WTNA: the block stays clean; the write goes through. */
+static void
+cache_write_wtna_hit(cache_generic_t *cache, mem_ref_t *mref, uint32_t set,
+        uint32_t way, uint32_t sectors)
+{
+    cache_write_through(cache, mref);
+
+    return;
+}
+
+
+/*
+ * WTNA: nothing is filled and the write goes through. The core doesn't
+ * wait for it; it retires as an L1 hit would.
+ */
+static boolean
+cache_write_wtna_miss(cache_generic_t *cache, mem_ref_t *mref)
+{
+    if (CACHE_TIMING_IS_DEMAND(cache, mref))
+        g_cache_ref_src = CACHE_TIMING_SRC_L1;
+
+    cache->stats.num_write_misses += 1;
+    cache_write_through(cache, mref);
+
+    return TRUE;
+}
+
+
+/* Indexed by CACHE_WRITE_PLCY_* */
+static const cache_write_ops_t g_cache_write_ops[] = {
+    { cache_write_wbwa_hit, cache_write_wbwa_miss },
+    { cache_write_wtna_hit, cache_write_wtna_miss },
+};
+
+
+/***************************************************************************
+ * Name:    cache_write_init
+ *
+ * Desc:    Binds every cache to its write policy, as per --<lvl>-write=.
+ *          A WTNA L1 can't have a VC, whose swaps carry dirty bits, nor
+ *          other cores, as its write misses would leave their copies be.
+ *          WTNA can't be used with sectors, whose fills are per write, nor
+ *          with an exclusive L2, which mustn't see writes of blocks that
+ *          are in L1. Must be called after the sectors are set up.
+ *
+ * Params:  None
+ *
+ * Returns: cache_rv
+ *  CACHE_RV_OK on success
+ *  CACHE_RV_ERR on an unsupported configuration
+ **************************************************************************/
+cache_rv
+cache_write_init(void)
+{
+    uint32_t        core = 0;
+    cache_generic_t *l1 = cache_util_get_l1(0);
+    cache_generic_t *l2 = cache_util_get_l2();
+    boolean         l1_wtna = FALSE;
+    boolean         l2_wtna = FALSE;
+
+    l1_wtna = (CACHE_WRITE_PLCY_WTNA ==
+            g_cache_opts.level[CACHE_OPTS_L1].write_plcy);
+    l2_wtna = (CACHE_WRITE_PLCY_WTNA ==
+            g_cache_opts.level[CACHE_OPTS_L2].write_plcy);
+
+    if ((l2_wtna) && (!cache_util_is_l2_present())) {
+        dprint("Error: --l2-write needs an L2 cache.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if ((l1_wtna) && ((cache_util_is_victim_present()) ||
+                (g_num_cores > 1))) {
+        dprint("Error: --l1-write=wtna can't be used with a victim cache "
+                "or more than one core.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if (((l1_wtna) && (l1->num_sectors > 1)) ||
+            ((l2_wtna) && (l2->num_sectors > 1))) {
+        dprint("Error: WTNA caches can't be sectored.\n");
+        return CACHE_RV_ERR;
+    }
+
+    if (((l1_wtna) || (l2_wtna)) && (CACHE_INCL_EXCLUSIVE == g_cache_incl)) {
+        dprint("Error: WTNA caches can't be used with "
+                "--inclusion=exclusive.\n");
+        return CACHE_RV_ERR;
+    }
+
+    for (core = 0; core < g_num_cores; ++core) {
+        l1 = cache_util_get_l1(core);
+        l1->write = &g_cache_write_ops[l1->write_plcy];
+        if (cache_util_is_victim_present()) {
+            cache_util_get_vc(core)->write =
+                &g_cache_write_ops[CACHE_WRITE_PLCY_WBWA];
+        }
+    }
+    if (cache_util_is_l2_present())
+        l2->write = &g_cache_write_ops[l2->write_plcy];
+
+    return CACHE_RV_OK;
+}
@@ -0,0 +1,44 @@
+/*
+ * ECE 521 - Computer Design Techniques, Fall 2014
+ * Project 1B - L1, victim & L2 cache implementation.
+ *
+ * This module contains the write policy interface. Every cache is bound
+ * to one policy at init and the cache core calls its hooks for writes
+ * only, so reads and the choice of policy cost nothing per reference.
+ *
+ *      wbwa:   write-back, write-allocate; writes dirty the block and a
+ *              write miss fills it like a read miss (default)
+ *      wtna:   write-through, no-write-allocate; every write goes on to
+ *              the next level or memory, and a write miss fills nothing
+ *
+ * Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+ */
+
+#ifndef CACHE_WRITE_H_
+#define CACHE_WRITE_H_
+
+#include <stdint.h>
+#include "cache.h"
+
+/* Write policy operations; one instance per policy */
+typedef struct cache_write_ops__ {
+    /* A write found its block in the way, or just filled it. */
+    void        (*on_hit)(cache_generic_t *cache, mem_ref_t *mref,
+                    uint32_t set, uint32_t way, uint32_t sectors);
+    /*
+     * A write missed. Returns TRUE if the policy took care of it and
+     * nothing is to be filled; FALSE to fill the block as for a read.
+     */
+    boolean     (*on_miss)(cache_generic_t *cache, mem_ref_t *mref);
+} cache_write_ops_t;
+
+
+/* Externs */
+extern const char       *g_cache_write_names[];
+
+
+/* Function declarations */
+cache_rv
+cache_write_init(void);
+
+#endif /* CACHE_WRITE_H_ */
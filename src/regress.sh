@@ -0,0 +1,194 @@
+#!/bin/bash
+#
+# ECE 521 - Computer Design Techniques, Fall 2014
+# Project 1B - Victim Cache and L2 Cache Simulator
+#
+# Shell script to regression test the simulator; run by "make regress". It
+# runs every reference configuration in parallel and compares the outputs
+# with the golden ones (docs/Validation*_PartB.txt), ignoring case and white
+# space like run_diffs.sh does. Every case is reported with its wall time,
+# and a failing case with the lines that differ from the golden output.
+#
+# With REGRESS_REF set to another build of sim_cache (eg. the one before a
+# change), the configurations of run_runs.sh are run as well, and compared
+# with the outputs of that build, so a rewrite can be checked bit exact over
+# more than the golden cases.
+#
+# Environment:
+#   REGRESS_JOBS    cases run at once (default # of CPUs)
+#   REGRESS_OPTS    options for every run; must not change the results,
+#                   eg. "--hugepages=thp" or "--arena-align=4096"
+#   REGRESS_REF     reference sim_cache for the run_runs.sh configurations
+#   REGRESS_LINES   differing lines shown per failing case (default 5)
+#
+# Exit status is 0 if every case passes, 1 otherwise.
+#
+# Author: Aravindhan Dhanasekaran <adhanas@ncsu.edu>
+#
+
+
+NUM_PARAMS=0
+SIM=$(pwd)/sim_cache
+TRACE_DIR=../docs
+RUN_DIR=$(pwd)/regress_runs
+REGRESS_JOBS=${REGRESS_JOBS:-$(nproc)}
+REGRESS_LINES=${REGRESS_LINES:-5}
+
+# Golden cases: <name> <golden output> <configuration>
+GOLDEN=(
+    "golden_6   Validation6_PartB.txt   32 2048 4 0 4096 8 gcc_trace.txt"
+    "golden_7   Validation7_PartB.txt   16 1024 8 0 8192 4 go_trace.txt"
+    "golden_8   Validation8_PartB.txt   32 1024 8 256 0 0 perl_trace.txt"
+    "golden_9   Validation9_PartB.txt   128 1024 2 1024 4096 4 gcc_trace.txt"
+    "golden_10  Validation10_PartB.txt  64 8192 2 1024 16384 4 perl_trace.txt"
+)
+
+# Reference build cases (run_runs.sh): <name> <configuration>
+REFERENCE=(
+    "vortex_6   32 2048 4 0 4096 8 vortex_trace.txt"
+    "vortex_7   16 1024 8 0 8192 4 vortex_trace.txt"
+    "vortex_8   32 1024 8 256 0 0 vortex_trace.txt"
+    "vortex_9   128 1024 2 1024 4096 4 vortex_trace.txt"
+    "vortex_10  64 8192 2 1024 16384 4 vortex_trace.txt"
+    "l1l2_6     32 2048 4 0 4096 8 gcc_trace.txt"
+    "l1l2_7     16 1024 8 0 8192 4 go_trace.txt"
+    "l1l2_8     32 1024 8 0 2048 4 perl_trace.txt"
+    "l1l2_9     128 1024 2 0 4096 4 gcc_trace.txt"
+    "l1l2_10    64 8192 2 0 16384 4 perl_trace.txt"
+    "vc_6       32 2048 4 512 0 0 gcc_trace.txt"
+    "vc_7       16 1024 8 128 0 0 go_trace.txt"
+    "vc_8       32 1024 8 256 0 0 perl_trace.txt"
+    "vc_9       128 1024 2 1024 0 0 gcc_trace.txt"
+    "vc_10      64 8192 2 1024 0 0 perl_trace.txt"
+    "all_6      32 2048 4 512 4096 8 gcc_trace.txt"
+    "all_7      16 1024 8 128 8192 4 go_trace.txt"
+    "all_8      32 1024 8 256 2048 4 perl_trace.txt"
+    "all_9      128 1024 2 1024 4096 4 gcc_trace.txt"
+    "all_10     64 8192 2 1024 16384 4 perl_trace.txt"
+)
+
+
+function print_usage()
+{
+    echo "Usage: $0"
+    echo "Example: REGRESS_REF=/tmp/sim_cache_old REGRESS_JOBS=4 $0"
+}
+
+
+# Writes the lines two outputs differ in, as diff -iw sees them:
+# <expected> <actual> <# of lines to show>
+function cmp_lines()
+{
+    awk -v max=$3 '
+        function norm(s) { s = tolower(s); gsub(/[ \t]+/, "", s); return s; }
+        NR == FNR { want[FNR] = $0; next; }
+        { got[FNR] = $0; n = FNR; }
+        END {
+            if (NR - n > n)
+                n = NR - n;
+            for (i = 1; i <= n; ++i) {
+                if (norm(want[i]) == norm(got[i]))
+                    continue;
+                if (++bad <= max) {
+                    printf("    line %u:\n", i);
+                    printf("        expected: %s\n",
+                        ((i in want) ? want[i] : "<none>"));
+                    printf("        actual:   %s\n",
+                        ((i in got) ? got[i] : "<none>"));
+                }
+            }
+            if (bad > max)
+                printf("    ... %u more lines differ\n", (bad - max));
+            exit(bad ? 1 : 0);
+        }' $1 $2
+}
+
+
+# Runs a case and records its result: <name> <expected output> <config>;
+# the expected output "-" means that of REGRESS_REF.
+function run_case()
+{
+    local name=$1
+    local expected=$2
+    local start end status
+
+    shift 2
+    if [ "$expected" == "-" ]; then
+        expected=$RUN_DIR/$name.ref
+        $REGRESS_REF $REGRESS_OPTS "$@" > $expected 2>&1
+    fi
+
+    start=$(date +%s%N)
+    $SIM $REGRESS_OPTS "$@" > $RUN_DIR/$name.out 2>&1
+    end=$(date +%s%N)
+
+    if cmp_lines $expected $RUN_DIR/$name.out $REGRESS_LINES \
+            > $RUN_DIR/$name.diff; then
+        status=PASS
+    else
+        status=FAIL
+    fi
+    echo "$status $(( end - start ))" > $RUN_DIR/$name.res
+}
+
+
+# Starts a case once fewer than REGRESS_JOBS are running.
+function start_case()
+{
+    while [ $(jobs -rp | wc -l) -ge $REGRESS_JOBS ]; do
+        wait -n
+    done
+    run_case "$@" &
+}
+
+
+function run_regress()
+{
+    local entry name status ns fails=0
+    local names=()
+    local start=$(date +%s%N)
+
+    rm -rf $RUN_DIR
+    mkdir -p $RUN_DIR
+    cd $TRACE_DIR
+
+    for entry in "${GOLDEN[@]}"; do
+        set -- $entry
+        names+=($1)
+        start_case $1 $2 ${@:3}
+    done
+
+    if [ -n "$REGRESS_REF" ]; then
+        for entry in "${REFERENCE[@]}"; do
+            set -- $entry
+            names+=($1)
+            start_case $1 - ${@:2}
+        done
+    fi
+    wait
+
+    for name in ${names[@]}; do
+        read status ns < $RUN_DIR/$name.res
+        awk -v status=$status -v name=$name -v ns=$ns 'BEGIN {
+            printf("%s  %-10s %8.3fs\n", status, name, (ns / 1e9)); }'
+        if [ "$status" != "PASS" ]; then
+            cat $RUN_DIR/$name.diff
+            fails=$(( fails + 1 ))
+        fi
+    done
+
+    ns=$(( $(date +%s%N) - start ))
+    awk -v cases=${#names[@]} -v fails=$fails -v ns=$ns 'BEGIN {
+        printf("%u cases, %u failed, %.3fs wall\n", cases, fails,
+            (ns / 1e9)); }'
+
+    [ $fails -eq 0 ]
+}
+
+
+if [ $# -ne $NUM_PARAMS ]; then
+    print_usage
+    exit 1
+fi
+
+run_regress